@@ -1,6 +1,6 @@
 #include "common.h"
 #include "mem.h"
-#include "hash.h"
+#include "kmer.h"
 
 
 /*********************************** DECLARATIONS ************************************/
@@ -88,6 +88,13 @@ void match_add( match **old_ppt, match **new_ppt )
     match *old = *old_ppt;
     match *new = *new_ppt;
 
+    if ( old == NULL )
+    {
+        *old_ppt = new;
+
+        return;
+    }
+
     new->next = old->next;
     old->next = new;
 }
@@ -195,91 +202,41 @@ void list_print( list *list_pt )
 }
 
 
-void seq_index( hash **index_ppt, char *seq, unsigned int seq_beg, unsigned int seq_end, unsigned int word_size )
+void seq_index( kmer_index **index_ppt, char *seq, unsigned int seq_beg, unsigned int seq_end, unsigned int word_size )
 {
-    hash         *index = *index_ppt;
-    unsigned int  i     = 0;
-    char         *word  = NULL;
-    list         *old   = NULL;
-    list         *new   = NULL;
+    /* Words are indexed as 2 bit k-mer codes, so matching is case */
+    /* insensitive - soft-masked words match - like match_expand, and */
+    /* words with N's or other ambiguity codes are not indexed. */
 
     assert( 0 <= seq_beg );
     assert( seq_beg < seq_end );
     assert( word_size > 0 );
 
-    word = mem_get_zero( sizeof( char ) * word_size + 1 );
-
-    for ( i = seq_beg; i < seq_end - word_size + 2; i++ )
-    {
-        memcpy( word, &seq[ i ], word_size );
-
-        new = list_new();
-
-        new->val = i;
-
-        if ( ( old = hash_get( index, word ) ) != NULL ) {
-            list_add( &old, &new );
-        } else {
-            hash_add( index, word, new );
-        }
-    }
-
-    free( word );
+    *index_ppt = kmer_index_new( seq, seq_beg, seq_end + 1, word_size );
 }
 
 
-void index_print( hash *index )
-{
-    hash_elem *bucket   = NULL;
-    list      *pos_list = NULL;
-    list      *node     = NULL;
-    size_t     i        = 0;
-
-    printf( "\ntable_size: %zu mask: %zu elem_count: %zu\n", index->table_size, index->mask, index->nmemb );
-
-    for ( i = 0; i < index->table_size; i++ )
-    {
-        bucket = index->table[ i ];
-
-        while ( bucket != NULL  )
-        {
-            printf( "i: %zu   key: %s   val: ", i, bucket->key );
-
-            pos_list = bucket->val;
-
-            for ( node = pos_list; node != NULL; node = node->next ) {
-                printf( "%d,", node->val );
-            }
-
-            printf( "\n" );
-
-            bucket = bucket->next;
-        }
-    }
-}
-
-
-unsigned int matches_find_s( match **matches_ppt, hash *index, search_space *ss, unsigned int word_size )
+unsigned int matches_find_s( match **matches_ppt, kmer_index *index, search_space *ss, unsigned int word_size )
 {
     match        *matches     = *matches_ppt;
-    unsigned int  s_pos       = 0;
     unsigned int  match_count = 0;
-    char         *word        = NULL;
-    list         *pos_list    = NULL;
-    list         *node        = NULL;
+    kmer_iter     iter;
+    uint64_t      word        = 0;
+    size_t        s_pos       = 0;
+    uint         *postings    = NULL;
+    size_t        count       = 0;
+    size_t        i           = 0;
     match        *new         = NULL;
 
-    word = mem_get_zero( sizeof( char ) * word_size + 1 );
+    kmer_iter_init( &iter, ss->s_seq, ss->s_beg, ss->s_end + 1, word_size );
 
-    for ( s_pos = ss->s_beg; s_pos < ss->s_end - word_size + 2; s_pos++ )
+    while ( kmer_iter_next( &iter, &word, &s_pos ) )
     {
-        memcpy( word, &ss->s_seq[ s_pos ], word_size );
-
-        if ( ( pos_list = hash_get( index, word ) ) != NULL )
+        if ( ( postings = kmer_index_get( index, word, &count ) ) != NULL )
         {
-            for ( node = pos_list; node != NULL; node = node->next )
+            for ( i = 0; i < count; i++ )
             {
-                new = match_new( node->val, s_pos, word_size );
+                new = match_new( postings[ i ], s_pos, word_size );
 
                 if ( ! match_redundant( matches, new ) )
                 {
@@ -289,16 +246,15 @@ unsigned int matches_find_s( match **matches_ppt, hash *index, search_space *ss,
 
                     match_count++;
                 }
+                else
+                {
+                    free( new );
+                }
             }
         }
     }
 
-    printf( "her\n" ); // DEBUG
-    matches_print( matches );
-    index_print( index );
-
-
-    free( word ); 
+    *matches_ppt = matches;
 
     return match_count;
 }
@@ -307,7 +263,7 @@ unsigned int matches_find_s( match **matches_ppt, hash *index, search_space *ss,
 unsigned int matches_find( match **matches_ppt, search_space *ss, unsigned int word_size )
 {
     match        *matches     = *matches_ppt;
-    hash         *index       = NULL;
+    kmer_index   *index       = NULL;
     unsigned int  match_count = 0;
 
     assert( word_size > 0 );
@@ -325,7 +281,9 @@ unsigned int matches_find( match **matches_ppt, search_space *ss, unsigned int w
         // match_count = matches_find_q( &matches, index, q_seq, s_seq, q_beg, q_end, word_size );
     }
 
-    // index_destroy( index );
+    kmer_index_destroy( &index );
+
+    *matches_ppt = matches;
 
     return match_count;
 }
@@ -527,19 +485,29 @@ void test_seq_index()
     unsigned int  seq_beg   = 0;
     unsigned int  seq_end   = strlen( seq ) - 1;
     unsigned int  word_size = 2;
-    hash         *index     = NULL;
-    unsigned int  size      = 16;
-    list         *node      = NULL;
-
-    index = hash_new( size );
+    kmer_index   *index     = NULL;
+    uint64_t      word      = 0;
+    uint         *postings  = NULL;
+    size_t        count     = 0;
 
     seq_index( &index, seq, seq_beg, seq_end, word_size ); 
 
-//    index_print( index );
+    assert( kmer_encode( "GA", word_size, &word ) );
+
+    postings = kmer_index_get( index, word, &count );
 
-    node = hash_get( index, "GA" );
+    assert( count == 1 );
+    assert( postings[ 0 ] == 3 );
 
-    assert( node->val == 3 );
+    assert( kmer_encode( "AT", word_size, &word ) );
+
+    postings = kmer_index_get( index, word, &count );
+
+    assert( count == 2 );
+    assert( postings[ 0 ] == 0 );
+    assert( postings[ 1 ] == 4 );
+
+    kmer_index_destroy( &index );
 
     fprintf( stderr, "done.\n" );
 }
@@ -553,19 +521,18 @@ void test_matches_find_s()
     unsigned int  word_size   = 2;
     unsigned int  match_count = 0;
     match        *matches     = NULL;
-    hash         *index       = NULL;
-    unsigned int  size        = 16;
+    kmer_index   *index       = NULL;
 
     ss      = search_space_new( "ATCG", "ATCG", 0, 0, 3, 3 );
 //    matches = match_new( 0, 0, 0 ); // FIXME: dummy match
-    matches = mem_get( sizeof( match ) );
-
-    index = hash_new( size );
+    matches = mem_get_zero( sizeof( match ) );
 
     seq_index( &index, ss->q_seq, ss->q_beg, ss->q_end, word_size ); 
 
     match_count = matches_find_s( &matches, index, ss, word_size );
 
+    kmer_index_destroy( &index );
+
     fprintf( stderr, "done.\n" );
 }
 
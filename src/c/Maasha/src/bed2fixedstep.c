@@ -1,9 +1,12 @@
 #include "common.h"
+#include "mem.h"
+#include "filesys.h"
+#include "list.h"
+#include "ucsc.h"
 #include "barray.h"
+#include "wig.h"
 
-#define BUFFER_SIZE 1024
-#define BED_CHR_MAX 16
-#define BED_QID_MAX 256
+#define BED_COLS    4
 #define BARRAY_SIZE ( 1 << 16 )
 
 
@@ -43,51 +46,69 @@ long get_score( char *str )
 
 int main( int argc, char *argv[] )
 {
-    char       buffer[ BUFFER_SIZE ];
-    char       chr[ BED_CHR_MAX ];
-    char       q_id[ BED_QID_MAX ];
-    size_t     beg   = 0;
-    size_t     end   = 0;
-    uint       score = 0;
-    size_t     pos   = 0;
-    size_t     i     = 0;
-    barray    *ba    = barray_new( BARRAY_SIZE );
+    file_buffer *buffer = NULL;
+    bed_entry   *entry  = NULL;
+    char        *chr    = NULL;
+    size_t       beg    = 0;
+    size_t       end    = 0;
+    uint         score  = 0;
+    size_t       pos    = 0;
+    size_t       i      = 0;
+    barray      *ba     = barray_new( BARRAY_SIZE );
+    wig_writer  *writer = NULL;
 
     if ( isatty( fileno( stdin ) ) ) {
         usage();
     }
+
+    entry = bed_entry_new( BED_COLS );
+
+    buffer_new( "/dev/stdin", &buffer, 0 );
     
-    while ( fgets( buffer, sizeof( buffer ), stdin ) )
+    while ( bed_entry_get( buffer, &entry ) )
     {
-//        printf( "BUFFER: %s\n", buffer );
-
-        if ( sscanf( buffer, "%s\t%zu\t%zu\t%s", chr, &beg, &end, q_id ) == 4 )
+        if ( entry->cols == BED_COLS )
         {
-//            printf( "chr: %s   beg: %zu   end: %zu   q_id: %s\n", chr, beg, end, q_id );
+//            printf( "chr: %s   beg: %u   end: %u   q_id: %s\n", entry->chr, entry->chr_beg, entry->chr_end, entry->q_id );
 
-            score = ( uint ) get_score( q_id );
+            if ( chr == NULL || strcmp( chr, entry->chr ) != 0 )
+            {
+                mem_free( &chr );
 
-            barray_interval_inc( ba, beg, end - 1, score );
+                chr = mem_clone( entry->chr, strlen( entry->chr ) + 1 );
+            }
+
+            score = ( uint ) get_score( entry->q_id );
+
+            barray_interval_inc( ba, entry->chr_beg, entry->chr_end - 1, score );
         }
     }
 
+    buffer_destroy( &buffer );
+
+    bed_entry_destroy( entry );
+
 //    barray_print( ba );
 
     pos = 0;
     beg = 0;
     end = 0;
 
+    writer = wig_writer_new( stdout, WIG_FIXEDSTEP, 0 );
+
     while ( barray_interval_scan( ba, &pos, &beg, &end ) )
     {
 //        printf( "chr: %s   pos: %zu   beg: %zu   end: %zu\n", chr, pos, beg, end );
 
-        printf( "fixedStep chrom=%s start=%zu step=1\n", chr, beg + 1 );
-
         for ( i = beg; i <= end; i++ ) {
-            printf( "%u\n", ba->array[ i ] );
+            wig_writer_put( writer, chr, i, ba->array[ i ] );
         }
     }
 
+    wig_writer_destroy( &writer );
+
+    mem_free( &chr );
+
     return EXIT_SUCCESS;
 }
 
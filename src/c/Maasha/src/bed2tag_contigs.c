@@ -1,12 +1,11 @@
 #include "common.h"
 #include "mem.h"
+#include "filesys.h"
 #include "list.h"
 #include "ucsc.h"
-#include "hash.h"
 #include "barray.h"
 
 #define BED_COLS    5
-#define HASH_SIZE   8
 #define BARRAY_SIZE ( 1 << 16 )
 
 
@@ -66,37 +65,51 @@ long get_score( char *str )
 
 int main( int argc, char *argv[] )
 {
-    bed_entry *entry    = NULL;
-    hash      *chr_hash = NULL;
-    hash_elem *bucket   = NULL;
-    barray    *ba       = NULL;
-    uint       score    = 0;
-    size_t     i        = 0;
-    char      *chr      = NULL;
-    size_t     beg      = 0;
-    size_t     end      = 0;
-    size_t     pos      = 0;
-    uint       max      = 0;
-    size_t     id       = 0;
-
-    entry    = bed_entry_new( BED_COLS );
-    chr_hash = hash_new( HASH_SIZE );
+    file_buffer  *buffer    = NULL;
+    bed_entry    *entry     = NULL;
+    bed_table    *chr_table = NULL;
+    barray      **bas       = NULL;
+    barray       *ba        = NULL;
+    uint          score     = 0;
+    uint          chr_id    = 0;
+    size_t        chr_max   = 0;
+    size_t        i         = 0;
+    char         *chr       = NULL;
+    size_t        beg       = 0;
+    size_t        end       = 0;
+    size_t        pos       = 0;
+    uint          max       = 0;
+    size_t        id        = 0;
+
+    entry     = bed_entry_new( BED_COLS );
+    chr_table = bed_table_new();
 
     if ( isatty( fileno( stdin ) ) ) {
         usage();
     }
+
+    buffer_new( "/dev/stdin", &buffer, 0 );
     
-    while ( ( bed_entry_get( stdin, &entry ) ) )
+    while ( ( bed_entry_get( buffer, &entry ) ) )
     {
+        if ( entry->cols < BED_COLS ) {
+            continue;
+        }
+
 //        bed_entry_put( entry, entry->cols );
 
-        ba = ( barray * ) hash_get( chr_hash, entry->chr );
+        /* The BED table is only used as string pool for chromosome names. */
+        chr_id = bed_table_chr_id( chr_table, entry->chr );
 
-        if ( ba == NULL )
+        if ( chr_id >= chr_max )
         {
-            ba = barray_new( BARRAY_SIZE );
+            bas = mem_resize_zero( bas, chr_max * sizeof( barray * ), chr_table->chr_max * sizeof( barray * ) );
 
-            hash_add( chr_hash, entry->chr, ba );
+            chr_max = chr_table->chr_max;
+        }
+
+        if ( ( ba = bas[ chr_id ] ) == NULL ) {
+            ba = bas[ chr_id ] = barray_new( BARRAY_SIZE );
         }
 
         score = ( uint ) get_score( entry->q_id );
@@ -106,29 +119,32 @@ int main( int argc, char *argv[] )
         }
     }
 
+    buffer_destroy( &buffer );
+
+    bed_entry_destroy( entry );
+
 //    barray_print( ba );
 
-    for ( i = 0; i < chr_hash->table_size; i++ )
+    for ( i = 0; i < chr_table->chr_count; i++ )
     {
-        for ( bucket = chr_hash->table[ i ]; bucket != NULL; bucket = bucket->next )
-        {
-            chr = bucket->key;
-            ba  = ( barray * ) bucket->val;
-        
-            pos = 0;
+        chr = chr_table->chrs[ i ];
+        ba  = bas[ i ];
+    
+        pos = 0;
 
-            while ( barray_interval_scan( ba, &pos, &beg, &end ) )
-            {
-                max = barray_interval_max( ba, beg, end );
+        while ( barray_interval_scan( ba, &pos, &beg, &end ) )
+        {
+            max = barray_interval_max( ba, beg, end );
 
-//                printf( "chr: %s   pos: %zu   beg: %zu   end: %zu   max: %hd\n", chr, pos, beg, end, max );
+//            printf( "chr: %s   pos: %zu   beg: %zu   end: %zu   max: %hd\n", chr, pos, beg, end, max );
 
-                printf( "%s\t%zu\t%zu\t%s_%08zu\t%u\n", chr, beg, end + 1, chr, id, ( uint ) max );
+            printf( "%s\t%zu\t%zu\t%s_%08zu\t%u\n", chr, beg, end + 1, chr, id, ( uint ) max );
 
-                id++;
-            }
+            id++;
         }
     }
 
+    bed_table_destroy( &chr_table );
+
     return EXIT_SUCCESS;
 }
@@ -1,7 +1,10 @@
 /* Martin Asser Hansen (mail@maasha.dk) Copyright (C) 2008 - All right reserved */
 
+#include <sys/stat.h>
 #include "common.h"
+#include "filesys.h"
 #include "list.h"
+#include "sort.h"
 #include "ucsc.h"
 
 static void usage()
@@ -19,9 +22,12 @@ static void usage()
         "                               # 4: strand AND chr_beg.\n"
         "   [-c <int> | --cols <int>]   # Number of columns to read (default all).\n"
         "   [-d <dir> | --dir <dir> ]   # Directory to use for file bound sorting.\n"
+        "   [-m <int> | --mem <int> ]   # Memory limit in MB for file bound sorting (default 1024).\n"
+        "   [-t <int> | --threads <int>] # Number of sorting threads (default 1).\n"
         "\n"
         "Examples:\n"
         "   bed_sort test.bed > test.bed.sort\n"
+        "   bed_sort -d /scratch -m 512 big.bed > big.bed.sort\n"
         "\n"
         );
 
@@ -30,34 +36,39 @@ static void usage()
 
 
 static struct option longopts[] = {
-    { "sort",  required_argument, NULL, 's' },
-    { "cols",  required_argument, NULL, 'c' },
-    { "dir",   required_argument, NULL, 'd' },
-    { NULL,    0,                 NULL,  0  }
+    { "sort",    required_argument, NULL, 's' },
+    { "cols",    required_argument, NULL, 'c' },
+    { "dir",     required_argument, NULL, 'd' },
+    { "mem",     required_argument, NULL, 'm' },
+    { "threads", required_argument, NULL, 't' },
+    { NULL,      0,                 NULL,  0  }
 };
 
 
 int main( int argc, char *argv[] )
 {
-    int      opt     = 0;
-    int      sort    = 1;
-    int      cols    = 0;
-    char    *dir     = NULL;
-    char    *file    = NULL;
-    list_sl *entries = NULL;
-
-    while ( ( opt = getopt_long( argc, argv, "n:l", longopts, NULL ) ) != -1 )
+    int        opt     = 0;
+    int        sort    = 1;
+    int        cols    = 0;
+    long       mem     = 1024;
+    int        threads = 1;
+    char      *dir     = NULL;
+    char      *file    = NULL;
+    bed_table *table   = NULL;
+    struct stat st;
+
+    while ( ( opt = getopt_long( argc, argv, "s:c:d:m:t:", longopts, NULL ) ) != -1 )
     {
         switch ( opt ) {
-            case 's': sort = strtol( optarg, NULL, 0 ); break;
-            case 'c': cols = strtol( optarg, NULL, 0 ); break;
-            case 'd': dir  = optarg;                    break;          
-            default:                                    break;
+            case 's': sort    = strtol( optarg, NULL, 0 ); break;
+            case 'c': cols    = strtol( optarg, NULL, 0 ); break;
+            case 'd': dir     = optarg;                    break;          
+            case 'm': mem     = strtol( optarg, NULL, 0 ); break;
+            case 't': threads = strtol( optarg, NULL, 0 ); break;
+            default:                                       break;
         }
     }
 
-    fprintf( stderr, "sort: %d  cols: %d   dir: %s\n", sort, cols, dir );
-
     argc -= optind;
     argv += optind;
 
@@ -67,9 +78,9 @@ int main( int argc, char *argv[] )
         abort();
     }
 
-    if ( cols != 0 && cols != 3 && cols != 4 && cols != 5 && cols != 6 && cols != 12 )
+    if ( cols != 0 && ( cols < BED_COLS_MIN || cols > BED_COLS_MAX ) )
     {
-        fprintf( stderr, "ERROR: argument to --cols must be 3, 4, 5, 6 or 12 - not: %d\n", cols );
+        fprintf( stderr, "ERROR: argument to --cols must be between %d and %d - not: %d\n", BED_COLS_MIN, BED_COLS_MAX, cols );
         abort();
     }
 
@@ -79,30 +90,44 @@ int main( int argc, char *argv[] )
         abort();
     }
 
-    if ( dir != NULL )
+    if ( dir != NULL && ( stat( dir, &st ) == -1 || ! S_ISDIR( st.st_mode ) ) )
     {
         fprintf( stderr, "ERROR: directory: %s does not exists\n", dir );
         abort();
     }
 
+    if ( mem < 1 )
+    {
+        fprintf( stderr, "ERROR: argument to --mem must be positive - not: %ld\n", mem );
+        abort();
+    }
+
+    if ( threads < 1 || threads > SORT_THREADS_MAX )
+    {
+        fprintf( stderr, "ERROR: argument to --threads must be between 1 and %d - not: %d\n", SORT_THREADS_MAX, threads );
+        abort();
+    }
+
     if ( argc < 1 ) {
         usage();
     }
 
     file = argv[ argc - 1 ];
 
-    entries = bed_entries_get( file, cols );
-
-    switch ( sort )
+    if ( dir != NULL )
     {
-        case 1: list_sl_sort( &entries, cmp_bed_sort_chr_beg );        break;
-        case 2: list_sl_sort( &entries, cmp_bed_sort_chr_strand_beg ); break;
-        case 3: list_sl_sort( &entries, cmp_bed_sort_beg );            break;
-        case 4: list_sl_sort( &entries, cmp_bed_sort_strand_beg );     break;
-        default: break;
+        bed_file_sort_external( file, cols, sort, dir, ( size_t ) mem * 1024 * 1024, threads );
     }
+    else
+    {
+        table = bed_table_get( file, cols );
+
+        bed_table_sort( table, sort, threads );
 
-    bed_entries_put( entries, cols );
+        bed_table_put( table, cols );
+
+        bed_table_destroy( &table );
+    }
 
     return EXIT_SUCCESS;
 }
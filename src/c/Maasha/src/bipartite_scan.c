@@ -1,11 +1,11 @@
 /* Martin Asser Hansen (mail@maasha.dk) Copyright (C) 2008 - All right reserved */
 
+#include <pthread.h>
 #include "common.h"
 #include "mem.h"
 #include "filesys.h"
 #include "seq.h"
 #include "fasta.h"
-#include "list.h"
 
 #define BLOCK_SIZE_NT     4                                /* one block holds 4 nucleotides. */
 #define BITS_IN_NT        2                                /* two bits holds 1 nucleotide. */
@@ -14,39 +14,67 @@
 #define BLOCK_MASK        ( ( BLOCK_SPACE_MAX << 1 ) - 1 ) /* mask for printing block space. */
 #define COUNT_ARRAY_NMEMB ( 1 << 30 )                      /* number of objects in the unsigned int count array. */
 #define CUTOFF            1                                /* minimum number of motifs in output. */
- 
-/* Structure that will hold one tetra nucleotide block. */
-struct _bitblock
+#define WINDOW_SIZE       ( BLOCK_SPACE_MAX + BLOCK_SIZE_NT + 1 ) /* number of blocks in a full window. */
+#define BLOCK_N           ( 1 << 8 )                       /* flag set in a packed block with any N's. */
+#define THREADS_MAX       64                               /* maximum number of scanning threads. */
+#define CHUNK_MIN         ( 1 << 20 )                      /* minimum number of windows per thread in a sequence. */
+
+/* Structure of a sliding window of tetra nucleotide blocks. Each block */
+/* is packed in a ushort with the binary encoded tetra nucleotide in the */
+/* low byte and BLOCK_N set if any N's. The blocks are kept in a circular */
+/* array where each block is stored twice - at slot and slot + WINDOW_SIZE */
+/* - so the window is always contiguous from the first block. */
+struct _window
+{
+    ushort blocks[ 2 * WINDOW_SIZE ];   /* Packed blocks. */
+    size_t beg;                         /* Slot of first block in window. */
+    size_t count;                       /* Number of blocks in window. */
+};
+
+typedef struct _window window;
+
+/* Structure of the chunk of a sequence scanned by one thread. A chunk */
+/* holds the windows with first blocks from beg to end, so the blocks */
+/* of the last windows overlap the next chunk. */
+struct _scan_job
 {
-    uchar bin;   /* Tetra nucleotide binary encoded. */
-    bool hasN;   /* Flag indicating any N's in the block. */
+    char   *seq;            /* Sequence. */
+    size_t  seq_len;        /* Sequence length. */
+    size_t  beg;            /* First block of first window in chunk. */
+    size_t  end;            /* First block of the window after the chunk. */
+    uint   *count_array;    /* Motif counts. */
+    uint   *output_array;   /* Position counts when rescanning - NULL when scanning. */
+    size_t  cutoff;         /* Minimum motif count when rescanning. */
+    bool    shared;         /* Flag indicating that the arrays are updated by other threads. */
 };
 
-typedef struct _bitblock bitblock;
+typedef struct _scan_job scan_job;
 
 /* Function declarations. */
 void      run_scan( int argc, char *argv[] );
 void      print_usage();
-void      scan_file( char *file, seq_entry *entry, uint *count_array );
-void      rescan_file( char *file, seq_entry *entry, uint *count_array, size_t cutoff );
+void      scan_file( char *file, seq_entry *entry, uint *count_array, int threads );
+void      rescan_file( char *file, seq_entry *entry, uint *count_array, size_t cutoff, int threads );
 uint     *count_array_new( size_t nmemb );
-void      scan_seq( char *seq, size_t seq_len, uint *count_array );
-void      rescan_seq( char *seq, size_t seq_len, uint *count_array, size_t cutoff );
-void      scan_list( list_sl *list, uint *count_array );
-void      rescan_list( list_sl *list, uint *count_array, size_t pos, size_t cutoff, uint *output_array );
-bitblock *bitblock_new();
+void      scan_seq( char *seq, size_t seq_len, uint *count_array, int threads );
+void      rescan_seq( char *seq, size_t seq_len, uint *count_array, size_t cutoff, int threads );
+void      scan_seq_threads( char *seq, size_t seq_len, uint *count_array, uint *output_array, size_t cutoff, int threads );
+void     *scan_chunk( void *arg );
+void      scan_window( ushort *blocks, size_t size, uint *count_array, bool shared );
+void      rescan_window( ushort *blocks, size_t size, uint *count_array, size_t pos, size_t cutoff, uint *output_array, bool shared );
+window   *window_new();
+void      window_push( window *win, ushort block );
+void      window_shift( window *win );
 uint      blocks2motif( uchar bin1, uchar bin2, ushort dist );
 void      count_array_print( uint *count_array, size_t nmemb, size_t cutoff );
-void      bitblock_list_print( list_sl *list );
-void      bitblock_print( bitblock *out );
 
 /* Unit test declarations. */
 static void run_tests();
 static void test_count_array_new();
-static void test_bitblock_new();
-static void test_bitblock_print();
-static void test_bitblock_list_print();
+static void test_window_new();
+static void test_window_push();
 static void test_scan_seq();
+static void test_scan_chunk();
 static void test_blocks2motif();
 
 
@@ -76,7 +104,12 @@ void print_usage()
 
     /* Print usage and exit if no files in argument. */
 
-    fprintf( stderr, "Usage: bipartite_scam <FASTA file(s)> > result.csv\n" );
+    fprintf( stderr,
+        "Usage: bipartite_scam [options] <FASTA file(s)> > result.csv\n"
+        "\n"
+        "Options:\n"
+        "   [-t <int> | --threads <int>] # number of scanning threads (Default 1).\n"
+    );
 
     exit( EXIT_SUCCESS );
 }
@@ -92,20 +125,45 @@ void run_scan( int argc, char *argv[] )
 
     char      *file        = NULL;
     int        i           = 0;
+    int        opt         = 0;
+    int        threads     = 1;
     seq_entry *entry       = NULL;
     uint      *count_array = NULL;
 //    size_t    new_nmemb    = 0;
 
+    static struct option longopts[] = {
+        { "threads", required_argument, NULL, 't' },
+        { NULL,      0,                 NULL,  0 }
+    };
+
+    while ( ( opt = getopt_long( argc, argv, "t:", longopts, NULL ) ) != -1 )
+    {
+        switch ( opt ) {
+            case 't': threads = strtol( optarg, NULL, 0 ); break;
+            default:  print_usage();                       break;
+        }
+    }
+
+    if ( threads < 1 || threads > THREADS_MAX )
+    {
+        fprintf( stderr, "ERROR: threads must be between 1 and %d - not %d\n", THREADS_MAX, threads );
+        abort();
+    }
+
+    if ( optind == argc ) {
+        print_usage();
+    }
+
     count_array = count_array_new( COUNT_ARRAY_NMEMB );
 
     entry = seq_new( MAX_SEQ_NAME, MAX_SEQ );
 
-    for ( i = 1; i < argc; i++ )
+    for ( i = optind; i < argc; i++ )
     {
         file = argv[ i ];
 
         fprintf( stderr, "Scanning file: %s\n", file );
-        scan_file( file, entry, count_array );
+        scan_file( file, entry, count_array, threads );
         fprintf( stderr, "done.\n" );
     }
 
@@ -113,10 +171,10 @@ void run_scan( int argc, char *argv[] )
 //    count_array_print( count_array, COUNT_ARRAY_NMEMB, CUTOFF );
 //    fprintf( stderr, "done.\n" );
 
-    file = argv[ 1 ];
+    file = argv[ optind ];
 
     fprintf( stderr, "Rescanning file: %s\n", file );
-    rescan_file( file, entry, count_array, CUTOFF );
+    rescan_file( file, entry, count_array, CUTOFF, threads );
     fprintf( stderr, "done.\n" );
 
     seq_destroy( entry );
@@ -141,162 +199,188 @@ uint *count_array_new( size_t nmemb )
 }
 
 
-void scan_file( char *file, seq_entry *entry, uint *count_array )
+void scan_file( char *file, seq_entry *entry, uint *count_array, int threads )
 {
     /* Martin A. Hansen, September 2008 */
     
     /* Scan all FASTA entries of a file. */
 
-    FILE *fp = read_open( file );
+    file_buffer *buffer = NULL;
+
+    buffer_new( file, &buffer, FASTA_BLOCK );
 
-    while ( fasta_get_entry( fp, &entry ) == TRUE )
+    while ( fasta_get_entry_buffer( buffer, &entry ) == TRUE )
     {
         fprintf( stderr, "   Scanning: %s (%zu nt) ... ", entry->seq_name, entry->seq_len );
     
-        scan_seq( entry->seq, entry->seq_len, count_array );
+        scan_seq( entry->seq, entry->seq_len, count_array, threads );
 
         fprintf( stderr, "done.\n" );
     }
 
-    close_stream( fp );
+    buffer_destroy( &buffer );
 }
 
 
-void rescan_file( char *file, seq_entry *entry, uint *count_array, size_t cutoff )
+void rescan_file( char *file, seq_entry *entry, uint *count_array, size_t cutoff, int threads )
 {
     /* Martin A. Hansen, September 2008 */
     
     /* Rescan all FASTA entries of a file. */
 
-    FILE *fp = read_open( file );
+    file_buffer *buffer = NULL;
 
-    while ( fasta_get_entry( fp, &entry ) == TRUE )
+    buffer_new( file, &buffer, FASTA_BLOCK );
+
+    while ( fasta_get_entry_buffer( buffer, &entry ) == TRUE )
     {
         fprintf( stderr, "   Rescanning: %s (%zu nt) ... ", entry->seq_name, entry->seq_len );
     
         printf( "SEQ_NAME: %s\n", entry->seq_name );
 
-        rescan_seq( entry->seq, entry->seq_len, count_array, cutoff );
+        rescan_seq( entry->seq, entry->seq_len, count_array, cutoff, threads );
 
         fprintf( stderr, "done.\n" );
     }
 
-    close_stream( fp );
+    buffer_destroy( &buffer );
 }
 
 
-void scan_seq( char *seq, size_t seq_len, uint *count_array )
+void scan_seq( char *seq, size_t seq_len, uint *count_array, int threads )
 {
     /* Martin A. Hansen, September 2008 */
 
-    /* Run a sliding window over a given sequence. The window */
-    /* consists of a list where new blocks of 4 nucleotides */
-    /* are pushed onto one end while at the same time old */
-    /* blocks are popped from the other end. The number of */
-    /* in the list is determined by the maximum seperator. */
-    /* Everytime we have a full window, the window is scanned */
-    /* for motifs. */
- 
-    bitblock *block      = NULL;
-    size_t    b_count    = 0;
-    ushort    n_count    = 0;
-    size_t    i          = 0;
-    uchar     bin        = 0;
-    bool      first_node = TRUE;
-    node_sl *new_node    = NULL;
-    node_sl *old_node    = NULL;
-    list_sl *list        = list_sl_new();
+    /* Scan a given sequence for bipartite motifs and add */
+    /* them to the count array. */
 
-    for ( i = 0; seq[ i ]; i++ )
-    {
-        bin <<= BITS_IN_NT;
+    scan_seq_threads( seq, seq_len, count_array, NULL, 0, threads );
+}
 
-        switch( seq[ i ] )
-        {
-            case 'A': case 'a': add_A( bin ); break;
-            case 'T': case 't': add_T( bin ); break;
-            case 'C': case 'c': add_C( bin ); break;
-            case 'G': case 'g': add_G( bin ); break;
-            default: n_count = BLOCK_SIZE_NT; break;
-        }
 
-        if ( i > BLOCK_SIZE_NT - 2 )
-        {
-            b_count++;
+void rescan_seq( char *seq, size_t seq_len, uint *count_array, size_t cutoff, int threads )
+{
+    /* Martin A. Hansen, September 2008 */
 
-            block      = bitblock_new();
-            block->bin = bin;
+    /* Rescan a given sequence for bipartite motifs and output */
+    /* for each position the sum of the counts of the motifs */
+    /* above the cutoff covering the position. */
 
-            if ( n_count > 0 )
-            {
-                 block->hasN = TRUE;
-                 n_count--;
-            }
+    size_t  i            = 0;
+    uint   *output_array = NULL;
 
-            new_node      = node_sl_new();
-            new_node->val = block;
+    output_array = mem_get_zero( sizeof( uint ) * ( seq_len + 1 ) );
 
-            if ( first_node ) {
-                list_sl_add_beg( &list, &new_node );
-            } else {
-                list_sl_add_after( &old_node, &new_node );
-            }
+    scan_seq_threads( seq, seq_len, count_array, output_array, cutoff, threads );
 
-            old_node = new_node;
+    for ( i = 0; i < seq_len; i++ ) {
+        printf( "%zu\t%u\n", i, output_array[ i ] );
+    }
 
-            first_node = FALSE;
+    free( output_array );
+}
 
-            if ( b_count > BLOCK_SPACE_MAX + BLOCK_SIZE_NT )
-            {
-                // bitblock_list_print( list );   /* DEBUG */
 
-                scan_list( list, count_array );
+void scan_seq_threads( char *seq, size_t seq_len, uint *count_array, uint *output_array, size_t cutoff, int threads )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Scan - or rescan if output_array is given - a sequence with a */
+    /* number of threads. The windows of the sequence are split in */
+    /* chunks of at least CHUNK_MIN windows, one per thread, and the */
+    /* arrays are updated with atomic operations if more than one. */
+
+    size_t     windows = 0;
+    size_t     chunk   = 0;
+    int        jobs    = 0;
+    int        t       = 0;
+    scan_job   job_array[ THREADS_MAX ];
+    pthread_t  thread_array[ THREADS_MAX ];
+
+    /* the number of full windows - the last block begins at seq_len - 1. */
+    if ( seq_len > WINDOW_SIZE + BLOCK_SIZE_NT - 2 ) {
+        windows = seq_len - ( WINDOW_SIZE + BLOCK_SIZE_NT - 2 );
+    }
 
-                mem_free( &list->first->val );
+    jobs = MIN( threads, windows / CHUNK_MIN );
 
-                list_sl_remove_beg( &list );
-            }
-        }
+    if ( jobs < 1 ) {
+        jobs = 1;
     }
 
-    /* if the list is shorter than BLOCK_SPACE_MAX + BLOCK_SIZE_NT */
-    if ( b_count <= BLOCK_SPACE_MAX + BLOCK_SIZE_NT )
+    chunk = ( windows + jobs - 1 ) / jobs;
+
+    for ( t = 0; t < jobs; t++ )
     {
-        // bitblock_list_print( list );  /* DEBUG */
+        job_array[ t ].seq          = seq;
+        job_array[ t ].seq_len      = seq_len;
+        job_array[ t ].beg          = MIN( t * chunk, windows );
+        job_array[ t ].end          = MIN( ( t + 1 ) * chunk, windows );
+        job_array[ t ].count_array  = count_array;
+        job_array[ t ].output_array = output_array;
+        job_array[ t ].cutoff       = cutoff;
+        job_array[ t ].shared       = ( jobs > 1 );
+    }
 
-        scan_list( list, count_array );
+    if ( jobs == 1 )
+    {
+        scan_chunk( &job_array[ 0 ] );
     }
+    else
+    {
+        for ( t = 0; t < jobs; t++ )
+        {
+            if ( pthread_create( &thread_array[ t ], NULL, scan_chunk, &job_array[ t ] ) != 0 )
+            {
+                fprintf( stderr, "ERROR: Could not create thread: %s\n", strerror( errno ) );
+                abort();
+            }
+        }
 
-    list_sl_destroy( &list );
+        for ( t = 0; t < jobs; t++ ) {
+            pthread_join( thread_array[ t ], NULL );
+        }
+    }
 }
 
 
-void rescan_seq( char *seq, size_t seq_len, uint *count_array, size_t cutoff )
+void *scan_chunk( void *arg )
 {
     /* Martin A. Hansen, September 2008 */
 
-    /* Run a sliding window over a given sequence. The window */
-    /* consists of a list where new blocks of 4 nucleotides */
-    /* are pushed onto one end while at the same time old */
-    /* blocks are popped from the other end. The number of */
-    /* in the list is determined by the maximum seperator. */
-    /* Everytime we have a full window, the window is scanned */
-    /* for motifs. */
+    /* Run a sliding window over a chunk of a sequence. The window */
+    /* consists of a circular array where new blocks of 4 */
+    /* nucleotides are pushed onto one end while at the same */
+    /* time old blocks are shifted from the other end. The */
+    /* number of blocks in the window is determined by the */
+    /* maximum seperator. Everytime we have a full window, the */
+    /* window is scanned for motifs. */
+
+    /* A chunk after the first starts reading 7 nucleotides before */
+    /* its first block, so the N flags of its blocks are the same */
+    /* as when reading the sequence from the beginning. A sequence */
+    /* without full windows is scanned once as a whole. */
  
-    bitblock *block      = NULL;
-    size_t    b_count    = 0;
+    scan_job *job        = ( scan_job * ) arg;
+    char     *seq        = job->seq;
+    window   *win        = NULL;
+    ushort    block      = 0;
     ushort    n_count    = 0;
+    size_t    beg        = 0;
+    size_t    end        = 0;
     size_t    i          = 0;
     uchar     bin        = 0;
-    bool      first_node = TRUE;
-    node_sl *new_node    = NULL;
-    node_sl *old_node    = NULL;
-    list_sl *list        = list_sl_new();
-    uint *output_array   = NULL;
 
-    output_array         = mem_get_zero( sizeof( uint ) * ( seq_len + 1 ) );
+    if ( job->beg > BLOCK_SIZE_NT ) {
+        beg = job->beg - BLOCK_SIZE_NT;
+    }
+
+    /* the last block of the last window of the chunk. */
+    end = MIN( job->end + WINDOW_SIZE + BLOCK_SIZE_NT - 2, job->seq_len );
+
+    win = window_new();
 
-    for ( i = 0; seq[ i ]; i++ )
+    for ( i = beg; i < end; i++ )
     {
         bin <<= BITS_IN_NT;
 
@@ -309,196 +393,181 @@ void rescan_seq( char *seq, size_t seq_len, uint *count_array, size_t cutoff )
             default: n_count = BLOCK_SIZE_NT; break;
         }
 
-        if ( i > BLOCK_SIZE_NT - 2 )
+        if ( i > beg + BLOCK_SIZE_NT - 2 )
         {
-            b_count++;
-
-            block      = bitblock_new();
-            block->bin = bin;
+            block = bin;
 
             if ( n_count > 0 )
             {
-                 block->hasN = TRUE;
+                 block |= BLOCK_N;
                  n_count--;
             }
 
-            new_node      = node_sl_new();
-            new_node->val = block;
-
-            if ( first_node ) {
-                list_sl_add_beg( &list, &new_node );
-            } else {
-                list_sl_add_after( &old_node, &new_node );
+            if ( i < job->beg + BLOCK_SIZE_NT - 1 ) {
+                continue;
             }
 
-            old_node = new_node;
+            window_push( win, block );
 
-            first_node = FALSE;
-
-            if ( b_count > BLOCK_SPACE_MAX + BLOCK_SIZE_NT )
+            if ( win->count == WINDOW_SIZE )
             {
-                // bitblock_list_print( list );   /* DEBUG */
-
-                rescan_list( list, count_array, i, cutoff, output_array );
-
-                mem_free( &list->first->val );
+                if ( job->output_array == NULL ) {
+                    scan_window( win->blocks + win->beg, win->count, job->count_array, job->shared );
+                } else {
+                    rescan_window( win->blocks + win->beg, win->count, job->count_array, i, job->cutoff, job->output_array, job->shared );
+                }
 
-                list_sl_remove_beg( &list );
+                window_shift( win );
             }
         }
     }
 
-    /* if the list is shorter than BLOCK_SPACE_MAX + BLOCK_SIZE_NT */
-    if ( b_count <= BLOCK_SPACE_MAX + BLOCK_SIZE_NT )
+    /* if the sequence is shorter than a full window */
+    if ( job->end == 0 )
     {
-        // bitblock_list_print( list );  /* DEBUG */
-
-        rescan_list( list, count_array, i, cutoff, output_array );
+        if ( job->output_array == NULL ) {
+            scan_window( win->blocks + win->beg, win->count, job->count_array, job->shared );
+        } else {
+            rescan_window( win->blocks + win->beg, win->count, job->count_array, i, job->cutoff, job->output_array, job->shared );
+        }
     }
 
-    list_sl_destroy( &list );
+    mem_free( &win );
 
-    for ( i = 0; i < seq_len; i++ ) {
-        printf( "%zu\t%u\n", i, output_array[ i ] );
-    }
-
-    free( output_array );
+    return NULL;
 }
 
 
-void scan_list( list_sl *list, uint *count_array )
+void scan_window( ushort *blocks, size_t size, uint *count_array, bool shared )
 {
     /* Martin A. Hansen, September 2008 */
 
-    /* Scan a list of blocks for biparite motifs by creating */
+    /* Scan a window of blocks for biparite motifs by creating */
     /* a binary motif consisting of two blocks of 4 nucleotides */
     /* along with the distance separating them. Motifs containing */
-    /* N's are skipped. */
+    /* N's are skipped. If shared, counts are added atomically. */
 
-    node_sl  *first_node = NULL;
-    node_sl  *next_node  = NULL;
-    bitblock *block1     = NULL;
-    bitblock *block2     = NULL;
-    int       i          = 0;
+    size_t    i          = 0;
     ushort    dist       = 0;
     uint      motif_bin  = 0;
 
-//    bitblock_list_print( list );
-
-    first_node = list->first;
-
-    block1 = ( bitblock * ) first_node->val;
+    if ( size == 0 || blocks[ 0 ] & BLOCK_N ) {
+        return;
+    }
 
-    if ( ! block1->hasN )
+    for ( i = BLOCK_SIZE_NT; i < size; i++ )
     {
-        next_node = first_node->next;
-
-        for ( i = 0; i < BLOCK_SIZE_NT - 1; i++ ) {
-            next_node = next_node->next;
-        }
-
-        for ( next_node = next_node; next_node != NULL; next_node = next_node->next )
+        if ( ! ( blocks[ i ] & BLOCK_N ) )
         {
-            block2 = ( bitblock * ) next_node->val;
-        
-            if ( ! block2->hasN )
-            {
-                motif_bin = blocks2motif( block1->bin, block2->bin, dist );
-
-                // bitblock_list_print( list ); /* DEBUG */
+            motif_bin = blocks2motif( blocks[ 0 ], blocks[ i ], dist );
 
+            if ( shared ) {
+                __atomic_fetch_add( &count_array[ motif_bin ], 1, __ATOMIC_RELAXED );
+            } else {
                 count_array[ motif_bin ]++;
             }
-
-            dist++;
         }
+
+        dist++;
     }
 }
 
 
-void rescan_list( list_sl *list, uint *count_array, size_t pos, size_t cutoff, uint *output_array )
+void rescan_window( ushort *blocks, size_t size, uint *count_array, size_t pos, size_t cutoff, uint *output_array, bool shared )
 {
     /* Martin A. Hansen, September 2008 */
 
-    /* Scan a list of blocks for biparite motifs by creating */
+    /* Scan a window of blocks for biparite motifs by creating */
     /* a binary motif consisting of two blocks of 4 nucleotides */
     /* along with the distance separating them. Motifs containing */
-    /* N's are skipped. */
+    /* N's are skipped. If shared, counts are added atomically. */
 
-    node_sl  *first_node = NULL;
-    node_sl  *next_node  = NULL;
-    bitblock *block1     = NULL;
-    bitblock *block2     = NULL;
-    int       i          = 0;
+    size_t    i          = 0;
     int       k          = 0;
     ushort    dist       = 0;
     uint      motif_bin  = 0;
-    uint      j          = 0;
+    uint      j          = BLOCK_SIZE_NT - 1;
     uint      count      = 0;
 
-//    bitblock_list_print( list );
-
-    first_node = list->first;
-
-    block1 = ( bitblock * ) first_node->val;
+    if ( size == 0 || blocks[ 0 ] & BLOCK_N ) {
+        return;
+    }
 
-    if ( ! block1->hasN )
+    for ( i = BLOCK_SIZE_NT; i < size; i++ )
     {
-        next_node = first_node->next;
-
-        for ( i = 0; i < BLOCK_SIZE_NT - 1; i++ )
+        if ( ! ( blocks[ i ] & BLOCK_N ) )
         {
-            next_node = next_node->next;
+            motif_bin = blocks2motif( blocks[ 0 ], blocks[ i ], dist );
 
-            j++;
-        }
+            count = count_array[ motif_bin ];
 
-        for ( next_node = next_node; next_node != NULL; next_node = next_node->next )
-        {
-            block2 = ( bitblock * ) next_node->val;
-        
-            if ( ! block2->hasN )
+            if ( count > cutoff )
             {
-                motif_bin = blocks2motif( block1->bin, block2->bin, dist );
-
-                // bitblock_list_print( list ); /* DEBUG */
-
-                count = count_array[ motif_bin ];
-
-                if ( count > cutoff )
+                for ( k = 0; k < BLOCK_SIZE_NT - 1; k++ )
                 {
-                    // printf( "%zu\t%u\t%u\n", pos + j, motif_bin, count );
-
-                    for ( k = 0; k < BLOCK_SIZE_NT - 1; k++ )
+                    if ( shared )
+                    {
+                        __atomic_fetch_add( &output_array[ pos - j + k - BLOCK_SIZE_NT ], count, __ATOMIC_RELAXED );
+                        __atomic_fetch_add( &output_array[ pos + k - dist - BLOCK_SIZE_NT ], count, __ATOMIC_RELAXED );
+                    }
+                    else
                     {
                         output_array[ pos - j + k - BLOCK_SIZE_NT ]    += count;
                         output_array[ pos + k - dist - BLOCK_SIZE_NT ] += count;
                     }
                 }
             }
+        }
 
-            dist++;
+        dist++;
 
-            j++;
-        }
+        j++;
     }
 }
 
 
-bitblock *bitblock_new()
+window *window_new()
 {
-    /* Martin A. Hansen, September 2008 */
+    /* Martin A. Hansen, October 2026 */
 
-    /* Initializes a new empty bitblock. */
+    /* Initializes a new empty window. */
 
-    bitblock *new_block = NULL;
+    window *win = NULL;
 
-    new_block = mem_get( sizeof( bitblock ) );
+    win = mem_get_zero( sizeof( window ) );
 
-    new_block->bin  = 0;
-    new_block->hasN = FALSE;
+    return win;
+}
 
-    return new_block;
+
+void window_push( window *win, ushort block )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Push a packed block onto the end of a window that is not full. */
+
+    size_t slot = ( win->beg + win->count ) % WINDOW_SIZE;
+
+    assert( win->count < WINDOW_SIZE );
+
+    win->blocks[ slot ]               = block;
+    win->blocks[ slot + WINDOW_SIZE ] = block;
+
+    win->count++;
+}
+
+
+void window_shift( window *win )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Shift the first block off a window. */
+
+    assert( win->count > 0 );
+
+    win->beg = ( win->beg + 1 ) % WINDOW_SIZE;
+
+    win->count--;
 }
 
 
@@ -557,10 +626,10 @@ void run_tests()
     fprintf( stderr, "Running tests\n" );
 
     test_count_array_new();
-    test_bitblock_new();
-    test_bitblock_print();
-    test_bitblock_list_print();
+    test_window_new();
+    test_window_push();
     test_scan_seq();
+    test_scan_chunk();
     test_blocks2motif();
 
     fprintf( stderr, "All tests OK\n" );
@@ -587,62 +656,51 @@ void test_count_array_new()
 }
 
 
-void test_bitblock_new()
+void test_window_new()
 {
-    fprintf( stderr, "   Running test_bitblock_new ... " );
+    fprintf( stderr, "   Running test_window_new ... " );
+
+    window *win = window_new();
 
-    bitblock *new_block = bitblock_new();
+    assert( win->beg   == 0 );
+    assert( win->count == 0 );
 
-    assert( new_block->bin  == 0 );
-    assert( new_block->hasN == FALSE );
+    mem_free( &win );
 
     fprintf( stderr, "done.\n" );
 }
 
 
-void test_bitblock_print()
+void test_window_push()
 {
-    fprintf( stderr, "   Running test_bitblock_print ... " );
+    fprintf( stderr, "   Running test_window_push ... " );
 
-    bitblock *new_block = bitblock_new();
+    window *win = window_new();
+    size_t  i   = 0;
 
-    new_block->bin  = 7;
-    new_block->hasN = TRUE;
-
-//    bitblock_print( new_block );
-
-    fprintf( stderr, "done.\n");
-}
+    for ( i = 0; i < WINDOW_SIZE; i++ ) {
+        window_push( win, i );
+    }
 
+    window_shift( win );
+    window_shift( win );
 
-void test_bitblock_list_print()
-{
-    fprintf( stderr, "   Running test_bitblock_list_print ... " );
+    window_push( win, 1000 );
+    window_push( win, 1001 | BLOCK_N );
 
-    list_sl  *list   = list_sl_new();
-    node_sl  *node1  = node_sl_new();
-    node_sl  *node2  = node_sl_new();
-    node_sl  *node3  = node_sl_new();
-    bitblock *block1 = bitblock_new();
-    bitblock *block2 = bitblock_new();
-    bitblock *block3 = bitblock_new();
+    assert( win->count == WINDOW_SIZE );
+    assert( win->beg   == 2 );
 
-    block1->bin  = 0;
-    block1->hasN = TRUE;
-    block2->bin  = 1;
-    block2->hasN = TRUE;
-    block3->bin  = 2;
-    block3->hasN = TRUE;
+    /* The window is contiguous across the end of the circular array. */
 
-    node1->val  = block1;
-    node2->val  = block2;
-    node3->val  = block3;
+    for ( i = 0; i < WINDOW_SIZE - 2; i++ ) {
+        assert( win->blocks[ win->beg + i ] == i + 2 );
+    }
 
-    list_sl_add_beg( &list, &node1 );
-    list_sl_add_beg( &list, &node2 );
-    list_sl_add_beg( &list, &node3 );
+    assert( win->blocks[ win->beg + WINDOW_SIZE - 2 ] == 1000 );
+    assert( win->blocks[ win->beg + WINDOW_SIZE - 1 ] == ( 1001 | BLOCK_N ) );
 
-    // bitblock_list_print( list );
+    mem_free( &win );
 
     fprintf( stderr, "done.\n" );
 }
@@ -652,17 +710,120 @@ void test_scan_seq()
 {
     fprintf( stderr, "   Running test_scan_seq ... " );
 
-    //char   *seq       = "AAAANTCGGCTNGGGG";
-    //char   *seq         = "AAAATCGGCTGGGG";
     char   *seq         = "AAAAAAAAAAAAAAG";
     size_t  seq_len     = strlen( seq );
-    size_t  nmemb       = 1 << 5;
+    size_t  nmemb       = 1 << 24;
+    uint    i           = 0;
     
     uint   *count_array = count_array_new( nmemb );
 
-    scan_seq( seq, seq_len, count_array );
+    scan_seq( seq, seq_len, count_array, 1 );
+
+    /* The first AAAA block against AAAA blocks at distance 0-6 and AAAG at 7. */
+
+    for ( i = 0; i < 7; i++ ) {
+        assert( count_array[ blocks2motif( 0, 0, i ) ] == 1 );
+    }
+
+    assert( count_array[ blocks2motif( 0, 2, 7 ) ] == 1 );
+    assert( count_array[ blocks2motif( 0, 0, 7 ) ] == 0 );
+
+    mem_free( &count_array );
+
+    fprintf( stderr, "done.\n" );
+}
+
+
+void test_scan_chunk()
+{
+    fprintf( stderr, "   Running test_scan_chunk ... " );
+
+    /* Scanning a sequence in chunks - at boundaries close to N's - must */
+    /* give the same counts as scanning it in one go. Only the motifs of */
+    /* blocks found in the sequence are compared, so the zeroed pages of */
+    /* the count arrays are not touched. */
+
+    char     *seq      = NULL;
+    size_t    seq_len  = 2000;
+    size_t    nmemb    = 1 << 24;
+    size_t    bounds[] = { 0, 3, 700, 703, 1200, seq_len - WINDOW_SIZE - 2 };
+    uint     *array1   = count_array_new( nmemb );
+    uint     *array2   = count_array_new( nmemb );
+    bool      seen[ 256 ];
+    uchar     bin      = 0;
+    uint      motif    = 0;
+    scan_job  job;
+    size_t    i        = 0;
+    size_t    j        = 0;
+    ushort    dist     = 0;
+
+    seq = mem_get( seq_len + 1 );
+
+    for ( i = 0; i < seq_len; i++ ) {
+        seq[ i ] = "ACGT"[ ( i * 7 + i / 13 ) % 4 ];
+    }
+
+    seq[ 1 ]    = 'N';
+    seq[ 702 ]  = 'N';
+    seq[ 1207 ] = 'N';
+    seq[ seq_len ] = '\0';
+
+    scan_seq( seq, seq_len, array1, 1 );
+
+    for ( i = 0; i < sizeof( bounds ) / sizeof( size_t ) - 1; i++ )
+    {
+        job.seq          = seq;
+        job.seq_len      = seq_len;
+        job.beg          = bounds[ i ];
+        job.end          = bounds[ i + 1 ];
+        job.count_array  = array2;
+        job.output_array = NULL;
+        job.cutoff       = 0;
+        job.shared       = FALSE;
+
+        scan_chunk( &job );
+    }
+
+    memset( seen, FALSE, sizeof( seen ) );
+
+    for ( i = 0; i < seq_len; i++ )
+    {
+        bin <<= BITS_IN_NT;
+
+        switch( seq[ i ] )
+        {
+            case 'A': add_A( bin ); break;
+            case 'T': add_T( bin ); break;
+            case 'C': add_C( bin ); break;
+            case 'G': add_G( bin ); break;
+            default: break;
+        }
+
+        if ( i >= BLOCK_SIZE_NT - 1 ) {
+            seen[ bin ] = TRUE;
+        }
+    }
+
+    for ( i = 0; i < 256; i++ )
+    {
+        for ( j = 0; j < 256; j++ )
+        {
+            if ( ! seen[ i ] || ! seen[ j ] ) {
+                continue;
+            }
+
+            for ( dist = 0; dist <= BLOCK_SPACE_MAX; dist++ )
+            {
+                motif = blocks2motif( i, j, dist );
+
+                assert( array1[ motif ] == array2[ motif ] );
+            }
+        }
+    }
 
-    // count_array_print( count_array, nmemb, 1 );   /* DEBUG */
+    mem_free( &array1 );
+    mem_free( &array2 );
+    mem_free( &seq );
 
     fprintf( stderr, "done.\n" );
 }
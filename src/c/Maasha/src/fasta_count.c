@@ -9,29 +9,37 @@
 
 int main( int argc, char *argv[] )
 {
-    int i;
-    int count;
-    int total;
-    FILE *fp;
+    /* Count the entries, residues and longest entry of FASTA files. */
 
-    count = 0;
-    total = 0;
+    int         i;
+    FILE       *fp;
+    fasta_stats stats;
+    fasta_stats total;
+
+    total.count    = 0;
+    total.residues = 0;
+    total.longest  = 0;
 
     for ( i = 1; argv[ i ]; i++ )
     {
         fp = read_open( argv[ i ] );
 
-        count = fasta_count( fp );
+        fasta_count_stats( fp, &stats );
 
         close_stream( fp );
 
-        printf( "%s: %d\n", argv[ i ], count );
+        printf( "%s: %zu\tresidues: %zu\tlongest: %zu\n", argv[ i ], stats.count, stats.residues, stats.longest );
+
+        total.count    += stats.count;
+        total.residues += stats.residues;
 
-        total += count;
+        if ( stats.longest > total.longest ) {
+            total.longest = stats.longest;
+        }
     }
 
-    if ( total > count ) {
-        printf( "total: %d\n", total );
+    if ( i > 2 ) {
+        printf( "total: %zu\tresidues: %zu\tlongest: %zu\n", total.count, total.residues, total.longest );
     }
 
     return 0;
@@ -0,0 +1,451 @@
+/* Martin Asser Hansen (mail@maasha.dk) Copyright (C) 2008 - All right reserved */
+
+#include <time.h>
+#include "common.h"
+#include "mem.h"
+#include "filesys.h"
+#include "hash.h"
+
+#define BENCH_DIST_MAX 8   /* Number of probe distances in histogram before the last >= bin. */
+
+/* Structure of a key set. Keys are \0 terminated in one arena. */
+struct _key_set
+{
+    char   *arena;       /* Key arena. */
+    size_t  arena_len;   /* Number of chars used in arena. */
+    size_t  arena_max;   /* Allocated size of arena. */
+    size_t *offsets;     /* Offsets of keys in arena. */
+    size_t  count;       /* Number of keys. */
+    size_t  max;         /* Allocated number of keys. */
+};
+
+typedef struct _key_set key_set;
+
+/* Structure of a named hash function. */
+struct _bench_func
+{
+    char      *name;   /* Name of function. */
+    hash_func  func;   /* Hash function. */
+};
+
+typedef struct _bench_func bench_func;
+
+static bench_func funcs[] = {
+    { "kent", hash_kent },
+    { "fnv",  hash_fnv  },
+    { "wy",   hash_wy   },
+    { NULL,   NULL      }
+};
+
+
+static void usage()
+{
+    fprintf( stderr,
+        "\n"
+        "hash_bench - benchmark hash functions on a key set.\n"
+        "\n"
+        "For each hash function the keys are added to a hash and looked up,\n"
+        "and the time per insert, hit and miss is reported together with\n"
+        "the number of 32 bit hash collisions and a histogram of probe\n"
+        "distances in the table.\n"
+        "\n"
+        "Usage: hash_bench [options] [<key file>]\n"
+        "\n"
+        "Options:\n"
+        "   [-g <set> | --gen <set>]      # Generate keys: chr, read or kmer.\n"
+        "   [-n <int> | --count <int>]    # Number of keys to generate (default 1000000).\n"
+        "   [-r <int> | --rounds <int>]   # Number of lookup rounds (default 3).\n"
+        "\n"
+        "Examples:\n"
+        "   cut -f 1 test.bed | hash_bench /dev/stdin\n"
+        "   cut -f 4 reads.bed | hash_bench /dev/stdin\n"
+        "   hash_bench -g kmer -n 5000000\n"
+        "\n"
+        );
+
+    exit( EXIT_FAILURE );
+}
+
+
+static struct option longopts[] = {
+    { "gen",    required_argument, NULL, 'g' },
+    { "count",  required_argument, NULL, 'n' },
+    { "rounds", required_argument, NULL, 'r' },
+    { NULL,     0,                 NULL,  0  }
+};
+
+
+static key_set *key_set_new()
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Initialize a new empty key set. */
+
+    key_set *keys = NULL;
+
+    keys = mem_get( sizeof( key_set ) );
+
+    keys->arena_max = 1024 * 1024;
+    keys->arena     = mem_get( keys->arena_max );
+    keys->arena_len = 0;
+    keys->max       = 1024;
+    keys->offsets   = mem_get( keys->max * sizeof( size_t ) );
+    keys->count     = 0;
+
+    return keys;
+}
+
+
+static void key_set_add( key_set *keys, char *key, size_t len )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Add a key of a given length to a key set. */
+
+    while ( keys->arena_len + len + 1 > keys->arena_max )
+    {
+        keys->arena_max <<= 1;
+        keys->arena       = mem_resize( keys->arena, keys->arena_max );
+    }
+
+    if ( keys->count == keys->max )
+    {
+        keys->max   <<= 1;
+        keys->offsets = mem_resize( keys->offsets, keys->max * sizeof( size_t ) );
+    }
+
+    memcpy( &keys->arena[ keys->arena_len ], key, len );
+
+    keys->arena[ keys->arena_len + len ] = '\0';
+
+    keys->offsets[ keys->count++ ] = keys->arena_len;
+    keys->arena_len               += len + 1;
+}
+
+
+static void key_set_destroy( key_set **keys_ppt )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Deallocate memory for a key set. */
+
+    key_set *keys = *keys_ppt;
+
+    mem_free( &keys->arena );
+    mem_free( &keys->offsets );
+    mem_free( &keys );
+
+    *keys_ppt = NULL;
+}
+
+
+static key_set *keys_read( char *file )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Read keys from a file with one key per line. */
+
+    file_buffer *buffer = NULL;
+    key_set     *keys   = NULL;
+    char        *line   = NULL;
+    size_t       len    = 0;
+
+    keys = key_set_new();
+
+    buffer_new( file, &buffer, 0 );
+
+    while ( ( len = buffer_gets( buffer, &line ) ) != 0 )
+    {
+        if ( line[ len - 1 ] == '\n' ) {
+            len--;
+        }
+
+        if ( len > 0 && line[ len - 1 ] == '\r' ) {
+            len--;
+        }
+
+        if ( len > 0 ) {
+            key_set_add( keys, line, len );
+        }
+    }
+
+    buffer_destroy( &buffer );
+
+    return keys;
+}
+
+
+static key_set *keys_gen( char *set, size_t count )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Generate a key set of a given size resembling chromosome names, */
+    /* Illumina read ids or 16-mers. Keys are generated with a fixed */
+    /* seed so runs are comparable. */
+
+    key_set  *keys = NULL;
+    char      key[ 256 ];
+    uint64_t  x    = 88172645463325252ULL;
+    size_t    len  = 0;
+    size_t    i    = 0;
+    size_t    j    = 0;
+
+    keys = key_set_new();
+
+    for ( i = 0; i < count; i++ )
+    {
+        x ^= x << 13;
+        x ^= x >> 7;
+        x ^= x << 17;
+
+        if ( strcmp( set, "chr" ) == 0 )
+        {
+            if ( i < 22 ) {
+                len = sprintf( key, "chr%zu", i + 1 );
+            } else {
+                len = sprintf( key, "chrUn_gl%06zu", i );
+            }
+        }
+        else if ( strcmp( set, "read" ) == 0 )
+        {
+            len = sprintf( key, "HWI-ST1234:8:%zu:%zu:%zu#0/%zu", 1101 + ( i >> 20 ), ( size_t ) ( x % 20000 ), i & 0xfffff, 1 + ( i & 1 ) );
+        }
+        else if ( strcmp( set, "kmer" ) == 0 )
+        {
+            for ( j = 0; j < 16; j++ ) {
+                key[ j ] = "ACGT"[ ( x >> ( 2 * j ) ) & 3 ];
+            }
+
+            len = 16;
+        }
+        else
+        {
+            fprintf( stderr, "ERROR: Unknown key set: %s\n", set );
+            abort();
+        }
+
+        key_set_add( keys, key, len );
+    }
+
+    return keys;
+}
+
+
+static double bench_time()
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Returns a monotonic time stamp in nano seconds. */
+
+    struct timespec ts;
+
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+
+static int cmp_uint( const void *a, const void *b )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Compare two uints for qsort. */
+
+    uint x = *( ( uint * ) a );
+    uint y = *( ( uint * ) b );
+
+    if ( x < y ) {
+        return -1;
+    } else if ( x > y ) {
+        return 1;
+    } else {
+        return 0;
+    }
+}
+
+
+static void bench_func_run( bench_func *bench, key_set *keys, key_set *misses, int rounds )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Benchmark a hash function on a key set and output a line of stats. */
+
+    hash   *hash_pt = NULL;
+    uint   *hashes  = NULL;
+    size_t  hist[ BENCH_DIST_MAX + 1 ];
+    size_t  dist    = 0;
+    size_t  dists   = 0;
+    size_t  max     = 0;
+    size_t  coll    = 0;
+    size_t  found   = 0;
+    size_t  i       = 0;
+    size_t  j       = 0;
+    double  t_add   = 0;
+    double  t_hit   = 0;
+    double  t_miss  = 0;
+    double  t       = 0;
+    int     r       = 0;
+
+    memset( hist, 0, sizeof( hist ) );
+
+    hash_pt = hash_new( 0 );
+
+    hash_func_set( hash_pt, bench->func );
+
+    t = bench_time();
+
+    for ( i = 0; i < keys->count; i++ ) {
+        hash_add( hash_pt, &keys->arena[ keys->offsets[ i ] ], NULL );
+    }
+
+    t_add = bench_time() - t;
+    t     = bench_time();
+
+    for ( r = 0; r < rounds; r++ )
+    {
+        for ( i = 0; i < keys->count; i++ ) {
+            found += ( hash_elem_get( hash_pt, &keys->arena[ keys->offsets[ i ] ] ) != NULL );
+        }
+    }
+
+    t_hit = bench_time() - t;
+    t     = bench_time();
+
+    for ( r = 0; r < rounds; r++ )
+    {
+        for ( i = 0; i < misses->count; i++ ) {
+            found += ( hash_elem_get( hash_pt, &misses->arena[ misses->offsets[ i ] ] ) != NULL );
+        }
+    }
+
+    t_miss = bench_time() - t;
+
+    assert( found == keys->count * rounds );
+
+    hashes = mem_get( ( hash_pt->nmemb + 1 ) * sizeof( uint ) );
+
+    for ( i = 0, j = 0; i < hash_pt->table_size; i++ )
+    {
+        if ( hash_pt->table[ i ].dist != 0 )
+        {
+            dist = hash_pt->table[ i ].dist - 1;
+
+            hist[ ( dist < BENCH_DIST_MAX ) ? dist : BENCH_DIST_MAX ]++;
+
+            dists += dist;
+
+            if ( dist > max ) {
+                max = dist;
+            }
+
+            hashes[ j++ ] = hash_pt->table[ i ].hash;
+        }
+    }
+
+    qsort( hashes, j, sizeof( uint ), cmp_uint );
+
+    for ( i = 1; i < j; i++ ) {
+        coll += ( hashes[ i ] == hashes[ i - 1 ] );
+    }
+
+    printf( "%-6s %10zu %10.1f %10.1f %10.1f %8zu %8.3f %6zu ",
+        bench->name,
+        hash_pt->nmemb,
+        t_add / keys->count,
+        t_hit / ( ( double ) keys->count * rounds ),
+        t_miss / ( ( double ) misses->count * rounds ),
+        coll,
+        ( double ) dists / hash_pt->nmemb,
+        max
+    );
+
+    for ( i = 0; i <= BENCH_DIST_MAX; i++ ) {
+        printf( " %5.1f", 100.0 * hist[ i ] / hash_pt->nmemb );
+    }
+
+    printf( "\n" );
+
+    mem_free( &hashes );
+
+    hash_destroy( hash_pt );
+}
+
+
+int main( int argc, char *argv[] )
+{
+    int      opt    = 0;
+    char    *set    = NULL;
+    long     count  = 1000000;
+    int      rounds = 3;
+    key_set *keys   = NULL;
+    key_set *misses = NULL;
+    char     key[ 4096 ];
+    size_t   len    = 0;
+    size_t   i      = 0;
+
+    while ( ( opt = getopt_long( argc, argv, "g:n:r:", longopts, NULL ) ) != -1 )
+    {
+        switch ( opt ) {
+            case 'g': set    = optarg;                    break;
+            case 'n': count  = strtol( optarg, NULL, 0 ); break;
+            case 'r': rounds = strtol( optarg, NULL, 0 ); break;
+            default:                                      break;
+        }
+    }
+
+    argc -= optind;
+    argv += optind;
+
+    if ( count < 1 )
+    {
+        fprintf( stderr, "ERROR: argument to --count must be positive - not: %ld\n", count );
+        abort();
+    }
+
+    if ( rounds < 1 )
+    {
+        fprintf( stderr, "ERROR: argument to --rounds must be positive - not: %d\n", rounds );
+        abort();
+    }
+
+    if ( set != NULL ) {
+        keys = keys_gen( set, count );
+    } else if ( argc > 0 ) {
+        keys = keys_read( argv[ argc - 1 ] );
+    } else {
+        usage();
+    }
+
+    if ( keys->count == 0 )
+    {
+        fprintf( stderr, "ERROR: no keys to benchmark\n" );
+        abort();
+    }
+
+    /* Misses are keys with an extra char that cannot be in a line. */
+    misses = key_set_new();
+
+    for ( i = 0; i < keys->count; i++ )
+    {
+        len = snprintf( key, sizeof( key ), "%s\n", &keys->arena[ keys->offsets[ i ] ] );
+
+        key_set_add( misses, key, ( len < sizeof( key ) ) ? len : sizeof( key ) - 1 );
+    }
+
+    printf( "%-6s %10s %10s %10s %10s %8s %8s %6s ", "#func", "keys", "ns/add", "ns/hit", "ns/miss", "coll", "dist", "max" );
+
+    for ( i = 0; i < BENCH_DIST_MAX; i++ ) {
+        printf( " %4zu%%", i );
+    }
+
+    printf( " >=%zu%%\n", i );
+
+    for ( i = 0; funcs[ i ].name != NULL; i++ ) {
+        bench_func_run( &funcs[ i ], keys, misses, rounds );
+    }
+
+    key_set_destroy( &keys );
+    key_set_destroy( &misses );
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,107 @@
+/* Martin Asser Hansen (mail@maasha.dk) Copyright (C) 2008 - All right reserved */
+
+/* Biopieces records are streams of "key: value" lines with records */
+/* separated by "---" lines. Records are parsed in place in a file */
+/* buffer and fields are slices pointing into the buffer. */
+
+/* Between C stages a binary framing can be used instead. The stream */
+/* starts with the header BP_MAGIC followed by a version byte, then */
+/* follows frames of a type byte and a varint payload length: */
+/*    'K': varint key id, key chars  - defines a key once per stream. */
+/*    'R': varint field count, and per field: varint key id, */
+/*         varint value length, value chars and a \0. */
+/* Varints are unsigned LEB128. Readers detect the format from the */
+/* header, and as text streams never start with \0, legacy Ruby and */
+/* Perl stages are unaffected as long as only C writers opt in. */
+
+#define BP_FIELDS  32            /* Initial number of fields in a bp_record. */
+#define BP_KEYS    32            /* Initial number of keys in a key dictionary. */
+#define BP_OUT     ( 64 * 1024 ) /* Size of output buffer of a bp_writer. */
+#define BP_MAGIC   "\0BPB"       /* Header of binary framed streams. */
+#define BP_VERSION 1             /* Version of binary framing. */
+
+#define BP_UNKNOWN 0             /* Stream format not yet detected. */
+#define BP_TEXT    1             /* Text stream format. */
+#define BP_BINARY  2             /* Binary framed stream format. */
+
+/* Structure of a key/value field of a Biopieces record. */
+struct _bp_field
+{
+    char   *key;       /* Key - \0 terminated. */
+    size_t  key_len;   /* Length of key. */
+    char   *val;       /* Value - \0 terminated. */
+    size_t  val_len;   /* Length of value. */
+};
+
+typedef struct _bp_field bp_field;
+
+/* Structure of a Biopieces record. The record is reused between */
+/* records and the fields are only valid until the next record is read. */
+/* A record used for reading is bound to one stream, as it holds the */
+/* stream format and the key dictionary of binary streams. */
+struct _bp_record
+{
+    bp_field *fields;      /* Array of fields. */
+    size_t    count;       /* Number of fields in record. */
+    size_t    max;         /* Allocated number of fields. */
+    int       format;      /* Format of input stream. */
+    char    **keys;        /* Key dictionary of binary input stream. */
+    size_t   *key_lens;    /* Lengths of keys in dictionary. */
+    size_t    key_count;   /* Number of keys in dictionary. */
+    size_t    key_max;     /* Allocated number of keys in dictionary. */
+};
+
+typedef struct _bp_record bp_record;
+
+/* Structure of a buffered writer of Biopieces records. */
+struct _bp_writer
+{
+    FILE    *fp;          /* Output stream. */
+    char    *buf;         /* Output buffer. */
+    size_t   len;         /* Number of chars in output buffer. */
+    size_t   size;        /* Size of output buffer. */
+    int      format;      /* Output format. */
+    bool     header;      /* Flag indicating that the binary header is written. */
+    char   **keys;        /* Key dictionary of binary output stream. */
+    size_t  *key_lens;    /* Lengths of keys in dictionary. */
+    size_t   key_count;   /* Number of keys in dictionary. */
+    size_t   key_max;     /* Allocated number of keys in dictionary. */
+    size_t  *ids;         /* Key ids of fields of the last record. */
+    size_t   id_max;      /* Allocated number of key ids. */
+};
+
+typedef struct _bp_writer bp_writer;
+
+/* Initialize a new empty Biopieces record. */
+bp_record *bp_record_new();
+
+/* Get the next Biopieces record from a text or binary stream in a file buffer. */
+/* Returns FALSE when no more records. */
+bool       bp_record_get( file_buffer *buffer, bp_record *record );
+
+/* Add a field to a Biopieces record. Key and value are not copied. */
+void       bp_record_add( bp_record *record, char *key, char *val );
+
+/* Lookup the value of a key in a Biopieces record - returns NULL if not found. */
+char      *bp_record_val( bp_record *record, char *key );
+
+/* Remove all fields from a Biopieces record. */
+void       bp_record_clear( bp_record *record );
+
+/* Deallocate memory for a Biopieces record. */
+void       bp_record_destroy( bp_record **record_ppt );
+
+/* Initialize a buffered writer of Biopieces records to a stream. */
+bp_writer *bp_writer_new( FILE *fp );
+
+/* Switch a writer to binary framing - must be called before any records are written. */
+void       bp_writer_binary( bp_writer *writer );
+
+/* Write a Biopieces record to a buffered writer. */
+void       bp_record_put( bp_writer *writer, bp_record *record );
+
+/* Flush the output buffer of a writer to the stream. */
+void       bp_writer_flush( bp_writer *writer );
+
+/* Flush and deallocate memory for a writer - the stream is not closed. */
+void       bp_writer_destroy( bp_writer **writer_ppt );
@@ -0,0 +1,164 @@
+/* Martin Asser Hansen (mail@maasha.dk) Copyright (C) 2008 - All right reserved */
+
+/* Concurrent hash of string keys to 64 bit values for use by many */
+/* threads. Keys are spread over shards on their hash, and each shard */
+/* has a lock taken only to insert new keys. Lookups and updates of */
+/* existing keys take no locks: Keys are stored once in nodes that */
+/* never move, and the tables of a shard only hold pointers to nodes, */
+/* which are published with atomic stores. Values are updated with */
+/* atomic operations on the node, so updates are not lost if a table */
+/* is grown meanwhile. Replaced tables are kept until the hash is */
+/* destroyed, as readers may still use them. */
+
+/* A hash created with chash_new_u64 instead maps 64 bit keys - e.g. */
+/* oligo codes - to 32 bit values. Keys and values are stored in the */
+/* shard tables in slots of 12 bytes, so at the max load a key takes 16 */
+/* bytes and 32 bytes just after a table is grown. As slots move when a */
+/* table grows, all operations lock the shard if the hash is shared - */
+/* unshared hashes are for use by one thread and take no locks. */
+
+#define CHASH_SHARDS    64            /* Default number of shards. */
+#define CHASH_BITS_MIN  4             /* Minimum table size of a shard as power of 2. */
+#define CHASH_LOAD      75            /* Max load of a shard table in percent before growing. */
+#define CHASH_ARENA     ( 64 * 1024 ) /* Size of node arena blocks. */
+
+/* Structure of a node holding a key and its value. */
+struct _chash_node
+{
+    uint64_t val;     /* Value - updated atomically. */
+    char     key[];   /* Key - \0 terminated. */
+};
+
+typedef struct _chash_node chash_node;
+
+/* Structure of a slot in a shard table. */
+struct _chash_slot
+{
+    chash_node *node;   /* Node - NULL for empty slots. */
+    uint        hash;   /* Hash of key. */
+};
+
+typedef struct _chash_slot chash_slot;
+
+/* Structure of a slot in a shard table of 64 bit keys. The key is split */
+/* in halves so the slot packs to 12 bytes. */
+struct _chash_u64_slot
+{
+    uint key_lo;   /* Low half of key + 1 - both halves 0 for empty slots. */
+    uint key_hi;   /* High half of key + 1. */
+    uint val;      /* Value. */
+};
+
+typedef struct _chash_u64_slot chash_u64_slot;
+
+/* Structure of a shard table of 64 bit keys. */
+struct _chash_u64_table
+{
+    size_t          size;    /* Number of slots - a power of 2. */
+    int             shift;   /* Shift of multiplied hash to get slot index. */
+    chash_u64_slot  slots[]; /* Slots. */
+};
+
+typedef struct _chash_u64_table chash_u64_table;
+
+/* Structure of a shard table. */
+struct _chash_table
+{
+    struct _chash_table *next;    /* Next replaced table. */
+    size_t               size;    /* Number of slots - a power of 2. */
+    int                  shift;   /* Shift of multiplied hash to get slot index. */
+    chash_slot           slots[]; /* Slots. */
+};
+
+typedef struct _chash_table chash_table;
+
+/* Structure of a shard. */
+struct _chash_shard
+{
+    pthread_mutex_t  lock;        /* Lock for inserts. */
+    chash_table     *table;       /* Current table - NULL for 64 bit keys. */
+    chash_u64_table *table_u64;   /* Table of 64 bit keys - NULL for string keys. */
+    chash_table     *old;         /* List of replaced tables. */
+    size_t           nmemb;       /* Number of keys in shard. */
+    char           **arenas;      /* Node arena blocks. */
+    size_t           arena_count; /* Number of node arena blocks. */
+    size_t           arena_len;   /* Number of chars used in last arena block. */
+    size_t           arena_max;   /* Size of last arena block. */
+};
+
+typedef struct _chash_shard chash_shard;
+
+/* Structure of a concurrent hash. */
+struct _chash
+{
+    chash_shard *shards;   /* Shards. */
+    uint         mask;     /* Mask to get shard from hash. */
+    bool         shared;   /* Flag indicating that the hash is used by many threads. */
+};
+
+typedef struct _chash chash;
+
+/* Structure of an iterator over a concurrent hash. Iteration during */
+/* inserts is safe, but keys inserted meanwhile may not be seen. */
+struct _chash_iter
+{
+    chash           *hash_pt;     /* Hash. */
+    uint             shard;       /* Current shard. */
+    size_t           index;       /* Next slot in table. */
+    chash_table     *table;       /* Table of current shard. */
+    chash_u64_table *table_u64;   /* Table of current shard for 64 bit keys. */
+};
+
+typedef struct _chash_iter chash_iter;
+
+/* Initialize a new concurrent hash with a number of shards */
+/* rounded up to a power of 2 - or CHASH_SHARDS if 0. */
+chash *chash_new( uint shards );
+
+/* Lookup a key without locking and set val_pt to the value. */
+/* Returns FALSE if the key is not found. */
+bool   chash_get( chash *hash_pt, char *key, uint64_t *val_pt );
+
+/* Add delta to the value of a key atomically - the key is */
+/* inserted with the value delta if not found. Returns the new value. */
+uint64_t chash_add( chash *hash_pt, char *key, uint64_t delta );
+
+/* Insert a key with a value unless the key is found. Returns */
+/* TRUE if inserted, and the value in the hash is set in val_pt. */
+bool   chash_insert( chash *hash_pt, char *key, uint64_t val, uint64_t *val_pt );
+
+/* Set the value of a key atomically - the key is inserted if not found. */
+void   chash_set( chash *hash_pt, char *key, uint64_t val );
+
+/* Initialize a new hash of 64 bit keys to 32 bit values with a number */
+/* of shards as chash_new. The hash is locked only if shared. The key */
+/* ~0 is reserved. */
+chash *chash_new_u64( uint shards, bool shared );
+
+/* Lookup a 64 bit key and set val_pt to the value. Returns FALSE if */
+/* the key is not found. */
+bool   chash_get_u64( chash *hash_pt, uint64_t key, uint *val_pt );
+
+/* Add delta to the value of a 64 bit key - the key is inserted with */
+/* the value delta if not found. Returns the new value. */
+uint   chash_add_u64( chash *hash_pt, uint64_t key, uint delta );
+
+/* Returns the number of keys in a concurrent hash. */
+size_t chash_count( chash *hash_pt );
+
+/* Initialize an iterator over a concurrent hash. */
+void   chash_iter_init( chash_iter *iter, chash *hash_pt );
+
+/* Get the next string key and value from an iterator. Returns FALSE when no more. */
+bool   chash_iter_next( chash_iter *iter, char **key_ppt, uint64_t *val_pt );
+
+/* Get the next 64 bit key and value from an iterator. Returns FALSE when no more. */
+bool   chash_iter_next_u64( chash_iter *iter, uint64_t *key_pt, uint *val_pt );
+
+/* Returns the number of bytes used by the shards and tables of a concurrent hash. */
+size_t chash_mem( chash *hash_pt );
+
+/* Deallocate memory for a concurrent hash - no threads may use it. */
+void   chash_destroy( chash **hash_ppt );
+
+
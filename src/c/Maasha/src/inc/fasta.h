@@ -1,13 +1,135 @@
 /* Martin Asser Hansen (mail@maasha.dk) Copyright (C) 2008 - All right reserved */
 
-#define FASTA_BUFFER 1024
+#define FASTA_BUFFER  1024
+#define FASTA_BLOCK   ( 64 * 1024 )          /* Block size for reading FASTA files into a file_buffer. */
+#define FASTA_LINES   64                     /* Initial number of lines in a fasta_view. */
+#define FASTA_RELEASE ( 64 * 1024 * 1024 )   /* Bytes scanned before pages are released from a fasta_map. */
+#define FASTA_INDEX   64                     /* Initial number of entries in a fasta_index. */
+#define FASTA_COUNT   ( 1024 * 1024 )        /* Block size for reading FASTA files in fasta_count_stats. */
+
+/* Structure with statistics from a single pass over a FASTA file. */
+struct _fasta_stats
+{
+    size_t count;      /* Number of entries. */
+    size_t residues;   /* Total number of residues (printable non-space chars) in all entries. */
+    size_t longest;    /* Number of residues in the longest entry. */
+};
+
+typedef struct _fasta_stats fasta_stats;
+
+/* Structure of a sequence line in a memory mapped FASTA file. */
+struct _fasta_line
+{
+    char   *str;   /* Pointer to the first char of the line in the map. */
+    size_t  len;   /* Length of the line excluding any \r\n. */
+};
+
+typedef struct _fasta_line fasta_line;
+
+/* Structure of a FASTA entry viewed directly in a memory mapped file. */
+/* Nothing is copied, so a view is only valid until the next call to */
+/* fasta_map_get_view and the sequence is walked line by line. */
+struct _fasta_view
+{
+    char       *seq_name;       /* Pointer to the sequence name in the map (not \0 terminated). */
+    size_t      seq_name_len;   /* Length of the sequence name. */
+    fasta_line *lines;          /* Array of sequence lines. */
+    size_t      line_count;     /* Number of sequence lines. */
+    size_t      line_max;       /* Allocated number of sequence lines. */
+    size_t      seq_len;        /* Total length of all sequence lines. */
+};
+
+typedef struct _fasta_view fasta_view;
+
+/* Structure of a memory mapped FASTA file. */
+struct _fasta_map
+{
+    int     fd;         /* File descriptor. */
+    char   *map;        /* Memory map of the file - NULL if the file is empty. */
+    size_t  map_size;   /* Size of the memory map. */
+    size_t  pos;        /* Offset of the scan position. */
+    size_t  released;   /* Offset up to which pages have been released. */
+};
+
+typedef struct _fasta_map fasta_map;
+
+/* Structure of a FASTA index entry as in samtools faidx .fai files. */
+struct _fai_entry
+{
+    char   *name;         /* Sequence name - first word of the header. */
+    size_t  len;          /* Sequence length. */
+    size_t  offset;       /* File offset of the first residue. */
+    size_t  line_bases;   /* Number of residues per line. */
+    size_t  line_width;   /* Number of bytes per line including newline. */
+};
+
+typedef struct _fai_entry fai_entry;
+
+/* Structure of a FASTA index with a file pointer for fetching regions. */
+struct _fasta_index
+{
+    FILE       *fp;            /* File pointer to the indexed FASTA file. */
+    fai_entry  *entries;       /* Array of index entries in file order. */
+    fai_entry **sorted;        /* Array of pointers to entries sorted by name. */
+    size_t      nmemb;         /* Number of index entries. */
+    size_t      max;           /* Allocated number of index entries. */
+    char       *buffer;        /* Read buffer used by fasta_fetch. */
+    size_t      buffer_size;   /* Allocated size of read buffer. */
+};
+
+typedef struct _fasta_index fasta_index;
 
 /* Count all entries in a FASTA file given a file pointer. */
 size_t fasta_count( FILE *fp );
 
+/* Count entries, residues and the longest entry in a FASTA file given a file pointer. */
+void fasta_count_stats( FILE *fp, fasta_stats *stats );
+
 /* Get next sequence entry from a FASTA file given a file pointer. */
 bool fasta_get_entry( FILE *fp, seq_entry **entry_ppt );
 
+/* Get next sequence entry from a FASTA file buffer. */
+bool fasta_get_entry_buffer( file_buffer *buffer, seq_entry **entry_ppt );
+
+/* Append a line of sequence to a sequence entry skipping non-sequence chars. */
+void fasta_seq_append( seq_entry *entry, char *line, size_t len );
+
+/* Memory map a FASTA file for sequential scanning with fasta_map_get_view. */
+fasta_map  *fasta_map_new( char *path );
+
+/* Initialize a new FASTA view. */
+fasta_view *fasta_view_new();
+
+/* Get a view of the next entry of a memory mapped FASTA file. */
+bool        fasta_map_get_view( fasta_map *map, fasta_view *view );
+
+/* Deallocate memory for a FASTA view. */
+void        fasta_view_destroy( fasta_view **view_ppt );
+
+/* Unmap and close a memory mapped FASTA file. */
+void        fasta_map_destroy( fasta_map **map_ppt );
+
+/* Build a FASTA index by scanning a FASTA file. */
+fasta_index *fasta_index_build( char *path );
+
+/* Read a FASTA index from a .fai file for a given FASTA file. */
+fasta_index *fasta_index_read( char *path, char *fai_path );
+
+/* Write a FASTA index to a .fai file. */
+void         fasta_index_write( fasta_index *index, char *fai_path );
+
+/* Load the .fai index of a FASTA file - building and saving it if missing or outdated. */
+fasta_index *fasta_index_load( char *path );
+
+/* Lookup a sequence name in a FASTA index - returns NULL if not found. */
+fai_entry   *fasta_index_get( fasta_index *index, char *name );
+
+/* Fetch the region beg to end (0-based, end exclusive) of a named sequence. */
+bool         fasta_fetch( fasta_index *index, char *name, size_t beg, size_t end, seq_entry **entry_ppt );
+
+/* Close the FASTA file and deallocate memory for a FASTA index. */
+void         fasta_index_destroy( fasta_index **index_ppt );
+
 /* Output a sequence entry in FASTA format. */
 void fasta_put_entry( seq_entry *entry );
 
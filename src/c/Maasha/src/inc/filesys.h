@@ -1,23 +1,27 @@
 /* Martin Asser Hansen (mail@maasha.dk) Copyright (C) 2008 - All right reserved */
 
-//#define FILE_BUFFER_SIZE 64 * 1024
-#define FILE_BUFFER_SIZE 1
+#define FILE_BUFFER_SIZE ( 64 * 1024 )   /* Default block size for reading a file_buffer. */
 
+/* A file buffer is a sliding window over a file. Blocks are read */
+/* directly into the space after buffer_end, and when the window is */
+/* refilled everything before token_pos is discarded. */
 struct _file_buffer
 {
     FILE   *fp;           /* file pointer */
+    int     fd;           /* file descriptor used with read(2) - -1 for compressed streams */
     size_t  token_pos;    /* index pointing to last position where some token was found */
     size_t  token_len;    /* length of some found token */
     size_t  buffer_pos;   /* index indicating how much of the buffer is scanned */
     size_t  buffer_end;   /* end position of buffer */
-    long    buffer_size;  /* default buffer size */
+    long    buffer_size;  /* block size for reads */
+    size_t  str_size;     /* allocated size of the buffer string excluding the terminating \0 */
     char   *str;          /* the buffer string */
     bool    eof;          /* flag indicating that buffer reached EOF */
 };
 
 typedef struct _file_buffer file_buffer;
 
-/* Read-open a file and return a file pointer. */
+/* Read-open a file, that may be compressed, and return a file pointer. */
 FILE   *read_open( char *file );
 
 /* Write-open a file and return a file pointer. */
@@ -40,11 +44,16 @@ void    file_unlink( char *file );
 /* Rename a file. */
 void    file_rename( char *old_name, char *new_name );
 
+/* Create a new temporary file in a given directory and return a */
+/* write file pointer. The allocated file name is set in file_ppt. */
+FILE   *file_temp( char *dir, char **file_ppt );
+
 
 /* >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>> FILE BUFFER <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<*/
 
 
 /* Opens a file for reading and loads a new buffer.*/
+/* The block size is FILE_BUFFER_SIZE if size is 0. */
 /* The number of read chars is returned. */
 size_t  buffer_new( char *file, file_buffer **buffer_ppt, size_t size );
 
@@ -52,6 +61,10 @@ size_t  buffer_new( char *file, file_buffer **buffer_ppt, size_t size );
 /* The number of read chars is returned. */
 size_t  buffer_read( file_buffer **buffer_ppt );
 
+/* Discard everything before buffer_pos and read a new block. */
+/* Returns FALSE when no more data could be read. */
+bool    buffer_fill( file_buffer *buffer );
+
 /* Get the next char from a file buffer, which is resized if necessary, until EOF.*/
 char    buffer_getc( file_buffer *buffer );
 
@@ -59,8 +72,9 @@ char    buffer_getc( file_buffer *buffer );
 void    buffer_ungetc( file_buffer *buffer );
 
 /* Get the next line that is terminated by \n or EOF from a file buffer. */
-/* The number of read chars is returned. */
-char   *buffer_gets( file_buffer *buffer );
+/* line_ppt is set to point to the line in the buffer, which is only */
+/* valid until the next call. The length of the line is returned. */
+size_t  buffer_gets( file_buffer *buffer, char **line_ppt );
 
 /* Rewind the file buffer one line, i.e. put one line back on the buffer.  */
 void    buffer_ungets( file_buffer *buffer );
@@ -68,8 +82,8 @@ void    buffer_ungets( file_buffer *buffer );
 /* Doubles buffer size until it is larger than len. */
 void    buffer_new_size( file_buffer *buffer, long len );
 
-/* Resize file buffer discarding any old buffer before offset, */
-/* and merge remaining old buffer with a new chunk of buffer. */
+/* Slide file buffer discarding any old buffer before token_pos, */
+/* and read a new block after the remaining old buffer. */
 bool    buffer_resize( file_buffer *buffer );
 
 /* Moves file buffer of a given size num positions to the left. */
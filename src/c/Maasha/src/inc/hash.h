@@ -1,11 +1,30 @@
 /* Martin Asser Hansen (mail@maasha.dk) Copyright (C) 2008 - All right reserved */
 
+/* Open addressing hash table with Robin Hood probing. Elements are */
+/* stored in a flat table together with the full hash of the key, */
+/* so most probes are resolved without touching the key. Keys are */
+/* copied into an arena of key blocks and the table is grown when */
+/* the load exceeds HASH_LOAD percent. */
+
+/* The hash function is pluggable. The default is hash_wy, which hashes */
+/* 8 bytes at a time (after wyhash). hash_fnv is the byte at a time */
+/* FNV-1a and hash_kent the original shift-add hash. Use hash_bench to */
+/* compare them on a key set. */
+
+#define HASH_BITS_MIN 3             /* Minimum table size as power of 2. */
+#define HASH_LOAD     85            /* Max load of table in percent before growing. */
+#define HASH_ARENA    ( 64 * 1024 ) /* Size of key arena blocks. */
+
+/* Hash function of a key of a given length. */
+typedef uint ( *hash_func )( char *key, size_t len );
+
 /* Structure of a generic hash element. */
 struct _hash_elem
 {
-    struct _hash_elem *next;   /* Hash elements constitue a sigly linked list. */
-    char              *key;    /* Hash key. */
-    void              *val;    /* Hash val. */
+    char *key;    /* Hash key - \0 terminated in key arena. */
+    void *val;    /* Hash val. */
+    uint  hash;   /* Full hash of key. */
+    uint  dist;   /* Probe distance + 1 - 0 for empty slots. */
 };
 
 typedef struct _hash_elem hash_elem;
@@ -13,36 +32,53 @@ typedef struct _hash_elem hash_elem;
 /* Structure of a generic hash. */
 struct _hash
 {
-    hash_elem **table;          /* Hash table. */
-    size_t      mask;           /* Mask to trim hashed keys. */
+    hash_elem  *table;          /* Hash table. */
+    size_t      mask;           /* Mask to wrap probes around the table. */
     size_t      table_size;     /* Size of hash table. */
     size_t      nmemb;          /* Number of elements in hash table. */
     size_t      index_table;    /* Index for iterating hash table. */
-    hash_elem  *index_bucket;   /* Index for iterating buckets. */
+    int         shift;          /* Shift of multiplied hash to get table index. */
+    hash_func   func;           /* Hash function. */
+    char      **arenas;         /* Key arena blocks. */
+    size_t      arena_count;    /* Number of key arena blocks. */
+    size_t      arena_len;      /* Number of chars used in last arena block. */
+    size_t      arena_max;      /* Size of last arena block. */
 };
 
 typedef struct _hash hash;
 
-/* Initialize a new generic hash structure. */
+/* Initialize a new generic hash structure with a table of 2 ** size elements. */
 hash *hash_new( size_t size );
 
-/* Initializes a new hash_elem structure. */
-hash_elem *hash_elem_new();
+/* Set the hash function of a hash - existing elements are rehashed. */
+void hash_func_set( hash *hash_pt, hash_func func );
 
 /* Hash function that generates a hash key. */
 uint hash_key( char *string );
 
+/* Shift-add hash function of a key of a given length - as hash_key. */
+uint hash_kent( char *key, size_t len );
+
+/* FNV-1a hash function of a key of a given length. */
+uint hash_fnv( char *key, size_t len );
+
+/* Word at a time hash function of a key of a given length after wyhash. */
+uint hash_wy( char *key, size_t len );
+
 /* Add a new hash element consisting of a key/value pair to an existing hash. */
+/* The key is copied, the value is not. */
 void hash_add( hash *hash_pt, char *key, void *val );
 
 /* Lookup a key in a given hash and return the value - or NULL if not found. */
 void *hash_get( hash *hash_pt, char *key );
 
 /* Lookup a key in a given hash and return the hash element - or NULL if not found. */
+/* The element is only valid until the next hash_add. */
 hash_elem *hash_elem_get( hash *hash_pt, char *key );
 
-/* Get the next key/value pair from a hash table. */
-bool hash_each( hash *hash_pt, char **key_ppt, void *val );
+/* Get the next key/value pair from a hash table - val_pt is the address */
+/* of a pointer to the value. Returns FALSE and resets when all are seen. */
+bool hash_each( hash *hash_pt, char **key_ppt, void *val_pt );
 
 /* Deallocate memory for hash and all hash elements. */
 void hash_destroy( hash *hash_pt );
@@ -50,7 +86,7 @@ void hash_destroy( hash *hash_pt );
 /* Debug function that prints hash meta data and all hash elements. */
 void hash_print( hash *hash_pt );
 
-/* Output some collision stats for a given hash. */
+/* Output the probe distance of each element for a given hash. */
 void hash_collision_stats( hash *hash_pt );
 
 
@@ -0,0 +1,58 @@
+/* Martin Asser Hansen (mail@maasha.dk) Copyright (C) 2008 - All right reserved */
+
+/* Count tables of oligo codes - k-mers packed in 64 bits - with a choice */
+/* of layouts that trade speed for memory: */
+
+/*    KCOUNT_DENSE   - uint array indexed by code (4 bytes per code). */
+/*    KCOUNT_DENSE16 - uint16_t array with counts saturating at 65535. */
+/*    KCOUNT_DENSE8  - uint8_t array with counts saturating at 255. */
+/*    KCOUNT_SPARSE  - hashed counts of the codes seen (12 bytes per code */
+/*                     in a slot - 16 to 32 bytes with the free slots). */
+
+/* Counts above the saturation value of a dense array are kept in an */
+/* overflow table hashed like the sparse counts, so all layouts return */
+/* exact counts. Dense layouts suit short oligos where most codes are */
+/* seen - the sparse layout suits long oligos where few are. */
+
+/* Hashed counts are kept in a chash of 64 bit keys. Tables created as */
+/* shared may be updated by many threads: Dense counts are updated with */
+/* atomic operations, and the hashed counts are locked per chash shard. */
+
+#define KCOUNT_DENSE     0
+#define KCOUNT_DENSE16   1
+#define KCOUNT_DENSE8    2
+#define KCOUNT_SPARSE    3
+
+/* Structure of a count table. */
+struct _kcount
+{
+    int       layout;   /* Layout of table. */
+    uint64_t  size;     /* Number of codes in dense array. */
+    void     *dense;    /* Dense array - NULL if sparse. */
+    uint      max;      /* Saturation value of dense counts. */
+    chash    *hash;     /* Hashed counts - sparse counts or overflow of dense counts - NULL if KCOUNT_DENSE. */
+    bool      shared;   /* Flag indicating that the table is shared between threads. */
+};
+
+typedef struct _kcount kcount;
+
+/* Initialize a new count table of a given layout. Dense layouts */
+/* hold codes from 0 to size - 1, the sparse layout ignores size. */
+kcount  *kcount_new( int layout, uint64_t size, bool shared );
+
+/* Add n to the count of a code. */
+void     kcount_add( kcount *table, uint64_t code, uint n );
+
+/* Returns the count of a code. */
+uint     kcount_get( kcount *table, uint64_t code );
+
+/* Add all counts of the table src to the table dst. */
+void     kcount_merge( kcount *dst, kcount *src );
+
+/* Returns the number of bytes used by a count table. */
+size_t   kcount_mem( kcount *table );
+
+/* Deallocate memory for a count table. */
+void     kcount_destroy( kcount **table_ppt );
+
+
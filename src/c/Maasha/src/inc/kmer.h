@@ -0,0 +1,69 @@
+/* Martin Asser Hansen (mail@maasha.dk) Copyright (C) 2008 - All right reserved */
+
+/* Nucleotide k-mers are packed into uint64_t with 2 bits per residue */
+/* using the same codes as oligo2bin (A=0, T/U=1, C=2, G=3). K-mers */
+/* with other residues than ACGTU are skipped. */
+
+/* A kmer_index maps k-mers to postings - the positions where each */
+/* k-mer begins in a sequence - stored in one flat array grouped by */
+/* k-mer. Short k-mers are indexed with a direct table of offsets, */
+/* longer k-mers with a sorted array of distinct k-mers split into */
+/* buckets on their top bits. Positions are first partitioned on the */
+/* top bits of the k-mer and then sorted bucket by bucket, so the */
+/* index is built in passes that stay in cache. */
+
+#define KMER_MAX         32                          /* Max k-mer size packed in a uint64_t. */
+#define KMER_DIRECT_MAX  12                          /* Max k-mer size indexed with a direct table. */
+#define KMER_BUCKET_BITS 16                          /* Number of k-mer bits sorted within a bucket. */
+#define KMER_BUCKETS     ( 1 << KMER_BUCKET_BITS )   /* Max number of buckets. */
+
+/* Structure of a rolling k-mer iterator over a sequence. */
+struct _kmer_iter
+{
+    char     *seq;    /* Sequence. */
+    size_t    pos;    /* Position of next residue. */
+    size_t    end;    /* End position - exclusive. */
+    uint      k;      /* K-mer size. */
+    uint      len;    /* Number of valid residues in current k-mer. */
+    uint64_t  mask;   /* Mask to trim k-mers to 2 * k bits. */
+    uint64_t  kmer;   /* Current k-mer. */
+};
+
+typedef struct _kmer_iter kmer_iter;
+
+/* Structure of a k-mer index. */
+struct _kmer_index
+{
+    uint      k;            /* K-mer size. */
+    uint     *postings;     /* Positions of k-mers grouped by k-mer in ascending order. */
+    size_t    count;        /* Number of postings. */
+    uint     *offsets;      /* Offsets of posting groups by k-mer, or by k-mer number if sorted. */
+    uint64_t *kmers;        /* Sorted distinct k-mers - NULL if direct. */
+    size_t    nmemb;        /* Number of distinct k-mers if sorted. */
+    uint     *buckets;      /* Number of first k-mer in each bucket if sorted. */
+    int       shift;        /* Shift of k-mer to get bucket. */
+};
+
+typedef struct _kmer_index kmer_index;
+
+/* Pack a k-mer from the first k residues of a sequence into kmer_pt. */
+/* Returns FALSE if the k-mer contains other residues than ACGTU. */
+bool        kmer_encode( char *seq, uint k, uint64_t *kmer_pt );
+
+/* Initialize a rolling k-mer iterator over seq[ beg ] to seq[ end - 1 ]. */
+void        kmer_iter_init( kmer_iter *iter, char *seq, size_t beg, size_t end, uint k );
+
+/* Get the next k-mer and its begin position from an iterator. */
+/* Returns FALSE when no more k-mers. */
+bool        kmer_iter_next( kmer_iter *iter, uint64_t *kmer_pt, size_t *pos_pt );
+
+/* Build a k-mer index over seq[ beg ] to seq[ end - 1 ]. */
+kmer_index *kmer_index_new( char *seq, size_t beg, size_t end, uint k );
+
+/* Lookup the postings of a k-mer in an index - returns NULL if not found. */
+uint       *kmer_index_get( kmer_index *index, uint64_t kmer, size_t *count_pt );
+
+/* Deallocate memory for a k-mer index. */
+void        kmer_index_destroy( kmer_index **index_ppt );
+
+
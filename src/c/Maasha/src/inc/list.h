@@ -73,6 +73,11 @@ void     node_sl_print( node_sl *node_pt );
 /* Sort a singly linked list according to the compare function. */
 void     list_sl_sort( list_sl **list_ppt, int ( *compare )( const void *a, const void *b ) );
 
+/* Stable radix sort of a singly linked list on the 64 bit key returned */
+/* for each node value by a key function, which is passed the value */
+/* and a data pointer. */
+void     list_sl_sort_radix( list_sl **list_ppt, uint64_t ( *key )( const void *val, void *data ), void *data );
+
 /* Free memory for all nodes in and including the singly linked list. */
 void     list_sl_destroy( list_sl **list_ppt );
 
@@ -1,8 +1,9 @@
 /* Martin Asser Hansen (mail@maasha.dk) Copyright (C) 2008 - All right reserved */
 
-/* Constants for allocating memory for sequence entries. */
+/* Constants for the initial memory allocation for sequence entries. */
+/* Entries are resized with seq_resize and seq_name_resize as needed. */
 #define MAX_SEQ_NAME      1024
-#define MAX_SEQ      250000000
+#define MAX_SEQ           1024
 
 /* Macro to test if a given char is sequence (DNA, RNA, Protein, indels. brackets, etc ). */
 #define isseq( x ) ( x > 32 && x < 127 ) ? 1 : 0
@@ -13,6 +14,9 @@
 /* Macro to test if a given char is RNA. */
 #define isRNA( c ) ( c == 'A' || c == 'a' || c == 'U' || c == 'u' ||  c == 'C' || c == 'c' ||  c == 'G' || c == 'g' || c == 'N' || c == 'n' ) ? 1 : 0
 
+/* Macro returning the 2 bit code of a nucleotide as used by oligo2bin - or -1 if not ACGTU. */
+#define nuc2bin( c ) ( nuc_bin[ ( uchar ) ( c ) ] )
+
 /* Macros for converting DNA ASCII to binary. */
 #define add_A( c )              /* add 00 to the rightmost two bits of bin (i.e. do nothing). */
 #define add_T( c ) ( c |= 3 )   /* add 11 on the rightmost two bits of c. */
@@ -23,9 +27,11 @@
 /* Definition of a sequence entry */
 struct _seq_entry
 {
-    char   *seq_name;
-    char   *seq;
-    size_t  seq_len;
+    char   *seq_name;        /* Sequence name. */
+    char   *seq;             /* Sequence. */
+    size_t  seq_len;         /* Sequence length. */
+    size_t  seq_name_size;   /* Allocated size of seq_name. */
+    size_t  seq_size;        /* Allocated size of seq. */
 };
 
 typedef struct _seq_entry seq_entry;
@@ -33,7 +39,11 @@ typedef struct _seq_entry seq_entry;
 /* Byte array for fast convertion of binary blocks to DNA. */
 /* Binary blocks holds four nucleotides encoded in 2 bits: */
 /* A=00 T=11 C=01 G=10 */
-char *bin2dna[256];
+extern char *bin2dna[256];
+
+/* Byte array for fast convertion of nucleotides to 2 bit codes */
+/* as used by oligo2bin: A=00 T/U=01 C=10 G=11 - others -1. */
+extern signed char nuc_bin[256];
 
 /* Initialize a new sequence entry. */
 seq_entry *seq_new( size_t max_seq_name, size_t max_seq );
@@ -41,6 +51,15 @@ seq_entry *seq_new( size_t max_seq_name, size_t max_seq );
 /* Destroy a sequence entry. */
 void       seq_destroy( seq_entry *entry );
 
+/* Resize a sequence entry so seq can hold len residues and a terminating \0. */
+void       seq_resize( seq_entry *entry, size_t len );
+
+/* Resize a sequence entry so seq_name can hold len chars and a terminating \0. */
+void       seq_name_resize( seq_entry *entry, size_t len );
+
+/* Empty a sequence entry for reuse while keeping the allocated memory. */
+void       seq_reset( seq_entry *entry );
+
 /* Uppercase sequence. */
 void       seq_uppercase( char *seq );
 
@@ -0,0 +1,24 @@
+/* Martin Asser Hansen (mail@maasha.dk) Copyright (C) 2008 - All right reserved */
+
+#define SORT_RADIX_BITS     8                          /* Number of key bits sorted per pass. */
+#define SORT_BUCKETS        ( 1 << SORT_RADIX_BITS )   /* Number of buckets per pass. */
+#define SORT_THREADS_MAX    64                         /* Max number of sorting threads. */
+#define SORT_PARALLEL_MIN   ( 64 * 1024 )              /* Min number of items per thread. */
+
+/* Structure of an item to be sorted on a packed 64 bit key. */
+/* The index refers to the record the key was extracted from. */
+struct _sort_item
+{
+    uint64_t key;     /* Packed sort key. */
+    size_t   index;   /* Index of record. */
+};
+
+typedef struct _sort_item sort_item;
+
+/* Stable LSD radix sort of items on their keys using a number of threads. */
+void sort_radix_items( sort_item *items, size_t count, int threads );
+
+/* Stable radix sort of an array of count elements of a given size on */
+/* the 64 bit key returned for each element by a key function, which */
+/* is passed the element and a data pointer, using a number of threads. */
+void sort_radix( void *base, size_t count, size_t size, uint64_t ( *key )( const void *elem, void *data ), void *data, int threads );
@@ -1,17 +1,25 @@
 /* Martin Asser Hansen (mail@maasha.dk) Copyright (C) 2008 - All right reserved */
 
-#define BED_BUFFER         2048
-#define BED_CHR_MAX          16
-#define BED_QID_MAX         256
-#define BED_ITEMRGB_MAX      16
-#define BED_BLOCKSIZES_MAX  256
-#define BED_QBEGS_MAX       256
+#define BED_BUFFER         2048   /* Initial size of the line copy of a BED entry. */
+#define BED_COLS_MIN          3
+#define BED_COLS_MAX         12
+#define BED_TABLE          1024   /* Initial number of entries in a BED table. */
+#define BED_ARENA   ( 64 * 1024 ) /* Initial size of the name arena of a BED table. */
+#define BED_MERGE_MAX        64   /* Max number of sorted runs merged at a time. */
+#define BED_KEY_RANK_BITS    24   /* Bits for chromosome rank in packed sort keys. */
+
+#define BED_SORT_CHR_BEG        1 /* Sort on chromosome AND begin position. */
+#define BED_SORT_CHR_STRAND_BEG 2 /* Sort on chromosome AND strand AND begin position. */
+#define BED_SORT_BEG            3 /* Sort on begin position. */
+#define BED_SORT_STRAND_BEG     4 /* Sort on strand AND begin position. */
 
 /* Structure of a BED entry with the 12 BED elements. */
 /* http://genome.ucsc.edu/FAQ/FAQformat#format1 */
+/* String elements point into a copy of the line owned by the entry. */
 struct _bed_entry
 {
     int    cols;       /* Number of BED elements used. */
+    int    max_cols;   /* Max number of BED elements to parse - 0 for all. */
     char  *chr;        /* Chromosome name. */
     uint   chr_beg;    /* Chromosome begin position. */
     uint   chr_end;    /* Chromosome end position. */
@@ -24,34 +32,105 @@ struct _bed_entry
     uint   blockcount; /* Number of blocks (exons). */
     char  *blocksizes; /* Comma separated string of blocks sizes. */
     char  *q_begs;     /* Comma separated string of block begins. */
+    char  *line;       /* Tokenized copy of the line. */
+    size_t line_len;   /* Length of line. */
+    size_t line_max;   /* Allocated size of line. */
 };
 
 typedef struct _bed_entry bed_entry;
 
-/* Returns a new BED entry with memory allocated for */
-/* a given number of columns. */
+/* Structure of a table of BED entries stored column wise. Chromosome */
+/* names are interned in a string pool and stored as ids, and the */
+/* q_id and any elements after strand are stored as text in an arena. */
+struct _bed_table
+{
+    size_t   count;       /* Number of entries. */
+    size_t   max;         /* Allocated number of entries. */
+    uint    *chr_ids;     /* Chromosome ids. */
+    uint    *chr_begs;    /* Chromosome begin positions. */
+    uint    *chr_ends;    /* Chromosome end positions. */
+    int     *scores;      /* Scores. */
+    char    *strands;     /* Strands. */
+    uchar   *cols;        /* Number of BED elements of each entry. */
+    size_t  *names;       /* Arena offsets of q_id followed by the elements after strand. */
+    char    *arena;       /* Arena of \0 terminated strings. */
+    size_t   arena_len;   /* Used size of arena. */
+    size_t   arena_max;   /* Allocated size of arena. */
+    char   **chrs;        /* String pool of chromosome names indexed by id. */
+    size_t   chr_count;   /* Number of chromosome names. */
+    size_t   chr_max;     /* Allocated number of chromosome names. */
+    uint    *chr_index;   /* Open addressing index of chromosome id + 1 - 0 is empty. */
+    size_t   chr_mask;    /* Mask of chromosome index size. */
+};
+
+typedef struct _bed_table bed_table;
+
+/* Returns a new BED entry that will be parsed up to a given */
+/* number of columns - or all columns if cols is 0. */
 bed_entry *bed_entry_new( const int cols );
 
 /* Free memory for a BED entry. */
 void bed_entry_destroy( bed_entry *entry );
 
-/* Get next BED entry from a file stream. */
-bool bed_entry_get( FILE *fp, bed_entry **entry_ppt );
+/* Get next BED entry from a file buffer. The number of columns */
+/* is detected from each line. Returns FALSE when no more entries. */
+bool bed_entry_get( file_buffer *buffer, bed_entry **entry_ppt );
 
 /* Get a singly linked list with all BED entries (of a given number of coluns */
 /* from a specified file. */
 list_sl *bed_entries_get( char *path, const int cols );
 
-/* Output a given number of columns from a BED entry to stdout. */
+/* Output a given number of columns from a BED entry to stdout - */
+/* or all columns of the entry if cols is 0. */
 void bed_entry_put( bed_entry *entry, int cols );
 
+/* Output a given number of columns from a BED entry to a stream - */
+/* or all columns of the entry if cols is 0. */
+void bed_entry_fput( FILE *fp, bed_entry *entry, int cols );
+
 /* Output a given number of columns from all BED entries */
 /* in a singly linked list. */
 void bed_entries_put( list_sl *entries, int cols );
 
+/* Sort a singly linked list of BED entries according to one of */
+/* the BED_SORT orders using radix sort on packed keys. */
+void bed_entries_sort( list_sl **entries_ppt, int sort );
+
 /* Free memory for all BED entries and list nodes. */
 void bed_entries_destroy( list_sl **entries_ppt );
 
+/* Returns a new empty BED table. */
+bed_table *bed_table_new();
+
+/* Add a BED entry to a BED table. */
+void bed_table_add( bed_table *table, bed_entry *entry );
+
+/* Get a BED table with all BED entries from a specified file - */
+/* parsed up to a given number of cols or all if cols is 0. */
+bed_table *bed_table_get( char *path, const int cols );
+
+/* Returns the id of a chromosome name in a BED table which is */
+/* added to the string pool if not found. */
+uint bed_table_chr_id( bed_table *table, char *chr );
+
+/* Sort a BED table in place according to one of the BED_SORT orders */
+/* using a number of threads. */
+void bed_table_sort( bed_table *table, int sort, int threads );
+
+/* Output a given number of columns from all entries in a BED table */
+/* to stdout - or all columns of each entry if cols is 0. */
+void bed_table_put( bed_table *table, int cols );
+
+/* Output a given number of columns from all entries in a BED table */
+/* to a stream - or all columns of each entry if cols is 0. */
+void bed_table_fput( FILE *fp, bed_table *table, int cols );
+
+/* Remove all entries from a BED table keeping the chromosome names. */
+void bed_table_clear( bed_table *table );
+
+/* Free memory for a BED table. */
+void bed_table_destroy( bed_table **table_ppt );
+
 /* Given a path to a BED file, read the given number of cols */
 /* according to the begin position. The result is written to stdout. */
 void bed_file_sort_beg( char *path, int cols );
@@ -68,6 +147,12 @@ void bed_file_sort_chr_beg( char *path, int cols );
 /* according to the chromosome AND strand AND begin position. The result is written to stdout. */
 void bed_file_sort_chr_strand_beg( char *path, int cols );
 
+/* Given a path to a BED file, read the given number of cols and sort */
+/* according to one of the BED_SORT orders using at most about mem */
+/* bytes of memory and a number of threads. Sorted runs are spilled to */
+/* temporary files in dir and merged. The result is written to stdout. */
+void bed_file_sort_external( char *path, int cols, int sort, char *dir, size_t mem, int threads );
+
 /* Compare function for sorting a singly linked list of BED entries */
 /* according to begin position. */
 int cmp_bed_sort_beg( const void *a, const void *b );
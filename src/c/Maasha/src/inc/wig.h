@@ -0,0 +1,168 @@
+/* Martin Asser Hansen (mail@maasha.dk) Copyright (C) 2008 - All right reserved */
+
+/* Writer of per-position value tracks. Values are put one position - or */
+/* one span of positions - at a time in ascending order per chromosome, */
+/* and are written as fixedStep, bedGraph or variableStep text or in a */
+/* binary format: */
+
+/* The text writer starts a new fixedStep section when the chromosome */
+/* changes or a position is skipped, and formats values in a buffer */
+/* that is written in large chunks instead of with printf. */
+
+/* The bedGraph and variableStep writers merge adjacent positions with */
+/* equal values into runs that are written as one line each. A new */
+/* variableStep section is started when the chromosome or the span of */
+/* the runs changes. */
+
+/* The binary format is inspired by bigWig: Values are stored as floats */
+/* in zlib compressed blocks of up to WIG_BLOCK_ITEMS values from one */
+/* chromosome. A block holds the number of runs of consecutive positions */
+/* (uint32_t), the offset from the block begin and the length of each */
+/* run (uint32_t pairs), and the values. For each zoom level, summaries */
+/* (count, min, max, sum and sum of squares) over bins of fixed size are */
+/* stored in compressed blocks as well. An index of all blocks and the */
+/* chromosome names is written at the end of the file, and its offset is */
+/* set in the header when the writer is closed - so the file must be */
+/* seekable. Integers are stored in native byte order. */
+
+/*    Header:     WIG_MAGIC (8 bytes) - index offset (uint64_t). */
+/*    Blocks:     compressed runs and values or wig_zoom records. */
+/*    Index:      chromosome count (uint32_t) - for each: name length */
+/*                (uint32_t) and name. Zoom level count (uint32_t). */
+/*                Data block count (uint64_t) and wig_block entries. */
+/*                For each zoom level: bin size (uint32_t), block count */
+/*                (uint64_t) and wig_block entries. */
+
+#define WIG_FIXEDSTEP     0              /* fixedStep text format. */
+#define WIG_BINARY        1              /* Binary format. */
+#define WIG_BEDGRAPH      2              /* bedGraph text format with runs of equal values. */
+#define WIG_VARSTEP       3              /* variableStep text format with runs of equal values. */
+
+#define WIG_MAGIC         "BPWIG01"      /* Magic string of binary format - 8 bytes with \0. */
+#define WIG_BUFFER        ( 1024 * 1024 ) /* Size of text output buffer. */
+#define WIG_BLOCK_ITEMS   4096           /* Max number of items in a binary block. */
+#define WIG_ZOOM_LEVELS   3              /* Number of zoom levels. */
+#define WIG_ZOOM_BIN      256            /* Bin size of first zoom level - 16 times larger per level. */
+
+/* Structure of a binary block index entry. */
+struct _wig_block
+{
+    uint32_t chrom;    /* Chromosome number. */
+    uint32_t count;    /* Number of values or zoom records in block. */
+    uint64_t beg;      /* Begin position of block. */
+    uint64_t end;      /* End position of block - exclusive. */
+    uint64_t offset;   /* File offset of compressed block. */
+    uint64_t size;     /* Size of compressed block. */
+};
+
+typedef struct _wig_block wig_block;
+
+/* Structure of a zoom record summarizing values in a bin. */
+struct _wig_zoom
+{
+    uint32_t chrom;    /* Chromosome number. */
+    uint32_t count;    /* Number of positions with values. */
+    uint64_t beg;      /* Begin position of bin. */
+    uint64_t end;      /* End position of bin - exclusive. */
+    float    min;      /* Min value. */
+    float    max;      /* Max value. */
+    double   sum;      /* Sum of values. */
+    double   sumsq;    /* Sum of squared values. */
+};
+
+typedef struct _wig_zoom wig_zoom;
+
+/* Structure of a zoom level of a binary writer or reader. */
+struct _wig_level
+{
+    uint32_t    bin;           /* Bin size. */
+    wig_zoom    current;       /* Summary of current bin - count 0 if none. */
+    wig_zoom   *records;       /* Zoom records waiting to be written. */
+    size_t      count;         /* Number of zoom records waiting. */
+    wig_block  *blocks;        /* Index of zoom blocks. */
+    size_t      block_count;   /* Number of zoom blocks. */
+};
+
+typedef struct _wig_level wig_level;
+
+/* Structure of a value track writer. */
+struct _wig_writer
+{
+    FILE       *fp;                         /* Output stream. */
+    int         format;                     /* Output format. */
+    int         decimals;                   /* Number of decimals of values - 0 for integers. */
+    char       *chr;                        /* Current chromosome. */
+    size_t      next;                       /* Next position in current section, run or block. */
+    char       *buffer;                     /* Text output buffer. */
+    size_t      len;                        /* Number of chars in text output buffer. */
+    double      value;                      /* Value of current run - bedGraph and variableStep. */
+    size_t      span;                       /* Span of current section - variableStep - 0 if none. */
+    uint32_t    chrom;                      /* Current chromosome number - binary. */
+    uint32_t    chr_count;                  /* Number of chromosomes - binary. */
+    char      **chrs;                       /* Chromosome names - binary. */
+    float      *values;                     /* Values of current block - binary. */
+    size_t      count;                      /* Number of values in current block - binary. */
+    uint32_t   *runs;                       /* Offset and length of runs in current block - binary. */
+    size_t      run_count;                  /* Number of runs in current block - binary. */
+    size_t      beg;                        /* Begin position of current run or block. */
+    wig_block  *blocks;                     /* Index of data blocks - binary. */
+    size_t      block_count;                /* Number of data blocks - binary. */
+    wig_level   levels[ WIG_ZOOM_LEVELS ];  /* Zoom levels - binary. */
+    uint64_t    offset;                     /* Current file offset - binary. */
+    uchar      *data;                       /* Block buffer - binary. */
+    uchar      *cdata;                      /* Compression buffer - binary. */
+    size_t      cdata_size;                 /* Size of compression buffer - binary. */
+    void       *zs;                         /* zlib stream reused for all blocks - binary. */
+};
+
+typedef struct _wig_writer wig_writer;
+
+/* Structure of a binary format reader. */
+struct _wig_reader
+{
+    FILE       *fp;                         /* Input stream. */
+    char      **chrs;                       /* Chromosome names. */
+    uint32_t    chr_count;                  /* Number of chromosomes. */
+    wig_block  *blocks;                     /* Index of data blocks. */
+    size_t      block_count;                /* Number of data blocks. */
+    wig_level   levels[ WIG_ZOOM_LEVELS ];  /* Zoom levels. */
+};
+
+typedef struct _wig_reader wig_reader;
+
+/* Initialize a new writer of a given format to a stream. Values are */
+/* written with a number of decimals - rounded to integers if 0. */
+wig_writer *wig_writer_new( FILE *fp, int format, int decimals );
+
+/* Put the value of a chromosome position (0-based). */
+void        wig_writer_put( wig_writer *writer, char *chr, size_t pos, double value );
+
+/* Put the value of chromosome positions from beg to end - exclusive. */
+void        wig_writer_put_span( wig_writer *writer, char *chr, size_t beg, size_t end, double value );
+
+/* Flush and deallocate memory for a writer. The stream is not closed. */
+void        wig_writer_destroy( wig_writer **writer_ppt );
+
+/* Format an unsigned integer in a buffer and return the number of chars. */
+size_t      wig_format_uint( char *buf, uint64_t value );
+
+/* Format a value with a number of decimals in a buffer of a given size */
+/* as snprintf %.*f and return the number of chars as snprintf. */
+size_t      wig_format_double( char *buf, size_t size, double value, int decimals );
+
+/* Open a binary format file and read the index. */
+wig_reader *wig_reader_new( char *path );
+
+/* Read the values of chromosome positions from beg to end - exclusive */
+/* - into values. Positions without values are set to NAN. Returns the */
+/* number of positions with values. */
+size_t      wig_reader_values( wig_reader *reader, char *chr, size_t beg, size_t end, float *values );
+
+/* Summarize the zoom records of a zoom level that overlap chromosome */
+/* positions from beg to end - exclusive. Returns FALSE if none. */
+bool        wig_reader_summary( wig_reader *reader, uint level, char *chr, size_t beg, size_t end, wig_zoom *summary );
+
+/* Close a binary format file and deallocate memory for a reader. */
+void        wig_reader_destroy( wig_reader **reader_ppt );
+
+
@@ -0,0 +1,25 @@
+/* Martin Asser Hansen (mail@maasha.dk) Copyright (C) 2008 - All right reserved */
+
+/* Transparent decompression of gzip, BGZF and zstd compressed streams. */
+/* A compressed stream is wrapped in a new stream that is read with the */
+/* usual stdio functions and closed with close_stream. zstd support */
+/* requires compiling with -DHAVE_ZSTD and linking with -lzstd. */
+
+#define ZFILE_BUFFER  ( 128 * 1024 )   /* Size of input buffer for compressed data. */
+#define ZFILE_PEEK    18               /* Number of bytes peeked to detect the format - size of a BGZF header. */
+#define ZFILE_THREADS 8                /* Max number of threads used to decompress BGZF blocks. */
+#define ZFILE_BATCH   64               /* Number of BGZF blocks decompressed per batch. */
+#define BGZF_BLOCK    ( 64 * 1024 )    /* Max size of a BGZF block - compressed or uncompressed. */
+
+#define ZFILE_PLAIN   0
+#define ZFILE_GZIP    1
+#define ZFILE_BGZF    2
+#define ZFILE_ZSTD    3
+
+/* Determine the compression format from the first bytes of a stream. */
+int   zfile_format( uchar *magic, size_t len );
+
+/* Given a stream opened for reading, detect the compression format and */
+/* return a stream of the decompressed data - or the stream itself if */
+/* the data is not compressed. */
+FILE *zfile_open( FILE *fp, char *file );
@@ -0,0 +1,791 @@
+/* Martin Asser Hansen (mail@maasha.dk) Copyright (C) 2008 - All right reserved */
+
+#include "common.h"
+#include "mem.h"
+#include "filesys.h"
+#include "biopieces.h"
+
+static bool   bp_record_end( file_buffer *buffer, size_t *end_ptr, size_t *next_ptr );
+static void   bp_record_parse( bp_record *record, char *beg, char *end );
+static bool   bp_record_get_text( file_buffer *buffer, bp_record *record );
+static bool   bp_record_get_binary( file_buffer *buffer, bp_record *record );
+static int    bp_format_detect( file_buffer *buffer );
+static bool   bp_buffer_ensure( file_buffer *buffer, size_t len );
+static bool   bp_frame_get( file_buffer *buffer, char *type_ptr, char **payload_ppt, size_t *len_ptr );
+static size_t bp_varint_get( char **pt_ppt, char *end );
+static size_t bp_varint_len( size_t val );
+static void   bp_varint_add( bp_writer *writer, size_t val );
+static size_t bp_writer_key( bp_writer *writer, bp_field *field, size_t i );
+static void   bp_record_put_binary( bp_writer *writer, bp_record *record );
+static void   bp_writer_add( bp_writer *writer, char *str, size_t len );
+
+
+bp_record *bp_record_new()
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Initialize a new empty Biopieces record. */
+
+    bp_record *record = NULL;
+
+    record = mem_get( sizeof( bp_record ) );
+
+    record->fields    = mem_get( BP_FIELDS * sizeof( bp_field ) );
+    record->count     = 0;
+    record->max       = BP_FIELDS;
+    record->format    = BP_UNKNOWN;
+    record->keys      = NULL;
+    record->key_lens  = NULL;
+    record->key_count = 0;
+    record->key_max   = 0;
+
+    return record;
+}
+
+
+bool bp_record_get( file_buffer *buffer, bp_record *record )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Get the next Biopieces record from a file buffer. The stream */
+    /* format, text or binary, is detected at the first record. */
+    /* Returns FALSE when no more records. */
+
+    if ( record->format == BP_UNKNOWN ) {
+        record->format = bp_format_detect( buffer );
+    }
+
+    if ( record->format == BP_BINARY ) {
+        return bp_record_get_binary( buffer, record );
+    } else {
+        return bp_record_get_text( buffer, record );
+    }
+}
+
+
+void bp_record_add( bp_record *record, char *key, char *val )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Add a field to a Biopieces record. Key and value are not copied */
+    /* and must be valid until the record is written or cleared. */
+
+    bp_field *field = NULL;
+
+    if ( record->count == record->max )
+    {
+        record->max  <<= 1;
+        record->fields = mem_resize( record->fields, record->max * sizeof( bp_field ) );
+    }
+
+    field = &record->fields[ record->count++ ];
+
+    field->key     = key;
+    field->key_len = strlen( key );
+    field->val     = val;
+    field->val_len = strlen( val );
+}
+
+
+char *bp_record_val( bp_record *record, char *key )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Lookup the value of a key in a Biopieces record - returns NULL if */
+    /* not found. Records are small so a linear scan is used. */
+
+    size_t i = 0;
+
+    for ( i = 0; i < record->count; i++ )
+    {
+        if ( strcmp( record->fields[ i ].key, key ) == 0 ) {
+            return record->fields[ i ].val;
+        }
+    }
+
+    return NULL;
+}
+
+
+void bp_record_clear( bp_record *record )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Remove all fields from a Biopieces record. */
+
+    record->count = 0;
+}
+
+
+void bp_record_destroy( bp_record **record_ppt )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Deallocate memory for a Biopieces record. */
+
+    bp_record *record = *record_ppt;
+    size_t     i      = 0;
+
+    for ( i = 0; i < record->key_count; i++ ) {
+        mem_free( &record->keys[ i ] );
+    }
+
+    mem_free( &record->keys );
+    mem_free( &record->key_lens );
+    mem_free( &record->fields );
+    mem_free( &record );
+
+    *record_ppt = NULL;
+}
+
+
+bp_writer *bp_writer_new( FILE *fp )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Initialize a buffered writer of Biopieces records to a stream. */
+
+    bp_writer *writer = NULL;
+
+    writer = mem_get( sizeof( bp_writer ) );
+
+    writer->fp        = fp;
+    writer->buf       = mem_get( BP_OUT );
+    writer->len       = 0;
+    writer->size      = BP_OUT;
+    writer->format    = BP_TEXT;
+    writer->header    = FALSE;
+    writer->keys      = NULL;
+    writer->key_lens  = NULL;
+    writer->key_count = 0;
+    writer->key_max   = 0;
+    writer->ids       = NULL;
+    writer->id_max    = 0;
+
+    return writer;
+}
+
+
+void bp_writer_binary( bp_writer *writer )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Switch a writer to binary framing. Only do this when the stream */
+    /* is read by a C stage, since Ruby and Perl stages read text only. */
+
+    assert( writer->len == 0 && ! writer->header );
+
+    writer->format = BP_BINARY;
+}
+
+
+void bp_record_put( bp_writer *writer, bp_record *record )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Write a Biopieces record to a buffered writer. Empty records are */
+    /* not written. */
+
+    bp_field *field = NULL;
+    size_t    i     = 0;
+
+    if ( record->count == 0 ) {
+        return;
+    }
+
+    if ( writer->format == BP_BINARY )
+    {
+        bp_record_put_binary( writer, record );
+
+        return;
+    }
+
+    for ( i = 0; i < record->count; i++ )
+    {
+        field = &record->fields[ i ];
+
+        bp_writer_add( writer, field->key, field->key_len );
+        bp_writer_add( writer, ": ", 2 );
+        bp_writer_add( writer, field->val, field->val_len );
+        bp_writer_add( writer, "\n", 1 );
+    }
+
+    bp_writer_add( writer, "---\n", 4 );
+}
+
+
+void bp_writer_flush( bp_writer *writer )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Flush the output buffer of a writer to the stream. */
+
+    if ( writer->len > 0 && fwrite( writer->buf, 1, writer->len, writer->fp ) != writer->len )
+    {
+        fprintf( stderr, "ERROR: Could not write record: %s\n", strerror( errno ) );
+        abort();
+    }
+
+    writer->len = 0;
+}
+
+
+void bp_writer_destroy( bp_writer **writer_ppt )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Flush and deallocate memory for a writer - the stream is not closed. */
+
+    bp_writer *writer = *writer_ppt;
+    size_t     i      = 0;
+
+    bp_writer_flush( writer );
+
+    fflush( writer->fp );
+
+    for ( i = 0; i < writer->key_count; i++ ) {
+        mem_free( &writer->keys[ i ] );
+    }
+
+    mem_free( &writer->keys );
+    mem_free( &writer->key_lens );
+    mem_free( &writer->ids );
+    mem_free( &writer->buf );
+    mem_free( &writer );
+
+    *writer_ppt = NULL;
+}
+
+
+static bool bp_record_get_text( file_buffer *buffer, bp_record *record )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Get the next record from a text stream. The record is first */
+    /* located in the buffer - refilling it as needed - and then the */
+    /* lines are split into key and value in place by replacing ':' */
+    /* and '\n' with '\0'. Thus the buffer is modified and no memory is */
+    /* allocated per field. Empty records are skipped. */
+
+    size_t end  = 0;
+    size_t next = 0;
+
+    record->count = 0;
+
+    while ( record->count == 0 )
+    {
+        if ( ! bp_record_end( buffer, &end, &next ) ) {
+            return FALSE;
+        }
+
+        bp_record_parse( record, &buffer->str[ buffer->buffer_pos ], &buffer->str[ end ] );
+
+        buffer->token_pos  = buffer->buffer_pos;
+        buffer->token_len  = next - buffer->buffer_pos;
+        buffer->buffer_pos = next;
+    }
+
+    return TRUE;
+}
+
+
+static bool bp_record_get_binary( file_buffer *buffer, bp_record *record )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Get the next record from a binary stream adding any key frames */
+    /* to the key dictionary on the way. Values point into the buffer */
+    /* and are already \0 terminated in the stream. */
+
+    bp_field *field   = NULL;
+    char     *payload = NULL;
+    char     *pt      = NULL;
+    char     *end     = NULL;
+    char      type    = 0;
+    size_t    len     = 0;
+    size_t    count   = 0;
+    size_t    id      = 0;
+    size_t    i       = 0;
+
+    while ( bp_frame_get( buffer, &type, &payload, &len ) )
+    {
+        pt  = payload;
+        end = payload + len;
+
+        if ( type == 'K' )
+        {
+            id = bp_varint_get( &pt, end );
+
+            if ( id != record->key_count )
+            {
+                fprintf( stderr, "ERROR: Bad key id in binary record stream: %zu\n", id );
+                abort();
+            }
+
+            if ( record->key_count == record->key_max )
+            {
+                record->key_max  = ( record->key_max == 0 ) ? BP_KEYS : record->key_max << 1;
+                record->keys     = mem_resize( record->keys, record->key_max * sizeof( char * ) );
+                record->key_lens = mem_resize( record->key_lens, record->key_max * sizeof( size_t ) );
+            }
+
+            record->keys[ record->key_count ] = mem_get( end - pt + 1 );
+
+            memcpy( record->keys[ record->key_count ], pt, end - pt );
+
+            record->keys[ record->key_count ][ end - pt ] = '\0';
+            record->key_lens[ record->key_count ]         = end - pt;
+
+            record->key_count++;
+        }
+        else if ( type == 'R' )
+        {
+            count = bp_varint_get( &pt, end );
+
+            while ( record->max < count )
+            {
+                record->max  <<= 1;
+                record->fields = mem_resize( record->fields, record->max * sizeof( bp_field ) );
+            }
+
+            for ( i = 0; i < count; i++ )
+            {
+                field = &record->fields[ i ];
+                id    = bp_varint_get( &pt, end );
+
+                if ( id >= record->key_count )
+                {
+                    fprintf( stderr, "ERROR: Undefined key id in binary record stream: %zu\n", id );
+                    abort();
+                }
+
+                field->key     = record->keys[ id ];
+                field->key_len = record->key_lens[ id ];
+                field->val_len = bp_varint_get( &pt, end );
+                field->val     = pt;
+
+                if ( field->val_len >= ( size_t ) ( end - pt ) || pt[ field->val_len ] != '\0' )
+                {
+                    fprintf( stderr, "ERROR: Bad value in binary record stream\n" );
+                    abort();
+                }
+
+                pt += field->val_len + 1;
+            }
+
+            record->count = count;
+
+            return TRUE;
+        }
+        else
+        {
+            fprintf( stderr, "ERROR: Unknown frame type in binary record stream: %d\n", type );
+            abort();
+        }
+    }
+
+    record->count = 0;
+
+    return FALSE;
+}
+
+
+static int bp_format_detect( file_buffer *buffer )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Detect the format of a record stream from the header and skip */
+    /* the header of binary streams. */
+
+    size_t len = strlen( BP_MAGIC + 1 ) + 1;
+
+    if ( ! bp_buffer_ensure( buffer, len ) || memcmp( &buffer->str[ buffer->buffer_pos ], BP_MAGIC, len ) != 0 ) {
+        return BP_TEXT;
+    }
+
+    if ( ! bp_buffer_ensure( buffer, len + 1 ) || buffer->str[ buffer->buffer_pos + len ] != BP_VERSION )
+    {
+        fprintf( stderr, "ERROR: Unsupported binary record stream version\n" );
+        abort();
+    }
+
+    buffer->buffer_pos += len + 1;
+
+    return BP_BINARY;
+}
+
+
+static bool bp_buffer_ensure( file_buffer *buffer, size_t len )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Ensure that at least len chars after buffer_pos are in the buffer */
+    /* refilling it as needed. Returns FALSE if EOF is reached first. */
+
+    while ( buffer->buffer_end - buffer->buffer_pos < len )
+    {
+        buffer->token_pos = buffer->buffer_pos;
+
+        if ( ! buffer_resize( buffer ) ) {
+            return FALSE;
+        }
+    }
+
+    return TRUE;
+}
+
+
+static bool bp_frame_get( file_buffer *buffer, char *type_ptr, char **payload_ppt, size_t *len_ptr )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Get the next frame from a binary stream making sure that the */
+    /* whole frame is in the buffer. Returns FALSE at EOF. */
+
+    char   *pt  = NULL;
+    size_t  hdr = 1;
+    size_t  len = 0;
+
+    if ( ! bp_buffer_ensure( buffer, 1 ) ) {
+        return FALSE;
+    }
+
+    /* The varint length ends with the first byte without the high bit. */
+    do
+    {
+        if ( ! bp_buffer_ensure( buffer, hdr + 1 ) || hdr > 10 )
+        {
+            fprintf( stderr, "ERROR: Truncated binary record stream\n" );
+            abort();
+        }
+    }
+    while ( buffer->str[ buffer->buffer_pos + hdr++ ] & 0x80 );
+
+    pt  = &buffer->str[ buffer->buffer_pos + 1 ];
+    len = bp_varint_get( &pt, &buffer->str[ buffer->buffer_pos + hdr ] );
+
+    if ( ! bp_buffer_ensure( buffer, hdr + len ) )
+    {
+        fprintf( stderr, "ERROR: Truncated binary record stream\n" );
+        abort();
+    }
+
+    *type_ptr    = buffer->str[ buffer->buffer_pos ];
+    *payload_ppt = &buffer->str[ buffer->buffer_pos + hdr ];
+    *len_ptr     = len;
+
+    buffer->token_pos   = buffer->buffer_pos;
+    buffer->token_len   = hdr + len;
+    buffer->buffer_pos += hdr + len;
+
+    return TRUE;
+}
+
+
+static size_t bp_varint_get( char **pt_ppt, char *end )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Decode an unsigned LEB128 varint advancing the pointer. */
+
+    uchar  *pt    = ( uchar * ) *pt_ppt;
+    size_t  val   = 0;
+    int     shift = 0;
+
+    while ( 1 )
+    {
+        if ( pt >= ( uchar * ) end || shift > 63 )
+        {
+            fprintf( stderr, "ERROR: Bad varint in binary record stream\n" );
+            abort();
+        }
+
+        val |= ( size_t ) ( *pt & 0x7f ) << shift;
+
+        shift += 7;
+
+        if ( ! ( *pt++ & 0x80 ) ) {
+            break;
+        }
+    }
+
+    *pt_ppt = ( char * ) pt;
+
+    return val;
+}
+
+
+static bool bp_record_end( file_buffer *buffer, size_t *end_ptr, size_t *next_ptr )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Locate the end of the record starting at buffer_pos, i.e. the */
+    /* start of the "---" line (end) and the start of the line after */
+    /* (next). The buffer is refilled keeping the record. At EOF the */
+    /* rest of the buffer is a record. Returns FALSE if no data left. */
+
+    char   *pt   = NULL;
+    size_t  scan = buffer->buffer_pos;
+    size_t  len  = 0;
+
+    while ( 1 )
+    {
+        if ( ( pt = memchr( &buffer->str[ scan ], '\n', buffer->buffer_end - scan ) ) != NULL )
+        {
+            len = pt - &buffer->str[ scan ];
+
+            if ( ( len == 3 || ( len == 4 && pt[ -1 ] == '\r' ) ) && strncmp( &buffer->str[ scan ], "---", 3 ) == 0 )
+            {
+                *end_ptr  = scan;
+                *next_ptr = pt - buffer->str + 1;
+
+                return TRUE;
+            }
+
+            scan = pt - buffer->str + 1;
+        }
+        else if ( buffer->eof )
+        {
+            if ( buffer->buffer_pos == buffer->buffer_end ) {
+                return FALSE;
+            }
+
+            *end_ptr  = buffer->buffer_end;
+            *next_ptr = buffer->buffer_end;
+
+            if ( strcmp( &buffer->str[ scan ], "---" ) == 0 ) {
+                *end_ptr = scan;
+            }
+
+            return TRUE;
+        }
+        else
+        {
+            /* buffer_resize keeps everything from token_pos and shifts the offsets. */
+            buffer->token_pos = buffer->buffer_pos;
+
+            scan -= buffer->buffer_pos;
+
+            buffer_resize( buffer );
+        }
+    }
+}
+
+
+static void bp_record_parse( bp_record *record, char *beg, char *end )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Parse the "key: value" lines between beg and end into the fields */
+    /* of a record splitting the lines in place. */
+
+    bp_field *field = NULL;
+    char     *nl    = NULL;
+    char     *sep   = NULL;
+
+    while ( beg < end )
+    {
+        if ( ( nl = memchr( beg, '\n', end - beg ) ) == NULL ) {
+            nl = end;
+        }
+
+        if ( ( sep = memchr( beg, ':', nl - beg ) ) == NULL || sep == beg || sep + 1 == nl || sep[ 1 ] != ' ' )
+        {
+            fprintf( stderr, "ERROR: Bad record format: %.*s\n", ( int ) ( nl - beg ), beg );
+            abort();
+        }
+
+        if ( record->count == record->max )
+        {
+            record->max  <<= 1;
+            record->fields = mem_resize( record->fields, record->max * sizeof( bp_field ) );
+        }
+
+        field = &record->fields[ record->count++ ];
+
+        field->key     = beg;
+        field->key_len = sep - beg;
+        field->val     = sep + 2;
+        field->val_len = nl - field->val;
+
+        if ( field->val_len > 0 && nl[ -1 ] == '\r' ) {
+            field->val_len--;
+        }
+
+        *sep = '\0';
+
+        field->val[ field->val_len ] = '\0';
+
+        beg = nl + 1;
+    }
+}
+
+
+static void bp_writer_add( bp_writer *writer, char *str, size_t len )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Append a string of a given length to the output buffer of a writer */
+    /* flushing it when full. Strings larger than the buffer are written */
+    /* directly. */
+
+    if ( writer->len + len > writer->size )
+    {
+        bp_writer_flush( writer );
+
+        if ( len > writer->size )
+        {
+            if ( fwrite( str, 1, len, writer->fp ) != len )
+            {
+                fprintf( stderr, "ERROR: Could not write record: %s\n", strerror( errno ) );
+                abort();
+            }
+
+            return;
+        }
+    }
+
+    memcpy( &writer->buf[ writer->len ], str, len );
+
+    writer->len += len;
+}
+
+
+static size_t bp_varint_len( size_t val )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Returns the number of bytes of an unsigned LEB128 varint. */
+
+    size_t len = 1;
+
+    while ( val >= 0x80 )
+    {
+        val >>= 7;
+        len++;
+    }
+
+    return len;
+}
+
+
+static void bp_varint_add( bp_writer *writer, size_t val )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Append an unsigned LEB128 varint to the output of a writer. */
+
+    char   buf[ 10 ];
+    size_t len = 0;
+
+    while ( val >= 0x80 )
+    {
+        buf[ len++ ] = ( char ) ( ( val & 0x7f ) | 0x80 );
+        val >>= 7;
+    }
+
+    buf[ len++ ] = ( char ) val;
+
+    bp_writer_add( writer, buf, len );
+}
+
+
+static size_t bp_writer_key( bp_writer *writer, bp_field *field, size_t i )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Returns the key id of field number i of a record. Records usually */
+    /* have the same keys in the same order, so the id used for the same */
+    /* field of the last record is tried first. New keys are added to */
+    /* the dictionary and a key frame is written. */
+
+    size_t id = 0;
+
+    if ( i < writer->id_max && ( id = writer->ids[ i ] ) < writer->key_count && writer->key_lens[ id ] == field->key_len && memcmp( writer->keys[ id ], field->key, field->key_len ) == 0 ) {
+        return id;
+    }
+
+    for ( id = 0; id < writer->key_count; id++ )
+    {
+        if ( writer->key_lens[ id ] == field->key_len && memcmp( writer->keys[ id ], field->key, field->key_len ) == 0 ) {
+            break;
+        }
+    }
+
+    if ( id == writer->key_count )
+    {
+        if ( writer->key_count == writer->key_max )
+        {
+            writer->key_max  = ( writer->key_max == 0 ) ? BP_KEYS : writer->key_max << 1;
+            writer->keys     = mem_resize( writer->keys, writer->key_max * sizeof( char * ) );
+            writer->key_lens = mem_resize( writer->key_lens, writer->key_max * sizeof( size_t ) );
+        }
+
+        writer->keys[ id ]     = mem_clone( field->key, field->key_len + 1 );
+        writer->key_lens[ id ] = field->key_len;
+
+        writer->key_count++;
+
+        bp_writer_add( writer, "K", 1 );
+        bp_varint_add( writer, bp_varint_len( id ) + field->key_len );
+        bp_varint_add( writer, id );
+        bp_writer_add( writer, field->key, field->key_len );
+    }
+
+    if ( i >= writer->id_max )
+    {
+        writer->id_max = ( i < BP_FIELDS ) ? BP_FIELDS : i << 1;
+        writer->ids    = mem_resize( writer->ids, writer->id_max * sizeof( size_t ) );
+    }
+
+    writer->ids[ i ] = id;
+
+    return id;
+}
+
+
+static void bp_record_put_binary( bp_writer *writer, bp_record *record )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Write a record as a binary frame preceded by frames for any new keys. */
+
+    bp_field *field = NULL;
+    size_t    len   = 0;
+    size_t    i     = 0;
+
+    if ( ! writer->header )
+    {
+        bp_writer_add( writer, BP_MAGIC, strlen( BP_MAGIC + 1 ) + 1 );
+        bp_varint_add( writer, BP_VERSION );
+
+        writer->header = TRUE;
+    }
+
+    for ( i = 0; i < record->count; i++ ) {
+        bp_writer_key( writer, &record->fields[ i ], i );
+    }
+
+    len = bp_varint_len( record->count );
+
+    for ( i = 0; i < record->count; i++ )
+    {
+        field = &record->fields[ i ];
+
+        len += bp_varint_len( writer->ids[ i ] ) + bp_varint_len( field->val_len ) + field->val_len + 1;
+    }
+
+    bp_writer_add( writer, "R", 1 );
+    bp_varint_add( writer, len );
+    bp_varint_add( writer, record->count );
+
+    for ( i = 0; i < record->count; i++ )
+    {
+        field = &record->fields[ i ];
+
+        bp_varint_add( writer, writer->ids[ i ] );
+        bp_varint_add( writer, field->val_len );
+        bp_writer_add( writer, field->val, field->val_len );
+        bp_writer_add( writer, "", 1 );
+    }
+}
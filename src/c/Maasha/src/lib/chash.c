@@ -0,0 +1,707 @@
+/* Martin Asser Hansen (mail@maasha.dk) Copyright (C) 2008 - All right reserved */
+
+#include <pthread.h>
+#include "common.h"
+#include "mem.h"
+#include "hash.h"
+#include "chash.h"
+
+
+static chash_node      *chash_lookup( chash_table *table, char *key, uint h );
+static chash_node      *chash_node_get( chash *hash_pt, char *key, uint64_t val, bool *new_pt );
+static chash_table     *chash_table_new( size_t size );
+static void             chash_table_put( chash_table *table, chash_node *node, uint h );
+static void             chash_shard_grow( chash_shard *shard );
+static chash_node      *chash_arena_add( chash_shard *shard, char *key, uint64_t val );
+static chash_shard     *chash_shard_u64( chash *hash_pt, uint64_t key, uint *h_pt );
+static chash_u64_slot  *chash_lookup_u64( chash_u64_table *table, uint64_t key, uint h );
+static chash_u64_table *chash_table_new_u64( size_t size );
+static void             chash_shard_grow_u64( chash_shard *shard );
+
+
+chash *chash_new( uint shards )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Initialize a new concurrent hash with a number of shards */
+    /* rounded up to a power of 2 - or CHASH_SHARDS if 0. */
+
+    chash       *new_hash = NULL;
+    chash_shard *shard    = NULL;
+    uint         count    = 1;
+    uint         i        = 0;
+
+    if ( shards == 0 ) {
+        shards = CHASH_SHARDS;
+    }
+
+    while ( count < shards ) {
+        count <<= 1;
+    }
+
+    new_hash = mem_get( sizeof( chash ) );
+
+    new_hash->shards = mem_get_zero( sizeof( chash_shard ) * count );
+    new_hash->mask   = count - 1;
+    new_hash->shared = TRUE;
+
+    for ( i = 0; i < count; i++ )
+    {
+        shard = &new_hash->shards[ i ];
+
+        pthread_mutex_init( &shard->lock, NULL );
+
+        shard->table = chash_table_new( ( size_t ) 1 << CHASH_BITS_MIN );
+    }
+
+    return new_hash;
+}
+
+
+bool chash_get( chash *hash_pt, char *key, uint64_t *val_pt )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Lookup a key without locking and set val_pt to the value. */
+    /* Returns FALSE if the key is not found. */
+
+    chash_shard *shard = NULL;
+    chash_table *table = NULL;
+    chash_node  *node  = NULL;
+    uint         h     = 0;
+
+    h     = hash_wy( key, strlen( key ) );
+    shard = &hash_pt->shards[ h & hash_pt->mask ];
+    table = __atomic_load_n( &shard->table, __ATOMIC_ACQUIRE );
+
+    if ( ( node = chash_lookup( table, key, h ) ) == NULL ) {
+        return FALSE;
+    }
+
+    *val_pt = __atomic_load_n( &node->val, __ATOMIC_RELAXED );
+
+    return TRUE;
+}
+
+
+uint64_t chash_add( chash *hash_pt, char *key, uint64_t delta )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Add delta to the value of a key atomically - the key is */
+    /* inserted with the value delta if not found. Returns the new value. */
+
+    chash_node *node = NULL;
+    bool        new  = FALSE;
+
+    node = chash_node_get( hash_pt, key, 0, &new );
+
+    return __atomic_add_fetch( &node->val, delta, __ATOMIC_RELAXED );
+}
+
+
+bool chash_insert( chash *hash_pt, char *key, uint64_t val, uint64_t *val_pt )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Insert a key with a value unless the key is found. Returns */
+    /* TRUE if inserted, and the value in the hash is set in val_pt. */
+
+    chash_node *node = NULL;
+    bool        new  = FALSE;
+
+    node = chash_node_get( hash_pt, key, val, &new );
+
+    *val_pt = __atomic_load_n( &node->val, __ATOMIC_RELAXED );
+
+    return new;
+}
+
+
+void chash_set( chash *hash_pt, char *key, uint64_t val )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Set the value of a key atomically - the key is inserted if not found. */
+
+    chash_node *node = NULL;
+    bool        new  = FALSE;
+
+    node = chash_node_get( hash_pt, key, val, &new );
+
+    if ( ! new ) {
+        __atomic_store_n( &node->val, val, __ATOMIC_RELAXED );
+    }
+}
+
+
+chash *chash_new_u64( uint shards, bool shared )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Initialize a new hash of 64 bit keys to 32 bit values with a number */
+    /* of shards as chash_new. The hash is locked only if shared. The key */
+    /* ~0 is reserved. */
+
+    chash       *new_hash = NULL;
+    chash_shard *shard    = NULL;
+    uint         i        = 0;
+
+    new_hash = chash_new( shards );
+
+    new_hash->shared = shared;
+
+    for ( i = 0; i <= new_hash->mask; i++ )
+    {
+        shard = &new_hash->shards[ i ];
+
+        mem_free( &shard->table );
+
+        shard->table_u64 = chash_table_new_u64( ( size_t ) 1 << CHASH_BITS_MIN );
+    }
+
+    return new_hash;
+}
+
+
+bool chash_get_u64( chash *hash_pt, uint64_t key, uint *val_pt )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Lookup a 64 bit key and set val_pt to the value. Returns FALSE if */
+    /* the key is not found. */
+
+    chash_shard    *shard = NULL;
+    chash_u64_slot *slot  = NULL;
+    uint            h     = 0;
+    bool            found = FALSE;
+
+    shard = chash_shard_u64( hash_pt, key, &h );
+
+    if ( hash_pt->shared ) {
+        pthread_mutex_lock( &shard->lock );
+    }
+
+    slot = chash_lookup_u64( shard->table_u64, key, h );
+
+    if ( slot->key_lo != 0 || slot->key_hi != 0 )
+    {
+        *val_pt = slot->val;
+
+        found = TRUE;
+    }
+
+    if ( hash_pt->shared ) {
+        pthread_mutex_unlock( &shard->lock );
+    }
+
+    return found;
+}
+
+
+uint chash_add_u64( chash *hash_pt, uint64_t key, uint delta )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Add delta to the value of a 64 bit key - the key is inserted with */
+    /* the value delta if not found. Returns the new value. */
+
+    chash_shard    *shard = NULL;
+    chash_u64_slot *slot  = NULL;
+    uint            h     = 0;
+    uint            val   = 0;
+
+    assert( key != ~( uint64_t ) 0 );
+
+    shard = chash_shard_u64( hash_pt, key, &h );
+
+    if ( hash_pt->shared ) {
+        pthread_mutex_lock( &shard->lock );
+    }
+
+    slot = chash_lookup_u64( shard->table_u64, key, h );
+
+    if ( slot->key_lo == 0 && slot->key_hi == 0 )
+    {
+        if ( ( shard->nmemb + 1 ) * 100 > shard->table_u64->size * CHASH_LOAD )
+        {
+            chash_shard_grow_u64( shard );
+
+            slot = chash_lookup_u64( shard->table_u64, key, h );
+        }
+
+        slot->key_lo = ( uint ) ( key + 1 );
+        slot->key_hi = ( uint ) ( ( key + 1 ) >> 32 );
+
+        __atomic_store_n( &shard->nmemb, shard->nmemb + 1, __ATOMIC_RELAXED );
+    }
+
+    val = slot->val += delta;
+
+    if ( hash_pt->shared ) {
+        pthread_mutex_unlock( &shard->lock );
+    }
+
+    return val;
+}
+
+
+size_t chash_count( chash *hash_pt )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Returns the number of keys in a concurrent hash. */
+
+    size_t count = 0;
+    uint   i     = 0;
+
+    for ( i = 0; i <= hash_pt->mask; i++ ) {
+        count += __atomic_load_n( &hash_pt->shards[ i ].nmemb, __ATOMIC_RELAXED );
+    }
+
+    return count;
+}
+
+
+void chash_iter_init( chash_iter *iter, chash *hash_pt )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Initialize an iterator over a concurrent hash. */
+
+    iter->hash_pt = hash_pt;
+    iter->shard   = 0;
+    iter->index   = 0;
+    iter->table   = __atomic_load_n( &hash_pt->shards[ 0 ].table, __ATOMIC_ACQUIRE );
+
+    iter->table_u64 = hash_pt->shards[ 0 ].table_u64;
+}
+
+
+bool chash_iter_next( chash_iter *iter, char **key_ppt, uint64_t *val_pt )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Get the next key and value from an iterator. Returns FALSE when no more. */
+
+    chash_node *node = NULL;
+
+    while ( iter->shard <= iter->hash_pt->mask )
+    {
+        while ( iter->index < iter->table->size )
+        {
+            node = __atomic_load_n( &iter->table->slots[ iter->index++ ].node, __ATOMIC_ACQUIRE );
+
+            if ( node != NULL )
+            {
+                *key_ppt = node->key;
+                *val_pt  = __atomic_load_n( &node->val, __ATOMIC_RELAXED );
+
+                return TRUE;
+            }
+        }
+
+        if ( ++iter->shard <= iter->hash_pt->mask )
+        {
+            iter->index = 0;
+            iter->table = __atomic_load_n( &iter->hash_pt->shards[ iter->shard ].table, __ATOMIC_ACQUIRE );
+        }
+    }
+
+    return FALSE;
+}
+
+
+bool chash_iter_next_u64( chash_iter *iter, uint64_t *key_pt, uint *val_pt )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Get the next 64 bit key and value from an iterator. Returns FALSE when */
+    /* no more. The hash may not be changed during the iteration. */
+
+    chash_u64_slot *slot = NULL;
+
+    while ( iter->shard <= iter->hash_pt->mask )
+    {
+        while ( iter->index < iter->table_u64->size )
+        {
+            slot = &iter->table_u64->slots[ iter->index++ ];
+
+            if ( slot->key_lo != 0 || slot->key_hi != 0 )
+            {
+                *key_pt = ( ( ( uint64_t ) slot->key_hi << 32 ) | slot->key_lo ) - 1;
+                *val_pt = slot->val;
+
+                return TRUE;
+            }
+        }
+
+        if ( ++iter->shard <= iter->hash_pt->mask )
+        {
+            iter->index     = 0;
+            iter->table_u64 = iter->hash_pt->shards[ iter->shard ].table_u64;
+        }
+    }
+
+    return FALSE;
+}
+
+
+size_t chash_mem( chash *hash_pt )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Returns the number of bytes used by the shards and tables of a */
+    /* concurrent hash. Node arenas of string keys are not included. */
+
+    chash_shard *shard = NULL;
+    chash_table *table = NULL;
+    size_t       mem   = sizeof( chash );
+    uint         i     = 0;
+
+    for ( i = 0; i <= hash_pt->mask; i++ )
+    {
+        shard = &hash_pt->shards[ i ];
+
+        mem += sizeof( chash_shard );
+
+        if ( shard->table_u64 != NULL ) {
+            mem += sizeof( chash_u64_table ) + sizeof( chash_u64_slot ) * shard->table_u64->size;
+        }
+
+        if ( shard->table != NULL ) {
+            mem += sizeof( chash_table ) + sizeof( chash_slot ) * shard->table->size;
+        }
+
+        for ( table = shard->old; table != NULL; table = table->next ) {
+            mem += sizeof( chash_table ) + sizeof( chash_slot ) * table->size;
+        }
+    }
+
+    return mem;
+}
+
+
+void chash_destroy( chash **hash_ppt )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Deallocate memory for a concurrent hash - no threads may use it. */
+
+    chash       *hash_pt = *hash_ppt;
+    chash_shard *shard   = NULL;
+    chash_table *table   = NULL;
+    chash_table *next    = NULL;
+    uint         i       = 0;
+    size_t       j       = 0;
+
+    for ( i = 0; i <= hash_pt->mask; i++ )
+    {
+        shard = &hash_pt->shards[ i ];
+
+        for ( table = shard->old; table != NULL; table = next )
+        {
+            next = table->next;
+
+            mem_free( &table );
+        }
+
+        for ( j = 0; j < shard->arena_count; j++ ) {
+            mem_free( &shard->arenas[ j ] );
+        }
+
+        mem_free( &shard->arenas );
+        mem_free( &shard->table );
+        mem_free( &shard->table_u64 );
+
+        pthread_mutex_destroy( &shard->lock );
+    }
+
+    mem_free( &hash_pt->shards );
+    mem_free( hash_ppt );
+}
+
+
+static chash_node *chash_lookup( chash_table *table, char *key, uint h )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Lookup a key in a shard table with linear probing and return */
+    /* the node - or NULL if not found. Slots are never moved or */
+    /* cleared, so the probe may run without locking. */
+
+    chash_slot *slot = NULL;
+    chash_node *node = NULL;
+    size_t      mask = table->size - 1;
+    size_t      i    = 0;
+
+    i = ( size_t ) ( ( ( uint64_t ) h * 0x9e3779b97f4a7c15ULL ) >> table->shift );
+
+    while ( 1 )
+    {
+        slot = &table->slots[ i ];
+        node = __atomic_load_n( &slot->node, __ATOMIC_ACQUIRE );
+
+        if ( node == NULL ) {
+            return NULL;
+        }
+
+        if ( slot->hash == h && strcmp( node->key, key ) == 0 ) {
+            return node;
+        }
+
+        i = ( i + 1 ) & mask;
+    }
+}
+
+
+static chash_node *chash_node_get( chash *hash_pt, char *key, uint64_t val, bool *new_pt )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Returns the node of a key - the key is inserted with a value if */
+    /* not found and new_pt is set to TRUE. The lookup is first done */
+    /* without locking, and only if that fails, the shard is locked and */
+    /* the lookup repeated, as another thread may have inserted the key. */
+
+    chash_shard *shard = NULL;
+    chash_table *table = NULL;
+    chash_node  *node  = NULL;
+    uint         h     = 0;
+
+    *new_pt = FALSE;
+
+    h     = hash_wy( key, strlen( key ) );
+    shard = &hash_pt->shards[ h & hash_pt->mask ];
+    table = __atomic_load_n( &shard->table, __ATOMIC_ACQUIRE );
+
+    if ( ( node = chash_lookup( table, key, h ) ) != NULL ) {
+        return node;
+    }
+
+    pthread_mutex_lock( &shard->lock );
+
+    if ( ( node = chash_lookup( shard->table, key, h ) ) == NULL )
+    {
+        if ( ( shard->nmemb + 1 ) * 100 > shard->table->size * CHASH_LOAD ) {
+            chash_shard_grow( shard );
+        }
+
+        node = chash_arena_add( shard, key, val );
+
+        chash_table_put( shard->table, node, h );
+
+        __atomic_store_n( &shard->nmemb, shard->nmemb + 1, __ATOMIC_RELAXED );
+
+        *new_pt = TRUE;
+    }
+
+    pthread_mutex_unlock( &shard->lock );
+
+    return node;
+}
+
+
+static chash_table *chash_table_new( size_t size )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Allocate a shard table with size empty slots - size must be a power of 2. */
+
+    chash_table *table = NULL;
+
+    table = mem_get_zero( sizeof( chash_table ) + sizeof( chash_slot ) * size );
+
+    table->size  = size;
+    table->shift = 64 - __builtin_ctzll( size );
+
+    return table;
+}
+
+
+static void chash_table_put( chash_table *table, chash_node *node, uint h )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Put a node in the first free slot of its probe sequence. The hash */
+    /* is written before the node is published, so readers that see the */
+    /* node also see the hash. The shard must be locked. */
+
+    chash_slot *slot = NULL;
+    size_t      mask = table->size - 1;
+    size_t      i    = 0;
+
+    i = ( size_t ) ( ( ( uint64_t ) h * 0x9e3779b97f4a7c15ULL ) >> table->shift );
+
+    while ( table->slots[ i ].node != NULL ) {
+        i = ( i + 1 ) & mask;
+    }
+
+    slot = &table->slots[ i ];
+
+    slot->hash = h;
+
+    __atomic_store_n( &slot->node, node, __ATOMIC_RELEASE );
+}
+
+
+static void chash_shard_grow( chash_shard *shard )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Copy the nodes of a shard to a table of twice the size and */
+    /* publish the new table. The old table is kept for readers that */
+    /* may still be probing it. The shard must be locked. */
+
+    chash_table *old   = shard->table;
+    chash_table *table = NULL;
+    size_t       i     = 0;
+
+    table = chash_table_new( old->size << 1 );
+
+    for ( i = 0; i < old->size; i++ )
+    {
+        if ( old->slots[ i ].node != NULL ) {
+            chash_table_put( table, old->slots[ i ].node, old->slots[ i ].hash );
+        }
+    }
+
+    old->next  = shard->old;
+    shard->old = old;
+
+    __atomic_store_n( &shard->table, table, __ATOMIC_RELEASE );
+}
+
+
+static chash_node *chash_arena_add( chash_shard *shard, char *key, uint64_t val )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Create a node with a copy of a key and a value in the node arena */
+    /* of a shard. Nodes are 8 byte aligned for atomic access to the */
+    /* value. Nodes larger than an arena block get their own block. */
+    /* The shard must be locked. */
+
+    chash_node *node = NULL;
+    size_t      len  = strlen( key ) + 1;
+    size_t      size = ( sizeof( chash_node ) + len + 7 ) & ~( size_t ) 7;
+    size_t      max  = CHASH_ARENA;
+
+    if ( shard->arena_count == 0 || shard->arena_len + size > shard->arena_max )
+    {
+        if ( size > max ) {
+            max = size;
+        }
+
+        shard->arenas = mem_resize( shard->arenas, sizeof( char * ) * ( shard->arena_count + 1 ) );
+
+        shard->arenas[ shard->arena_count++ ] = mem_get( max );
+
+        shard->arena_len = 0;
+        shard->arena_max = max;
+    }
+
+    node = ( chash_node * ) &shard->arenas[ shard->arena_count - 1 ][ shard->arena_len ];
+
+    node->val = val;
+
+    memcpy( node->key, key, len );
+
+    shard->arena_len += size;
+
+    return node;
+}
+
+
+
+
+static chash_shard *chash_shard_u64( chash *hash_pt, uint64_t key, uint *h_pt )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Returns the shard of a 64 bit key and set h_pt to the hash of the */
+    /* key - hash_wy of the 8 bytes of the key as for string keys. */
+
+    *h_pt = hash_wy( ( char * ) &key, sizeof( key ) );
+
+    return &hash_pt->shards[ *h_pt & hash_pt->mask ];
+}
+
+
+static chash_u64_slot *chash_lookup_u64( chash_u64_table *table, uint64_t key, uint h )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Returns the slot of a 64 bit key in a shard table with linear */
+    /* probing - or the empty slot where it should be inserted. */
+
+    chash_u64_slot *slot = NULL;
+    size_t          mask = table->size - 1;
+    size_t          i    = 0;
+    uint            lo   = ( uint ) ( key + 1 );
+    uint            hi   = ( uint ) ( ( key + 1 ) >> 32 );
+
+    i = ( size_t ) ( ( ( uint64_t ) h * 0x9e3779b97f4a7c15ULL ) >> table->shift );
+
+    while ( 1 )
+    {
+        slot = &table->slots[ i ];
+
+        if ( ( slot->key_lo == lo && slot->key_hi == hi ) || ( slot->key_lo == 0 && slot->key_hi == 0 ) ) {
+            return slot;
+        }
+
+        i = ( i + 1 ) & mask;
+    }
+}
+
+
+static chash_u64_table *chash_table_new_u64( size_t size )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Allocate a shard table of 64 bit keys with size empty slots - size */
+    /* must be a power of 2. */
+
+    chash_u64_table *table = NULL;
+
+    table = mem_get_zero( sizeof( chash_u64_table ) + sizeof( chash_u64_slot ) * size );
+
+    table->size  = size;
+    table->shift = 64 - __builtin_ctzll( size );
+
+    return table;
+}
+
+
+static void chash_shard_grow_u64( chash_shard *shard )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Copy the slots of a shard of 64 bit keys to a table of twice the */
+    /* size. The old table is freed at once, as all access to the table */
+    /* is under the lock of a shared hash. */
+
+    chash_u64_table *old   = shard->table_u64;
+    chash_u64_table *table = NULL;
+    chash_u64_slot  *slot  = NULL;
+    uint64_t         key   = 0;
+    size_t           i     = 0;
+
+    table = chash_table_new_u64( old->size << 1 );
+
+    for ( i = 0; i < old->size; i++ )
+    {
+        if ( old->slots[ i ].key_lo != 0 || old->slots[ i ].key_hi != 0 )
+        {
+            key  = ( ( ( uint64_t ) old->slots[ i ].key_hi << 32 ) | old->slots[ i ].key_lo ) - 1;
+            slot = chash_lookup_u64( table, key, hash_wy( ( char * ) &key, sizeof( key ) ) );
+
+            *slot = old->slots[ i ];
+        }
+    }
+
+    shard->table_u64 = table;
+
+    mem_free( &old );
+}
@@ -1,5 +1,8 @@
 /* Martin Asser Hansen (mail@maasha.dk) Copyright (C) 2008 - All right reserved */
 
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include "common.h"
 #include "mem.h"
 #include "filesys.h"
@@ -7,6 +10,27 @@
 #include "fasta.h"
 #include "list.h"
 #include "strings.h"
+#include "zfile.h"
+
+#if defined( __GNUC__ ) && ( defined( __x86_64__ ) || defined( __i386__ ) )
+#include <immintrin.h>
+#define FASTA_X86
+#endif
+
+static size_t fasta_count_scan( char *block, size_t pos, size_t end, size_t *residues );
+static size_t fasta_count_scan_scalar( char *block, size_t pos, size_t end, size_t *residues );
+#ifdef FASTA_X86
+static size_t fasta_count_scan_sse2( char *block, size_t pos, size_t end, size_t *residues );
+static size_t fasta_count_scan_avx2( char *block, size_t pos, size_t end, size_t *residues );
+#endif
+static void fasta_map_release( fasta_map *map, size_t offset );
+static void fasta_view_add_line( fasta_view *view, char *str, size_t len );
+static fasta_index *fasta_index_new( char *path );
+static void fasta_index_add( fasta_index *index, char *name, size_t name_len, size_t len, size_t offset, size_t line_bases, size_t line_width );
+static void fasta_index_sort( fasta_index *index );
+static void fasta_index_put( fasta_index *index, FILE *fp );
+static int  cmp_fai_entry_name( const void *a, const void *b );
+static int  cmp_fai_entry_key( const void *key, const void *b );
 
 
 size_t fasta_count( FILE *fp )
@@ -15,19 +39,97 @@ size_t fasta_count( FILE *fp )
 
     /* Counts all entries in a FASTA file given a file pointer. */
 
-    char   buffer[ FASTA_BUFFER ];
-    size_t count;
+    fasta_stats stats;
+
+    fasta_count_stats( fp, &stats );
+
+    return stats.count;
+}
+
+
+void fasta_count_stats( FILE *fp, fasta_stats *stats )
+{
+    /* Martin A. Hansen, October 2026 */
 
-    count = 0;
+    /* Counts entries, residues and the residues of the longest entry */
+    /* in a FASTA file given a file pointer. The file is read in large */
+    /* blocks and entries are located by scanning for '>' at the start */
+    /* of a line, so lines of any length are handled. Residues are the */
+    /* printable non-space chars of the sequence lines. */
 
-    while ( ( fgets( buffer, sizeof( buffer ), fp ) ) != NULL )
+    char   *block      = NULL;
+    char   *pt         = NULL;
+    size_t  end        = 0;
+    size_t  pos        = 0;
+    size_t  len        = 0;
+    size_t  residues   = 0;
+    bool    header     = FALSE;
+    bool    line_start = TRUE;
+
+    stats->count    = 0;
+    stats->residues = 0;
+    stats->longest  = 0;
+
+    block = mem_get( FASTA_COUNT );
+
+    while ( ( end = fread( block, 1, FASTA_COUNT, fp ) ) > 0 )
     {
-        if ( buffer[ 0 ] == '>' ) {
-            count++;
+        pos = 0;
+
+        while ( pos < end )
+        {
+            if ( header )
+            {
+                if ( ( pt = memchr( &block[ pos ], '\n', end - pos ) ) == NULL )
+                {
+                    pos = end;
+                }
+                else
+                {
+                    pos        = pt - block + 1;
+                    header     = FALSE;
+                    line_start = TRUE;
+                }
+            }
+            else if ( line_start && block[ pos ] == '>' )
+            {
+                if ( stats->count > 0 && len > stats->longest ) {
+                    stats->longest = len;
+                }
+
+                stats->count++;
+
+                len    = 0;
+                header = TRUE;
+                pos++;
+            }
+            else
+            {
+                residues = 0;
+                pos      = fasta_count_scan( block, pos, end, &residues );
+
+                if ( stats->count > 0 )
+                {
+                    len             += residues;
+                    stats->residues += residues;
+                }
+
+                line_start = ( pos < end || block[ end - 1 ] == '\n' );
+            }
         }
     }
 
-    return count;
+    if ( ferror( fp ) )
+    {
+        fprintf( stderr, "ERROR: Could not read FASTA file: %s\n", strerror( errno ) );
+        abort();
+    }
+
+    if ( stats->count > 0 && len > stats->longest ) {
+        stats->longest = len;
+    }
+
+    mem_free( &block );
 }
 
 
@@ -38,11 +140,10 @@ bool fasta_get_entry( FILE *fp, seq_entry **entry_ppt )
     /* Get next sequence entry from a FASTA file given a file pointer. */
 
     seq_entry *entry = *entry_ppt;
+    size_t     i     = 0;
+    char       c;
 
-    entry->seq_len = 0;
-
-    char  c;
-    char *pt;
+    seq_reset( entry );
 
     while ( ( c = fgetc( fp ) ) && c != '>' && c != EOF ) {
     }
@@ -53,26 +154,26 @@ bool fasta_get_entry( FILE *fp, seq_entry **entry_ppt )
         return FALSE;
     }
 
-    pt = entry->seq_name;
+    while ( ( c = fgetc( fp ) ) && c != '\n' && c != EOF )
+    {
+        seq_name_resize( entry, i + 1 );
 
-    while ( ( c = fgetc( fp ) ) && c != '\n' ) {
-        *( pt++ ) = c;
+        entry->seq_name[ i++ ] = c;
     }
 
-    *( pt ) = '\0';
-
-    pt = entry->seq;
+    entry->seq_name[ i ] = '\0';
 
     while ( ( c = fgetc( fp ) ) && c != '>' && c != EOF )
     {
         if ( isseq( c ) )
         {
-            *( pt++ ) = c;
-            entry->seq_len++;
+            seq_resize( entry, entry->seq_len + 1 );
+
+            entry->seq[ entry->seq_len++ ] = c;
         }
     }
 
-    *( pt ) = '\0';
+    entry->seq[ entry->seq_len ] = '\0';
 
     if ( c == '>' ) {
         ungetc( c, fp );
@@ -84,6 +185,666 @@ bool fasta_get_entry( FILE *fp, seq_entry **entry_ppt )
 }
 
 
+bool fasta_get_entry_buffer( file_buffer *buffer, seq_entry **entry_ppt )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Get next sequence entry from a FASTA file buffer. The buffer is */
+    /* refilled in blocks and scanned for '>' and newlines with memchr, */
+    /* so whole sequence lines are copied with memcpy. The resulting */
+    /* entry is identical to what fasta_get_entry returns. */
+
+    seq_entry *entry    = *entry_ppt;
+    char      *beg      = NULL;
+    char      *end      = NULL;
+    char      *stop     = NULL;
+    char      *pt       = NULL;
+    size_t     name_len = 0;
+
+    seq_reset( entry );
+
+    /* ---- locate the next header ---- */
+
+    while ( 1 )
+    {
+        beg = &buffer->str[ buffer->buffer_pos ];
+        end = &buffer->str[ buffer->buffer_end ];
+
+        if ( beg < end && ( pt = memchr( beg, '>', end - beg ) ) != NULL )
+        {
+            buffer->buffer_pos = pt - buffer->str + 1;
+            break;
+        }
+
+        buffer->buffer_pos = buffer->buffer_end;
+
+        if ( ! buffer_fill( buffer ) ) {
+            return FALSE;
+        }
+    }
+
+    /* ---- sequence name ---- */
+
+    while ( 1 )
+    {
+        beg = &buffer->str[ buffer->buffer_pos ];
+        end = &buffer->str[ buffer->buffer_end ];
+
+        if ( ( pt = memchr( beg, '\n', end - beg ) ) != NULL ) {
+            break;
+        }
+
+        if ( ! buffer_fill( buffer ) )
+        {
+            beg = &buffer->str[ buffer->buffer_pos ];
+            pt  = &buffer->str[ buffer->buffer_end ];
+            break;
+        }
+    }
+
+    name_len = pt - beg;
+
+    seq_name_resize( entry, name_len );
+
+    memcpy( entry->seq_name, beg, name_len );
+
+    entry->seq_name[ name_len ] = '\0';
+
+    buffer->buffer_pos = pt - buffer->str;
+
+    if ( buffer->buffer_pos < buffer->buffer_end ) {
+        buffer->buffer_pos++;
+    }
+
+    /* ---- sequence lines until next '>' or EOF ---- */
+
+    while ( 1 )
+    {
+        beg = &buffer->str[ buffer->buffer_pos ];
+        end = &buffer->str[ buffer->buffer_end ];
+
+        if ( beg == end )
+        {
+            if ( ! buffer_fill( buffer ) ) {
+                break;
+            }
+
+            continue;
+        }
+
+        if ( ( stop = memchr( beg, '>', end - beg ) ) == NULL ) {
+            stop = end;
+        }
+
+        while ( beg < stop )
+        {
+            if ( ( pt = memchr( beg, '\n', stop - beg ) ) == NULL ) {
+                pt = stop;
+            }
+
+            fasta_seq_append( entry, beg, pt - beg );
+
+            beg = pt + 1;
+        }
+
+        buffer->buffer_pos = stop - buffer->str;
+
+        if ( stop < end ) {
+            break;
+        }
+    }
+
+    entry->seq[ entry->seq_len ] = '\0';
+
+    *entry_ppt = entry;
+
+    return TRUE;
+}
+
+
+void fasta_seq_append( seq_entry *entry, char *line, size_t len )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Append a line of sequence to a sequence entry. The line is copied */
+    /* with memcpy and only compacted if it contains non-sequence chars, */
+    /* such as \r or whitespace, which are skipped as in fasta_get_entry. */
+
+    char   *seq = NULL;
+    size_t  i   = 0;
+    size_t  j   = 0;
+
+    seq_resize( entry, entry->seq_len + len );
+
+    seq = &entry->seq[ entry->seq_len ];
+
+    memcpy( seq, line, len );
+
+    while ( i < len && ( isseq( seq[ i ] ) ) ) {
+        i++;
+    }
+
+    for ( j = i; i < len; i++ )
+    {
+        if ( isseq( seq[ i ] ) ) {
+            seq[ j++ ] = seq[ i ];
+        }
+    }
+
+    entry->seq_len += j;
+}
+
+
+fasta_map *fasta_map_new( char *path )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Memory map a FASTA file for read-only sequential scanning with */
+    /* fasta_map_get_view. The kernel is advised of the sequential access */
+    /* and pages behind the scan position are released as the scan */
+    /* proceeds, so files larger than RAM can be scanned. */
+
+    fasta_map   *map = NULL;
+    struct stat  st;
+
+    map = mem_get( sizeof( fasta_map ) );
+
+    if ( ( map->fd = open( path, O_RDONLY ) ) == -1 )
+    {
+        fprintf( stderr, "ERROR: Could not read-open file '%s': %s\n", path, strerror( errno ) );
+        abort();
+    }
+
+    if ( fstat( map->fd, &st ) == -1 )
+    {
+        fprintf( stderr, "ERROR: Could not stat file '%s': %s\n", path, strerror( errno ) );
+        abort();
+    }
+
+    map->map      = NULL;
+    map->map_size = ( size_t ) st.st_size;
+    map->pos      = 0;
+    map->released = 0;
+
+    if ( map->map_size > 0 )
+    {
+        if ( ( map->map = mmap( NULL, map->map_size, PROT_READ, MAP_PRIVATE, map->fd, 0 ) ) == MAP_FAILED )
+        {
+            fprintf( stderr, "ERROR: Could not memory map file '%s': %s\n", path, strerror( errno ) );
+            abort();
+        }
+
+        madvise( map->map, map->map_size, MADV_SEQUENTIAL );
+
+        if ( zfile_format( ( uchar * ) map->map, map->map_size ) != ZFILE_PLAIN )
+        {
+            fprintf( stderr, "ERROR: Compressed file '%s' cannot be memory mapped\n", path );
+            abort();
+        }
+    }
+
+    return map;
+}
+
+
+fasta_view *fasta_view_new()
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Initialize a new FASTA view. */
+
+    fasta_view *view = NULL;
+
+    view = mem_get( sizeof( fasta_view ) );
+
+    view->seq_name     = NULL;
+    view->seq_name_len = 0;
+    view->lines        = mem_get( FASTA_LINES * sizeof( fasta_line ) );
+    view->line_count   = 0;
+    view->line_max     = FASTA_LINES;
+    view->seq_len      = 0;
+
+    return view;
+}
+
+
+bool fasta_map_get_view( fasta_map *map, fasta_view *view )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Get a view of the next entry of a memory mapped FASTA file. The */
+    /* view points directly into the map and holds an index of the */
+    /* sequence lines, so the residues can be walked without copying. */
+    /* A header is a line beginning with '>'. The view is valid until */
+    /* the next call. */
+
+    char   *beg = NULL;
+    char   *end = NULL;
+    char   *pt  = NULL;
+    char   *nl  = NULL;
+    size_t  len = 0;
+
+    view->seq_name     = NULL;
+    view->seq_name_len = 0;
+    view->line_count   = 0;
+    view->seq_len      = 0;
+
+    if ( map->map == NULL ) {
+        return FALSE;
+    }
+
+    beg = &map->map[ map->pos ];
+    end = &map->map[ map->map_size ];
+
+    /* ---- locate the next header at a line start ---- */
+
+    while ( beg < end && *beg != '>' )
+    {
+        if ( ( pt = memchr( beg, '\n', end - beg ) ) == NULL ) {
+            beg = end;
+        } else {
+            beg = pt + 1;
+        }
+    }
+
+    if ( beg == end )
+    {
+        map->pos = map->map_size;
+
+        return FALSE;
+    }
+
+    fasta_map_release( map, beg - map->map );
+
+    /* ---- sequence name ---- */
+
+    beg++;
+
+    if ( ( nl = memchr( beg, '\n', end - beg ) ) == NULL ) {
+        nl = end;
+    }
+
+    len = nl - beg;
+
+    if ( len > 0 && beg[ len - 1 ] == '\r' ) {
+        len--;
+    }
+
+    view->seq_name     = beg;
+    view->seq_name_len = len;
+
+    beg = ( nl < end ) ? nl + 1 : end;
+
+    /* ---- sequence lines until the next header ---- */
+
+    while ( beg < end && *beg != '>' )
+    {
+        if ( ( nl = memchr( beg, '\n', end - beg ) ) == NULL ) {
+            nl = end;
+        }
+
+        len = nl - beg;
+
+        if ( len > 0 && beg[ len - 1 ] == '\r' ) {
+            len--;
+        }
+
+        if ( len > 0 ) {
+            fasta_view_add_line( view, beg, len );
+        }
+
+        beg = ( nl < end ) ? nl + 1 : end;
+    }
+
+    map->pos = beg - map->map;
+
+    return TRUE;
+}
+
+
+void fasta_view_destroy( fasta_view **view_ppt )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Deallocate memory for a FASTA view. */
+
+    fasta_view *view = *view_ppt;
+
+    mem_free( &view->lines );
+    mem_free( &view );
+
+    *view_ppt = NULL;
+}
+
+
+void fasta_map_destroy( fasta_map **map_ppt )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Unmap and close a memory mapped FASTA file. */
+
+    fasta_map *map = *map_ppt;
+
+    if ( map->map != NULL && munmap( map->map, map->map_size ) == -1 )
+    {
+        fprintf( stderr, "ERROR: Could not unmap file: %s\n", strerror( errno ) );
+        abort();
+    }
+
+    if ( close( map->fd ) == -1 )
+    {
+        fprintf( stderr, "ERROR: Could not close file: %s\n", strerror( errno ) );
+        abort();
+    }
+
+    mem_free( &map );
+
+    *map_ppt = NULL;
+}
+
+
+fasta_index *fasta_index_build( char *path )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Build a FASTA index by scanning a FASTA file. As with samtools */
+    /* faidx, all sequence lines of an entry, but the last, must have */
+    /* the same length. */
+
+    fasta_index *index    = NULL;
+    fasta_map   *map      = NULL;
+    fasta_view  *view     = NULL;
+    fasta_line  *line     = NULL;
+    char        *pt       = NULL;
+    size_t       name_len = 0;
+    size_t       offset   = 0;
+    size_t       bases    = 0;
+    size_t       width    = 0;
+    size_t       i        = 0;
+
+    index = fasta_index_new( path );
+    map   = fasta_map_new( path );
+    view  = fasta_view_new();
+
+    while ( fasta_map_get_view( map, view ) )
+    {
+        for ( name_len = 0; name_len < view->seq_name_len; name_len++ )
+        {
+            if ( isspace( view->seq_name[ name_len ] ) ) {
+                break;
+            }
+        }
+
+        if ( view->line_count == 0 )
+        {
+            pt     = memchr( view->seq_name, '\n', map->map_size - ( view->seq_name - map->map ) );
+            offset = ( pt == NULL ) ? map->map_size : ( size_t ) ( pt + 1 - map->map );
+            bases  = 0;
+            width  = 0;
+        }
+        else
+        {
+            line   = &view->lines[ 0 ];
+            offset = line->str - map->map;
+            bases  = line->len;
+            width  = bases + 1;
+
+            if ( offset + bases < map->map_size && line->str[ bases ] == '\r' ) {
+                width++;
+            }
+
+            for ( i = 0; i < view->line_count; i++ )
+            {
+                line = &view->lines[ i ];
+
+                if ( ( i < view->line_count - 1 && ( line->len != bases || line[ 1 ].str - line->str != width ) ) || line->len > bases )
+                {
+                    fprintf( stderr, "ERROR: Different line length in sequence '%.*s' of file '%s'\n", ( int ) name_len, view->seq_name, path );
+                    abort();
+                }
+            }
+        }
+
+        fasta_index_add( index, view->seq_name, name_len, view->seq_len, offset, bases, width );
+    }
+
+    fasta_view_destroy( &view );
+    fasta_map_destroy( &map );
+
+    fasta_index_sort( index );
+
+    return index;
+}
+
+
+fasta_index *fasta_index_read( char *path, char *fai_path )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Read a FASTA index for a given FASTA file from a .fai file */
+    /* with the columns: name, length, offset, line bases, line width. */
+
+    fasta_index *index  = NULL;
+    file_buffer *buffer = NULL;
+    char        *line   = NULL;
+    char        *tab    = NULL;
+    char        *pt     = NULL;
+    size_t       len    = 0;
+    size_t       val[ 4 ];
+    size_t       i      = 0;
+
+    index = fasta_index_new( path );
+
+    buffer_new( fai_path, &buffer, FASTA_BLOCK );
+
+    while ( ( len = buffer_gets( buffer, &line ) ) != 0 )
+    {
+        if ( ( tab = memchr( line, '\t', len ) ) == NULL )
+        {
+            fprintf( stderr, "ERROR: Malformed line in FASTA index '%s': %.*s\n", fai_path, ( int ) len, line );
+            abort();
+        }
+
+        for ( pt = tab, i = 0; i < 4; i++ )
+        {
+            if ( *pt != '\t' || ! isdigit( pt[ 1 ] ) )
+            {
+                fprintf( stderr, "ERROR: Malformed line in FASTA index '%s': %.*s\n", fai_path, ( int ) len, line );
+                abort();
+            }
+
+            val[ i ] = strtoul( pt + 1, &pt, 10 );
+        }
+
+        fasta_index_add( index, line, tab - line, val[ 0 ], val[ 1 ], val[ 2 ], val[ 3 ] );
+    }
+
+    buffer_destroy( &buffer );
+
+    fasta_index_sort( index );
+
+    return index;
+}
+
+
+void fasta_index_write( fasta_index *index, char *fai_path )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Write a FASTA index to a .fai file. */
+
+    FILE *fp = NULL;
+
+    fp = write_open( fai_path );
+
+    fasta_index_put( index, fp );
+
+    close_stream( fp );
+}
+
+
+fasta_index *fasta_index_load( char *path )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Load the index of a FASTA file from <path>.fai. If the .fai file */
+    /* is missing or older than the FASTA file, the index is built and, */
+    /* if possible, saved for the next time. */
+
+    fasta_index *index    = NULL;
+    FILE        *fp       = NULL;
+    char        *fai_path = NULL;
+    struct stat  fa_st;
+    struct stat  fai_st;
+
+    fai_path = mem_get( strlen( path ) + 5 );
+
+    sprintf( fai_path, "%s.fai", path );
+
+    if ( stat( path, &fa_st ) == -1 )
+    {
+        fprintf( stderr, "ERROR: Could not stat file '%s': %s\n", path, strerror( errno ) );
+        abort();
+    }
+
+    if ( stat( fai_path, &fai_st ) == 0 && fai_st.st_mtime >= fa_st.st_mtime )
+    {
+        index = fasta_index_read( path, fai_path );
+    }
+    else
+    {
+        index = fasta_index_build( path );
+
+        if ( ( fp = fopen( fai_path, "w" ) ) != NULL )
+        {
+            fasta_index_put( index, fp );
+
+            close_stream( fp );
+        }
+    }
+
+    mem_free( &fai_path );
+
+    return index;
+}
+
+
+fai_entry *fasta_index_get( fasta_index *index, char *name )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Lookup a sequence name in a FASTA index - returns NULL if not found. */
+
+    fai_entry **pt = NULL;
+
+    if ( index->nmemb == 0 ) {
+        return NULL;
+    }
+
+    pt = bsearch( name, index->sorted, index->nmemb, sizeof( fai_entry * ), cmp_fai_entry_key );
+
+    return ( pt == NULL ) ? NULL : *pt;
+}
+
+
+bool fasta_fetch( fasta_index *index, char *name, size_t beg, size_t end, seq_entry **entry_ppt )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Fetch the region beg to end (0-based, end exclusive) of a named */
+    /* sequence into a sequence entry by seeking directly to the region */
+    /* in the FASTA file. The end is clipped to the sequence length. */
+    /* Returns FALSE if the name is not in the index. */
+
+    seq_entry *entry = *entry_ppt;
+    fai_entry *fai   = NULL;
+    size_t     first = 0;
+    size_t     last  = 0;
+    size_t     len   = 0;
+    size_t     i     = 0;
+    char       c     = 0;
+
+    if ( ( fai = fasta_index_get( index, name ) ) == NULL ) {
+        return FALSE;
+    }
+
+    if ( end > fai->len ) {
+        end = fai->len;
+    }
+
+    if ( beg > end )
+    {
+        fprintf( stderr, "ERROR: Bad region %s:%zu-%zu\n", name, beg, end );
+        abort();
+    }
+
+    seq_reset( entry );
+    seq_name_resize( entry, strlen( fai->name ) );
+
+    strcpy( entry->seq_name, fai->name );
+
+    if ( beg < end )
+    {
+        first = fai->offset + ( beg / fai->line_bases ) * fai->line_width + beg % fai->line_bases;
+        last  = fai->offset + ( ( end - 1 ) / fai->line_bases ) * fai->line_width + ( end - 1 ) % fai->line_bases + 1;
+        len   = last - first;
+
+        if ( len > index->buffer_size )
+        {
+            index->buffer      = mem_resize( index->buffer, len );
+            index->buffer_size = len;
+        }
+
+        if ( fseeko( index->fp, ( off_t ) first, SEEK_SET ) != 0 || fread( index->buffer, 1, len, index->fp ) != len )
+        {
+            fprintf( stderr, "ERROR: Could not read region %s:%zu-%zu: %s\n", name, beg, end, strerror( errno ) );
+            abort();
+        }
+
+        seq_resize( entry, end - beg );
+
+        for ( i = 0; i < len; i++ )
+        {
+            c = index->buffer[ i ];
+
+            if ( c != '\n' && c != '\r' ) {
+                entry->seq[ entry->seq_len++ ] = c;
+            }
+        }
+    }
+
+    entry->seq[ entry->seq_len ] = '\0';
+
+    *entry_ppt = entry;
+
+    return TRUE;
+}
+
+
+void fasta_index_destroy( fasta_index **index_ppt )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Close the FASTA file and deallocate memory for a FASTA index. */
+
+    fasta_index *index = *index_ppt;
+    size_t       i     = 0;
+
+    for ( i = 0; i < index->nmemb; i++ ) {
+        mem_free( &index->entries[ i ].name );
+    }
+
+    close_stream( index->fp );
+
+    mem_free( &index->entries );
+    mem_free( &index->sorted );
+    mem_free( &index->buffer );
+    mem_free( &index );
+
+    *index_ppt = NULL;
+}
+
+
 void fasta_put_entry( seq_entry *entry )
 {
     /* Martin A. Hansen, May 2008 */
@@ -129,3 +890,307 @@ void fasta_put_entry( seq_entry *entry )
 //        fasta_put_entry( elem->val );                                                                                           
 //    }                                                                                                                           
 //}
+
+
+
+static void fasta_map_release( fasta_map *map, size_t offset )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Release the pages of a memory mapped FASTA file before a given */
+    /* offset, once more than FASTA_RELEASE bytes have been scanned, */
+    /* so resident memory stays bounded on files larger than RAM. */
+
+    size_t page = ( size_t ) sysconf( _SC_PAGESIZE );
+
+    offset -= offset % page;
+
+    if ( offset > map->released + FASTA_RELEASE )
+    {
+        madvise( &map->map[ map->released ], offset - map->released, MADV_DONTNEED );
+
+        map->released = offset;
+    }
+}
+
+
+static void fasta_view_add_line( fasta_view *view, char *str, size_t len )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Add a sequence line to a FASTA view resizing the line index if needed. */
+
+    if ( view->line_count == view->line_max )
+    {
+        view->line_max <<= 1;
+        view->lines      = mem_resize( view->lines, view->line_max * sizeof( fasta_line ) );
+    }
+
+    view->lines[ view->line_count ].str = str;
+    view->lines[ view->line_count ].len = len;
+
+    view->line_count++;
+    view->seq_len += len;
+}
+
+
+static fasta_index *fasta_index_new( char *path )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Initialize a new empty FASTA index for a given FASTA file. */
+
+    fasta_index *index = NULL;
+
+    index = mem_get( sizeof( fasta_index ) );
+
+    index->fp          = read_open( path );
+    index->entries     = mem_get( FASTA_INDEX * sizeof( fai_entry ) );
+    index->sorted      = NULL;
+    index->nmemb       = 0;
+    index->max         = FASTA_INDEX;
+    index->buffer      = NULL;
+    index->buffer_size = 0;
+
+    return index;
+}
+
+
+static void fasta_index_add( fasta_index *index, char *name, size_t name_len, size_t len, size_t offset, size_t line_bases, size_t line_width )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Add an entry to a FASTA index resizing the index if needed. */
+
+    fai_entry *entry = NULL;
+
+    if ( index->nmemb == index->max )
+    {
+        index->max   <<= 1;
+        index->entries = mem_resize( index->entries, index->max * sizeof( fai_entry ) );
+    }
+
+    entry = &index->entries[ index->nmemb ];
+
+    entry->name       = mem_get( name_len + 1 );
+    entry->len        = len;
+    entry->offset     = offset;
+    entry->line_bases = line_bases;
+    entry->line_width = line_width;
+
+    memcpy( entry->name, name, name_len );
+
+    entry->name[ name_len ] = '\0';
+
+    index->nmemb++;
+}
+
+
+static void fasta_index_sort( fasta_index *index )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Sort pointers to the entries of a FASTA index by name for lookups. */
+
+    size_t i = 0;
+
+    if ( index->nmemb == 0 ) {
+        return;
+    }
+
+    index->sorted = mem_get( index->nmemb * sizeof( fai_entry * ) );
+
+    for ( i = 0; i < index->nmemb; i++ ) {
+        index->sorted[ i ] = &index->entries[ i ];
+    }
+
+    qsort( index->sorted, index->nmemb, sizeof( fai_entry * ), cmp_fai_entry_name );
+}
+
+
+static void fasta_index_put( fasta_index *index, FILE *fp )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Output the entries of a FASTA index in .fai format to a stream. */
+
+    fai_entry *entry = NULL;
+    size_t     i     = 0;
+
+    for ( i = 0; i < index->nmemb; i++ )
+    {
+        entry = &index->entries[ i ];
+
+        fprintf( fp, "%s\t%zu\t%zu\t%zu\t%zu\n", entry->name, entry->len, entry->offset, entry->line_bases, entry->line_width );
+    }
+}
+
+
+static int cmp_fai_entry_name( const void *a, const void *b )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Compare function for sorting pointers to FASTA index entries by name. */
+
+    fai_entry *a_entry = *( ( fai_entry ** ) a );
+    fai_entry *b_entry = *( ( fai_entry ** ) b );
+
+    return strcmp( a_entry->name, b_entry->name );
+}
+
+
+static int cmp_fai_entry_key( const void *key, const void *b )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Compare function for bsearch of a name among sorted FASTA index entries. */
+
+    fai_entry *b_entry = *( ( fai_entry ** ) b );
+
+    return strcmp( ( char * ) key, b_entry->name );
+}
+
+
+static size_t fasta_count_scan( char *block, size_t pos, size_t end, size_t *residues )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Scan a block from pos, that is not the start of a header, to the */
+    /* next '>' following a newline - or the end of the block - adding */
+    /* the residues on the way. Returns the offset of the '>' or end. */
+    /* The widest instruction set supported by the CPU is used. */
+
+#ifdef FASTA_X86
+    static int avx2 = -1;
+#endif
+    uchar      c    = ( uchar ) block[ pos ];
+
+    if ( c > ' ' && c < 127 ) {
+        ( *residues )++;
+    }
+
+#ifdef FASTA_X86
+    if ( avx2 == -1 ) {
+        avx2 = __builtin_cpu_supports( "avx2" ) ? 1 : 0;
+    }
+
+    if ( avx2 ) {
+        return fasta_count_scan_avx2( block, pos + 1, end, residues );
+    } else {
+        return fasta_count_scan_sse2( block, pos + 1, end, residues );
+    }
+#else
+    return fasta_count_scan_scalar( block, pos + 1, end, residues );
+#endif
+}
+
+
+static size_t fasta_count_scan_scalar( char *block, size_t pos, size_t end, size_t *residues )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Scalar version of fasta_count_scan starting after the first char. */
+    /* Also used for the tails of blocks in the vector versions. */
+
+    size_t i     = 0;
+    size_t count = 0;
+    uchar  c     = 0;
+
+    for ( i = pos; i < end; i++ )
+    {
+        c = ( uchar ) block[ i ];
+
+        if ( c == '>' && block[ i - 1 ] == '\n' ) {
+            break;
+        }
+
+        if ( c > ' ' && c < 127 ) {
+            count++;
+        }
+    }
+
+    *residues += count;
+
+    return i;
+}
+
+
+#ifdef FASTA_X86
+__attribute__ ( ( target( "sse2" ) ) )
+static size_t fasta_count_scan_sse2( char *block, size_t pos, size_t end, size_t *residues )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* SSE2 version of fasta_count_scan comparing 16 chars at a time */
+    /* with the same chars shifted by one to find '\n>' boundaries. */
+
+    size_t  i     = 0;
+    uint    mask  = 0;
+    uint    res   = 0;
+    __m128i v;
+    __m128i p;
+    __m128i hdr   = _mm_set1_epi8( '>' );
+    __m128i nl    = _mm_set1_epi8( '\n' );
+    __m128i space = _mm_set1_epi8( ' ' );
+    __m128i del   = _mm_set1_epi8( 127 );
+
+    for ( i = pos; i + 16 <= end; i += 16 )
+    {
+        v = _mm_loadu_si128( ( __m128i * ) &block[ i ] );
+        p = _mm_loadu_si128( ( __m128i * ) &block[ i - 1 ] );
+
+        mask = _mm_movemask_epi8( _mm_and_si128( _mm_cmpeq_epi8( v, hdr ), _mm_cmpeq_epi8( p, nl ) ) );
+        res  = _mm_movemask_epi8( _mm_andnot_si128( _mm_cmpeq_epi8( v, del ), _mm_cmpgt_epi8( v, space ) ) );
+
+        if ( mask != 0 )
+        {
+            *residues += __builtin_popcount( res & ( ( 1U << __builtin_ctz( mask ) ) - 1 ) );
+
+            return i + __builtin_ctz( mask );
+        }
+
+        *residues += __builtin_popcount( res );
+    }
+
+    return fasta_count_scan_scalar( block, i, end, residues );
+}
+
+
+__attribute__ ( ( target( "avx2" ) ) )
+static size_t fasta_count_scan_avx2( char *block, size_t pos, size_t end, size_t *residues )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* AVX2 version of fasta_count_scan comparing 32 chars at a time. */
+
+    size_t  i     = 0;
+    uint    mask  = 0;
+    uint    res   = 0;
+    __m256i v;
+    __m256i p;
+    __m256i hdr   = _mm256_set1_epi8( '>' );
+    __m256i nl    = _mm256_set1_epi8( '\n' );
+    __m256i space = _mm256_set1_epi8( ' ' );
+    __m256i del   = _mm256_set1_epi8( 127 );
+
+    for ( i = pos; i + 32 <= end; i += 32 )
+    {
+        v = _mm256_loadu_si256( ( __m256i * ) &block[ i ] );
+        p = _mm256_loadu_si256( ( __m256i * ) &block[ i - 1 ] );
+
+        mask = ( uint ) _mm256_movemask_epi8( _mm256_and_si256( _mm256_cmpeq_epi8( v, hdr ), _mm256_cmpeq_epi8( p, nl ) ) );
+        res  = ( uint ) _mm256_movemask_epi8( _mm256_andnot_si256( _mm256_cmpeq_epi8( v, del ), _mm256_cmpgt_epi8( v, space ) ) );
+
+        if ( mask != 0 )
+        {
+            *residues += __builtin_popcount( res & ( ( 1U << __builtin_ctz( mask ) ) - 1 ) );
+
+            return i + __builtin_ctz( mask );
+        }
+
+        *residues += __builtin_popcount( res );
+    }
+
+    return fasta_count_scan_scalar( block, i, end, residues );
+}
+#endif
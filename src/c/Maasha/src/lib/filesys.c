@@ -3,6 +3,7 @@
 #include "common.h"
 #include "mem.h"
 #include "filesys.h"
+#include "zfile.h"
 
 
 FILE *read_open( char *file )
@@ -12,7 +13,8 @@ FILE *read_open( char *file )
     /* Unit test done. */
 
     /* Given a file name, read-opens the file, */
-    /* and returns a file pointer. */
+    /* and returns a file pointer. gzip, BGZF and */
+    /* zstd compressed files are decompressed on the fly. */
     
     FILE *fp;
 
@@ -22,7 +24,7 @@ FILE *read_open( char *file )
         abort();
     }
 
-    return fp;
+    return zfile_open( fp, file );
 }
 
 
@@ -148,6 +150,40 @@ void file_rename( char *old_name, char *new_name )
 }
 
 
+FILE *file_temp( char *dir, char **file_ppt )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Create a new uniquely named temporary file in a given directory */
+    /* and return a write file pointer. The allocated file name is */
+    /* returned in file_ppt and the file must be unlinked by the caller. */
+
+    char *file = NULL;
+    FILE *fp   = NULL;
+    int   fd   = 0;
+
+    file = mem_get( strlen( dir ) + 16 );
+
+    sprintf( file, "%s/tmp_XXXXXX", dir );
+
+    if ( ( fd = mkstemp( file ) ) == -1 )
+    {
+        fprintf( stderr, "ERROR: Could not create temporary file in '%s': %s\n", dir, strerror( errno ) );
+        abort();
+    }
+
+    if ( ( fp = fdopen( fd, "w" ) ) == NULL )
+    {
+        fprintf( stderr, "ERROR: Could not write-open temporary file '%s': %s\n", file, strerror( errno ) );
+        abort();
+    }
+
+    *file_ppt = file;
+
+    return fp;
+}
+
+
 /* >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>> FILE BUFFER <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<*/
 
 
@@ -156,18 +192,26 @@ size_t buffer_new( char *file, file_buffer **buffer_ppt, size_t size )
     /* Martin A. Hansen, June 2008 */
 
     /* Opens a file for reading and loads a new buffer.*/
+    /* The buffer is read in blocks of size bytes, or */
+    /* FILE_BUFFER_SIZE if size is 0. */
     /* The number of read chars is returned. */
 
     file_buffer *buffer = *buffer_ppt;
     FILE        *fp     = NULL;
     size_t       num    = 0;
 
+    if ( size == 0 ) {
+        size = FILE_BUFFER_SIZE;
+    }
+
     buffer = mem_get( sizeof( file_buffer ) );
 
     fp = read_open( file );
 
     buffer->fp          = fp;
-    buffer->str         = NULL;
+    buffer->fd          = fileno( fp );
+    buffer->str_size    = size;
+    buffer->str         = mem_get( size + 1 );
     buffer->token_pos   = 0;
     buffer->token_len   = 0;
     buffer->buffer_pos  = 0;
@@ -175,6 +219,13 @@ size_t buffer_new( char *file, file_buffer **buffer_ppt, size_t size )
     buffer->buffer_size = size;
     buffer->eof         = FALSE;
 
+    buffer->str[ 0 ] = '\0';
+
+    /* Plain files are read with read(2) from the stream position. */
+    if ( buffer->fd >= 0 && lseek( buffer->fd, ftello( fp ), SEEK_SET ) == -1 ) {
+        buffer->fd = -1;
+    }
+
     num = buffer_read( &buffer );
 
     *buffer_ppt = buffer;
@@ -187,32 +238,54 @@ size_t buffer_read( file_buffer **buffer_ppt )
 {
     /* Martin A. Hansen, June 2008 */
 
-    /* Read in buffer->buffer_size bytes from file and appends to buffer string. */
+    /* Read in buffer->buffer_size bytes from file directly into the */
+    /* space after the end of the buffer string, which is only enlarged */
+    /* if there is not room. Plain files are read with read(2) and */
+    /* compressed streams with fread. Reading stops at EOF or when */
+    /* buffer_size bytes are read. */
  
-    file_buffer *buffer  = *buffer_ppt;
-    char        *str     = NULL;
-    size_t       str_len = 0;
-    size_t       new_end = 0;
-    size_t       num     = 0;
+    file_buffer *buffer = *buffer_ppt;
+    size_t       size   = ( size_t ) buffer->buffer_size;
+    size_t       num    = 0;
+    ssize_t      n      = 0;
 
-    num = file_read( buffer->fp, &str, buffer->buffer_size );
+    if ( buffer->buffer_end + size > buffer->str_size )
+    {
+        while ( buffer->buffer_end + size > buffer->str_size ) {
+            buffer->str_size <<= 1;
+        }
+
+        buffer->str = mem_resize( buffer->str, buffer->str_size + 1 );
+    }
 
-    if ( num != 0 )
+    while ( num < size && ! buffer->eof )
     {
-        str_len = num;
-        new_end = buffer->buffer_end + str_len;
+        if ( buffer->fd >= 0 ) {
+            n = read( buffer->fd, &buffer->str[ buffer->buffer_end + num ], size - num );
+        } else {
+            n = fread( &buffer->str[ buffer->buffer_end + num ], 1, size - num, buffer->fp );
+        }
 
-        buffer->str = mem_resize( buffer->str, new_end );
+        if ( n == -1 && errno == EINTR ) {
+            continue;
+        }
 
-        memcpy( &buffer->str[ buffer->buffer_end ], str, str_len );
+        if ( n == -1 || ( buffer->fd < 0 && ferror( buffer->fp ) ) )
+        {
+            fprintf( stderr, "ERROR: Could not read file: %s\n", strerror( errno ) );
+            abort();
+        }
 
-        buffer->str[ new_end ] = '\0';
-        buffer->buffer_end     = new_end;
+        if ( n == 0 ) {
+            buffer->eof = TRUE;
+        }
 
-        mem_free( &str );
+        num += n;
     }
 
-    buffer->eof = feof( buffer->fp ) ? TRUE : FALSE;
+    buffer->buffer_end += num;
+
+    buffer->str[ buffer->buffer_end ] = '\0';
 
     *buffer_ppt = buffer;
 
@@ -220,33 +293,36 @@ size_t buffer_read( file_buffer **buffer_ppt )
 }
 
 
+bool buffer_fill( file_buffer *buffer )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Discard the scanned part of a file buffer, i.e. everything before */
+    /* buffer_pos, and read a new block into the freed space. Returns */
+    /* FALSE when no more data could be read. */
+
+    buffer->token_pos = buffer->buffer_pos;
+
+    return buffer_resize( buffer );
+}
+
+
 char buffer_getc( file_buffer *buffer )
 {
     /* Martin A. Hansen, June 2008 */
 
-    /* Get the next char from a file buffer, which is resized if necessary, until EOF.*/
+    /* Get the next char from a file buffer, which is refilled if necessary, until EOF.*/
 
-    while ( 1 )
+    while ( buffer->buffer_pos == buffer->buffer_end )
     {
-        if ( buffer->buffer_pos == buffer->buffer_end )
-        {
-            if ( buffer->eof )
-            {
-                return EOF;
-            }
-            else
-            {
-                buffer->token_pos = buffer->buffer_pos;
-                buffer_new_size( buffer, buffer->buffer_pos );  // MOVE THIS TO buffer_resize !!!!! ??????
-
-                if ( ( buffer_resize( buffer ) == FALSE ) ) {
-                    return EOF;
-                }
-            }
+        if ( ! buffer_resize( buffer ) ) {
+            return EOF;
         }
-    
-        return buffer->str[ buffer->buffer_pos++ ];
     }
+
+    buffer->token_pos = buffer->buffer_pos;
+
+    return buffer->str[ buffer->buffer_pos++ ];
 }
 
 
@@ -263,65 +339,54 @@ void buffer_ungetc( file_buffer *buffer )
 }
 
 
-char *buffer_gets( file_buffer *buffer )
+size_t buffer_gets( file_buffer *buffer, char **line_ppt )
 {
     /* Martin A. Hansen, June 2008 */
 
     /* Get the next line that is terminated by \n or EOF from a file buffer. */
+    /* The line is not copied, but line_ppt is set to point to the line */
+    /* in the buffer - and the line is only valid until the next call. */
+    /* The line is terminated by \n, or \0 for a last line without \n. */
+    /* The length of the line including any \n is returned - 0 at EOF. */
 
-    char   *pt        = NULL;
-    char   *line      = NULL;
-    size_t  line_size = 0;
+    char   *pt   = NULL;
+    size_t  scan = buffer->buffer_pos;
+    size_t  len  = 0;
 
     while ( 1 )
     {
-        if ( ( pt = memchr( &buffer->str[ buffer->buffer_pos ], '\n', buffer->buffer_end + 1 - buffer->buffer_pos ) ) != NULL )
+        if ( ( pt = memchr( &buffer->str[ scan ], '\n', buffer->buffer_end - scan ) ) != NULL )
         {
-            line_size = pt - &buffer->str[ buffer->buffer_pos ] + 1;
-
-            line = mem_get( line_size + 1 );
+            len = pt - &buffer->str[ buffer->buffer_pos ] + 1;
 
-            memcpy( line, &buffer->str[ buffer->buffer_pos ], line_size );
+            break;
+        }
 
-            line[ line_size ] = '\0';
+        scan = buffer->buffer_end;
 
-            buffer->token_len   = line_size;
-            buffer->buffer_pos += line_size;
+        if ( buffer->eof )
+        {
+            len = buffer->buffer_end - buffer->buffer_pos;
 
-            buffer_new_size( buffer, line_size );
+            if ( len == 0 ) {
+                return 0;
+            }
 
-            return line;
+            break;
         }
-        else
-        {
-            if ( buffer->eof )
-            {
-                if ( buffer->buffer_pos < buffer->buffer_end )
-                {
-                    line_size = buffer->buffer_end - buffer->buffer_pos + 1;
 
-                    line = mem_get( line_size + 1 );
+        scan -= buffer->token_pos;
 
-                    memcpy( line, &buffer->str[ buffer->buffer_pos ], line_size );
+        buffer_resize( buffer );
+    }
 
-                    line[ line_size ] = '\0';
+    *line_ppt = &buffer->str[ buffer->buffer_pos ];
 
-                    buffer->token_len   = line_size;
-                    buffer->buffer_pos += line_size;
+    buffer->token_pos   = buffer->buffer_pos;
+    buffer->token_len   = len;
+    buffer->buffer_pos += len;
 
-                    return line;
-                }
-                else
-                {
-                    return NULL;
-                }
-            }
-            else
-            {
-                buffer_resize( buffer );
-            }
-        }
-    }
+    return len;
 }
 
 
@@ -361,17 +426,20 @@ bool buffer_resize( file_buffer *buffer )
 {
     /* Martin A. Hansen, June 2008 */
 
-    /* Resize file buffer. */
+    /* Slide the file buffer window discarding everything before */
+    /* token_pos, i.e. all but the last token, which is kept to */
+    /* allow buffer_ungetc and buffer_ungets. A new block is then */
+    /* read into the freed space. Returns FALSE at EOF. */
 
-    size_t num = 0;
+    if ( buffer->eof ) {
+        return FALSE;
+    }
 
     if ( buffer->token_pos != 0 ) {
-        buffer_move( buffer, buffer->buffer_pos, buffer->token_pos );
+        buffer_move( buffer, buffer->buffer_end, buffer->token_pos );
     }
 
-    num = buffer_read( &buffer );
-
-    if ( num == 0 ) {
+    if ( buffer_read( &buffer ) == 0 ) {
         return FALSE;
     } else {
         return TRUE;
@@ -384,6 +452,7 @@ size_t buffer_move( file_buffer *buffer, size_t size, size_t num )
     /* Martin A. Hansen, August 2008 */
 
     /* Moves file buffer of a given size num positions to the left. */
+    /* The scan position is moved along. */
     /* The size of the resulting string is returned. */
 
     size_t len = 0;
@@ -392,12 +461,14 @@ size_t buffer_move( file_buffer *buffer, size_t size, size_t num )
     assert( num > 0 );
     assert( num <= size );
 
-    memmove( buffer->str, &buffer->str[ num ], size );
-
     len = size - num;
 
+    memmove( buffer->str, &buffer->str[ num ], len );
+
+    buffer->str[ len ] = '\0';
+
     buffer->buffer_end = len;
-    buffer->buffer_pos = 0;
+    buffer->buffer_pos = ( buffer->buffer_pos > num ) ? buffer->buffer_pos - num : 0;
     buffer->token_pos  = 0;
 
     return len;
@@ -419,7 +490,7 @@ void buffer_destroy( file_buffer **buffer_ppt )
     mem_free( &buffer->str );
     mem_free( &buffer );
 
-    buffer = NULL;
+    *buffer_ppt = NULL;
 }
 
 
@@ -435,6 +506,7 @@ void buffer_print( file_buffer *buffer )
     printf( "   buffer_pos   : %zu\n",    buffer->buffer_pos );
     printf( "   buffer_end   : %zu\n",    buffer->buffer_end );
     printf( "   buffer_size  : %ld\n",    buffer->buffer_size );
+    printf( "   str_size     : %zu\n",    buffer->str_size );
     printf( "   str          : ->%s<-\n", buffer->str );
     printf( "   eof          : %d\n",     buffer->eof );
 
@@ -6,6 +6,17 @@
 #include "list.h"
 
 
+static size_t     hash_index( hash *hash_pt, uint h );
+static hash_elem *hash_lookup( hash *hash_pt, char *key, size_t len, uint *h_pt, size_t *i_pt, uint *dist_pt );
+static void       hash_insert( hash *hash_pt, hash_elem *elem );
+static void       hash_insert_at( hash *hash_pt, hash_elem *elem, size_t i, uint dist );
+static void       hash_rehash( hash *hash_pt, size_t table_size );
+static uint64_t   hash_mum( uint64_t a, uint64_t b );
+static uint64_t   hash_read8( uchar *p );
+static uint64_t   hash_read4( uchar *p );
+static char      *hash_arena_add( hash *hash_pt, char *key, size_t len );
+
+
 hash *hash_new( size_t size )
 {
     /* Martin A. Hansen, June 2008 */
@@ -15,37 +26,27 @@ hash *hash_new( size_t size )
     hash   *new_hash   = NULL;
     size_t  table_size = 0;
 
-    new_hash = mem_get( sizeof( new_hash ) );
-
-    table_size = 1 << size;   /* table_size = ( 2 ** size ) */
-
-    new_hash->table_size   = table_size;
-    new_hash->mask         = table_size - 1;
-    new_hash->table        = mem_get( sizeof( hash_elem * ) * table_size );
-    new_hash->nmemb        = 0;
-    new_hash->index_table  = 0;
-    new_hash->index_bucket = mem_get( sizeof( hash_elem ) );
-    new_hash->index_bucket = NULL;
-
-    return new_hash;
-}
+    new_hash = mem_get( sizeof( hash ) );
 
+    if ( size < HASH_BITS_MIN ) {
+        size = HASH_BITS_MIN;
+    }
 
-hash_elem *hash_elem_new()
-{
-    /* Martin A. Hansen, November 2008. */
-
-    /* Initializes a new hash_elem structure. */
-
-    hash_elem *new_elem = NULL;
-
-    new_elem = mem_get( sizeof( hash_elem ) );
+    table_size = ( size_t ) 1 << size;   /* table_size = ( 2 ** size ) */
 
-    new_elem->next = NULL;
-    new_elem->key  = NULL;
-    new_elem->val  = NULL;
+    new_hash->table_size  = table_size;
+    new_hash->mask        = table_size - 1;
+    new_hash->shift       = 64 - size;
+    new_hash->table       = mem_get_zero( sizeof( hash_elem ) * table_size );
+    new_hash->nmemb       = 0;
+    new_hash->index_table = 0;
+    new_hash->func        = hash_wy;
+    new_hash->arenas      = NULL;
+    new_hash->arena_count = 0;
+    new_hash->arena_len   = 0;
+    new_hash->arena_max   = 0;
 
-    return new_elem;
+    return new_hash;
 }
 
 
@@ -55,25 +56,37 @@ void hash_add( hash *hash_pt, char *key, void *val )
 
     /* Add a new hash element consisting of a key/value pair to an existing hash. */
 
-    hash_elem *old_elem   = NULL;
-    hash_elem *new_elem   = NULL;
-    size_t     hash_index = 0;
+    /* The key is hashed once. A new element is inserted from the slot */
+    /* where the lookup stopped unless the table must grow first. */
+
+    hash_elem *old_elem = NULL;
+    hash_elem  new_elem;
+    size_t     len      = strlen( key );
+    uint       h        = 0;
+    size_t     i        = 0;
+    uint       dist     = 0;
 
-    if ( ( old_elem = hash_elem_get( hash_pt, key ) ) != NULL )
+    if ( ( old_elem = hash_lookup( hash_pt, key, len, &h, &i, &dist ) ) != NULL )
     {
         old_elem->val = val;
     }
     else
     {
-        new_elem = hash_elem_new();
+        new_elem.key  = hash_arena_add( hash_pt, key, len + 1 );
+        new_elem.val  = val;
+        new_elem.hash = h;
 
-        hash_index = ( hash_key( key ) & hash_pt->mask );
+        if ( ( hash_pt->nmemb + 1 ) * 100 > hash_pt->table_size * HASH_LOAD )
+        {
+            hash_rehash( hash_pt, hash_pt->table_size << 1 );
 
-        new_elem->key  = mem_clone( key, strlen( key ) );
-        new_elem->val  = val;
-        new_elem->next = hash_pt->table[ hash_index ];
+            hash_insert( hash_pt, &new_elem );
+        }
+        else
+        {
+            hash_insert_at( hash_pt, &new_elem, i, dist );
+        }
 
-        hash_pt->table[ hash_index ] = new_elem;
         hash_pt->nmemb++;
     }
 }
@@ -85,17 +98,10 @@ void *hash_get( hash *hash_pt, char *key )
 
     /* Lookup a key in a given hash and return the value - or NULL if not found. */
 
-    hash_elem *bucket;
+    hash_elem *elem = NULL;
 
-    bucket = hash_pt->table[ ( hash_key( key ) & hash_pt->mask ) ];
-
-    while ( bucket != NULL )
-    {
-        if ( strcmp( bucket->key, key ) == 0 ) {
-            return bucket->val;
-        }
-
-        bucket = bucket->next;
+    if ( ( elem = hash_elem_get( hash_pt, key ) ) != NULL ) {
+        return elem->val;
     }
 
     return NULL;
@@ -108,69 +114,36 @@ hash_elem *hash_elem_get( hash *hash_pt, char *key )
 
     /* Lookup a key in a given hash and return the hash element - or NULL if not found. */
 
-    hash_elem *bucket;
-
-    bucket = hash_pt->table[ ( hash_key( key ) & hash_pt->mask ) ];
-
-    while ( bucket != NULL )
-    {
-        if ( strcmp( bucket->key, key ) == 0 ) {
-            return bucket;
-        }
-
-        bucket = bucket->next;
-    }
+    uint   h    = 0;
+    size_t i    = 0;
+    uint   dist = 0;
 
-    return NULL;
+    return hash_lookup( hash_pt, key, strlen( key ), &h, &i, &dist );
 }
 
 
-bool hash_each( hash *hash_pt, char **key_ppt, void *val )
+bool hash_each( hash *hash_pt, char **key_ppt, void *val_pt )
 {
     /* Martin A. Hansen, December 2008. */
 
     /* Get the next key/value pair from a hash table. */
 
-    char *key = *key_ppt;
-
-    printf( "\nhash_each INIT   -> i: %zu   he: %p\n", hash_pt->index_table, hash_pt->index_bucket );
-
-    if ( hash_pt->index_bucket != NULL )
-    {
-        key = hash_pt->index_bucket->key;
-        val = hash_pt->index_bucket->val;
-    
-        hash_pt->index_bucket = hash_pt->index_bucket->next;
-
-        *key_ppt = key;
-
-        printf( "\nhash_each BUCKET -> i: %zu   he: %p\n", hash_pt->index_table, hash_pt->index_bucket );
-        return TRUE;
-    }
+    hash_elem *elem = NULL;
 
     while ( hash_pt->index_table < hash_pt->table_size )
     {
-        hash_pt->index_bucket = hash_pt->table[ hash_pt->index_table ];
+        elem = &hash_pt->table[ hash_pt->index_table++ ];
 
-        if ( hash_pt->index_bucket != NULL )
+        if ( elem->dist != 0 )
         {
-            key = hash_pt->index_bucket->key;
-            val = hash_pt->index_bucket->val;
-        
-            hash_pt->index_bucket = hash_pt->index_bucket->next;
-
-            *key_ppt = key;
+            *key_ppt            = elem->key;
+            *( void ** ) val_pt = elem->val;
 
-            printf( "hash_each TABLE table[ %zu ]\n", hash_pt->index_table );
             return TRUE;
         }
-
-        hash_pt->index_table++;
     }
 
-    printf( "\nhash_each FALSE -> i: %zu   he: %p\n", hash_pt->index_table, hash_pt->index_bucket );
-
-    // RESET ITERATORS!
+    hash_pt->index_table = 0;
 
     return FALSE;
 }
@@ -182,21 +155,36 @@ void hash_destroy( hash *hash_pt )
 
     /* Deallocate memory for hash and all hash elements. */
 
-    size_t     i;
-    hash_elem *bucket;
+    size_t i;
+
+    for ( i = 0; i < hash_pt->arena_count; i++ ) {
+        mem_free( &hash_pt->arenas[ i ] );
+    }
+
+    mem_free( &hash_pt->arenas );
+    mem_free( &hash_pt->table );
+    mem_free( &hash_pt );
+}
+
+
+void hash_func_set( hash *hash_pt, hash_func func )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Set the hash function of a hash - existing elements are rehashed. */
+
+    size_t i = 0;
+
+    hash_pt->func = func;
 
     for ( i = 0; i < hash_pt->table_size; i++ )
     {
-        for ( bucket = hash_pt->table[ i ]; bucket != NULL; bucket = bucket->next )
-        {
-//            mem_free( bucket->key );
-//            mem_free( bucket->val );
-            mem_free( bucket );
+        if ( hash_pt->table[ i ].dist != 0 ) {
+            hash_pt->table[ i ].hash = func( hash_pt->table[ i ].key, strlen( hash_pt->table[ i ].key ) );
         }
     }
 
-    mem_free( hash_pt->table );
-    mem_free( hash_pt );
+    hash_rehash( hash_pt, hash_pt->table_size );
 }
 
 
@@ -219,6 +207,120 @@ uint hash_key( char *string )
 }
 
 
+uint hash_kent( char *key, size_t len )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Shift-add hash function of a key of a given length - as hash_key. */
+
+    uint   result = 0;
+    size_t i      = 0;
+
+    for ( i = 0; i < len; i++ ) {
+        result += ( result << 3 ) + key[ i ];
+    }
+
+    return result;
+}
+
+
+uint hash_fnv( char *key, size_t len )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* FNV-1a hash function of a key of a given length. */
+
+    uint   result = 2166136261U;
+    size_t i      = 0;
+
+    for ( i = 0; i < len; i++ )
+    {
+        result ^= ( uchar ) key[ i ];
+        result *= 16777619U;
+    }
+
+    return result;
+}
+
+
+uint hash_wy( char *key, size_t len )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Word at a time hash function of a key of a given length after */
+    /* wyhash by Wang Yi. Keys are read 8 bytes at a time and mixed */
+    /* with 64 x 64 -> 128 bit multiplications, and short keys with a */
+    /* few overlapping reads. The 64 bit result is folded to 32 bits. */
+
+    uchar    *p    = ( uchar * ) key;
+    uint64_t  s0   = 0xa0761d6478bd642fULL;
+    uint64_t  s1   = 0xe7037ed1a0b428dbULL;
+    uint64_t  s2   = 0x8ebc6af09c88c6e3ULL;
+    uint64_t  s3   = 0x589965cc75374cc3ULL;
+    uint64_t  seed = 0;
+    uint64_t  see1 = 0;
+    uint64_t  see2 = 0;
+    uint64_t  a    = 0;
+    uint64_t  b    = 0;
+    size_t    i    = len;
+    __uint128_t r;
+
+    seed ^= hash_mum( seed ^ s0, s1 );
+
+    if ( len <= 16 )
+    {
+        if ( len >= 4 )
+        {
+            a = ( hash_read4( p ) << 32 ) | hash_read4( p + ( ( len >> 3 ) << 2 ) );
+            b = ( hash_read4( p + len - 4 ) << 32 ) | hash_read4( p + len - 4 - ( ( len >> 3 ) << 2 ) );
+        }
+        else if ( len > 0 )
+        {
+            a = ( ( uint64_t ) p[ 0 ] << 16 ) | ( ( uint64_t ) p[ len >> 1 ] << 8 ) | p[ len - 1 ];
+        }
+    }
+    else
+    {
+        if ( i > 48 )
+        {
+            see1 = seed;
+            see2 = seed;
+
+            do
+            {
+                seed = hash_mum( hash_read8( p ) ^ s1, hash_read8( p + 8 ) ^ seed );
+                see1 = hash_mum( hash_read8( p + 16 ) ^ s2, hash_read8( p + 24 ) ^ see1 );
+                see2 = hash_mum( hash_read8( p + 32 ) ^ s3, hash_read8( p + 40 ) ^ see2 );
+
+                p += 48;
+                i -= 48;
+            } while ( i > 48 );
+
+            seed ^= see1 ^ see2;
+        }
+
+        while ( i > 16 )
+        {
+            seed = hash_mum( hash_read8( p ) ^ s1, hash_read8( p + 8 ) ^ seed );
+
+            p += 16;
+            i -= 16;
+        }
+
+        a = hash_read8( p + i - 16 );
+        b = hash_read8( p + i - 8 );
+    }
+
+    r = ( __uint128_t ) ( a ^ s1 ) * ( b ^ seed );
+    a = ( uint64_t ) r;
+    b = ( uint64_t ) ( r >> 64 );
+
+    a = hash_mum( a ^ s0 ^ len, b ^ s1 );
+
+    return ( uint ) ( a ^ ( a >> 32 ) );
+}
+
+
 void hash_print( hash *hash_pt )
 {
     /* Martin A. Hansen, November 2008. */
@@ -226,20 +328,17 @@ void hash_print( hash *hash_pt )
     /* Debug function that prints hash meta data and
      * all hash elements. */
 
-    hash_elem *bucket = NULL;
-    size_t     i      = 0;
+    hash_elem *elem = NULL;
+    size_t     i    = 0;
 
     printf( "table_size: %zu mask: %zu elem_count: %zu\n", hash_pt->table_size, hash_pt->mask, hash_pt->nmemb );
 
     for ( i = 0; i < hash_pt->table_size; i++ )
     {
-        bucket = hash_pt->table[ i ];
+        elem = &hash_pt->table[ i ];
 
-        while ( bucket != NULL  )
-        {
-            printf( "i: %zu   key: %s   val: %s\n", i, bucket->key, ( char * ) bucket->val );
-
-            bucket = bucket->next;
+        if ( elem->dist != 0 ) {
+            printf( "i: %zu   dist: %u   key: %s   val: %s\n", i, elem->dist, elem->key, ( char * ) elem->val );
         }
     }
 }
@@ -249,22 +348,226 @@ void hash_collision_stats( hash *hash_pt )
 {
     /* Martin A. Hansen, June 2008 */
 
-    /* Output some collision stats for a given hash. */
+    /* Output the probe distance of each element for a given hash. */
 
-    /* Use with Biopieces: ... | plot_histogram -k Col -x */
+    /* Use with Biopieces: ... | plot_histogram -k Dist -x */
 
-    size_t     i      = 0;
-    size_t     col    = 0;
-    hash_elem *bucket = NULL;
+    size_t i = 0;
 
     for ( i = 0; i < hash_pt->table_size; i++ )
     {
-        col = 0;
+        if ( hash_pt->table[ i ].dist != 0 ) {
+            printf( "Dist: %u\n---\n", hash_pt->table[ i ].dist - 1 );
+        }
+    }
+}
+
+
+static size_t hash_index( hash *hash_pt, uint h )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Returns the home slot of a hash in the table. The hash is */
+    /* multiplied with 2^64 / golden ratio and the high bits are used, */
+    /* so weak low bits of the hash are spread over the table. */
+
+    return ( size_t ) ( ( ( uint64_t ) h * 0x9e3779b97f4a7c15ULL ) >> hash_pt->shift );
+}
+
+
+static hash_elem *hash_lookup( hash *hash_pt, char *key, size_t len, uint *h_pt, size_t *i_pt, uint *dist_pt )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Lookup a key of a given length in a given hash and return the hash */
+    /* element - or NULL if not found. The hash of the key and, for a */
+    /* missing key, the slot and probe distance where the search stopped */
+    /* are returned via the pointers. */
+
+    /* With Robin Hood probing the search stops at the first slot */
+    /* holding an element closer to its home than the probed key. */
+
+    hash_elem *elem = NULL;
+    uint       h    = 0;
+    uint       dist = 1;
+    size_t     i    = 0;
+
+    h = hash_pt->func( key, len );
+    i = hash_index( hash_pt, h );
+
+    *h_pt = h;
+
+    while ( 1 )
+    {
+        elem = &hash_pt->table[ i ];
+
+        if ( elem->dist < dist )
+        {
+            *i_pt    = i;
+            *dist_pt = dist;
+
+            return NULL;
+        }
+
+        if ( elem->hash == h && strcmp( elem->key, key ) == 0 ) {
+            return elem;
+        }
+
+        i = ( i + 1 ) & hash_pt->mask;
+
+        dist++;
+    }
+}
+
+
+static void hash_insert( hash *hash_pt, hash_elem *elem )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Insert an element with a new key into the hash table from its home slot. */
+
+    hash_insert_at( hash_pt, elem, hash_index( hash_pt, elem->hash ), 1 );
+}
+
+
+static void hash_insert_at( hash *hash_pt, hash_elem *elem, size_t i, uint dist )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Insert an element with a new key into the hash table with Robin Hood */
+    /* probing starting at a given slot and probe distance: An element */
+    /* further from its home slot than the resident takes the slot and */
+    /* the resident is moved on. */
+
+    hash_elem  new_elem = *elem;
+    hash_elem  tmp;
+    hash_elem *slot     = NULL;
+
+    new_elem.dist = dist;
+
+    while ( 1 )
+    {
+        slot = &hash_pt->table[ i ];
+
+        if ( slot->dist == 0 )
+        {
+            *slot = new_elem;
+
+            return;
+        }
+
+        if ( slot->dist < new_elem.dist )
+        {
+            tmp      = *slot;
+            *slot    = new_elem;
+            new_elem = tmp;
+        }
+
+        i = ( i + 1 ) & hash_pt->mask;
+
+        new_elem.dist++;
+    }
+}
+
+
+static void hash_rehash( hash *hash_pt, size_t table_size )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Rebuild the hash table with a given size and reinsert all */
+    /* elements with their stored hashes. Keys stay in the arena. */
+
+    hash_elem *old_table = hash_pt->table;
+    size_t     old_size  = hash_pt->table_size;
+    size_t     i         = 0;
+
+    hash_pt->shift        = 64 - __builtin_ctzl( table_size );
+    hash_pt->table_size   = table_size;
+    hash_pt->mask         = table_size - 1;
+    hash_pt->table        = mem_get_zero( sizeof( hash_elem ) * table_size );
+    hash_pt->index_table  = 0;
+
+    for ( i = 0; i < old_size; i++ )
+    {
+        if ( old_table[ i ].dist != 0 ) {
+            hash_insert( hash_pt, &old_table[ i ] );
+        }
+    }
 
-        for ( bucket = hash_pt->table[ i ]; bucket != NULL; bucket = bucket->next ) {
-            col++;
+    mem_free( &old_table );
+}
+
+
+static char *hash_arena_add( hash *hash_pt, char *key, size_t len )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Copy a key of a given length with the terminating \0 to the key */
+    /* arena and return a pointer to the copy. Keys longer than an arena */
+    /* block get their own block. */
+
+    char   *arena = NULL;
+    size_t  max   = HASH_ARENA;
+
+    if ( hash_pt->arena_count == 0 || hash_pt->arena_len + len > hash_pt->arena_max )
+    {
+        if ( len > max ) {
+            max = len;
         }
 
-        printf( "Col: %zu\n---\n", col );
+        hash_pt->arenas = mem_resize( hash_pt->arenas, sizeof( char * ) * ( hash_pt->arena_count + 1 ) );
+
+        hash_pt->arenas[ hash_pt->arena_count++ ] = mem_get( max );
+
+        hash_pt->arena_len = 0;
+        hash_pt->arena_max = max;
     }
+
+    arena = &hash_pt->arenas[ hash_pt->arena_count - 1 ][ hash_pt->arena_len ];
+
+    memcpy( arena, key, len );
+
+    hash_pt->arena_len += len;
+
+    return arena;
+}
+
+
+static uint64_t hash_mum( uint64_t a, uint64_t b )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Multiply two 64 bit words to 128 bits and fold to 64 bits. */
+
+    __uint128_t r = ( __uint128_t ) a * b;
+
+    return ( uint64_t ) r ^ ( uint64_t ) ( r >> 64 );
+}
+
+
+static uint64_t hash_read8( uchar *p )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Read 8 unaligned bytes as a 64 bit word. */
+
+    uint64_t v;
+
+    memcpy( &v, p, sizeof( v ) );
+
+    return v;
+}
+
+
+static uint64_t hash_read4( uchar *p )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Read 4 unaligned bytes as a 64 bit word. */
+
+    uint v;
+
+    memcpy( &v, p, sizeof( v ) );
+
+    return v;
 }
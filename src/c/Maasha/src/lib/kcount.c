@@ -0,0 +1,271 @@
+/* Martin Asser Hansen (mail@maasha.dk) Copyright (C) 2008 - All right reserved */
+
+#include <pthread.h>
+#include "common.h"
+#include "mem.h"
+#include "chash.h"
+#include "kcount.h"
+
+
+static uint kcount_dense_add( kcount *table, uint64_t code, uint n );
+static uint kcount_dense_get( kcount *table, uint64_t code );
+static uint kcount_hash_get( kcount *table, uint64_t code );
+
+
+kcount *kcount_new( int layout, uint64_t size, bool shared )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Initialize a new count table of a given layout. Dense layouts */
+    /* hold codes from 0 to size - 1, the sparse layout ignores size. */
+
+    kcount *table = NULL;
+    size_t  width = 0;
+
+    switch ( layout )
+    {
+        case KCOUNT_DENSE:   width = sizeof( uint );     break;
+        case KCOUNT_DENSE16: width = sizeof( uint16_t ); break;
+        case KCOUNT_DENSE8:  width = sizeof( uint8_t );  break;
+        case KCOUNT_SPARSE:  width = 0;                  break;
+        default:
+            fprintf( stderr, "ERROR: Unknown count table layout: %d\n", layout );
+            abort();
+    }
+
+    table = mem_get_zero( sizeof( kcount ) );
+
+    table->layout = layout;
+    table->shared = shared;
+
+    if ( width > 0 )
+    {
+        table->size  = size;
+        table->dense = mem_get_zero( width * size );
+        table->max   = ( layout == KCOUNT_DENSE16 ) ? 0xffff : ( layout == KCOUNT_DENSE8 ) ? 0xff : 0;
+    }
+
+    if ( layout == KCOUNT_DENSE ) {
+        return table;
+    }
+
+    table->hash = chash_new_u64( 0, shared );
+
+    return table;
+}
+
+
+void kcount_add( kcount *table, uint64_t code, uint n )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Add n to the count of a code. */
+
+    uint over = 0;
+
+    if ( table->layout == KCOUNT_SPARSE )
+    {
+        chash_add_u64( table->hash, code, n );
+    }
+    else
+    {
+        assert( code < table->size );
+
+        if ( ( over = kcount_dense_add( table, code, n ) ) > 0 ) {
+            chash_add_u64( table->hash, code, over );
+        }
+    }
+}
+
+
+uint kcount_get( kcount *table, uint64_t code )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Returns the count of a code. */
+
+    uint count = 0;
+
+    if ( table->layout == KCOUNT_SPARSE ) {
+        return kcount_hash_get( table, code );
+    }
+
+    assert( code < table->size );
+
+    count = kcount_dense_get( table, code );
+
+    if ( table->max > 0 && count == table->max ) {
+        count += kcount_hash_get( table, code );
+    }
+
+    return count;
+}
+
+
+void kcount_merge( kcount *dst, kcount *src )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Add all counts of the table src to the table dst. */
+
+    chash_iter iter;
+    uint64_t   code  = 0;
+    uint       count = 0;
+
+    if ( src->layout == KCOUNT_SPARSE )
+    {
+        chash_iter_init( &iter, src->hash );
+
+        while ( chash_iter_next_u64( &iter, &code, &count ) ) {
+            kcount_add( dst, code, count );
+        }
+    }
+    else
+    {
+        for ( code = 0; code < src->size; code++ )
+        {
+            if ( ( count = kcount_get( src, code ) ) > 0 ) {
+                kcount_add( dst, code, count );
+            }
+        }
+    }
+}
+
+
+size_t kcount_mem( kcount *table )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Returns the number of bytes used by a count table. */
+
+    size_t mem = sizeof( kcount );
+
+    switch ( table->layout )
+    {
+        case KCOUNT_DENSE:   mem += sizeof( uint )     * table->size; break;
+        case KCOUNT_DENSE16: mem += sizeof( uint16_t ) * table->size; break;
+        case KCOUNT_DENSE8:  mem += sizeof( uint8_t )  * table->size; break;
+        default:                                                      break;
+    }
+
+    if ( table->hash != NULL ) {
+        mem += chash_mem( table->hash );
+    }
+
+    return mem;
+}
+
+
+void kcount_destroy( kcount **table_ppt )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Deallocate memory for a count table. */
+
+    kcount *table = *table_ppt;
+
+    if ( table->hash != NULL ) {
+        chash_destroy( &table->hash );
+    }
+
+    if ( table->dense != NULL ) {
+        mem_free( &table->dense );
+    }
+
+    mem_free( table_ppt );
+}
+
+
+static uint kcount_dense_add( kcount *table, uint64_t code, uint n )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Add n to the dense count of a code. Counts saturate at the max */
+    /* value of the layout, and the part of n above that is returned to */
+    /* be added to the overflow table. */
+
+    uint     *dense32 = ( uint * ) table->dense;
+    uint16_t *dense16 = ( uint16_t * ) table->dense;
+    uint8_t  *dense8  = ( uint8_t * ) table->dense;
+    uint16_t  old16   = 0;
+    uint8_t   old8    = 0;
+    uint      old     = 0;
+    uint      new     = 0;
+
+    switch ( table->layout )
+    {
+        case KCOUNT_DENSE:
+            if ( table->shared ) {
+                __atomic_fetch_add( &dense32[ code ], n, __ATOMIC_RELAXED );
+            } else {
+                dense32[ code ] += n;
+            }
+
+            return 0;
+
+        case KCOUNT_DENSE16:
+            old16 = __atomic_load_n( &dense16[ code ], __ATOMIC_RELAXED );
+
+            do
+            {
+                old = old16;
+                new = ( old + n < table->max ) ? old + n : table->max;
+
+                if ( ! table->shared ) {
+                    dense16[ code ] = new;
+                }
+            }
+            while ( table->shared && ! __atomic_compare_exchange_n( &dense16[ code ], &old16, new, TRUE, __ATOMIC_RELAXED, __ATOMIC_RELAXED ) );
+
+            break;
+
+        case KCOUNT_DENSE8:
+            old8 = __atomic_load_n( &dense8[ code ], __ATOMIC_RELAXED );
+
+            do
+            {
+                old = old8;
+                new = ( old + n < table->max ) ? old + n : table->max;
+
+                if ( ! table->shared ) {
+                    dense8[ code ] = new;
+                }
+            }
+            while ( table->shared && ! __atomic_compare_exchange_n( &dense8[ code ], &old8, new, TRUE, __ATOMIC_RELAXED, __ATOMIC_RELAXED ) );
+
+            break;
+    }
+
+    return old + n - new;
+}
+
+
+static uint kcount_dense_get( kcount *table, uint64_t code )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Returns the dense count of a code. */
+
+    switch ( table->layout )
+    {
+        case KCOUNT_DENSE16: return __atomic_load_n( &( ( uint16_t * ) table->dense )[ code ], __ATOMIC_RELAXED );
+        case KCOUNT_DENSE8:  return __atomic_load_n( &( ( uint8_t * ) table->dense )[ code ], __ATOMIC_RELAXED );
+        default:             return __atomic_load_n( &( ( uint * ) table->dense )[ code ], __ATOMIC_RELAXED );
+    }
+}
+
+
+static uint kcount_hash_get( kcount *table, uint64_t code )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Returns the hashed count of a code - 0 if not found. */
+
+    uint count = 0;
+
+    if ( ! chash_get_u64( table->hash, code, &count ) ) {
+        return 0;
+    }
+
+    return count;
+}
@@ -0,0 +1,408 @@
+/* Martin Asser Hansen (mail@maasha.dk) Copyright (C) 2008 - All right reserved */
+
+#include <limits.h>
+#include "common.h"
+#include "mem.h"
+#include "seq.h"
+#include "sort.h"
+#include "kmer.h"
+
+
+static uint *kmer_index_partition( kmer_index *index, char *seq, size_t beg, size_t end, int shift, uint64_t **keys_ppt, ushort **lows_ppt );
+static void  kmer_index_direct( kmer_index *index, char *seq, size_t beg, size_t end );
+static void  kmer_index_sorted( kmer_index *index, char *seq, size_t beg, size_t end );
+
+
+bool kmer_encode( char *seq, uint k, uint64_t *kmer_pt )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Pack a k-mer from the first k residues of a sequence. */
+    /* Returns FALSE if the k-mer contains other residues than ACGTU. */
+
+    uint64_t kmer = 0;
+    uint     i    = 0;
+    int      code = 0;
+
+    assert( k > 0 && k <= KMER_MAX );
+
+    for ( i = 0; i < k; i++ )
+    {
+        if ( ( code = nuc2bin( seq[ i ] ) ) < 0 ) {
+            return FALSE;
+        }
+
+        kmer = ( kmer << 2 ) | code;
+    }
+
+    *kmer_pt = kmer;
+
+    return TRUE;
+}
+
+
+void kmer_iter_init( kmer_iter *iter, char *seq, size_t beg, size_t end, uint k )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Initialize a rolling k-mer iterator over seq[ beg ] to seq[ end - 1 ]. */
+
+    assert( k > 0 && k <= KMER_MAX );
+
+    iter->seq  = seq;
+    iter->pos  = beg;
+    iter->end  = end;
+    iter->k    = k;
+    iter->len  = 0;
+    iter->mask = ( k == KMER_MAX ) ? ~( uint64_t ) 0 : ( ( uint64_t ) 1 << ( 2 * k ) ) - 1;
+    iter->kmer = 0;
+}
+
+
+bool kmer_iter_next( kmer_iter *iter, uint64_t *kmer_pt, size_t *pos_pt )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Get the next k-mer and its begin position from an iterator. Each */
+    /* residue is shifted onto the current k-mer, and k-mers with other */
+    /* residues than ACGTU are skipped. Returns FALSE when no more k-mers. */
+
+    int code = 0;
+
+    while ( iter->pos < iter->end )
+    {
+        code = nuc2bin( iter->seq[ iter->pos++ ] );
+
+        if ( code < 0 )
+        {
+            iter->len = 0;
+
+            continue;
+        }
+
+        iter->kmer = ( ( iter->kmer << 2 ) | code ) & iter->mask;
+
+        if ( ++iter->len >= iter->k )
+        {
+            *kmer_pt = iter->kmer;
+            *pos_pt  = iter->pos - iter->k;
+
+            return TRUE;
+        }
+    }
+
+    return FALSE;
+}
+
+
+kmer_index *kmer_index_new( char *seq, size_t beg, size_t end, uint k )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Build a k-mer index over seq[ beg ] to seq[ end - 1 ]. */
+
+    kmer_index *index = NULL;
+
+    assert( k > 0 && k <= KMER_MAX );
+    assert( beg <= end );
+
+    if ( end - beg > UINT_MAX )
+    {
+        fprintf( stderr, "ERROR: Sequence too long for kmer_index_new: %zu\n", end - beg );
+        abort();
+    }
+
+    index = mem_get_zero( sizeof( kmer_index ) );
+
+    index->k = k;
+
+    if ( k <= KMER_DIRECT_MAX ) {
+        kmer_index_direct( index, seq, beg, end );
+    } else {
+        kmer_index_sorted( index, seq, beg, end );
+    }
+
+    return index;
+}
+
+
+uint *kmer_index_get( kmer_index *index, uint64_t kmer, size_t *count_pt )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Lookup the postings of a k-mer in an index - returns NULL if not found. */
+    /* Sorted k-mers are found with binary search in the bucket of the k-mer. */
+
+    size_t lo    = 0;
+    size_t hi    = 0;
+    size_t mid   = 0;
+    size_t beg   = 0;
+    size_t count = 0;
+
+    if ( index->kmers == NULL )
+    {
+        beg   = index->offsets[ kmer ];
+        count = index->offsets[ kmer + 1 ] - beg;
+    }
+    else
+    {
+        lo = index->buckets[ kmer >> index->shift ];
+        hi = index->buckets[ ( kmer >> index->shift ) + 1 ];
+
+        while ( lo < hi )
+        {
+            mid = ( lo + hi ) / 2;
+
+            if ( index->kmers[ mid ] < kmer ) {
+                lo = mid + 1;
+            } else {
+                hi = mid;
+            }
+        }
+
+        if ( lo < index->buckets[ ( kmer >> index->shift ) + 1 ] && index->kmers[ lo ] == kmer )
+        {
+            beg   = index->offsets[ lo ];
+            count = index->offsets[ lo + 1 ] - beg;
+        }
+    }
+
+    *count_pt = count;
+
+    if ( count == 0 ) {
+        return NULL;
+    }
+
+    return &index->postings[ beg ];
+}
+
+
+void kmer_index_destroy( kmer_index **index_ppt )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Deallocate memory for a k-mer index. */
+
+    kmer_index *index = *index_ppt;
+
+    mem_free( &index->postings );
+    mem_free( &index->offsets );
+    mem_free( &index->kmers );
+    mem_free( &index->buckets );
+    mem_free( &index );
+
+    *index_ppt = NULL;
+}
+
+
+static uint *kmer_index_partition( kmer_index *index, char *seq, size_t beg, size_t end, int shift, uint64_t **keys_ppt, ushort **lows_ppt )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Allocate and fill the postings of an index with the positions of */
+    /* all k-mers partitioned into buckets on the k-mer bits above shift. */
+    /* Positions are ascending within each bucket. Unless NULL, arrays of */
+    /* the k-mers and of their low 16 bits along the postings are also */
+    /* allocated and filled, so buckets can be sorted without reading the */
+    /* sequence again. Returns an allocated array with the offset of each */
+    /* bucket in the postings and the total last. */
+
+    kmer_iter  iter;
+    uint64_t  *keys        = NULL;
+    ushort    *lows        = NULL;
+    uint      *bucket_begs = NULL;
+    uint      *bucket_ends = NULL;
+    uint64_t   kmer        = 0;
+    size_t     pos         = 0;
+    size_t     size        = ( size_t ) 1 << ( 2 * index->k - shift );
+    size_t     i           = 0;
+    uint       sum         = 0;
+    uint       count       = 0;
+
+    bucket_begs = mem_get_zero( sizeof( uint ) * ( size + 1 ) );
+
+    kmer_iter_init( &iter, seq, beg, end, index->k );
+
+    while ( kmer_iter_next( &iter, &kmer, &pos ) ) {
+        bucket_begs[ kmer >> shift ]++;
+    }
+
+    for ( i = 0; i < size; i++ )
+    {
+        count            = bucket_begs[ i ];
+        bucket_begs[ i ] = sum;
+        sum             += count;
+    }
+
+    bucket_begs[ size ] = sum;
+    bucket_ends         = mem_clone( bucket_begs, sizeof( uint ) * ( size + 1 ) );
+
+    index->count    = sum;
+    index->postings = mem_get( sizeof( uint ) * ( sum + 1 ) );
+
+    if ( keys_ppt != NULL ) {
+        keys = *keys_ppt = mem_get( sizeof( uint64_t ) * ( sum + 1 ) );
+    }
+
+    if ( lows_ppt != NULL ) {
+        lows = *lows_ppt = mem_get( sizeof( ushort ) * ( sum + 1 ) );
+    }
+
+    kmer_iter_init( &iter, seq, beg, end, index->k );
+
+    while ( kmer_iter_next( &iter, &kmer, &pos ) )
+    {
+        i = bucket_ends[ kmer >> shift ]++;
+
+        index->postings[ i ] = pos;
+
+        if ( keys != NULL ) {
+            keys[ i ] = kmer;
+        }
+
+        if ( lows != NULL ) {
+            lows[ i ] = kmer & 0xffff;
+        }
+    }
+
+    mem_free( &bucket_ends );
+
+    return bucket_begs;
+}
+
+
+static void kmer_index_direct( kmer_index *index, char *seq, size_t beg, size_t end )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Build a k-mer index with a direct table of posting offsets. After */
+    /* partitioning the positions on the top bits of the k-mers, each */
+    /* bucket is counting sorted on the low bits with a slice of the */
+    /* offset table small enough to stay in cache. */
+
+    uint     *bucket_begs = NULL;
+    uint     *offsets     = NULL;
+    ushort   *lows        = NULL;
+    uint     *tmp         = NULL;
+    int       low_bits    = 0;
+    size_t    buckets     = 0;
+    size_t    size        = ( size_t ) 1 << ( 2 * index->k );
+    size_t    max         = 0;
+    size_t    b           = 0;
+    size_t    i           = 0;
+    uint      sum         = 0;
+
+    low_bits = ( 2 * index->k < KMER_BUCKET_BITS ) ? 2 * index->k : KMER_BUCKET_BITS;
+    buckets  = size >> low_bits;
+
+    bucket_begs    = kmer_index_partition( index, seq, beg, end, low_bits, NULL, &lows );
+    index->offsets = mem_get_zero( sizeof( uint ) * ( size + 1 ) );
+
+    for ( b = 0; b < buckets; b++ )
+    {
+        if ( bucket_begs[ b + 1 ] - bucket_begs[ b ] > max ) {
+            max = bucket_begs[ b + 1 ] - bucket_begs[ b ];
+        }
+    }
+
+    tmp = mem_get( sizeof( uint ) * ( max + 1 ) );
+
+    for ( b = 0; b < buckets; b++ )
+    {
+        offsets = &index->offsets[ b << low_bits ];
+
+        for ( i = bucket_begs[ b ]; i < bucket_begs[ b + 1 ]; i++ ) {
+            offsets[ lows[ i ] ]++;
+        }
+
+        /* Offsets are set to group ends and moved to group begins by */
+        /* scattering backwards, which keeps the positions ascending. */
+        for ( sum = bucket_begs[ b ], i = 0; i < ( ( size_t ) 1 << low_bits ); i++ )
+        {
+            sum         += offsets[ i ];
+            offsets[ i ] = sum;
+        }
+
+        for ( i = bucket_begs[ b + 1 ]; i > bucket_begs[ b ]; i-- ) {
+            tmp[ --offsets[ lows[ i - 1 ] ] - bucket_begs[ b ] ] = index->postings[ i - 1 ];
+        }
+
+        memcpy( &index->postings[ bucket_begs[ b ] ], tmp, sizeof( uint ) * ( bucket_begs[ b + 1 ] - bucket_begs[ b ] ) );
+    }
+
+    index->offsets[ size ] = index->count;
+
+    mem_free( &bucket_begs );
+    mem_free( &lows );
+    mem_free( &tmp );
+}
+
+
+static void kmer_index_sorted( kmer_index *index, char *seq, size_t beg, size_t end )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Build a k-mer index with a sorted array of distinct k-mers. After */
+    /* partitioning the positions on the top bits of the k-mers, each */
+    /* bucket is radix sorted on the full k-mers and the distinct k-mers */
+    /* and their posting offsets are collected in order. The distinct */
+    /* k-mers are written over the partitioned k-mers already sorted. */
+
+    uint      *bucket_begs = NULL;
+    sort_item *items       = NULL;
+    size_t     max         = 0;
+    size_t     n           = 0;
+    size_t     b           = 0;
+    size_t     i           = 0;
+
+    index->shift   = 2 * index->k - KMER_BUCKET_BITS;
+    bucket_begs    = kmer_index_partition( index, seq, beg, end, index->shift, &index->kmers, NULL );
+    index->offsets = mem_get( sizeof( uint ) * ( index->count + 1 ) );
+    index->buckets = mem_get( sizeof( uint ) * ( KMER_BUCKETS + 1 ) );
+
+    for ( b = 0; b < KMER_BUCKETS; b++ )
+    {
+        if ( bucket_begs[ b + 1 ] - bucket_begs[ b ] > max ) {
+            max = bucket_begs[ b + 1 ] - bucket_begs[ b ];
+        }
+    }
+
+    items = mem_get( sizeof( sort_item ) * ( max + 1 ) );
+
+    for ( b = 0; b < KMER_BUCKETS; b++ )
+    {
+        index->buckets[ b ] = index->nmemb;
+
+        n = bucket_begs[ b + 1 ] - bucket_begs[ b ];
+
+        for ( i = 0; i < n; i++ )
+        {
+            items[ i ].key   = index->kmers[ bucket_begs[ b ] + i ];
+            items[ i ].index = index->postings[ bucket_begs[ b ] + i ];
+        }
+
+        sort_radix_items( items, n, 1 );
+
+        for ( i = 0; i < n; i++ )
+        {
+            if ( i == 0 || items[ i ].key != items[ i - 1 ].key )
+            {
+                index->kmers[ index->nmemb ]   = items[ i ].key;
+                index->offsets[ index->nmemb ] = bucket_begs[ b ] + i;
+
+                index->nmemb++;
+            }
+
+            index->postings[ bucket_begs[ b ] + i ] = items[ i ].index;
+        }
+    }
+
+    index->buckets[ KMER_BUCKETS ]  = index->nmemb;
+    index->offsets[ index->nmemb ] = index->count;
+
+    index->kmers   = mem_resize( index->kmers, sizeof( uint64_t ) * ( index->nmemb + 1 ) );
+    index->offsets = mem_resize( index->offsets, sizeof( uint ) * ( index->nmemb + 1 ) );
+
+    mem_free( &bucket_begs );
+    mem_free( &items );
+}
@@ -3,6 +3,7 @@
 #include "common.h"
 #include "mem.h"
 #include "list.h"
+#include "sort.h"
 
 
 /* >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>> SINGLY LINKED LIST <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<*/
@@ -174,6 +175,54 @@ void list_sl_sort( list_sl **list_ppt, int ( *compare )( const void *a, const vo
 }
 
 
+void list_sl_sort_radix( list_sl **list_ppt, uint64_t ( *key )( const void *val, void *data ), void *data )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Stable radix sort of a singly linked list on the 64 bit key returned */
+    /* for each node value by a key function, which is passed the value */
+    /* and a data pointer. The keys are extracted once per node, sorted */
+    /* with sort_radix_items, and the nodes are then relinked in order. */
+
+    list_sl    *list       = *list_ppt;
+    node_sl   **node_array = NULL;        /* array of pointers to nodes */
+    node_sl    *node       = NULL;
+    sort_item  *items      = NULL;
+    size_t      count      = 0;
+    size_t      i          = 0;
+
+    count = list_count( list );
+
+    if ( count > 1 )
+    {
+        node_array = mem_get( count * sizeof( *node_array ) );
+        items      = mem_get( count * sizeof( sort_item ) );
+
+        for ( node = list->first, i = 0; node != NULL; node = node->next, i++ )
+        {
+            node_array[ i ]  = node;
+            items[ i ].key   = key( node->val, data );
+            items[ i ].index = i;
+        }
+
+        sort_radix_items( items, count, 1 );
+
+        list->first = node_array[ items[ 0 ].index ];
+
+        for ( i = 1; i < count; i++ ) {
+            node_array[ items[ i - 1 ].index ]->next = node_array[ items[ i ].index ];
+        }
+
+        node_array[ items[ count - 1 ].index ]->next = NULL;
+
+        *list_ppt = list;
+
+        mem_free( &node_array );
+        mem_free( &items );
+    }
+}
+
+
 void list_sl_destroy( list_sl **list_ppt )
 {
     /* Martin A. Hansen, August 2008 */
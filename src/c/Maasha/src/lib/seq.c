@@ -42,6 +42,27 @@ char *bin2dna[256] = {
     "TTGA", "TTGC", "TTGG", "TTGT", "TTTA", "TTTC", "TTTG", "TTTT"
 };
 
+/* Byte array for fast convertion of nucleotides to 2 bit codes as */
+/* used by oligo2bin and k-mers: A=00 T/U=01 C=10 G=11 - others -1. */
+signed char nuc_bin[256] = {
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1,  0, -1,  2, -1, -1, -1,  3, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1,  1,  1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1,  0, -1,  2, -1, -1, -1,  3, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1,  1,  1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1
+};
+
 
 seq_entry *seq_new( size_t max_seq_name, size_t max_seq )
 {
@@ -49,11 +70,16 @@ seq_entry *seq_new( size_t max_seq_name, size_t max_seq )
 
     /* Initialize a new sequence entry. */
 
-    seq_entry *entry = NULL;
-    entry            = mem_get( sizeof( seq_entry ) );
-    entry->seq_name  = mem_get( max_seq_name );
-    entry->seq       = mem_get( max_seq );
-    entry->seq_len   = 0;
+    seq_entry *entry     = NULL;
+    entry                = mem_get( sizeof( seq_entry ) );
+    entry->seq_name      = mem_get( max_seq_name );
+    entry->seq           = mem_get( max_seq );
+    entry->seq_len       = 0;
+    entry->seq_name_size = max_seq_name;
+    entry->seq_size      = max_seq;
+
+    entry->seq_name[ 0 ] = '\0';
+    entry->seq[ 0 ]      = '\0';
 
     return entry;
 }
@@ -71,6 +97,77 @@ void seq_destroy( seq_entry *entry )
 }
 
 
+void seq_resize( seq_entry *entry, size_t len )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Resize a sequence entry so seq can hold len residues and a */
+    /* terminating \0. The allocation is doubled until large enough */
+    /* so appending residues one by one is amortized O(1). */
+
+    size_t size = entry->seq_size;
+
+    if ( len < size ) {
+        return;
+    }
+
+    while ( size <= len )
+    {
+        size <<= 1;
+
+        if ( size == 0 )
+        {
+            fprintf( stderr, "ERROR: seq_resize failed.\n" );
+            abort();
+        }
+    }
+
+    entry->seq      = mem_resize( entry->seq, size );
+    entry->seq_size = size;
+}
+
+
+void seq_name_resize( seq_entry *entry, size_t len )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Resize a sequence entry so seq_name can hold len chars and a */
+    /* terminating \0. The allocation is doubled until large enough. */
+
+    size_t size = entry->seq_name_size;
+
+    if ( len < size ) {
+        return;
+    }
+
+    while ( size <= len )
+    {
+        size <<= 1;
+
+        if ( size == 0 )
+        {
+            fprintf( stderr, "ERROR: seq_name_resize failed.\n" );
+            abort();
+        }
+    }
+
+    entry->seq_name      = mem_resize( entry->seq_name, size );
+    entry->seq_name_size = size;
+}
+
+
+void seq_reset( seq_entry *entry )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Empty a sequence entry for reuse while keeping the allocated memory. */
+
+    entry->seq_name[ 0 ] = '\0';
+    entry->seq[ 0 ]      = '\0';
+    entry->seq_len       = 0;
+}
+
+
 void seq_uppercase( char *seq )
 {
     /* Martin A. Hansen, May 2008 */
@@ -542,6 +639,7 @@ int oligo2bin( char *oligo )
     
     int i;
     int bin; 
+    int code;
     
     if ( strlen( oligo ) > 15 ) {
         abort();
@@ -552,18 +650,14 @@ int oligo2bin( char *oligo )
     for ( i = 0; oligo[ i ]; i++ )
     {
         bin <<= 2;
-        
-        switch ( oligo[ i ] )
-        {
-            case 'A': case 'a': bin |= 0; break;
-            case 'N': case 'n': bin |= 0; break;
-            case 'T': case 't': bin |= 1; break;
-            case 'U': case 'u': bin |= 1; break;
-            case 'C': case 'c': bin |= 2; break;
-            case 'G': case 'g': bin |= 3; break;
-            default: abort();
+
+        if ( ( code = nuc2bin( oligo[ i ] ) ) >= 0 ) {
+            bin |= code;
+        } else if ( oligo[ i ] != 'N' && oligo[ i ] != 'n' ) {
+            abort();
         }
     }
 
     return bin;
 }
+
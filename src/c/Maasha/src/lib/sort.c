@@ -0,0 +1,232 @@
+/* Martin Asser Hansen (mail@maasha.dk) Copyright (C) 2008 - All right reserved */
+
+#include <pthread.h>
+#include "common.h"
+#include "mem.h"
+#include "sort.h"
+
+/* Structure of the slice of items handled by one thread in a radix pass. */
+struct _sort_job
+{
+    sort_item *src;                       /* Items to scatter. */
+    sort_item *dst;                       /* Destination of scattered items. */
+    size_t     beg;                       /* Begin index of slice. */
+    size_t     end;                       /* End index of slice - exclusive. */
+    int        shift;                     /* Shift of the key digit of this pass. */
+    size_t     counts[ SORT_BUCKETS ];    /* Bucket counts of slice. */
+    size_t     offsets[ SORT_BUCKETS ];   /* Destination offsets of slice buckets. */
+};
+
+typedef struct _sort_job sort_job;
+
+static void  sort_jobs_run( sort_job *jobs, int threads, void *( *func )( void * ) );
+static void *sort_radix_count( void *arg );
+static void *sort_radix_scatter( void *arg );
+
+
+void sort_radix_items( sort_item *items, size_t count, int threads )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Stable LSD radix sort of items on their keys using a number of threads. */
+    /* Each pass sorts on one digit of SORT_RADIX_BITS, and passes over digits */
+    /* that are the same in all keys are skipped. In each pass every thread */
+    /* counts the digits of its slice, the counts are turned into offsets */
+    /* in thread order - which keeps the sort stable - and then each thread */
+    /* scatters its slice. */
+
+    sort_job  *jobs    = NULL;
+    sort_item *src     = items;
+    sort_item *dst     = NULL;
+    sort_item *tmp     = NULL;
+    uint64_t   key_or  = 0;
+    uint64_t   key_and = ~( uint64_t ) 0;
+    size_t     pos     = 0;
+    size_t     i       = 0;
+    int        shift   = 0;
+    int        b       = 0;
+    int        t       = 0;
+
+    if ( count < 2 ) {
+        return;
+    }
+
+    if ( threads < 1 ) {
+        threads = 1;
+    } else if ( threads > SORT_THREADS_MAX ) {
+        threads = SORT_THREADS_MAX;
+    }
+
+    if ( ( size_t ) threads > count / SORT_PARALLEL_MIN ) {
+        threads = ( count / SORT_PARALLEL_MIN > 0 ) ? count / SORT_PARALLEL_MIN : 1;
+    }
+
+    for ( i = 0; i < count; i++ )
+    {
+        key_or  |= items[ i ].key;
+        key_and &= items[ i ].key;
+    }
+
+    dst  = mem_get( count * sizeof( sort_item ) );
+    jobs = mem_get( threads * sizeof( sort_job ) );
+
+    for ( t = 0; t < threads; t++ )
+    {
+        jobs[ t ].beg = count / threads * t;
+        jobs[ t ].end = ( t == threads - 1 ) ? count : count / threads * ( t + 1 );
+    }
+
+    for ( shift = 0; shift < 64; shift += SORT_RADIX_BITS )
+    {
+        if ( ( ( ( key_or ^ key_and ) >> shift ) & ( SORT_BUCKETS - 1 ) ) == 0 ) {
+            continue;
+        }
+
+        for ( t = 0; t < threads; t++ )
+        {
+            jobs[ t ].src   = src;
+            jobs[ t ].dst   = dst;
+            jobs[ t ].shift = shift;
+        }
+
+        sort_jobs_run( jobs, threads, sort_radix_count );
+
+        for ( pos = 0, b = 0; b < SORT_BUCKETS; b++ )
+        {
+            for ( t = 0; t < threads; t++ )
+            {
+                jobs[ t ].offsets[ b ] = pos;
+
+                pos += jobs[ t ].counts[ b ];
+            }
+        }
+
+        sort_jobs_run( jobs, threads, sort_radix_scatter );
+
+        tmp = src;
+        src = dst;
+        dst = tmp;
+    }
+
+    if ( src != items )
+    {
+        memcpy( items, src, count * sizeof( sort_item ) );
+
+        dst = src;
+    }
+
+    mem_free( &dst );
+    mem_free( &jobs );
+}
+
+
+void sort_radix( void *base, size_t count, size_t size, uint64_t ( *key )( const void *elem, void *data ), void *data, int threads )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Stable radix sort of an array of count elements of a given size on */
+    /* the 64 bit key returned for each element by a key function, which */
+    /* is passed the element and a data pointer, using a number of threads. */
+    /* Keys are extracted once per element and the elements are moved */
+    /* once after the keys are sorted. */
+
+    sort_item *items = NULL;
+    char      *array = ( char * ) base;
+    char      *tmp   = NULL;
+    size_t     i     = 0;
+
+    if ( count < 2 ) {
+        return;
+    }
+
+    items = mem_get( count * sizeof( sort_item ) );
+
+    for ( i = 0; i < count; i++ )
+    {
+        items[ i ].key   = key( &array[ i * size ], data );
+        items[ i ].index = i;
+    }
+
+    sort_radix_items( items, count, threads );
+
+    tmp = mem_get( count * size );
+
+    for ( i = 0; i < count; i++ ) {
+        memcpy( &tmp[ i * size ], &array[ items[ i ].index * size ], size );
+    }
+
+    memcpy( array, tmp, count * size );
+
+    mem_free( &tmp );
+    mem_free( &items );
+}
+
+
+static void sort_jobs_run( sort_job *jobs, int threads, void *( *func )( void * ) )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Run a function on each job in a thread of its own - the first */
+    /* job in the calling thread - and wait for all to finish. */
+
+    pthread_t thread_array[ SORT_THREADS_MAX ];
+    int       t = 0;
+
+    for ( t = 1; t < threads; t++ )
+    {
+        if ( pthread_create( &thread_array[ t ], NULL, func, &jobs[ t ] ) != 0 )
+        {
+            fprintf( stderr, "ERROR: Could not create thread\n" );
+            abort();
+        }
+    }
+
+    func( &jobs[ 0 ] );
+
+    for ( t = 1; t < threads; t++ ) {
+        pthread_join( thread_array[ t ], NULL );
+    }
+}
+
+
+static void *sort_radix_count( void *arg )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Count the key digits of the items in the slice of a job. */
+
+    sort_job  *job    = ( sort_job * ) arg;
+    sort_item *src    = job->src;
+    size_t    *counts = job->counts;
+    int        shift  = job->shift;
+    size_t     i      = 0;
+
+    memset( counts, 0, sizeof( job->counts ) );
+
+    for ( i = job->beg; i < job->end; i++ ) {
+        counts[ ( src[ i ].key >> shift ) & ( SORT_BUCKETS - 1 ) ]++;
+    }
+
+    return NULL;
+}
+
+
+static void *sort_radix_scatter( void *arg )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Scatter the items in the slice of a job to their bucket offsets. */
+
+    sort_job  *job     = ( sort_job * ) arg;
+    sort_item *src     = job->src;
+    sort_item *dst     = job->dst;
+    size_t    *offsets = job->offsets;
+    int        shift   = job->shift;
+    size_t     i       = 0;
+
+    for ( i = job->beg; i < job->end; i++ ) {
+        dst[ offsets[ ( src[ i ].key >> shift ) & ( SORT_BUCKETS - 1 ) ]++ ] = src[ i ];
+    }
+
+    return NULL;
+}
@@ -1,58 +1,93 @@
 /* Martin Asser Hansen (mail@maasha.dk) Copyright (C) 2008 - All right reserved */
 
 
+#include <limits.h>
 #include "common.h"
 #include "mem.h"
 #include "filesys.h"
 #include "list.h"
 #include "strings.h"
+#include "sort.h"
 #include "ucsc.h"
 
-
-bed_entry *bed_entry_new( const int cols )
+/* Structure of a sorted run of BED entries being merged. */
+struct _bed_run
 {
-    /* Martin A. Hansen, September 2008 */
-
-    /* Returns a new BED entry with memory allocated for */
-    /* a given number of columns. */
+    file_buffer *buffer;   /* Buffer of run file. */
+    bed_entry   *entry;    /* Current entry of run. */
+    size_t       index;    /* Index of run - used to keep ties in input order. */
+};
 
-    bed_entry *entry = mem_get( sizeof( bed_entry ) );
-
-    entry->cols    = cols;
-    entry->chr     = NULL;
-    entry->chr_beg = 0;
-    entry->chr_end = 0;
+typedef struct _bed_run bed_run;
 
-    entry->chr = mem_get( BED_CHR_MAX );
-
-    if ( cols == 3 ) {
-        return entry;
-    }
+/* Structure of the data passed to bed_entry_key. */
+struct _bed_key_data
+{
+    bed_table *pool;    /* String pool of chromosome names. */
+    uint      *ranks;   /* Ranks of chromosome names by id. */
+    int        sort;    /* BED_SORT order. */
+};
 
-    entry->q_id = mem_get( BED_QID_MAX );
+typedef struct _bed_key_data bed_key_data;
 
-    if ( cols == 4 ) {
-        return entry;
-    }
+/* Structure of a chromosome name and id sorted by bed_table_chr_ranks. */
+struct _bed_chr_name
+{
+    char *name;   /* Chromosome name. */
+    uint  id;     /* Chromosome id. */
+};
+
+typedef struct _bed_chr_name bed_chr_name;
+
+
+static bed_entry *bed_entry_clone( bed_entry *entry );
+static uint       bed_uint_parse( char *str, char *name );
+static int        bed_int_parse( char *str, char *name );
+static llong      bed_num_parse( char *str, char *name, llong min, llong max );
+static void       bed_table_resize( bed_table *table );
+static void       bed_table_arena_add( bed_table *table, char *str, size_t len );
+static void       bed_table_arena_uint( bed_table *table, uint val );
+static void       bed_table_chr_index( bed_table *table, size_t size );
+static uint       bed_table_chr_hash( char *chr );
+static void      *bed_table_permute( void *array, size_t size, size_t *order, size_t count );
+static int        cmp_bed_chr_name( const void *a, const void *b );
+static uint      *bed_table_chr_ranks( bed_table *table );
+static uint64_t   bed_entry_key( const void *val, void *data );
+static size_t     bed_table_mem( bed_table *table );
+static char      *bed_run_write( bed_table *table, int sort, int cols, char *dir, int threads );
+static void       bed_runs_merge( char **runs, size_t count, int sort, FILE *fp );
+static void       bed_heap_down( bed_run **heap, size_t count, size_t i, int sort );
+static int        cmp_bed_run( bed_run *a, bed_run *b, int sort );
 
-    entry->score = 0;
 
-    if ( cols == 5 ) {
-        return entry;
-    }
+bed_entry *bed_entry_new( const int cols )
+{
+    /* Martin A. Hansen, September 2008 */
 
-    entry->strand = 0; 
+    /* Returns a new BED entry that will be parsed up to a given */
+    /* number of columns - or all columns if cols is 0. */
 
-    if ( cols == 6 ) {
-        return entry;
-    }
+    bed_entry *entry = mem_get( sizeof( bed_entry ) );
 
+    entry->cols       = cols;
+    entry->max_cols   = cols;
+    entry->chr        = NULL;
+    entry->chr_beg    = 0;
+    entry->chr_end    = 0;
+    entry->q_id       = NULL;
+    entry->score      = 0;
+    entry->strand     = 0;
     entry->thick_beg  = 0;
     entry->thick_end  = 0;
-    entry->itemrgb    = mem_get( BED_ITEMRGB_MAX );
+    entry->itemrgb    = NULL;
     entry->blockcount = 0;
-    entry->blocksizes = mem_get( BED_BLOCKSIZES_MAX );
-    entry->q_begs     = mem_get( BED_QBEGS_MAX );
+    entry->blocksizes = NULL;
+    entry->q_begs     = NULL;
+    entry->line       = mem_get( BED_BUFFER );
+    entry->line_len   = 0;
+    entry->line_max   = BED_BUFFER;
+
+    entry->line[ 0 ] = '\0';
 
     return entry;
 }
@@ -64,118 +99,133 @@ void bed_entry_destroy( bed_entry *entry )
 
     /* Free memory for a BED entry. */
 
-    if ( entry->cols > 6 )
-    {
-        free( entry->itemrgb );
-        free( entry->blocksizes );
-        free( entry->q_begs );
-        free( entry->q_id );
-        free( entry->chr );
-    }
-    else if ( entry->cols > 3 )
-    {
-        free( entry->q_id );
-        free( entry->chr );
-    }
-    else
-    {
-        free( entry->chr );
-    }
-
+    mem_free( &entry->line );
     mem_free( &entry );
 }
 
 
-bool bed_entry_get( FILE *fp, bed_entry **entry_ppt )
+bool bed_entry_get( file_buffer *buffer, bed_entry **entry_ppt )
 {
-    /* Martin A. Hansen, September 2008 */
+    /* Martin A. Hansen, October 2026 */
 
-    /* Get next BED entry from a file stream. */
+    /* Get next BED entry from a file buffer. The line is copied to the */
+    /* entry and split on tabs, and the number of columns is detected */
+    /* from the line - up to max_cols if set. Integer elements are */
+    /* parsed without sscanf and any malformed element is an error. */
+    /* Empty lines, comments and track and browser lines are skipped. */
+    /* Returns FALSE when no more entries. */
 
     bed_entry *entry = *entry_ppt;
-    char       buffer[ BED_BUFFER ];
-
-    if ( fgets( buffer, sizeof( buffer ), fp ) != NULL )
+    char      *fields[ BED_COLS_MAX ];
+    char      *line  = NULL;
+    char      *pt    = NULL;
+    char      *end   = NULL;
+    char      *tab   = NULL;
+    size_t     len   = 0;
+    int        max   = 0;
+    int        cols  = 0;
+
+    max = ( entry->max_cols == 0 ) ? BED_COLS_MAX : entry->max_cols;
+
+    while ( ( len = buffer_gets( buffer, &line ) ) != 0 )
     {
-        if ( entry->cols == 3 )
-        {
-            sscanf(
-                    buffer,
-                    "%s\t%u\t%u",
-                    entry->chr, 
-                    &entry->chr_beg, 
-                    &entry->chr_end
-            );
+        if ( line[ len - 1 ] == '\n' ) {
+            len--;
+        }
+
+        if ( len > 0 && line[ len - 1 ] == '\r' ) {
+            len--;
+        }
 
-            return TRUE;
+        if ( len == 0 || line[ 0 ] == '#' || strncmp( line, "track", 5 ) == 0 || strncmp( line, "browser", 7 ) == 0 ) {
+            continue;
         }
 
-        if ( entry->cols == 4 )
+        if ( len >= entry->line_max )
         {
-            sscanf(
-                    buffer,
-                    "%s\t%u\t%u\t%s",
-                    entry->chr, 
-                    &entry->chr_beg, 
-                    &entry->chr_end,
-                    entry->q_id
-            );
+            while ( len >= entry->line_max ) {
+                entry->line_max <<= 1;
+            }
 
-            return TRUE;
+            entry->line = mem_resize( entry->line, entry->line_max );
         }
 
-        if ( entry->cols == 5 )
+        memcpy( entry->line, line, len );
+
+        entry->line[ len ] = '\0';
+        entry->line_len    = len;
+
+        pt   = entry->line;
+        end  = entry->line + len;
+        cols = 0;
+
+        while ( cols < max )
         {
-            sscanf(
-                    buffer,
-                    "%s\t%u\t%u\t%s\t%i",
-                    entry->chr, 
-                    &entry->chr_beg, 
-                    &entry->chr_end,
-                    entry->q_id, 
-                    &entry->score
-            );
+            fields[ cols++ ] = pt;
 
-            return TRUE;
+            if ( ( tab = memchr( pt, '\t', end - pt ) ) == NULL ) {
+                break;
+            }
+
+            *tab = '\0';
+            pt   = tab + 1;
         }
 
-        if ( entry->cols == 6 )
+        if ( cols < BED_COLS_MIN )
         {
-            sscanf(
-                    buffer,
-                    "%s\t%u\t%u\t%s\t%i\t%c",
-                    entry->chr, 
-                    &entry->chr_beg, 
-                    &entry->chr_end,
-                    entry->q_id, 
-                    &entry->score,
-                    &entry->strand
-            );
+            fprintf( stderr, "ERROR: BED entry with less than %d columns: %s\n", BED_COLS_MIN, entry->line );
+            abort();
+        }
 
-            return TRUE;
+        entry->cols    = cols;
+        entry->chr     = fields[ 0 ];
+        entry->chr_beg = bed_uint_parse( fields[ 1 ], "chr_beg" );
+        entry->chr_end = bed_uint_parse( fields[ 2 ], "chr_end" );
+
+        if ( cols > 3 ) {
+            entry->q_id = fields[ 3 ];
+        }
+
+        if ( cols > 4 ) {
+            entry->score = bed_int_parse( fields[ 4 ], "score" );
         }
 
-        if ( entry->cols == 12 )
+        if ( cols > 5 )
         {
-            sscanf(
-                    buffer,
-                    "%s\t%u\t%u\t%s\t%i\t%c\t%u\t%u\t%s\t%u\t%s\t%s",
-                    entry->chr, 
-                    &entry->chr_beg, 
-                    &entry->chr_end,
-                    entry->q_id, 
-                    &entry->score,
-                    &entry->strand,
-                    &entry->thick_beg,
-                    &entry->thick_end,
-                    entry->itemrgb,
-                    &entry->blockcount,
-                    entry->blocksizes,
-                    entry->q_begs
-            );
-
-            return TRUE;
+            if ( fields[ 5 ][ 0 ] == '\0' || fields[ 5 ][ 1 ] != '\0' )
+            {
+                fprintf( stderr, "ERROR: Bad BED strand: \"%s\"\n", fields[ 5 ] );
+                abort();
+            }
+
+            entry->strand = fields[ 5 ][ 0 ];
+        }
+
+        if ( cols > 6 ) {
+            entry->thick_beg = bed_uint_parse( fields[ 6 ], "thick_beg" );
+        }
+
+        if ( cols > 7 ) {
+            entry->thick_end = bed_uint_parse( fields[ 7 ], "thick_end" );
+        }
+
+        if ( cols > 8 ) {
+            entry->itemrgb = fields[ 8 ];
+        }
+
+        if ( cols > 9 ) {
+            entry->blockcount = bed_uint_parse( fields[ 9 ], "blockcount" );
         }
+
+        if ( cols > 10 ) {
+            entry->blocksizes = fields[ 10 ];
+        }
+
+        if ( cols > 11 ) {
+            entry->q_begs = fields[ 11 ];
+        }
+
+        return TRUE;
     }
 
     return FALSE;
@@ -189,37 +239,34 @@ list_sl *bed_entries_get( char *path, const int cols )
     /* Get a singly linked list with all BED entries (of a given number of coluns */
     /* from a specified file. */
 
-    list_sl   *list     = list_sl_new();
-    node_sl   *node     = node_sl_new();
-    node_sl   *old_node = NULL;
-    bed_entry *entry    = NULL;
-    FILE      *fp       = NULL;
+    list_sl     *list     = list_sl_new();
+    node_sl     *node     = NULL;
+    node_sl     *old_node = NULL;
+    bed_entry   *entry    = NULL;
+    file_buffer *buffer   = NULL;
     
     entry = bed_entry_new( cols );
 
-    fp = read_open( path );
-
-    if ( ( bed_entry_get( fp, &entry ) ) )
-    {
-        node->val = mem_clone( entry, sizeof( bed_entry ) );
-    
-        list_sl_add_beg( &list, &node );
-
-        old_node = node;
-    }
+    buffer_new( path, &buffer, 0 );
 
-    while ( ( bed_entry_get( fp, &entry ) ) )
+    while ( ( bed_entry_get( buffer, &entry ) ) )
     {
         node = node_sl_new();
 
-        node->val = mem_clone( entry, sizeof( bed_entry ) );
+        node->val = bed_entry_clone( entry );
 
-        list_sl_add_after( &old_node, &node );
+        if ( old_node == NULL ) {
+            list_sl_add_beg( &list, &node );
+        } else {
+            list_sl_add_after( &old_node, &node );
+        }
 
         old_node = node;
     }
 
-    close_stream( fp );
+    buffer_destroy( &buffer );
+
+    bed_entry_destroy( entry );
 
     return list;
 }
@@ -229,78 +276,70 @@ void bed_entry_put( bed_entry *entry, int cols )
 {
     /* Martin A. Hansen, September 2008 */
 
-    /* Output a given number of columns from a BED entry to stdout. */
+    /* Output a given number of columns from a BED entry to stdout - */
+    /* or all columns of the entry if cols is 0. */
+
+    bed_entry_fput( stdout, entry, cols );
+}
+
+
+void bed_entry_fput( FILE *fp, bed_entry *entry, int cols )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Output a given number of columns from a BED entry to a stream - */
+    /* or all columns of the entry if cols is 0. */
 
     if ( ! cols ) {
         cols = entry->cols;
     } 
 
-    if ( cols == 3 )
-    {
-        printf(
-            "%s\t%u\t%u\n",
-            entry->chr,
-            entry->chr_beg,
-            entry->chr_end
-        );
-    }
-    else if ( cols == 4 )
-    {
-        printf(
-            "%s\t%u\t%u\t%s\n",
-            entry->chr,
-            entry->chr_beg,
-            entry->chr_end,
-            entry->q_id 
-        );
-    }
-    else if ( cols == 5 )
-    {
-        printf(
-            "%s\t%u\t%u\t%s\t%i\n",
-            entry->chr,
-            entry->chr_beg,
-            entry->chr_end,
-            entry->q_id,
-            entry->score
-        );
-    }
-    else if ( cols == 6 )
-    {
-        printf(
-            "%s\t%u\t%u\t%s\t%i\t%c\n",
-            entry->chr,
-            entry->chr_beg,
-            entry->chr_end,
-            entry->q_id,
-            entry->score,
-            entry->strand
-        );
-    }
-    else if ( cols == 12 )
-    {
-        printf(
-            "%s\t%u\t%u\t%s\t%i\t%c\t%u\t%u\t%s\t%u\t%s\t%s\n",
-            entry->chr,
-            entry->chr_beg,
-            entry->chr_end,
-            entry->q_id,
-            entry->score,
-            entry->strand,
-            entry->thick_beg,
-            entry->thick_end,
-            entry->itemrgb,
-            entry->blockcount,
-            entry->blocksizes,
-            entry->q_begs
-        );
-    }
-    else
-    {
-        fprintf( stderr, "ERROR: Wrong number of columns in bed_entry_put: %d\n", cols );
+    if ( cols < BED_COLS_MIN || cols > entry->cols )
+    {
+        fprintf( stderr, "ERROR: Wrong number of columns in bed_entry_fput: %d\n", cols );
 
         abort();
     }
+
+    fprintf( fp, "%s\t%u\t%u", entry->chr, entry->chr_beg, entry->chr_end );
+
+    if ( cols > 3 ) {
+        fprintf( fp, "\t%s", entry->q_id );
+    }
+
+    if ( cols > 4 ) {
+        fprintf( fp, "\t%i", entry->score );
+    }
+
+    if ( cols > 5 ) {
+        fprintf( fp, "\t%c", entry->strand );
+    }
+
+    if ( cols > 6 ) {
+        fprintf( fp, "\t%u", entry->thick_beg );
+    }
+
+    if ( cols > 7 ) {
+        fprintf( fp, "\t%u", entry->thick_end );
+    }
+
+    if ( cols > 8 ) {
+        fprintf( fp, "\t%s", entry->itemrgb );
+    }
+
+    if ( cols > 9 ) {
+        fprintf( fp, "\t%u", entry->blockcount );
+    }
+
+    if ( cols > 10 ) {
+        fprintf( fp, "\t%s", entry->blocksizes );
+    }
+
+    if ( cols > 11 ) {
+        fprintf( fp, "\t%s", entry->q_begs );
+    }
+
+    fprintf( fp, "\n" );
 }
 
 
@@ -348,198 +387,1181 @@ void bed_entries_destroy( list_sl **entries_ppt )
 }
 
 
-void bed_file_sort_beg( char *path, int cols )
+void bed_entries_sort( list_sl **entries_ppt, int sort )
 {
-    /* Martin A. Hansen, September 2008 */
+    /* Martin A. Hansen, October 2026 */
 
-    /* Given a path to a BED file, read the given number of cols */
-    /* according to the begin position. The result is written to stdout. */
+    /* Sort a singly linked list of BED entries according to one of the */
+    /* BED_SORT orders. The chromosome names are ranked once, and the */
+    /* list is radix sorted on keys of rank, strand and begin position. */
+    /* Entries with equal keys keep their order. */
+
+    list_sl      *entries = *entries_ppt;
+    node_sl      *node    = NULL;
+    bed_key_data  data;
+
+    if ( sort < BED_SORT_CHR_BEG || sort > BED_SORT_STRAND_BEG )
+    {
+        fprintf( stderr, "ERROR: Unknown sort order in bed_entries_sort: %d\n", sort );
+        abort();
+    }
+
+    data.pool = bed_table_new();
+    data.sort = sort;
+
+    for ( node = entries->first; node != NULL; node = node->next ) {
+        bed_table_chr_id( data.pool, ( ( bed_entry * ) node->val )->chr );
+    }
 
-    list_sl *entries = NULL;
+    if ( data.pool->chr_count > ( ( size_t ) 1 << BED_KEY_RANK_BITS ) )
+    {
+        fprintf( stderr, "ERROR: Too many chromosomes in bed_entries_sort: %zu\n", data.pool->chr_count );
+        abort();
+    }
 
-    entries = bed_entries_get( path, cols );
+    data.ranks = bed_table_chr_ranks( data.pool );
 
-    list_sl_sort( &entries, cmp_bed_sort_beg );
+    list_sl_sort_radix( entries_ppt, bed_entry_key, &data );
 
-    bed_entries_put( entries, cols );
+    mem_free( &data.ranks );
 
-    bed_entries_destroy( &entries );
+    bed_table_destroy( &data.pool );
 }
 
 
-void bed_file_sort_strand_beg( char *path, int cols )
+bed_table *bed_table_new()
 {
-    /* Martin A. Hansen, September 2008 */
+    /* Martin A. Hansen, October 2026 */
+
+    /* Returns a new empty BED table. */
+
+    bed_table *table = mem_get( sizeof( bed_table ) );
+
+    table->count     = 0;
+    table->max       = BED_TABLE;
+    table->chr_ids   = mem_get( BED_TABLE * sizeof( uint ) );
+    table->chr_begs  = mem_get( BED_TABLE * sizeof( uint ) );
+    table->chr_ends  = mem_get( BED_TABLE * sizeof( uint ) );
+    table->scores    = mem_get( BED_TABLE * sizeof( int ) );
+    table->strands   = mem_get( BED_TABLE * sizeof( char ) );
+    table->cols      = mem_get( BED_TABLE * sizeof( uchar ) );
+    table->names     = mem_get( BED_TABLE * sizeof( size_t ) );
+    table->arena     = mem_get( BED_ARENA );
+    table->arena_len = 0;
+    table->arena_max = BED_ARENA;
+    table->chrs      = NULL;
+    table->chr_count = 0;
+    table->chr_max   = 0;
+    table->chr_index = NULL;
+    table->chr_mask  = 0;
+
+    bed_table_chr_index( table, BED_TABLE );
+
+    return table;
+}
 
-    /* Given a path to a BED file, read the given number of cols */
-    /* according to the strand AND begin position. The result is written to stdout. */
 
-    assert( cols >= 6 );
+void bed_table_add( bed_table *table, bed_entry *entry )
+{
+    /* Martin A. Hansen, October 2026 */
 
-    list_sl *entries = NULL;
+    /* Add a BED entry to a BED table. Consecutive entries are mostly */
+    /* on the same chromosome, so the id of the last entry is tried */
+    /* before looking up the chromosome name. */
 
-    entries = bed_entries_get( path, cols );
+    size_t i  = 0;
+    uint   id = 0;
 
-    list_sl_sort( &entries, cmp_bed_sort_strand_beg );
+    if ( table->count == table->max ) {
+        bed_table_resize( table );
+    }
 
-    bed_entries_put( entries, cols );
+    i = table->count++;
 
-    bed_entries_destroy( &entries );
-}
+    if ( i > 0 ) {
+        id = table->chr_ids[ i - 1 ];
+    }
 
+    if ( i > 0 && strcmp( table->chrs[ id ], entry->chr ) == 0 ) {
+        table->chr_ids[ i ] = id;
+    } else {
+        table->chr_ids[ i ] = bed_table_chr_id( table, entry->chr );
+    }
 
-void bed_file_sort_chr_beg( char *path, int cols )
-{
-    /* Martin A. Hansen, September 2008 */
+    table->chr_begs[ i ] = entry->chr_beg;
+    table->chr_ends[ i ] = entry->chr_end;
+    table->scores[ i ]   = ( entry->cols > 4 ) ? entry->score  : 0;
+    table->strands[ i ]  = ( entry->cols > 5 ) ? entry->strand : 0;
+    table->cols[ i ]     = entry->cols;
+    table->names[ i ]    = table->arena_len;
 
-    /* Given a path to a BED file, read the given number of cols */
-    /* according to the chromosome AND begin position. The result is written to stdout. */
+    if ( entry->cols > 3 ) {
+        bed_table_arena_add( table, entry->q_id, strlen( entry->q_id ) + 1 );
+    }
+
+    if ( entry->cols > 6 ) {
+        bed_table_arena_uint( table, entry->thick_beg );
+    }
+
+    if ( entry->cols > 7 )
+    {
+        bed_table_arena_add( table, "\t", 1 );
+        bed_table_arena_uint( table, entry->thick_end );
+    }
 
-    list_sl *entries = NULL;
+    if ( entry->cols > 8 )
+    {
+        bed_table_arena_add( table, "\t", 1 );
+        bed_table_arena_add( table, entry->itemrgb, strlen( entry->itemrgb ) );
+    }
 
-    entries = bed_entries_get( path, cols );
+    if ( entry->cols > 9 )
+    {
+        bed_table_arena_add( table, "\t", 1 );
+        bed_table_arena_uint( table, entry->blockcount );
+    }
 
-    list_sl_sort( &entries, cmp_bed_sort_chr_beg );
+    if ( entry->cols > 10 )
+    {
+        bed_table_arena_add( table, "\t", 1 );
+        bed_table_arena_add( table, entry->blocksizes, strlen( entry->blocksizes ) );
+    }
 
-    bed_entries_put( entries, cols );
+    if ( entry->cols > 11 )
+    {
+        bed_table_arena_add( table, "\t", 1 );
+        bed_table_arena_add( table, entry->q_begs, strlen( entry->q_begs ) );
+    }
 
-    bed_entries_destroy( &entries );
+    if ( entry->cols > 6 ) {
+        bed_table_arena_add( table, "", 1 );
+    }
 }
 
 
-void bed_file_sort_chr_strand_beg( char *path, int cols )
+bed_table *bed_table_get( char *path, const int cols )
 {
-    /* Martin A. Hansen, September 2008 */
+    /* Martin A. Hansen, October 2026 */
 
-    /* Given a path to a BED file, read the given number of cols */
-    /* according to the chromosome AND strand AND begin position. The result is written to stdout. */
+    /* Get a BED table with all BED entries from a specified file - */
+    /* parsed up to a given number of cols or all if cols is 0. */
 
-    assert( cols >= 6 );
+    bed_table   *table  = bed_table_new();
+    bed_entry   *entry  = NULL;
+    file_buffer *buffer = NULL;
+
+    entry = bed_entry_new( cols );
 
-    list_sl *entries = NULL;
+    buffer_new( path, &buffer, 0 );
 
-    entries = bed_entries_get( path, cols );
+    while ( bed_entry_get( buffer, &entry ) ) {
+        bed_table_add( table, entry );
+    }
 
-    list_sl_sort( &entries, cmp_bed_sort_chr_strand_beg );
+    buffer_destroy( &buffer );
 
-    bed_entries_put( entries, cols );
+    bed_entry_destroy( entry );
 
-    bed_entries_destroy( &entries );
+    return table;
 }
 
 
-int cmp_bed_sort_beg( const void *a, const void *b )
+uint bed_table_chr_id( bed_table *table, char *chr )
 {
-    /* Martin A. Hansen, September 2008 */
+    /* Martin A. Hansen, October 2026 */
 
-    /* Compare function for sorting a singly linked list of BED entries */
-    /* according to begin position. */
+    /* Returns the id of a chromosome name in a BED table which is */
+    /* added to the string pool if not found. */
 
-    node_sl *a_node = *( ( node_sl ** ) a );
-    node_sl *b_node = *( ( node_sl ** ) b );
+    size_t i  = 0;
+    uint   id = 0;
 
-    bed_entry *a_entry = ( bed_entry * ) a_node->val;
-    bed_entry *b_entry = ( bed_entry * ) b_node->val;
+    i = bed_table_chr_hash( chr ) & table->chr_mask;
 
-    if ( a_entry->chr_beg < b_entry->chr_beg ) {
-        return -1;
-    } else if ( a_entry->chr_beg > b_entry->chr_beg ) {
-        return 1;
-    } else {
-        return 0;
+    while ( ( id = table->chr_index[ i ] ) != 0 )
+    {
+        if ( strcmp( table->chrs[ id - 1 ], chr ) == 0 ) {
+            return id - 1;
+        }
+
+        i = ( i + 1 ) & table->chr_mask;
+    }
+
+    if ( table->chr_count == table->chr_max )
+    {
+        table->chr_max = ( table->chr_max == 0 ) ? BED_TABLE : table->chr_max << 1;
+        table->chrs    = mem_resize( table->chrs, table->chr_max * sizeof( char * ) );
+    }
+
+    table->chrs[ table->chr_count ] = mem_clone( chr, strlen( chr ) + 1 );
+
+    table->chr_index[ i ] = ++table->chr_count;
+
+    /* Keep the index at most half full. */
+    if ( table->chr_count * 2 > table->chr_mask + 1 ) {
+        bed_table_chr_index( table, ( table->chr_mask + 1 ) << 1 );
     }
+
+    return table->chr_count - 1;
 }
 
 
-int cmp_bed_sort_strand_beg( const void *a, const void *b )
+void bed_table_sort( bed_table *table, int sort, int threads )
 {
-    /* Martin A. Hansen, September 2008 */
+    /* Martin A. Hansen, October 2026 */
+
+    /* Sort a BED table in place according to one of the BED_SORT orders */
+    /* using a number of threads. Chromosome names are ranked once, and */
+    /* rank, strand and begin position are packed into a 64 bit key per */
+    /* entry, which is radix sorted. With more chromosomes than fit in */
+    /* the key, entries are first sorted on strand and begin and then on */
+    /* rank. The columns are then permuted in order. Entries with equal */
+    /* keys keep their order. */
+
+    sort_item *items  = NULL;
+    uint      *ranks  = NULL;
+    size_t    *order  = NULL;
+    size_t     i      = 0;
+    uint64_t   rank   = 0;
+    uint64_t   pos    = 0;
+    bool       chr    = ( sort == BED_SORT_CHR_BEG || sort == BED_SORT_CHR_STRAND_BEG );
+    bool       strand = ( sort == BED_SORT_CHR_STRAND_BEG || sort == BED_SORT_STRAND_BEG );
+    bool       packed = ( table->chr_count <= ( ( size_t ) 1 << BED_KEY_RANK_BITS ) );
+
+    if ( sort < BED_SORT_CHR_BEG || sort > BED_SORT_STRAND_BEG )
+    {
+        fprintf( stderr, "ERROR: Unknown sort order in bed_table_sort: %d\n", sort );
+        abort();
+    }
 
-    /* Compare function for sorting a singly linked list of BED entries */
-    /* according to strand AND begin position. */
+    if ( table->count < 2 ) {
+        return;
+    }
 
-    node_sl *a_node = *( ( node_sl ** ) a );
-    node_sl *b_node = *( ( node_sl ** ) b );
+    ranks = bed_table_chr_ranks( table );
 
-    bed_entry *a_entry = ( bed_entry * ) a_node->val;
-    bed_entry *b_entry = ( bed_entry * ) b_node->val;
+    items = mem_get( table->count * sizeof( sort_item ) );
 
-    if ( a_entry->strand < b_entry->strand ) {
-        return -1;
-    } else if ( a_entry->strand > b_entry->strand ) {
-        return 1;
-    } else if ( a_entry->chr_beg < b_entry->chr_beg ) {
-        return -1;
-    } else if ( a_entry->chr_beg > b_entry->chr_beg ) {
-        return 1;
-    } else {
-        return 0;
+    for ( i = 0; i < table->count; i++ )
+    {
+        rank = chr    ? ranks[ table->chr_ids[ i ] ] : 0;
+        pos  = strand ? ( uchar ) table->strands[ i ] : 0;
+        pos  = ( pos << 32 ) | table->chr_begs[ i ];
+
+        items[ i ].key   = packed ? ( rank << 40 ) | pos : pos;
+        items[ i ].index = i;
     }
-}
 
+    sort_radix_items( items, table->count, threads );
 
-int cmp_bed_sort_chr_beg( const void *a, const void *b )
-{
-    /* Martin A. Hansen, September 2008 */
+    if ( chr && ! packed )
+    {
+        for ( i = 0; i < table->count; i++ ) {
+            items[ i ].key = ranks[ table->chr_ids[ items[ i ].index ] ];
+        }
 
-    /* Compare function for sorting a singly linked list of BED entries */
-    /* according to chromosome name AND begin position. */
+        sort_radix_items( items, table->count, threads );
+    }
 
-    node_sl *a_node = *( ( node_sl ** ) a );
-    node_sl *b_node = *( ( node_sl ** ) b );
+    order = mem_get( table->count * sizeof( size_t ) );
 
-    bed_entry *a_entry = ( bed_entry * ) a_node->val;
-    bed_entry *b_entry = ( bed_entry * ) b_node->val;
+    for ( i = 0; i < table->count; i++ ) {
+        order[ i ] = items[ i ].index;
+    }
 
-    int diff = 0;
+    table->chr_ids  = bed_table_permute( table->chr_ids,  sizeof( uint ),   order, table->count );
+    table->chr_begs = bed_table_permute( table->chr_begs, sizeof( uint ),   order, table->count );
+    table->chr_ends = bed_table_permute( table->chr_ends, sizeof( uint ),   order, table->count );
+    table->scores   = bed_table_permute( table->scores,   sizeof( int ),    order, table->count );
+    table->strands  = bed_table_permute( table->strands,  sizeof( char ),   order, table->count );
+    table->cols     = bed_table_permute( table->cols,     sizeof( uchar ),  order, table->count );
+    table->names    = bed_table_permute( table->names,    sizeof( size_t ), order, table->count );
 
-    diff = strcmp( a_entry->chr, b_entry->chr );
+    table->max = table->count;
 
-    if ( diff < 0 ) {
-        return -1;
-    } else if ( diff > 0 ) {
-        return 1;
-    } else if ( a_entry->chr_beg < b_entry->chr_beg ) {
-        return -1;
-    } else if ( a_entry->chr_beg > b_entry->chr_beg ) {
-        return 1;
-    } else {
-        return 0;
-    }
+    mem_free( &ranks );
+    mem_free( &items );
+    mem_free( &order );
 }
 
 
-int cmp_bed_sort_chr_strand_beg( const void *a, const void *b )
+void bed_table_put( bed_table *table, int cols )
 {
-    /* Martin A. Hansen, September 2008 */
+    /* Martin A. Hansen, October 2026 */
 
-    /* Compare function for sorting a singly linked list of BED entries */
-    /* according to chromosome name AND strand AND begin position. */
+    /* Output a given number of columns from all entries in a BED table */
+    /* to stdout - or all columns of each entry if cols is 0. */
 
-    node_sl *a_node = *( ( node_sl ** ) a );
-    node_sl *b_node = *( ( node_sl ** ) b );
+    bed_table_fput( stdout, table, cols );
+}
 
-    bed_entry *a_entry = ( bed_entry * ) a_node->val;
-    bed_entry *b_entry = ( bed_entry * ) b_node->val;
 
-    int diff = 0;
+void bed_table_fput( FILE *fp, bed_table *table, int cols )
+{
+    /* Martin A. Hansen, October 2026 */
 
-    diff = strcmp( a_entry->chr, b_entry->chr );
+    /* Output a given number of columns from all entries in a BED table */
+    /* to a stream - or all columns of each entry if cols is 0. */
 
-    if ( diff < 0 ) {
-        return -1;
-    } else if ( diff > 0 ) {
-        return 1;
-    } else if ( a_entry->strand < b_entry->strand ) {
-        return -1;
-    } else if ( a_entry->strand > b_entry->strand ) {
-        return 1;
-    } else if ( a_entry->chr_beg < b_entry->chr_beg ) {
-        return -1;
-    } else if ( a_entry->chr_beg > b_entry->chr_beg ) {
-        return 1;
-    } else {
-        return 0;
-    }
-}
+    char   *q_id = NULL;
+    char   *rest = NULL;
+    char   *pt   = NULL;
+    size_t  i    = 0;
+    int     c    = 0;
+    int     n    = 0;
+
+    for ( i = 0; i < table->count; i++ )
+    {
+        c = ( cols == 0 ) ? table->cols[ i ] : cols;
+
+        if ( c < BED_COLS_MIN || c > table->cols[ i ] )
+        {
+            fprintf( stderr, "ERROR: Wrong number of columns in bed_table_fput: %d\n", c );
+            abort();
+        }
 
+        fprintf( fp, "%s\t%u\t%u", table->chrs[ table->chr_ids[ i ] ], table->chr_begs[ i ], table->chr_ends[ i ] );
+
+        if ( c > 3 )
+        {
+            q_id = &table->arena[ table->names[ i ] ];
+
+            fprintf( fp, "\t%s", q_id );
+        }
+
+        if ( c > 4 ) {
+            fprintf( fp, "\t%i", table->scores[ i ] );
+        }
+
+        if ( c > 5 ) {
+            fprintf( fp, "\t%c", table->strands[ i ] );
+        }
+
+        if ( c > 6 )
+        {
+            rest = q_id + strlen( q_id ) + 1;
+
+            for ( pt = rest, n = 7; n < c && ( pt = strchr( pt, '\t' ) ) != NULL; n++ ) {
+                pt++;
+            }
+
+            if ( pt == NULL || ( pt = strchr( pt, '\t' ) ) == NULL ) {
+                fprintf( fp, "\t%s", rest );
+            } else {
+                fprintf( fp, "\t%.*s", ( int ) ( pt - rest ), rest );
+            }
+        }
+
+        fprintf( fp, "\n" );
+    }
+}
+
+
+void bed_table_clear( bed_table *table )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Remove all entries from a BED table keeping the chromosome names. */
+
+    table->count     = 0;
+    table->arena_len = 0;
+}
+
+
+void bed_table_destroy( bed_table **table_ppt )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Free memory for a BED table. */
+
+    bed_table *table = *table_ppt;
+    size_t     i     = 0;
+
+    for ( i = 0; i < table->chr_count; i++ ) {
+        mem_free( &table->chrs[ i ] );
+    }
+
+    mem_free( &table->chrs );
+    mem_free( &table->chr_index );
+    mem_free( &table->chr_ids );
+    mem_free( &table->chr_begs );
+    mem_free( &table->chr_ends );
+    mem_free( &table->scores );
+    mem_free( &table->strands );
+    mem_free( &table->cols );
+    mem_free( &table->names );
+    mem_free( &table->arena );
+    mem_free( &table );
+
+    *table_ppt = NULL;
+}
+
+
+void bed_file_sort_beg( char *path, int cols )
+{
+    /* Martin A. Hansen, September 2008 */
+
+    /* Given a path to a BED file, read the given number of cols */
+    /* according to the begin position. The result is written to stdout. */
+
+    bed_table *table = NULL;
+
+    table = bed_table_get( path, cols );
+
+    bed_table_sort( table, BED_SORT_BEG, 1 );
+
+    bed_table_put( table, cols );
+
+    bed_table_destroy( &table );
+}
+
+
+void bed_file_sort_strand_beg( char *path, int cols )
+{
+    /* Martin A. Hansen, September 2008 */
+
+    /* Given a path to a BED file, read the given number of cols */
+    /* according to the strand AND begin position. The result is written to stdout. */
+
+    assert( cols >= 6 );
+
+    bed_table *table = NULL;
+
+    table = bed_table_get( path, cols );
+
+    bed_table_sort( table, BED_SORT_STRAND_BEG, 1 );
+
+    bed_table_put( table, cols );
+
+    bed_table_destroy( &table );
+}
+
+
+void bed_file_sort_chr_beg( char *path, int cols )
+{
+    /* Martin A. Hansen, September 2008 */
+
+    /* Given a path to a BED file, read the given number of cols */
+    /* according to the chromosome AND begin position. The result is written to stdout. */
+
+    bed_table *table = NULL;
+
+    table = bed_table_get( path, cols );
+
+    bed_table_sort( table, BED_SORT_CHR_BEG, 1 );
+
+    bed_table_put( table, cols );
+
+    bed_table_destroy( &table );
+}
+
+
+void bed_file_sort_chr_strand_beg( char *path, int cols )
+{
+    /* Martin A. Hansen, September 2008 */
+
+    /* Given a path to a BED file, read the given number of cols */
+    /* according to the chromosome AND strand AND begin position. The result is written to stdout. */
+
+    assert( cols >= 6 );
+
+    bed_table *table = NULL;
+
+    table = bed_table_get( path, cols );
+
+    bed_table_sort( table, BED_SORT_CHR_STRAND_BEG, 1 );
+
+    bed_table_put( table, cols );
+
+    bed_table_destroy( &table );
+}
+
+
+void bed_file_sort_external( char *path, int cols, int sort, char *dir, size_t mem, int threads )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Given a path to a BED file, read the given number of cols and sort */
+    /* according to one of the BED_SORT orders using at most about mem */
+    /* bytes of memory. Entries are read into a BED table until it holds */
+    /* half the memory - leaving room for sorting - and the table is then */
+    /* sorted and spilled as a run to a temporary file in dir. The runs */
+    /* are merged with a heap - in several passes if there are more runs */
+    /* than can be opened within mem. Ties are kept in input order. */
+    /* The result is written to stdout. */
+
+    bed_table    *table     = NULL;
+    bed_entry    *entry     = NULL;
+    file_buffer  *buffer    = NULL;
+    FILE         *fp        = NULL;
+    char         *file      = NULL;
+    char        **runs      = NULL;
+    size_t        run_count = 0;
+    size_t        run_max   = 0;
+    size_t        fan_in    = 0;
+    size_t        count     = 0;
+    size_t        i         = 0;
+    size_t        n         = 0;
+
+    table = bed_table_new();
+    entry = bed_entry_new( cols );
+
+    buffer_new( path, &buffer, 0 );
+
+    while ( bed_entry_get( buffer, &entry ) )
+    {
+        bed_table_add( table, entry );
+
+        if ( bed_table_mem( table ) > mem / 2 )
+        {
+            if ( run_count == run_max )
+            {
+                run_max = ( run_max == 0 ) ? BED_MERGE_MAX : run_max << 1;
+                runs    = mem_resize( runs, run_max * sizeof( char * ) );
+            }
+
+            runs[ run_count++ ] = bed_run_write( table, sort, cols, dir, threads );
+
+            bed_table_clear( table );
+        }
+    }
+
+    buffer_destroy( &buffer );
+
+    bed_entry_destroy( entry );
+
+    /* Everything fitted in memory. */
+    if ( run_count == 0 )
+    {
+        bed_table_sort( table, sort, threads );
+        bed_table_put( table, cols );
+        bed_table_destroy( &table );
+
+        return;
+    }
+
+    if ( table->count > 0 )
+    {
+        if ( run_count == run_max )
+        {
+            run_max <<= 1;
+            runs      = mem_resize( runs, run_max * sizeof( char * ) );
+        }
+
+        runs[ run_count++ ] = bed_run_write( table, sort, cols, dir, threads );
+    }
+
+    bed_table_destroy( &table );
+
+    fan_in = mem / FILE_BUFFER_SIZE;
+    fan_in = ( fan_in < 2 ) ? 2 : fan_in;
+    fan_in = ( fan_in > BED_MERGE_MAX ) ? BED_MERGE_MAX : fan_in;
+
+    while ( run_count > fan_in )
+    {
+        count = 0;
+
+        for ( i = 0; i < run_count; i += n )
+        {
+            n = ( run_count - i < fan_in ) ? run_count - i : fan_in;
+
+            if ( n == 1 )
+            {
+                runs[ count++ ] = runs[ i ];
+            }
+            else
+            {
+                fp = file_temp( dir, &file );
+
+                bed_runs_merge( &runs[ i ], n, sort, fp );
+
+                close_stream( fp );
+
+                runs[ count++ ] = file;
+            }
+        }
+
+        run_count = count;
+    }
+
+    bed_runs_merge( runs, run_count, sort, stdout );
+
+    mem_free( &runs );
+}
+
+
+int cmp_bed_sort_beg( const void *a, const void *b )
+{
+    /* Martin A. Hansen, September 2008 */
+
+    /* Compare function for sorting a singly linked list of BED entries */
+    /* according to begin position. */
+
+    node_sl *a_node = *( ( node_sl ** ) a );
+    node_sl *b_node = *( ( node_sl ** ) b );
+
+    bed_entry *a_entry = ( bed_entry * ) a_node->val;
+    bed_entry *b_entry = ( bed_entry * ) b_node->val;
+
+    if ( a_entry->chr_beg < b_entry->chr_beg ) {
+        return -1;
+    } else if ( a_entry->chr_beg > b_entry->chr_beg ) {
+        return 1;
+    } else {
+        return 0;
+    }
+}
+
+
+int cmp_bed_sort_strand_beg( const void *a, const void *b )
+{
+    /* Martin A. Hansen, September 2008 */
+
+    /* Compare function for sorting a singly linked list of BED entries */
+    /* according to strand AND begin position. */
+
+    node_sl *a_node = *( ( node_sl ** ) a );
+    node_sl *b_node = *( ( node_sl ** ) b );
+
+    bed_entry *a_entry = ( bed_entry * ) a_node->val;
+    bed_entry *b_entry = ( bed_entry * ) b_node->val;
+
+    if ( a_entry->strand < b_entry->strand ) {
+        return -1;
+    } else if ( a_entry->strand > b_entry->strand ) {
+        return 1;
+    } else if ( a_entry->chr_beg < b_entry->chr_beg ) {
+        return -1;
+    } else if ( a_entry->chr_beg > b_entry->chr_beg ) {
+        return 1;
+    } else {
+        return 0;
+    }
+}
+
+
+int cmp_bed_sort_chr_beg( const void *a, const void *b )
+{
+    /* Martin A. Hansen, September 2008 */
+
+    /* Compare function for sorting a singly linked list of BED entries */
+    /* according to chromosome name AND begin position. */
+
+    node_sl *a_node = *( ( node_sl ** ) a );
+    node_sl *b_node = *( ( node_sl ** ) b );
+
+    bed_entry *a_entry = ( bed_entry * ) a_node->val;
+    bed_entry *b_entry = ( bed_entry * ) b_node->val;
+
+    int diff = 0;
+
+    diff = strcmp( a_entry->chr, b_entry->chr );
+
+    if ( diff < 0 ) {
+        return -1;
+    } else if ( diff > 0 ) {
+        return 1;
+    } else if ( a_entry->chr_beg < b_entry->chr_beg ) {
+        return -1;
+    } else if ( a_entry->chr_beg > b_entry->chr_beg ) {
+        return 1;
+    } else {
+        return 0;
+    }
+}
+
+
+int cmp_bed_sort_chr_strand_beg( const void *a, const void *b )
+{
+    /* Martin A. Hansen, September 2008 */
+
+    /* Compare function for sorting a singly linked list of BED entries */
+    /* according to chromosome name AND strand AND begin position. */
+
+    node_sl *a_node = *( ( node_sl ** ) a );
+    node_sl *b_node = *( ( node_sl ** ) b );
+
+    bed_entry *a_entry = ( bed_entry * ) a_node->val;
+    bed_entry *b_entry = ( bed_entry * ) b_node->val;
+
+    int diff = 0;
+
+    diff = strcmp( a_entry->chr, b_entry->chr );
+
+    if ( diff < 0 ) {
+        return -1;
+    } else if ( diff > 0 ) {
+        return 1;
+    } else if ( a_entry->strand < b_entry->strand ) {
+        return -1;
+    } else if ( a_entry->strand > b_entry->strand ) {
+        return 1;
+    } else if ( a_entry->chr_beg < b_entry->chr_beg ) {
+        return -1;
+    } else if ( a_entry->chr_beg > b_entry->chr_beg ) {
+        return 1;
+    } else {
+        return 0;
+    }
+}
+
+
+static bed_entry *bed_entry_clone( bed_entry *entry )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Returns a copy of a BED entry with its own copy of the line */
+    /* that the string elements point into. */
+
+    bed_entry *copy = mem_clone( entry, sizeof( bed_entry ) );
+
+    copy->line     = mem_clone( entry->line, entry->line_len + 1 );
+    copy->line_max = entry->line_len + 1;
+
+    copy->chr = copy->line + ( entry->chr - entry->line );
+
+    if ( entry->cols > 3 ) {
+        copy->q_id = copy->line + ( entry->q_id - entry->line );
+    }
+
+    if ( entry->cols > 8 ) {
+        copy->itemrgb = copy->line + ( entry->itemrgb - entry->line );
+    }
+
+    if ( entry->cols > 10 ) {
+        copy->blocksizes = copy->line + ( entry->blocksizes - entry->line );
+    }
+
+    if ( entry->cols > 11 ) {
+        copy->q_begs = copy->line + ( entry->q_begs - entry->line );
+    }
+
+    return copy;
+}
+
+
+static uint bed_uint_parse( char *str, char *name )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Parse an unsigned integer BED element that must consist of digits only. */
+
+    return ( uint ) bed_num_parse( str, name, 0, UINT_MAX );
+}
+
+
+static int bed_int_parse( char *str, char *name )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Parse a signed integer BED element. */
+
+    return ( int ) bed_num_parse( str, name, INT_MIN, INT_MAX );
+}
+
+
+static llong bed_num_parse( char *str, char *name, llong min, llong max )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Parse an integer BED element of digits with an optional minus sign */
+    /* if min is negative. Values outside min and max are bad - checked */
+    /* before each digit is added so they never overflow. */
+
+    char  *pt    = str;
+    llong  limit = max;
+    llong  val   = 0;
+    llong  d     = 0;
+    bool   neg   = FALSE;
+
+    if ( min < 0 && *pt == '-' )
+    {
+        neg   = TRUE;
+        limit = -min;
+
+        pt++;
+    }
+
+    if ( *pt < '0' || *pt > '9' )
+    {
+        fprintf( stderr, "ERROR: Bad BED %s: \"%s\"\n", name, str );
+        abort();
+    }
+
+    while ( *pt >= '0' && *pt <= '9' )
+    {
+        d = *pt++ - '0';
+
+        if ( val > ( limit - d ) / 10 )
+        {
+            fprintf( stderr, "ERROR: Bad BED %s: \"%s\"\n", name, str );
+            abort();
+        }
+
+        val = val * 10 + d;
+    }
+
+    if ( *pt != '\0' )
+    {
+        fprintf( stderr, "ERROR: Bad BED %s: \"%s\"\n", name, str );
+        abort();
+    }
+
+    return neg ? -val : val;
+}
+
+
+static void bed_table_resize( bed_table *table )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Double the number of entries allocated in a BED table. */
+
+    table->max <<= 1;
+
+    table->chr_ids  = mem_resize( table->chr_ids,  table->max * sizeof( uint ) );
+    table->chr_begs = mem_resize( table->chr_begs, table->max * sizeof( uint ) );
+    table->chr_ends = mem_resize( table->chr_ends, table->max * sizeof( uint ) );
+    table->scores   = mem_resize( table->scores,   table->max * sizeof( int ) );
+    table->strands  = mem_resize( table->strands,  table->max * sizeof( char ) );
+    table->cols     = mem_resize( table->cols,     table->max * sizeof( uchar ) );
+    table->names    = mem_resize( table->names,    table->max * sizeof( size_t ) );
+}
+
+
+static void bed_table_arena_add( bed_table *table, char *str, size_t len )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Append len chars of a string to the arena of a BED table. */
+
+    if ( table->arena_len + len > table->arena_max )
+    {
+        while ( table->arena_len + len > table->arena_max ) {
+            table->arena_max <<= 1;
+        }
+
+        table->arena = mem_resize( table->arena, table->arena_max );
+    }
+
+    memcpy( &table->arena[ table->arena_len ], str, len );
+
+    table->arena_len += len;
+}
+
+
+static void bed_table_arena_uint( bed_table *table, uint val )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Append an unsigned integer as text to the arena of a BED table. */
+
+    char buf[ 16 ];
+    int  len = 0;
+
+    len = sprintf( buf, "%u", val );
+
+    bed_table_arena_add( table, buf, len );
+}
+
+
+static void bed_table_chr_index( bed_table *table, size_t size )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* (Re)build the chromosome index of a BED table with a given */
+    /* size that must be a power of 2. */
+
+    size_t i = 0;
+    size_t j = 0;
+
+    mem_free( &table->chr_index );
+
+    table->chr_index = mem_get_zero( size * sizeof( uint ) );
+    table->chr_mask  = size - 1;
+
+    for ( i = 0; i < table->chr_count; i++ )
+    {
+        j = bed_table_chr_hash( table->chrs[ i ] ) & table->chr_mask;
+
+        while ( table->chr_index[ j ] != 0 ) {
+            j = ( j + 1 ) & table->chr_mask;
+        }
+
+        table->chr_index[ j ] = i + 1;
+    }
+}
+
+
+static uint bed_table_chr_hash( char *chr )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* FNV-1a hash of a chromosome name. */
+
+    uchar *pt   = ( uchar * ) chr;
+    uint   hash = 2166136261U;
+
+    while ( *pt != '\0' )
+    {
+        hash ^= *pt++;
+        hash *= 16777619U;
+    }
+
+    return hash;
+}
+
+
+static void *bed_table_permute( void *array, size_t size, size_t *order, size_t count )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Returns a new array with the elements of a given size from an */
+    /* array in the given order. The old array is freed. */
+
+    char   *old = ( char * ) array;
+    char   *new = NULL;
+    size_t  i   = 0;
+
+    new = mem_get( count * size );
+
+    for ( i = 0; i < count; i++ ) {
+        memcpy( &new[ i * size ], &old[ order[ i ] * size ], size );
+    }
+
+    mem_free( &old );
+
+    return new;
+}
+
+
+static int cmp_bed_chr_name( const void *a, const void *b )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Compare function for sorting chromosome names. */
+
+    bed_chr_name *a_chr = ( bed_chr_name * ) a;
+    bed_chr_name *b_chr = ( bed_chr_name * ) b;
+
+    return strcmp( a_chr->name, b_chr->name );
+}
+
+
+static size_t bed_table_mem( bed_table *table )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Returns the approximate number of bytes used by the entries in a BED */
+    /* table - including the temporary arrays used by bed_table_sort. */
+
+    size_t entry_size = 4 * sizeof( uint ) + 2 * sizeof( char ) + sizeof( size_t );
+
+    return table->count * ( entry_size + sizeof( sort_item ) + sizeof( size_t ) ) + table->arena_len;
+}
+
+
+static char *bed_run_write( bed_table *table, int sort, int cols, char *dir, int threads )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Sort a BED table using a number of threads and write it to a new */
+    /* temporary file in dir. Returns the name of the file. */
+
+    char *file = NULL;
+    FILE *fp   = NULL;
+
+    bed_table_sort( table, sort, threads );
+
+    fp = file_temp( dir, &file );
+
+    bed_table_fput( fp, table, cols );
+
+    close_stream( fp );
+
+    return file;
+}
+
+
+static void bed_runs_merge( char **runs, size_t count, int sort, FILE *fp )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Merge a number of sorted run files in order into a stream. */
+    /* The run files are unlinked and the file names freed. */
+
+    bed_run  *run_array = NULL;
+    bed_run **heap      = NULL;
+    size_t    heap_size = 0;
+    size_t    i         = 0;
+
+    run_array = mem_get( count * sizeof( bed_run ) );
+    heap      = mem_get( count * sizeof( bed_run * ) );
+
+    for ( i = 0; i < count; i++ )
+    {
+        run_array[ i ].buffer = NULL;
+        run_array[ i ].entry  = bed_entry_new( 0 );
+        run_array[ i ].index  = i;
+
+        buffer_new( runs[ i ], &run_array[ i ].buffer, 0 );
+
+        if ( bed_entry_get( run_array[ i ].buffer, &run_array[ i ].entry ) ) {
+            heap[ heap_size++ ] = &run_array[ i ];
+        }
+    }
+
+    for ( i = heap_size / 2; i > 0; i-- ) {
+        bed_heap_down( heap, heap_size, i - 1, sort );
+    }
+
+    while ( heap_size > 0 )
+    {
+        bed_entry_fput( fp, heap[ 0 ]->entry, 0 );
+
+        if ( ! bed_entry_get( heap[ 0 ]->buffer, &heap[ 0 ]->entry ) ) {
+            heap[ 0 ] = heap[ --heap_size ];
+        }
+
+        bed_heap_down( heap, heap_size, 0, sort );
+    }
+
+    for ( i = 0; i < count; i++ )
+    {
+        buffer_destroy( &run_array[ i ].buffer );
+
+        bed_entry_destroy( run_array[ i ].entry );
+
+        file_unlink( runs[ i ] );
+
+        mem_free( &runs[ i ] );
+    }
+
+    mem_free( &run_array );
+    mem_free( &heap );
+}
+
+
+static void bed_heap_down( bed_run **heap, size_t count, size_t i, int sort )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Move a run down a min heap of runs until the heap order is restored. */
+
+    bed_run *tmp   = NULL;
+    size_t   child = 0;
+
+    while ( ( child = 2 * i + 1 ) < count )
+    {
+        if ( child + 1 < count && cmp_bed_run( heap[ child + 1 ], heap[ child ], sort ) < 0 ) {
+            child++;
+        }
+
+        if ( cmp_bed_run( heap[ child ], heap[ i ], sort ) >= 0 ) {
+            break;
+        }
+
+        tmp           = heap[ i ];
+        heap[ i ]     = heap[ child ];
+        heap[ child ] = tmp;
+
+        i = child;
+    }
+}
+
+
+static int cmp_bed_run( bed_run *a, bed_run *b, int sort )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Compare the current entries of two runs according to one of the */
+    /* BED_SORT orders and then the run index. */
+
+    bed_entry *a_entry = a->entry;
+    bed_entry *b_entry = b->entry;
+    char       a_strand = 0;
+    char       b_strand = 0;
+    int        diff     = 0;
+
+    if ( sort == BED_SORT_CHR_BEG || sort == BED_SORT_CHR_STRAND_BEG )
+    {
+        if ( ( diff = strcmp( a_entry->chr, b_entry->chr ) ) != 0 ) {
+            return diff;
+        }
+    }
+
+    if ( sort == BED_SORT_CHR_STRAND_BEG || sort == BED_SORT_STRAND_BEG )
+    {
+        a_strand = ( a_entry->cols > 5 ) ? a_entry->strand : 0;
+        b_strand = ( b_entry->cols > 5 ) ? b_entry->strand : 0;
+
+        if ( a_strand != b_strand ) {
+            return ( a_strand < b_strand ) ? -1 : 1;
+        }
+    }
+
+    if ( a_entry->chr_beg != b_entry->chr_beg ) {
+        return ( a_entry->chr_beg < b_entry->chr_beg ) ? -1 : 1;
+    } else if ( a->index != b->index ) {
+        return ( a->index < b->index ) ? -1 : 1;
+    } else {
+        return 0;
+    }
+}
+
+
+static uint *bed_table_chr_ranks( bed_table *table )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Returns an allocated array with the rank of each chromosome name */
+    /* of a BED table in sorted order indexed by chromosome id. */
+
+    bed_chr_name *names = NULL;
+    uint         *ranks = NULL;
+    size_t        i     = 0;
+
+    names = mem_get( ( table->chr_count + 1 ) * sizeof( bed_chr_name ) );
+    ranks = mem_get( ( table->chr_count + 1 ) * sizeof( uint ) );
+
+    for ( i = 0; i < table->chr_count; i++ )
+    {
+        names[ i ].name = table->chrs[ i ];
+        names[ i ].id   = i;
+    }
+
+    qsort( names, table->chr_count, sizeof( bed_chr_name ), cmp_bed_chr_name );
+
+    for ( i = 0; i < table->chr_count; i++ ) {
+        ranks[ names[ i ].id ] = i;
+    }
+
+    mem_free( &names );
+
+    return ranks;
+}
+
+
+static uint64_t bed_entry_key( const void *val, void *data )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Returns the packed sort key of a BED entry - chromosome rank, strand */
+    /* and begin position as used in the BED_SORT order given in data. */
+
+    bed_entry    *entry    = ( bed_entry * ) val;
+    bed_key_data *key_data = ( bed_key_data * ) data;
+    uint64_t      rank     = 0;
+    uint64_t      strand   = 0;
+    int           sort     = key_data->sort;
+
+    if ( sort == BED_SORT_CHR_BEG || sort == BED_SORT_CHR_STRAND_BEG ) {
+        rank = key_data->ranks[ bed_table_chr_id( key_data->pool, entry->chr ) ];
+    }
+
+    if ( ( sort == BED_SORT_CHR_STRAND_BEG || sort == BED_SORT_STRAND_BEG ) && entry->cols > 5 ) {
+        strand = ( uchar ) entry->strand;
+    }
+
+    return ( rank << 40 ) | ( strand << 32 ) | entry->chr_beg;
+}
@@ -0,0 +1,1025 @@
+/* Martin Asser Hansen (mail@maasha.dk) Copyright (C) 2008 - All right reserved */
+
+#include <zlib.h>
+#include "common.h"
+#include "mem.h"
+#include "wig.h"
+
+
+static void     wig_text_put( wig_writer *writer, char *chr, size_t pos, double value );
+static void     wig_text_flush( wig_writer *writer );
+static void     wig_text_value( wig_writer *writer, double value );
+static void     wig_span_put( wig_writer *writer, char *chr, size_t beg, size_t end, double value );
+static void     wig_span_flush( wig_writer *writer );
+static void     wig_binary_put( wig_writer *writer, char *chr, size_t pos, double value );
+static void     wig_binary_block( wig_writer *writer );
+static void     wig_binary_zoom( wig_writer *writer, wig_level *level, bool flush );
+static void     wig_binary_index( wig_writer *writer );
+static void     wig_block_write( wig_writer *writer, void *data, size_t size, wig_block **blocks_ppt, size_t *count_pt, wig_block *block );
+static void     wig_write( wig_writer *writer, void *data, size_t size );
+static void     wig_read( wig_reader *reader, void *data, size_t size );
+static void     wig_read_blocks( wig_reader *reader, wig_block **blocks_ppt, size_t *count_pt );
+static void    *wig_block_read( wig_reader *reader, wig_block *block, size_t size, size_t *len_pt );
+static int      wig_chrom( wig_reader *reader, char *chr );
+
+
+wig_writer *wig_writer_new( FILE *fp, int format, int decimals )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Initialize a new writer of a given format to a stream. Values are */
+    /* written with a number of decimals - rounded to integers if 0. */
+
+    wig_writer *writer = NULL;
+    z_stream   *zs     = NULL;
+    uint64_t    offset = 0;
+    uint        i      = 0;
+
+    writer = mem_get_zero( sizeof( wig_writer ) );
+
+    writer->fp       = fp;
+    writer->format   = format;
+    writer->decimals = decimals;
+
+    if ( format == WIG_FIXEDSTEP || format == WIG_BEDGRAPH || format == WIG_VARSTEP )
+    {
+        writer->buffer = mem_get( WIG_BUFFER );
+    }
+    else if ( format == WIG_BINARY )
+    {
+        /* A single deflate stream is reset for each block instead of */
+        /* setting up a new one with compress2. */
+
+        zs = mem_get_zero( sizeof( z_stream ) );
+
+        if ( deflateInit( zs, Z_BEST_SPEED ) != Z_OK )
+        {
+            fprintf( stderr, "ERROR: Could not initialize zlib stream\n" );
+            abort();
+        }
+
+        writer->zs         = zs;
+        writer->values     = mem_get( sizeof( float ) * WIG_BLOCK_ITEMS );
+        writer->runs       = mem_get( sizeof( uint32_t ) * 2 * WIG_BLOCK_ITEMS );
+        writer->data       = mem_get( sizeof( uint32_t ) * ( 1 + 3 * WIG_BLOCK_ITEMS ) );
+        /* Zoom records are larger than the runs and values of a data block. */
+
+        writer->cdata_size = deflateBound( zs, sizeof( wig_zoom ) * WIG_BLOCK_ITEMS );
+        writer->cdata      = mem_get( writer->cdata_size );
+
+        for ( i = 0; i < WIG_ZOOM_LEVELS; i++ )
+        {
+            writer->levels[ i ].bin     = WIG_ZOOM_BIN << ( 4 * i );
+            writer->levels[ i ].records = mem_get( sizeof( wig_zoom ) * WIG_BLOCK_ITEMS );
+        }
+
+        /* The index offset is set when the writer is closed. */
+
+        wig_write( writer, WIG_MAGIC, 8 );
+        wig_write( writer, &offset, sizeof( uint64_t ) );
+    }
+    else
+    {
+        fprintf( stderr, "ERROR: Unknown wig format: %d\n", format );
+        abort();
+    }
+
+    return writer;
+}
+
+
+void wig_writer_put( wig_writer *writer, char *chr, size_t pos, double value )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Put the value of a chromosome position (0-based). */
+
+    if ( writer->format == WIG_FIXEDSTEP ) {
+        wig_text_put( writer, chr, pos, value );
+    } else if ( writer->format == WIG_BINARY ) {
+        wig_binary_put( writer, chr, pos, value );
+    } else {
+        wig_span_put( writer, chr, pos, pos + 1, value );
+    }
+}
+
+
+void wig_writer_put_span( wig_writer *writer, char *chr, size_t beg, size_t end, double value )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Put the value of chromosome positions from beg to end - exclusive. */
+    /* Formats without runs get the value put for each position. */
+
+    size_t pos = 0;
+
+    if ( writer->format == WIG_BEDGRAPH || writer->format == WIG_VARSTEP )
+    {
+        wig_span_put( writer, chr, beg, end, value );
+    }
+    else
+    {
+        for ( pos = beg; pos < end; pos++ ) {
+            wig_writer_put( writer, chr, pos, value );
+        }
+    }
+}
+
+
+void wig_writer_destroy( wig_writer **writer_ppt )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Flush and deallocate memory for a writer. The stream is not closed. */
+
+    wig_writer *writer = *writer_ppt;
+    uint        i      = 0;
+
+    if ( writer->format != WIG_BINARY )
+    {
+        if ( writer->format != WIG_FIXEDSTEP ) {
+            wig_span_flush( writer );
+        }
+
+        wig_text_flush( writer );
+
+        mem_free( &writer->buffer );
+    }
+    else
+    {
+        wig_binary_index( writer );
+
+        for ( i = 0; i < writer->chr_count; i++ ) {
+            mem_free( &writer->chrs[ i ] );
+        }
+
+        for ( i = 0; i < WIG_ZOOM_LEVELS; i++ )
+        {
+            mem_free( &writer->levels[ i ].records );
+            mem_free( &writer->levels[ i ].blocks );
+        }
+
+        deflateEnd( writer->zs );
+
+        mem_free( &writer->zs );
+        mem_free( &writer->chrs );
+        mem_free( &writer->values );
+        mem_free( &writer->runs );
+        mem_free( &writer->data );
+        mem_free( &writer->blocks );
+        mem_free( &writer->cdata );
+    }
+
+    fflush( writer->fp );
+
+    if ( writer->chr != NULL ) {
+        mem_free( &writer->chr );
+    }
+
+    mem_free( writer_ppt );
+}
+
+
+size_t wig_format_uint( char *buf, uint64_t value )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Format an unsigned integer in a buffer and return the number of chars. */
+
+    char   tmp[ 20 ];
+    size_t len = 0;
+    size_t i   = 0;
+
+    do
+    {
+        tmp[ len++ ] = '0' + value % 10;
+
+        value /= 10;
+    }
+    while ( value > 0 );
+
+    for ( i = 0; i < len; i++ ) {
+        buf[ i ] = tmp[ len - i - 1 ];
+    }
+
+    return len;
+}
+
+
+size_t wig_format_double( char *buf, size_t size, double value, int decimals )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Format a value with a number of decimals in a buffer of a given size */
+    /* as snprintf %.*f - and return the number of chars as snprintf. The */
+    /* value is scaled and rounded to an integer if it fits in the 53 bit */
+    /* mantissa and is not close to a tie between two roundings - where */
+    /* printf rounds the exact binary value - other values are left to */
+    /* snprintf. The buffer is not '\0' terminated by the fast path. */
+
+    static const double scales[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9 };
+
+    double   x      = 0;
+    double   whole  = 0;
+    double   rest   = 0;
+    uint64_t scaled = 0;
+    uint64_t unit   = 0;
+    size_t   len    = 0;
+    size_t   frac   = 0;
+    int      i      = 0;
+
+    if ( size < 32 || decimals < 0 || decimals > 9 || ! isfinite( value ) ) {
+        return snprintf( buf, size, "%.*f", decimals, value );
+    }
+
+    x = fabs( value ) * scales[ decimals ];
+
+    if ( x >= 9007199254740992.0 ) {   /* 2^53 */
+        return snprintf( buf, size, "%.*f", decimals, value );
+    }
+
+    whole = floor( x );
+    rest  = x - whole;
+
+    /* The scaled value is off by at most half an ulp - a few ulps from a tie is safe. */
+
+    if ( fabs( rest - 0.5 ) <= ldexp( x, -50 ) ) {
+        return snprintf( buf, size, "%.*f", decimals, value );
+    }
+
+    scaled = ( uint64_t ) whole + ( rest > 0.5 );
+
+    if ( signbit( value ) ) {
+        buf[ len++ ] = '-';
+    }
+
+    unit = ( uint64_t ) scales[ decimals ];
+
+    len += wig_format_uint( buf + len, scaled / unit );
+
+    if ( decimals > 0 )
+    {
+        buf[ len++ ] = '.';
+
+        frac = scaled % unit;
+
+        for ( i = decimals - 1; i >= 0; i-- )
+        {
+            buf[ len + i ] = '0' + frac % 10;
+
+            frac /= 10;
+        }
+
+        len += decimals;
+    }
+
+    return len;
+}
+
+
+wig_reader *wig_reader_new( char *path )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Open a binary format file and read the index. */
+
+    wig_reader *reader = NULL;
+    char        magic[ 8 ];
+    uint64_t    offset = 0;
+    uint32_t    len    = 0;
+    uint32_t    levels = 0;
+    uint        i      = 0;
+
+    reader = mem_get_zero( sizeof( wig_reader ) );
+
+    if ( ( reader->fp = fopen( path, "r" ) ) == NULL )
+    {
+        fprintf( stderr, "ERROR: Could not open file '%s': %s\n", path, strerror( errno ) );
+        abort();
+    }
+
+    wig_read( reader, magic, 8 );
+
+    if ( memcmp( magic, WIG_MAGIC, 8 ) != 0 )
+    {
+        fprintf( stderr, "ERROR: Not a binary wig file: %s\n", path );
+        abort();
+    }
+
+    wig_read( reader, &offset, sizeof( uint64_t ) );
+
+    if ( offset == 0 || fseeko( reader->fp, offset, SEEK_SET ) != 0 )
+    {
+        fprintf( stderr, "ERROR: Bad index offset in binary wig file: %s\n", path );
+        abort();
+    }
+
+    wig_read( reader, &reader->chr_count, sizeof( uint32_t ) );
+
+    reader->chrs = mem_get_zero( sizeof( char * ) * ( reader->chr_count + 1 ) );
+
+    for ( i = 0; i < reader->chr_count; i++ )
+    {
+        wig_read( reader, &len, sizeof( uint32_t ) );
+
+        reader->chrs[ i ] = mem_get_zero( len + 1 );
+
+        wig_read( reader, reader->chrs[ i ], len );
+    }
+
+    wig_read( reader, &levels, sizeof( uint32_t ) );
+
+    if ( levels != WIG_ZOOM_LEVELS )
+    {
+        fprintf( stderr, "ERROR: Unsupported number of zoom levels in binary wig file: %u\n", levels );
+        abort();
+    }
+
+    wig_read_blocks( reader, &reader->blocks, &reader->block_count );
+
+    for ( i = 0; i < WIG_ZOOM_LEVELS; i++ )
+    {
+        wig_read( reader, &reader->levels[ i ].bin, sizeof( uint32_t ) );
+
+        wig_read_blocks( reader, &reader->levels[ i ].blocks, &reader->levels[ i ].block_count );
+    }
+
+    return reader;
+}
+
+
+size_t wig_reader_values( wig_reader *reader, char *chr, size_t beg, size_t end, float *values )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Read the values of chromosome positions from beg to end - exclusive */
+    /* - into values. Positions without values are set to NAN. Returns the */
+    /* number of positions with values. */
+
+    wig_block *block     = NULL;
+    uint32_t  *data      = NULL;
+    uint32_t  *runs      = NULL;
+    float     *vals      = NULL;
+    uint32_t   run_count = 0;
+    size_t     run_beg   = 0;
+    size_t     run_end   = 0;
+    size_t     len       = 0;
+    size_t     count     = 0;
+    size_t     pos       = 0;
+    size_t     i         = 0;
+    size_t     r         = 0;
+    int        chrom     = 0;
+
+    for ( pos = beg; pos < end; pos++ ) {
+        values[ pos - beg ] = NAN;
+    }
+
+    if ( ( chrom = wig_chrom( reader, chr ) ) < 0 ) {
+        return 0;
+    }
+
+    for ( i = 0; i < reader->block_count; i++ )
+    {
+        block = &reader->blocks[ i ];
+
+        if ( block->chrom != chrom || block->end <= beg || block->beg >= end ) {
+            continue;
+        }
+
+        data = wig_block_read( reader, block, sizeof( uint32_t ) * ( 1 + 3 * block->count ), &len );
+
+        run_count = data[ 0 ];
+        runs      = data + 1;
+        vals      = ( float * ) ( runs + 2 * run_count );
+
+        if ( len != sizeof( uint32_t ) * ( 1 + 2 * run_count ) + sizeof( float ) * block->count )
+        {
+            fprintf( stderr, "ERROR: Bad wig block\n" );
+            abort();
+        }
+
+        for ( r = 0; r < run_count; r++ )
+        {
+            run_beg = block->beg + runs[ 2 * r ];
+            run_end = run_beg + runs[ 2 * r + 1 ];
+
+            for ( pos = MAX( run_beg, beg ); pos < run_end && pos < end; pos++ )
+            {
+                values[ pos - beg ] = vals[ pos - run_beg ];
+
+                count++;
+            }
+
+            vals += runs[ 2 * r + 1 ];
+        }
+
+        mem_free( &data );
+    }
+
+    return count;
+}
+
+
+bool wig_reader_summary( wig_reader *reader, uint level, char *chr, size_t beg, size_t end, wig_zoom *summary )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Summarize the zoom records of a zoom level that overlap chromosome */
+    /* positions from beg to end - exclusive. Returns FALSE if none. */
+
+    wig_level *lev    = NULL;
+    wig_block *block  = NULL;
+    wig_zoom  *data   = NULL;
+    wig_zoom  *zoom   = NULL;
+    size_t     len    = 0;
+    size_t     i      = 0;
+    size_t     j      = 0;
+    int        chrom  = 0;
+
+    assert( level < WIG_ZOOM_LEVELS );
+
+    memset( summary, 0, sizeof( wig_zoom ) );
+
+    if ( ( chrom = wig_chrom( reader, chr ) ) < 0 ) {
+        return FALSE;
+    }
+
+    lev = &reader->levels[ level ];
+
+    for ( i = 0; i < lev->block_count; i++ )
+    {
+        block = &lev->blocks[ i ];
+
+        if ( block->chrom != chrom || block->end <= beg || block->beg >= end ) {
+            continue;
+        }
+
+        data = wig_block_read( reader, block, sizeof( wig_zoom ) * block->count, &len );
+
+        if ( len != sizeof( wig_zoom ) * block->count )
+        {
+            fprintf( stderr, "ERROR: Bad wig zoom block\n" );
+            abort();
+        }
+
+        for ( j = 0; j < block->count; j++ )
+        {
+            zoom = &data[ j ];
+
+            if ( zoom->chrom != chrom || zoom->end <= beg || zoom->beg >= end ) {
+                continue;
+            }
+
+            if ( summary->count == 0 )
+            {
+                *summary = *zoom;
+            }
+            else
+            {
+                summary->beg    = MIN( summary->beg, zoom->beg );
+                summary->end    = MAX( summary->end, zoom->end );
+                summary->min    = MIN( summary->min, zoom->min );
+                summary->max    = MAX( summary->max, zoom->max );
+                summary->count += zoom->count;
+                summary->sum   += zoom->sum;
+                summary->sumsq += zoom->sumsq;
+            }
+        }
+
+        mem_free( &data );
+    }
+
+    return summary->count > 0;
+}
+
+
+void wig_reader_destroy( wig_reader **reader_ppt )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Close a binary format file and deallocate memory for a reader. */
+
+    wig_reader *reader = *reader_ppt;
+    uint        i      = 0;
+
+    fclose( reader->fp );
+
+    for ( i = 0; i < reader->chr_count; i++ ) {
+        mem_free( &reader->chrs[ i ] );
+    }
+
+    for ( i = 0; i < WIG_ZOOM_LEVELS; i++ ) {
+        mem_free( &reader->levels[ i ].blocks );
+    }
+
+    mem_free( &reader->chrs );
+    mem_free( &reader->blocks );
+    mem_free( reader_ppt );
+}
+
+
+static void wig_text_put( wig_writer *writer, char *chr, size_t pos, double value )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Put a value as fixedStep text. A new section is started when the */
+    /* chromosome changes or a position is skipped. */
+
+    if ( writer->len + strlen( chr ) + 64 > WIG_BUFFER ) {
+        wig_text_flush( writer );
+    }
+
+    if ( writer->chr == NULL || pos != writer->next || strcmp( chr, writer->chr ) != 0 )
+    {
+        if ( writer->chr == NULL || strcmp( chr, writer->chr ) != 0 )
+        {
+            if ( writer->chr != NULL ) {
+                mem_free( &writer->chr );
+            }
+
+            writer->chr = mem_clone( chr, strlen( chr ) + 1 );
+        }
+
+        /* fixedStep format is 1 based. */
+
+        writer->len += sprintf( writer->buffer + writer->len, "fixedStep chrom=%s start=%zu step=1\n", chr, pos + 1 );
+    }
+
+    wig_text_value( writer, value );
+
+    writer->buffer[ writer->len++ ] = '\n';
+
+    writer->next = pos + 1;
+}
+
+
+static void wig_text_flush( wig_writer *writer )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Write the text output buffer to the stream. */
+
+    if ( writer->len > 0 && fwrite( writer->buffer, 1, writer->len, writer->fp ) != writer->len )
+    {
+        fprintf( stderr, "ERROR: Could not write wig output: %s\n", strerror( errno ) );
+        abort();
+    }
+
+    writer->len = 0;
+}
+
+
+static void wig_text_value( wig_writer *writer, double value )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Format a value at the end of the text output buffer leaving room */
+    /* for a line end. If the value does not fit, the buffer is flushed */
+    /* and the value formatted again. */
+
+    size_t size = WIG_BUFFER - writer->len - 1;
+    size_t len  = 0;
+
+    len = wig_format_double( writer->buffer + writer->len, size, value, writer->decimals );
+
+    if ( len >= size )
+    {
+        wig_text_flush( writer );
+
+        size = WIG_BUFFER - 1;
+        len  = wig_format_double( writer->buffer, size, value, writer->decimals );
+
+        if ( len >= size )
+        {
+            fprintf( stderr, "ERROR: Value too long for wig output buffer: %zu chars\n", len );
+            abort();
+        }
+    }
+
+    writer->len += len;
+}
+
+
+static void wig_span_put( wig_writer *writer, char *chr, size_t beg, size_t end, double value )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Put the value of a span of positions in the current run if the span */
+    /* is adjacent and the value equal - otherwise write the current run */
+    /* and start a new one. */
+
+    if ( writer->chr != NULL && beg == writer->next && value == writer->value && strcmp( chr, writer->chr ) == 0 )
+    {
+        writer->next = end;
+
+        return;
+    }
+
+    wig_span_flush( writer );
+
+    if ( writer->chr == NULL || strcmp( chr, writer->chr ) != 0 )
+    {
+        if ( writer->chr != NULL ) {
+            mem_free( &writer->chr );
+        }
+
+        writer->chr  = mem_clone( chr, strlen( chr ) + 1 );
+        writer->span = 0;
+    }
+
+    writer->beg   = beg;
+    writer->next  = end;
+    writer->value = value;
+}
+
+
+static void wig_span_flush( wig_writer *writer )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Write the current run as a bedGraph or variableStep line. */
+
+    if ( writer->chr == NULL || writer->next == writer->beg ) {
+        return;
+    }
+
+    if ( writer->len + 2 * strlen( writer->chr ) + 128 > WIG_BUFFER ) {
+        wig_text_flush( writer );
+    }
+
+    if ( writer->format == WIG_BEDGRAPH )
+    {
+        /* bedGraph format is 0 based and the end exclusive. */
+
+        writer->len += sprintf( writer->buffer + writer->len, "%s\t", writer->chr );
+        writer->len += wig_format_uint( writer->buffer + writer->len, writer->beg );
+        writer->buffer[ writer->len++ ] = '\t';
+        writer->len += wig_format_uint( writer->buffer + writer->len, writer->next );
+        writer->buffer[ writer->len++ ] = '\t';
+    }
+    else
+    {
+        /* variableStep format is 1 based. */
+
+        if ( writer->span != writer->next - writer->beg )
+        {
+            writer->span = writer->next - writer->beg;
+
+            writer->len += sprintf( writer->buffer + writer->len, "variableStep chrom=%s span=%zu\n", writer->chr, writer->span );
+        }
+
+        writer->len += wig_format_uint( writer->buffer + writer->len, writer->beg + 1 );
+        writer->buffer[ writer->len++ ] = ' ';
+    }
+
+    wig_text_value( writer, writer->value );
+
+    writer->buffer[ writer->len++ ] = '\n';
+
+    writer->beg = writer->next;
+}
+
+
+static void wig_binary_put( wig_writer *writer, char *chr, size_t pos, double value )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Put a value in the current binary block and update the zoom bins. */
+    /* A skipped position starts a new run in the block. The block is */
+    /* written when full or when the chromosome changes. */
+
+    wig_level *level = NULL;
+    wig_zoom  *zoom  = NULL;
+    uint       i     = 0;
+
+    if ( writer->chr == NULL || strcmp( chr, writer->chr ) != 0 )
+    {
+        wig_binary_block( writer );
+
+        for ( i = 0; i < WIG_ZOOM_LEVELS; i++ ) {
+            wig_binary_zoom( writer, &writer->levels[ i ], TRUE );
+        }
+
+        if ( writer->chr != NULL ) {
+            mem_free( &writer->chr );
+        }
+
+        writer->chr = mem_clone( chr, strlen( chr ) + 1 );
+
+        writer->chrs = mem_resize( writer->chrs, sizeof( char * ) * ( writer->chr_count + 1 ) );
+        writer->chrs[ writer->chr_count ] = mem_clone( chr, strlen( chr ) + 1 );
+
+        writer->chrom = writer->chr_count++;
+    }
+    else if ( writer->count == WIG_BLOCK_ITEMS || pos - writer->beg > UINT32_MAX )
+    {
+        wig_binary_block( writer );
+    }
+
+    if ( writer->count == 0 ) {
+        writer->beg = pos;
+    }
+
+    if ( writer->count == 0 || pos != writer->next )
+    {
+        writer->runs[ 2 * writer->run_count ]     = pos - writer->beg;
+        writer->runs[ 2 * writer->run_count + 1 ] = 0;
+
+        writer->run_count++;
+    }
+
+    writer->runs[ 2 * writer->run_count - 1 ]++;
+    writer->values[ writer->count++ ] = ( float ) value;
+    writer->next = pos + 1;
+
+    for ( i = 0; i < WIG_ZOOM_LEVELS; i++ )
+    {
+        level = &writer->levels[ i ];
+        zoom  = &level->current;
+
+        if ( zoom->count > 0 && pos >= zoom->end ) {
+            wig_binary_zoom( writer, level, FALSE );
+        }
+
+        if ( zoom->count == 0 )
+        {
+            zoom->chrom = writer->chrom;
+            zoom->beg   = pos - pos % level->bin;
+            zoom->end   = zoom->beg + level->bin;
+            zoom->min   = value;
+            zoom->max   = value;
+            zoom->sum   = 0;
+            zoom->sumsq = 0;
+        }
+
+        zoom->count++;
+        zoom->min    = MIN( zoom->min, ( float ) value );
+        zoom->max    = MAX( zoom->max, ( float ) value );
+        zoom->sum   += value;
+        zoom->sumsq += value * value;
+    }
+}
+
+
+static void wig_binary_block( wig_writer *writer )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Write the runs and values of the current binary block. */
+
+    wig_block  block;
+    uint32_t  *data = ( uint32_t * ) writer->data;
+    uint32_t   runs = writer->run_count;
+    size_t     size = 0;
+
+    if ( writer->count == 0 ) {
+        return;
+    }
+
+    block.chrom = writer->chrom;
+    block.count = writer->count;
+    block.beg   = writer->beg;
+    block.end   = writer->next;
+
+    data[ 0 ] = runs;
+
+    memcpy( data + 1, writer->runs, sizeof( uint32_t ) * 2 * runs );
+    memcpy( data + 1 + 2 * runs, writer->values, sizeof( float ) * writer->count );
+
+    size = sizeof( uint32_t ) * ( 1 + 2 * runs ) + sizeof( float ) * writer->count;
+
+    wig_block_write( writer, data, size, &writer->blocks, &writer->block_count, &block );
+
+    writer->count     = 0;
+    writer->run_count = 0;
+}
+
+
+static void wig_binary_zoom( wig_writer *writer, wig_level *level, bool flush )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Add the current bin of a zoom level to the waiting records, and */
+    /* write the waiting records as a block when full or if flush is */
+    /* set. Levels are flushed at the end of each chromosome, so blocks */
+    /* never span chromosomes. */
+
+    wig_block block;
+
+    if ( level->current.count > 0 )
+    {
+        level->records[ level->count++ ] = level->current;
+
+        level->current.count = 0;
+    }
+
+    if ( level->count == 0 || ( ! flush && level->count < WIG_BLOCK_ITEMS ) ) {
+        return;
+    }
+
+    block.chrom = level->records[ 0 ].chrom;
+    block.count = level->count;
+    block.beg   = level->records[ 0 ].beg;
+    block.end   = level->records[ level->count - 1 ].end;
+
+    wig_block_write( writer, level->records, sizeof( wig_zoom ) * level->count, &level->blocks, &level->block_count, &block );
+
+    level->count = 0;
+}
+
+
+static void wig_binary_index( wig_writer *writer )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Flush all blocks and write the index at the end of the file, and */
+    /* set the index offset in the header. */
+
+    wig_level *level  = NULL;
+    uint64_t   offset = 0;
+    uint64_t   count  = 0;
+    uint32_t   len    = 0;
+    uint32_t   levels = WIG_ZOOM_LEVELS;
+    uint       i      = 0;
+
+    wig_binary_block( writer );
+
+    for ( i = 0; i < WIG_ZOOM_LEVELS; i++ ) {
+        wig_binary_zoom( writer, &writer->levels[ i ], TRUE );
+    }
+
+    offset = writer->offset;
+
+    wig_write( writer, &writer->chr_count, sizeof( uint32_t ) );
+
+    for ( i = 0; i < writer->chr_count; i++ )
+    {
+        len = strlen( writer->chrs[ i ] );
+
+        wig_write( writer, &len, sizeof( uint32_t ) );
+        wig_write( writer, writer->chrs[ i ], len );
+    }
+
+    wig_write( writer, &levels, sizeof( uint32_t ) );
+
+    count = writer->block_count;
+
+    wig_write( writer, &count, sizeof( uint64_t ) );
+    wig_write( writer, writer->blocks, sizeof( wig_block ) * count );
+
+    for ( i = 0; i < WIG_ZOOM_LEVELS; i++ )
+    {
+        level = &writer->levels[ i ];
+        count = level->block_count;
+
+        wig_write( writer, &level->bin, sizeof( uint32_t ) );
+        wig_write( writer, &count, sizeof( uint64_t ) );
+        wig_write( writer, level->blocks, sizeof( wig_block ) * count );
+    }
+
+    if ( fseeko( writer->fp, 8, SEEK_SET ) != 0 || fwrite( &offset, sizeof( uint64_t ), 1, writer->fp ) != 1 )
+    {
+        fprintf( stderr, "ERROR: Could not write binary wig index - output must be a file: %s\n", strerror( errno ) );
+        abort();
+    }
+
+    fseeko( writer->fp, 0, SEEK_END );
+}
+
+
+static void wig_block_write( wig_writer *writer, void *data, size_t size, wig_block **blocks_ppt, size_t *count_pt, wig_block *block )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Compress and write a block and add the block to an index. */
+
+    z_stream *zs = writer->zs;
+
+    zs->next_in   = data;
+    zs->avail_in  = size;
+    zs->next_out  = writer->cdata;
+    zs->avail_out = writer->cdata_size;
+
+    if ( deflate( zs, Z_FINISH ) != Z_STREAM_END )
+    {
+        fprintf( stderr, "ERROR: Could not compress wig block\n" );
+        abort();
+    }
+
+    block->offset = writer->offset;
+    block->size   = zs->total_out;
+
+    wig_write( writer, writer->cdata, zs->total_out );
+
+    deflateReset( zs );
+
+    if ( ( *count_pt & ( *count_pt - 1 ) ) == 0 ) {
+        *blocks_ppt = mem_resize( *blocks_ppt, sizeof( wig_block ) * ( *count_pt == 0 ? 1 : *count_pt * 2 ) );
+    }
+
+    ( *blocks_ppt )[ ( *count_pt )++ ] = *block;
+}
+
+
+static void wig_write( wig_writer *writer, void *data, size_t size )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Write data to a binary stream and advance the file offset. */
+
+    if ( size > 0 && fwrite( data, 1, size, writer->fp ) != size )
+    {
+        fprintf( stderr, "ERROR: Could not write wig output: %s\n", strerror( errno ) );
+        abort();
+    }
+
+    writer->offset += size;
+}
+
+
+static void wig_read( wig_reader *reader, void *data, size_t size )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Read data from a binary stream. */
+
+    if ( size > 0 && fread( data, 1, size, reader->fp ) != size )
+    {
+        fprintf( stderr, "ERROR: Truncated binary wig file\n" );
+        abort();
+    }
+}
+
+
+static void wig_read_blocks( wig_reader *reader, wig_block **blocks_ppt, size_t *count_pt )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Read a block count and the block index entries. */
+
+    uint64_t count = 0;
+
+    wig_read( reader, &count, sizeof( uint64_t ) );
+
+    *blocks_ppt = mem_get( sizeof( wig_block ) * ( count + 1 ) );
+    *count_pt   = count;
+
+    wig_read( reader, *blocks_ppt, sizeof( wig_block ) * count );
+}
+
+
+static void *wig_block_read( wig_reader *reader, wig_block *block, size_t size, size_t *len_pt )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Read and uncompress a block of at most a given uncompressed size. */
+    /* The uncompressed size is returned in len_pt. */
+
+    uchar  *cdata = NULL;
+    uchar  *data  = NULL;
+    uLongf  len   = size;
+
+    cdata = mem_get( block->size );
+    data  = mem_get( size );
+
+    if ( fseeko( reader->fp, block->offset, SEEK_SET ) != 0 )
+    {
+        fprintf( stderr, "ERROR: Could not seek in binary wig file: %s\n", strerror( errno ) );
+        abort();
+    }
+
+    wig_read( reader, cdata, block->size );
+
+    if ( uncompress( data, &len, cdata, block->size ) != Z_OK )
+    {
+        fprintf( stderr, "ERROR: Could not uncompress wig block\n" );
+        abort();
+    }
+
+    mem_free( &cdata );
+
+    *len_pt = len;
+
+    return data;
+}
+
+
+static int wig_chrom( wig_reader *reader, char *chr )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Returns the number of a chromosome - or -1 if not found. */
+
+    uint i = 0;
+
+    for ( i = 0; i < reader->chr_count; i++ )
+    {
+        if ( strcmp( reader->chrs[ i ], chr ) == 0 ) {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+
@@ -0,0 +1,668 @@
+/* Martin Asser Hansen (mail@maasha.dk) Copyright (C) 2008 - All right reserved */
+
+#define _GNU_SOURCE
+#include <pthread.h>
+#include <zlib.h>
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+#include "common.h"
+#include "mem.h"
+#include "zfile.h"
+
+/* Structure of a BGZF block with compressed and decompressed data. */
+struct _bgzf_block
+{
+    uchar  *cdata;   /* Compressed data - the deflate stream of the block. */
+    size_t  csize;   /* Size of compressed data. */
+    uchar  *data;    /* Decompressed data. */
+    size_t  size;    /* Size of decompressed data - ISIZE from the block trailer. */
+    uint    crc;     /* CRC32 of decompressed data from the block trailer. */
+};
+
+typedef struct _bgzf_block bgzf_block;
+
+/* Structure holding the state of a decompressed stream. */
+struct _zfile
+{
+    FILE        *fp;            /* Underlying stream with compressed data. */
+    char        *file;          /* File name used in error messages. */
+    int          format;        /* Compression format. */
+    uchar       *in;            /* Input buffer. */
+    size_t       in_pos;        /* Position of next unused byte in input buffer. */
+    size_t       in_end;        /* End of data in input buffer. */
+    bool         end;           /* Flag indicating end of decompressed data. */
+    z_stream     strm;          /* zlib stream for gzip data. */
+    bgzf_block  *blocks;        /* Batch of BGZF blocks. */
+    size_t       block_count;   /* Number of blocks in batch. */
+    size_t       block_pos;     /* Index of block being output. */
+    size_t       data_pos;      /* Position in data of block being output. */
+    size_t       block_next;    /* Index of next block to decompress - shared by threads. */
+    int          threads;       /* Number of threads used for BGZF decompression. */
+#ifdef HAVE_ZSTD
+    ZSTD_DStream *zstd;         /* zstd stream for zstd data. */
+    size_t        zstd_ret;     /* Last return value from ZSTD_decompressStream. */
+#endif
+};
+
+typedef struct _zfile zfile;
+
+static zfile  *zfile_new( FILE *fp, char *file, int format, uchar *magic, size_t len );
+static FILE   *zfile_stream( zfile *z );
+static size_t  zfile_raw( zfile *z, uchar *dst, size_t len );
+static bool    zfile_fill( zfile *z );
+static ssize_t zfile_plain_read( void *cookie, char *buf, size_t size );
+static ssize_t zfile_gzip_read( void *cookie, char *buf, size_t size );
+static ssize_t zfile_bgzf_read( void *cookie, char *buf, size_t size );
+static bool    zfile_bgzf_batch( zfile *z );
+static bool    zfile_bgzf_block_get( zfile *z, bgzf_block *block );
+static void   *zfile_bgzf_worker( void *arg );
+static void    zfile_bgzf_inflate( zfile *z, bgzf_block *block, z_stream *strm );
+#ifdef HAVE_ZSTD
+static ssize_t zfile_zstd_read( void *cookie, char *buf, size_t size );
+#endif
+static int     zfile_close( void *cookie );
+#ifndef __GLIBC__
+static int     zfile_read( void *cookie, char *buf, int size );
+#endif
+
+
+int zfile_format( uchar *magic, size_t len )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Determine the compression format from the first bytes of a stream. */
+    /* BGZF is gzip with an extra field with the subfield 'BC' (SAM spec). */
+
+    if ( len >= 2 && magic[ 0 ] == 0x1f && magic[ 1 ] == 0x8b )
+    {
+        if ( len >= 16 && ( magic[ 3 ] & 4 ) && magic[ 12 ] == 'B' && magic[ 13 ] == 'C' && magic[ 14 ] == 2 && magic[ 15 ] == 0 ) {
+            return ZFILE_BGZF;
+        } else {
+            return ZFILE_GZIP;
+        }
+    }
+
+    if ( len >= 4 && magic[ 0 ] == 0x28 && magic[ 1 ] == 0xb5 && magic[ 2 ] == 0x2f && magic[ 3 ] == 0xfd ) {
+        return ZFILE_ZSTD;
+    }
+
+    return ZFILE_PLAIN;
+}
+
+
+FILE *zfile_open( FILE *fp, char *file )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Given a stream opened for reading, detect the compression format and */
+    /* return a stream of the decompressed data - or the stream itself if */
+    /* the data is not compressed. The peeked bytes are rewound for plain */
+    /* files and replayed from the input buffer for compressed data and */
+    /* non-seekable streams such as pipes. */
+
+    uchar  magic[ ZFILE_PEEK ];
+    size_t len    = 0;
+    int    format = 0;
+
+    len    = fread( magic, 1, ZFILE_PEEK, fp );
+    format = zfile_format( magic, len );
+
+    if ( ferror( fp ) )
+    {
+        fprintf( stderr, "ERROR: Could not read file '%s': %s\n", file, strerror( errno ) );
+        abort();
+    }
+
+    if ( format == ZFILE_PLAIN && fseeko( fp, 0, SEEK_SET ) == 0 ) {
+        return fp;
+    }
+
+#ifndef HAVE_ZSTD
+    if ( format == ZFILE_ZSTD )
+    {
+        fprintf( stderr, "ERROR: File '%s' is zstd compressed - compile with -DHAVE_ZSTD for zstd support\n", file );
+        abort();
+    }
+#endif
+
+    return zfile_stream( zfile_new( fp, file, format, magic, len ) );
+}
+
+
+static zfile *zfile_new( FILE *fp, char *file, int format, uchar *magic, size_t len )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Initialize the decompression state for a stream with the peeked */
+    /* bytes put in the input buffer. */
+
+    zfile *z = NULL;
+    long   n = 0;
+
+    z = mem_get_zero( sizeof( zfile ) );
+
+    z->fp     = fp;
+    z->file   = mem_clone( file, strlen( file ) + 1 );
+    z->format = format;
+    z->in     = mem_get( ZFILE_BUFFER );
+    z->in_end = len;
+
+    memcpy( z->in, magic, len );
+
+    if ( format == ZFILE_GZIP )
+    {
+        z->strm.next_in  = z->in;
+        z->strm.avail_in = len;
+
+        /* 15 + 32: max window and automatic gzip header detection. */
+        if ( inflateInit2( &z->strm, 15 + 32 ) != Z_OK )
+        {
+            fprintf( stderr, "ERROR: Could not initialize zlib for file '%s'\n", file );
+            abort();
+        }
+    }
+    else if ( format == ZFILE_BGZF )
+    {
+        n = sysconf( _SC_NPROCESSORS_ONLN );
+
+        z->threads = ( n < 1 ) ? 1 : ( ( n > ZFILE_THREADS ) ? ZFILE_THREADS : n );
+        z->blocks  = mem_get_zero( ZFILE_BATCH * sizeof( bgzf_block ) );
+    }
+#ifdef HAVE_ZSTD
+    else if ( format == ZFILE_ZSTD )
+    {
+        z->zstd = ZSTD_createDStream();
+
+        ZSTD_initDStream( z->zstd );
+    }
+#endif
+
+    return z;
+}
+
+
+static FILE *zfile_stream( zfile *z )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Create a read-only stream with the decompression state as cookie. */
+
+    FILE *fp = NULL;
+
+#ifdef __GLIBC__
+    cookie_io_functions_t funcs = { NULL, NULL, NULL, zfile_close };
+
+    switch ( z->format )
+    {
+        case ZFILE_GZIP: funcs.read = zfile_gzip_read;  break;
+        case ZFILE_BGZF: funcs.read = zfile_bgzf_read;  break;
+#ifdef HAVE_ZSTD
+        case ZFILE_ZSTD: funcs.read = zfile_zstd_read;  break;
+#endif
+        default:         funcs.read = zfile_plain_read; break;
+    }
+
+    fp = fopencookie( z, "r", funcs );
+#else
+    fp = funopen( z, zfile_read, NULL, NULL, zfile_close );
+#endif
+
+    if ( fp == NULL )
+    {
+        fprintf( stderr, "ERROR: Could not open stream for file '%s': %s\n", z->file, strerror( errno ) );
+        abort();
+    }
+
+    return fp;
+}
+
+
+static size_t zfile_raw( zfile *z, uchar *dst, size_t len )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Read len bytes of compressed data into dst from the input buffer */
+    /* and the underlying stream. Returns the number of bytes read. */
+
+    size_t num = 0;
+    size_t n   = 0;
+
+    while ( num < len )
+    {
+        if ( z->in_pos == z->in_end && ! zfile_fill( z ) ) {
+            break;
+        }
+
+        n = z->in_end - z->in_pos;
+
+        if ( n > len - num ) {
+            n = len - num;
+        }
+
+        memcpy( &dst[ num ], &z->in[ z->in_pos ], n );
+
+        z->in_pos += n;
+        num       += n;
+    }
+
+    return num;
+}
+
+
+static bool zfile_fill( zfile *z )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Refill the input buffer from the underlying stream. */
+    /* Returns FALSE at EOF. */
+
+    z->in_pos = 0;
+    z->in_end = fread( z->in, 1, ZFILE_BUFFER, z->fp );
+
+    if ( ferror( z->fp ) )
+    {
+        fprintf( stderr, "ERROR: Could not read file '%s': %s\n", z->file, strerror( errno ) );
+        abort();
+    }
+
+    return z->in_end > 0;
+}
+
+
+static ssize_t zfile_plain_read( void *cookie, char *buf, size_t size )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Read uncompressed data from a non-seekable stream. */
+
+    return zfile_raw( ( zfile * ) cookie, ( uchar * ) buf, size );
+}
+
+
+static ssize_t zfile_gzip_read( void *cookie, char *buf, size_t size )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Read gzip compressed data. Concatenated gzip members are decompressed */
+    /* one after the other as with gunzip. */
+
+    zfile *z   = ( zfile * ) cookie;
+    int    ret = 0;
+
+    z->strm.next_out  = ( uchar * ) buf;
+    z->strm.avail_out = size;
+
+    while ( ! z->end && z->strm.avail_out == size )
+    {
+        if ( z->strm.avail_in == 0 )
+        {
+            if ( ! zfile_fill( z ) )
+            {
+                fprintf( stderr, "ERROR: Unexpected end of gzip file '%s'\n", z->file );
+                abort();
+            }
+
+            z->strm.next_in  = z->in;
+            z->strm.avail_in = z->in_end;
+        }
+
+        ret = inflate( &z->strm, Z_NO_FLUSH );
+
+        if ( ret == Z_STREAM_END )
+        {
+            if ( z->strm.avail_in == 0 && ! zfile_fill( z ) )
+            {
+                z->end = TRUE;
+            }
+            else
+            {
+                if ( z->strm.avail_in == 0 )
+                {
+                    z->strm.next_in  = z->in;
+                    z->strm.avail_in = z->in_end;
+                }
+
+                inflateReset( &z->strm );
+            }
+        }
+        else if ( ret != Z_OK )
+        {
+            fprintf( stderr, "ERROR: Could not decompress gzip file '%s': %s\n", z->file, z->strm.msg ? z->strm.msg : "corrupt data" );
+            abort();
+        }
+    }
+
+    return size - z->strm.avail_out;
+}
+
+
+static ssize_t zfile_bgzf_read( void *cookie, char *buf, size_t size )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Read BGZF compressed data. Blocks are decompressed in parallel */
+    /* batches and copied out in order. */
+
+    zfile      *z     = ( zfile * ) cookie;
+    bgzf_block *block = NULL;
+    size_t      num   = 0;
+    size_t      n     = 0;
+
+    while ( num < size )
+    {
+        if ( z->block_pos == z->block_count && ! zfile_bgzf_batch( z ) ) {
+            break;
+        }
+
+        block = &z->blocks[ z->block_pos ];
+        n     = block->size - z->data_pos;
+
+        if ( n > size - num ) {
+            n = size - num;
+        }
+
+        memcpy( &buf[ num ], &block->data[ z->data_pos ], n );
+
+        num         += n;
+        z->data_pos += n;
+
+        if ( z->data_pos == block->size )
+        {
+            z->block_pos++;
+            z->data_pos = 0;
+        }
+    }
+
+    return num;
+}
+
+
+static bool zfile_bgzf_batch( zfile *z )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Read the next batch of BGZF blocks and decompress these using */
+    /* a number of threads that each grab the next undone block. */
+    /* Returns FALSE when no more blocks. */
+
+    pthread_t threads[ ZFILE_THREADS ];
+    int       i = 0;
+    int       n = 0;
+
+    z->block_count = 0;
+    z->block_pos   = 0;
+    z->data_pos    = 0;
+    z->block_next  = 0;
+
+    while ( z->block_count < ZFILE_BATCH && zfile_bgzf_block_get( z, &z->blocks[ z->block_count ] ) ) {
+        z->block_count++;
+    }
+
+    if ( z->block_count == 0 ) {
+        return FALSE;
+    }
+
+    n = ( z->threads < ( int ) z->block_count ) ? z->threads : ( int ) z->block_count;
+
+    for ( i = 1; i < n; i++ )
+    {
+        if ( pthread_create( &threads[ i ], NULL, zfile_bgzf_worker, z ) != 0 )
+        {
+            fprintf( stderr, "ERROR: Could not create thread\n" );
+            abort();
+        }
+    }
+
+    zfile_bgzf_worker( z );
+
+    for ( i = 1; i < n; i++ ) {
+        pthread_join( threads[ i ], NULL );
+    }
+
+    /* Skip empty blocks such as the EOF marker block. */
+    while ( z->block_pos < z->block_count && z->blocks[ z->block_pos ].size == 0 ) {
+        z->block_pos++;
+    }
+
+    return TRUE;
+}
+
+
+static bool zfile_bgzf_block_get( zfile *z, bgzf_block *block )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Read the next BGZF block parsing the header for the block size */
+    /* and the trailer for CRC32 and size of uncompressed data. */
+    /* Returns FALSE at EOF. */
+
+    uchar  header[ 12 ];
+    uchar  extra[ 0xffff ];
+    uchar  trailer[ 8 ];
+    size_t xlen  = 0;
+    size_t bsize = 0;
+    size_t len   = 0;
+    size_t i     = 0;
+
+    if ( ( len = zfile_raw( z, header, sizeof( header ) ) ) == 0 ) {
+        return FALSE;
+    }
+
+    if ( len != sizeof( header ) || header[ 0 ] != 0x1f || header[ 1 ] != 0x8b || header[ 2 ] != 8 || ! ( header[ 3 ] & 4 ) )
+    {
+        fprintf( stderr, "ERROR: Bad BGZF block header in file '%s'\n", z->file );
+        abort();
+    }
+
+    xlen = header[ 10 ] | ( header[ 11 ] << 8 );
+
+    if ( zfile_raw( z, extra, xlen ) != xlen )
+    {
+        fprintf( stderr, "ERROR: Unexpected end of BGZF file '%s'\n", z->file );
+        abort();
+    }
+
+    for ( i = 0; i + 4 <= xlen; i += 4 + ( extra[ i + 2 ] | ( extra[ i + 3 ] << 8 ) ) )
+    {
+        if ( extra[ i ] == 'B' && extra[ i + 1 ] == 'C' && i + 6 <= xlen ) {
+            bsize = ( extra[ i + 4 ] | ( extra[ i + 5 ] << 8 ) ) + 1;
+        }
+    }
+
+    if ( bsize < sizeof( header ) + xlen + sizeof( trailer ) )
+    {
+        fprintf( stderr, "ERROR: Bad BGZF block size in file '%s'\n", z->file );
+        abort();
+    }
+
+    block->csize = bsize - sizeof( header ) - xlen - sizeof( trailer );
+
+    if ( block->cdata == NULL )
+    {
+        block->cdata = mem_get( BGZF_BLOCK );
+        block->data  = mem_get( BGZF_BLOCK );
+    }
+
+    if ( zfile_raw( z, block->cdata, block->csize ) != block->csize || zfile_raw( z, trailer, sizeof( trailer ) ) != sizeof( trailer ) )
+    {
+        fprintf( stderr, "ERROR: Unexpected end of BGZF file '%s'\n", z->file );
+        abort();
+    }
+
+    block->crc  = trailer[ 0 ] | ( trailer[ 1 ] << 8 ) | ( trailer[ 2 ] << 16 ) | ( ( uint ) trailer[ 3 ] << 24 );
+    block->size = trailer[ 4 ] | ( trailer[ 5 ] << 8 ) | ( trailer[ 6 ] << 16 ) | ( ( uint ) trailer[ 7 ] << 24 );
+
+    if ( block->size > BGZF_BLOCK )
+    {
+        fprintf( stderr, "ERROR: Bad BGZF block size in file '%s'\n", z->file );
+        abort();
+    }
+
+    return TRUE;
+}
+
+
+static void *zfile_bgzf_worker( void *arg )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Thread function decompressing BGZF blocks of a batch until none are left. */
+
+    zfile    *z = ( zfile * ) arg;
+    z_stream  strm;
+    size_t    i = 0;
+
+    memset( &strm, 0, sizeof( strm ) );
+
+    /* Negative window bits: raw deflate data without gzip header. */
+    if ( inflateInit2( &strm, -15 ) != Z_OK )
+    {
+        fprintf( stderr, "ERROR: Could not initialize zlib for file '%s'\n", z->file );
+        abort();
+    }
+
+    while ( ( i = __sync_fetch_and_add( &z->block_next, 1 ) ) < z->block_count ) {
+        zfile_bgzf_inflate( z, &z->blocks[ i ], &strm );
+    }
+
+    inflateEnd( &strm );
+
+    return NULL;
+}
+
+
+static void zfile_bgzf_inflate( zfile *z, bgzf_block *block, z_stream *strm )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Decompress a single BGZF block and check size and CRC32. */
+
+    inflateReset( strm );
+
+    strm->next_in   = block->cdata;
+    strm->avail_in  = block->csize;
+    strm->next_out  = block->data;
+    strm->avail_out = BGZF_BLOCK;
+
+    if ( inflate( strm, Z_FINISH ) != Z_STREAM_END || strm->total_out != block->size )
+    {
+        fprintf( stderr, "ERROR: Could not decompress BGZF block in file '%s'\n", z->file );
+        abort();
+    }
+
+    if ( crc32( crc32( 0L, Z_NULL, 0 ), block->data, block->size ) != block->crc )
+    {
+        fprintf( stderr, "ERROR: CRC32 mismatch in BGZF block in file '%s'\n", z->file );
+        abort();
+    }
+}
+
+
+#ifdef HAVE_ZSTD
+static ssize_t zfile_zstd_read( void *cookie, char *buf, size_t size )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Read zstd compressed data. */
+
+    zfile          *z      = ( zfile * ) cookie;
+    ZSTD_inBuffer   input  = { NULL, 0, 0 };
+    ZSTD_outBuffer  output = { buf, size, 0 };
+
+    while ( ! z->end && output.pos == 0 )
+    {
+        if ( z->in_pos == z->in_end && ! zfile_fill( z ) )
+        {
+            if ( z->zstd_ret != 0 )
+            {
+                fprintf( stderr, "ERROR: Unexpected end of zstd file '%s'\n", z->file );
+                abort();
+            }
+
+            z->end = TRUE;
+
+            break;
+        }
+
+        input.src  = z->in;
+        input.size = z->in_end;
+        input.pos  = z->in_pos;
+
+        z->zstd_ret = ZSTD_decompressStream( z->zstd, &output, &input );
+
+        if ( ZSTD_isError( z->zstd_ret ) )
+        {
+            fprintf( stderr, "ERROR: Could not decompress zstd file '%s': %s\n", z->file, ZSTD_getErrorName( z->zstd_ret ) );
+            abort();
+        }
+
+        z->in_pos = input.pos;
+    }
+
+    return output.pos;
+}
+#endif
+
+
+static int zfile_close( void *cookie )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Deallocate the decompression state and close the underlying stream. */
+
+    zfile *z = ( zfile * ) cookie;
+    size_t i = 0;
+    int    ret = 0;
+
+    if ( z->format == ZFILE_GZIP ) {
+        inflateEnd( &z->strm );
+    }
+
+    if ( z->blocks != NULL )
+    {
+        for ( i = 0; i < ZFILE_BATCH; i++ )
+        {
+            mem_free( &z->blocks[ i ].cdata );
+            mem_free( &z->blocks[ i ].data );
+        }
+
+        mem_free( &z->blocks );
+    }
+
+#ifdef HAVE_ZSTD
+    if ( z->zstd != NULL ) {
+        ZSTD_freeDStream( z->zstd );
+    }
+#endif
+
+    ret = fclose( z->fp );
+
+    mem_free( &z->in );
+    mem_free( &z->file );
+    mem_free( &z );
+
+    return ret;
+}
+
+
+#ifndef __GLIBC__
+static int zfile_read( void *cookie, char *buf, int size )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Read function for funopen on BSD and Mac OS X. */
+
+    zfile *z = ( zfile * ) cookie;
+
+    switch ( z->format )
+    {
+        case ZFILE_GZIP: return zfile_gzip_read( cookie, buf, size );
+        case ZFILE_BGZF: return zfile_bgzf_read( cookie, buf, size );
+#ifdef HAVE_ZSTD
+        case ZFILE_ZSTD: return zfile_zstd_read( cookie, buf, size );
+#endif
+        default:         return zfile_plain_read( cookie, buf, size );
+    }
+}
+#endif
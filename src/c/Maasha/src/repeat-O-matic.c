@@ -1,20 +1,61 @@
 /* Martin Asser Hansen (mail@maasha.dk) Copyright (C) 2008 - All right reserved */
 
+#include <pthread.h>
 #include "common.h"
 #include "mem.h"
 #include "filesys.h"
 #include "seq.h"
 #include "fasta.h"
+#include "chash.h"
+#include "kcount.h"
+#include "wig.h"
 
 #define add_A( c )            /* add 00 to the rightmost two bits of bin (i.e. do nothing). */
 #define add_T( c ) ( c |= 3 ) /* add 11 on the rightmost two bits of c. */
 #define add_C( c ) ( c |= 1 ) /* add 01 on the rightmost two bits of c. */
 #define add_G( c ) ( c |= 2 ) /* add 10 on the rightmost two bits of c. */
- 
-static uint mask_create( int oligo_size );
-static void oligo_count( char *path, uint **array_ppt, uint nmer, uint mask );
-static void oligo_count_output( char *path, uint *array, uint nmer, uint mask, bool log10_flag );
-static void fixedstep_put_entry( char *chr, int beg, int step_size, uint *block_array, int block_size, bool log10_flag );
+
+#define NMER_MAX     31          /* Max nmer size packed in 64 bits. */
+#define DENSE_MAX    16          /* Max nmer size counted in a dense table. */
+#define THREADS_MAX  64          /* Max number of counting threads. */
+#define PRIVATE_NMER 11          /* Max nmer size counted in private tables per thread. */
+#define CHUNK_SIZE   ( 1 << 20 ) /* Number of residues in a chunk counted by one thread. */
+#define BATCH_CHUNKS 4           /* Number of chunks per thread in a batch of sequences. */
+#define BATCH_MAX    ( 1 << 16 ) /* Max number of sequences in a batch. */
+
+/* Structure of the chunk of a sequence counted by one thread. */
+struct _count_job
+{
+    char     *seq;      /* Sequence. */
+    size_t    beg;      /* Begin position of first oligo in chunk. */
+    size_t    end;      /* End position of chunk - exclusive. */
+    uint      nmer;     /* Oligo size. */
+    uint64_t  mask;     /* Oligo mask. */
+    kcount   *table;    /* Count table. */
+    bool      canon;    /* Flag indicating canonical counting. */
+};
+
+typedef struct _count_job count_job;
+
+/* Structure of a counting thread that takes chunks from a shared list. */
+struct _count_worker
+{
+    count_job *jobs;    /* Chunks of a batch of sequences. */
+    size_t     count;   /* Number of chunks. */
+    size_t    *next;    /* Next chunk to count - shared by all workers. */
+    kcount    *table;   /* Count table of worker. */
+};
+
+typedef struct _count_worker count_worker;
+
+static uint64_t  mask_create( int oligo_size );
+static uint64_t  oligo_array_size( uint nmer, bool canon );
+static uint64_t  oligo_canonical( uint64_t bin, uint64_t rc, uint nmer );
+static void      oligo_count( char *path, kcount **table_ppt, uint nmer, uint64_t mask, int layout, bool canon, int threads );
+static void     *oligo_count_worker( void *arg );
+static void     *oligo_count_chunk( void *arg );
+static void      oligo_count_output( char *path, kcount *table, uint nmer, uint64_t mask, bool canon, wig_writer *writer, bool log10_flag );
+static void      oligo_run_put( wig_writer *writer, char *chr, size_t beg, size_t end, uint count, bool log10_flag );
 
 
 static void usage()
@@ -25,16 +66,33 @@ static void usage()
         "the number of identical n-mers for each position in the genome.\n"
         "\n"
         "The output is a fixedStep file ala the phastCons files from the UCSC\n"
-        "Genome browser.\n"
+        "Genome browser, a bedGraph or variableStep file with runs of positions\n"
+        "with equal counts - or a binary file with zoom levels (see wig.h).\n"
         "\n"
         "Usage: repeat-O-matic [options] <FASTA file>\n"
         "\n"
         "Options:\n"
-        "   [-n <int> | --nmer <int>]   # nmer size between 1 and 15 (Default 15).\n"
+        "   [-n <int> | --nmer <int>]   # nmer size between 1 and 31 (Default 15).\n"
         "   [-1       | --log10]        # output log10 (Default no).\n"
+        "   [-c       | --canonical]    # count each n-mer and its reverse complement once (Default no).\n"
+        "   [-t <int> | --threads <int>] # number of counting threads (Default 1).\n"
+        "   [-L <str> | --layout <str>] # count table layout (Default dense for nmer <= 15, else sparse).\n"
+        "   [-f <str> | --format <str>] # text output format: fixedstep, bedgraph or varstep (Default fixedstep).\n"
+        "   [-b <file> | --binary <file>] # write binary output to file (Default text to stdout).\n"
+        "\n"
+        "Count table layouts:\n"
+        "   dense   - 4 bytes per nmer (nmer <= 16).\n"
+        "   dense16 - 2 bytes per nmer - counts above 65535 kept in an overflow table (nmer <= 16).\n"
+        "   dense8  - 1 byte per nmer - counts above 255 kept in an overflow table (nmer <= 16).\n"
+        "   sparse  - 16 to 32 bytes per distinct nmer seen (12 byte slots at 37-75%% load).\n"
         "\n"
         "Examples:\n"
         "   repeat-O-matic -n 14 -l hg18.fna > hg18.fixedStep\n"
+        "   repeat-O-matic -n 15 -t 8 -c hg18.fna > hg18.fixedStep\n"
+        "   repeat-O-matic -n 15 -L dense8 -c hg18.fna > hg18.fixedStep\n"
+        "   repeat-O-matic -n 24 -L sparse -t 8 -c hg18.fna > hg18.fixedStep\n"
+        "   repeat-O-matic -n 15 -t 8 -c -f bedgraph hg18.fna > hg18.bedGraph\n"
+        "   repeat-O-matic -n 15 -t 8 -c -b hg18.wig hg18.fna\n"
         "\n"
         "Copyright (C) 2008, Martin A. Hansen\n"
         "\n"
@@ -46,34 +104,97 @@ static void usage()
 
 int main( int argc, char *argv[] )
 {
-    int   opt        = 0;
-    uint  nmer       = 15;
-    bool  log10_flag = FALSE;
-    char *path       = NULL;
-    uint  mask       = 0;
-    uint *array      = NULL;
+    int         opt        = 0;
+    uint        nmer       = 15;
+    bool        log10_flag = FALSE;
+    bool        canon      = FALSE;
+    char       *path       = NULL;
+    char       *layout     = NULL;
+    int         type       = KCOUNT_DENSE;
+    uint64_t    mask       = 0;
+    kcount     *table      = NULL;
+    int         threads    = 1;
+    char       *binary     = NULL;
+    char       *format     = NULL;
+    int         wig_format = WIG_FIXEDSTEP;
+    FILE       *fp         = stdout;
+    wig_writer *writer     = NULL;
 
     static struct option longopts[] = {
-        { "nmer",  required_argument, NULL, 'n' },
-        { "log10", no_argument,       NULL, 'l' },
-        { NULL,    0,                 NULL,  0 }
+        { "nmer",      required_argument, NULL, 'n' },
+        { "log10",     no_argument,       NULL, 'l' },
+        { "canonical", no_argument,       NULL, 'c' },
+        { "threads",   required_argument, NULL, 't' },
+        { "layout",    required_argument, NULL, 'L' },
+        { "format",    required_argument, NULL, 'f' },
+        { "binary",    required_argument, NULL, 'b' },
+        { NULL,        0,                 NULL,  0 }
     };
 
-    while ( ( opt = getopt_long( argc, argv, "n:l", longopts, NULL ) ) != -1 )
+    while ( ( opt = getopt_long( argc, argv, "n:lct:L:f:b:", longopts, NULL ) ) != -1 )
     {
         switch ( opt ) {
-            case 'n': nmer  = strtol( optarg, NULL, 0 ); break;
-            case 'l': log10_flag = TRUE;                 break;
-            default:                                     break;
+            case 'n': nmer    = strtol( optarg, NULL, 0 ); break;
+            case 'l': log10_flag = TRUE;                   break;
+            case 'c': canon      = TRUE;                   break;
+            case 't': threads = strtol( optarg, NULL, 0 ); break;
+            case 'L': layout  = optarg;                    break;
+            case 'f': format  = optarg;                    break;
+            case 'b': binary  = optarg;                    break;
+            default:                                       break;
         }
     }
 
     argc -= optind;
     argv += optind;
 
-    if ( nmer < 1 || nmer > 15 )
+    if ( nmer < 1 || nmer > NMER_MAX )
+    {
+        fprintf( stderr, "ERROR: nmer must be between 1 and %d inclusive - not %d\n", NMER_MAX, nmer );
+        abort();
+    }
+
+    if ( layout == NULL ) {
+        type = ( nmer <= 15 ) ? KCOUNT_DENSE : KCOUNT_SPARSE;
+    } else if ( strcmp( layout, "dense" ) == 0 ) {
+        type = KCOUNT_DENSE;
+    } else if ( strcmp( layout, "dense16" ) == 0 ) {
+        type = KCOUNT_DENSE16;
+    } else if ( strcmp( layout, "dense8" ) == 0 ) {
+        type = KCOUNT_DENSE8;
+    } else if ( strcmp( layout, "sparse" ) == 0 ) {
+        type = KCOUNT_SPARSE;
+    }
+    else
+    {
+        fprintf( stderr, "ERROR: layout must be dense, dense16, dense8 or sparse - not %s\n", layout );
+        abort();
+    }
+
+    if ( type != KCOUNT_SPARSE && nmer > DENSE_MAX )
+    {
+        fprintf( stderr, "ERROR: nmer must be at most %d with a dense layout - not %d\n", DENSE_MAX, nmer );
+        abort();
+    }
+
+    if ( binary != NULL ) {
+        wig_format = WIG_BINARY;
+    } else if ( format == NULL || strcmp( format, "fixedstep" ) == 0 ) {
+        wig_format = WIG_FIXEDSTEP;
+    } else if ( strcmp( format, "bedgraph" ) == 0 ) {
+        wig_format = WIG_BEDGRAPH;
+    } else if ( strcmp( format, "varstep" ) == 0 ) {
+        wig_format = WIG_VARSTEP;
+    }
+    else
+    {
+        fprintf( stderr, "ERROR: format must be fixedstep, bedgraph or varstep - not %s\n", format );
+        abort();
+    }
+
+    if ( threads < 1 || threads > THREADS_MAX )
     {
-        fprintf( stderr, "ERROR: nmer must be between 1 and 15 inclusive - not %d\n", nmer );
+        fprintf( stderr, "ERROR: threads must be between 1 and %d - not %d\n", THREADS_MAX, threads );
         abort();
     }
 
@@ -85,22 +206,38 @@ int main( int argc, char *argv[] )
 
     mask = mask_create( nmer );
 
-    oligo_count( path, &array, nmer, mask );
+    if ( binary != NULL && ( fp = fopen( binary, "w" ) ) == NULL )
+    {
+        fprintf( stderr, "ERROR: Could not open file '%s': %s\n", binary, strerror( errno ) );
+        abort();
+    }
+
+    oligo_count( path, &table, nmer, mask, type, canon, threads );
+
+    writer = wig_writer_new( fp, wig_format, log10_flag ? 6 : 0 );
+
+    oligo_count_output( path, table, nmer, mask, canon, writer, log10_flag );
+
+    wig_writer_destroy( &writer );
+
+    kcount_destroy( &table );
 
-    oligo_count_output( path, array, nmer, mask, log10_flag );
+    if ( binary != NULL ) {
+        fclose( fp );
+    }
 
     return EXIT_SUCCESS;
 }
 
 
-uint mask_create( int oligo_size )
+uint64_t mask_create( int oligo_size )
 {
     /* Martin A. Hansen, June 2008 */
 
-    /* Create a bit mask for binary encoded oligos less than 32 bits. */
+    /* Create a bit mask for binary encoded oligos less than 64 bits. */
 
-    uint i    = 0;
-    uint mask = 0;
+    uint     i    = 0;
+    uint64_t mask = 0;
 
     for ( i = 0; i < oligo_size; i++ )
     {
@@ -113,240 +250,402 @@ uint mask_create( int oligo_size )
 }
 
 
-void oligo_count( char *path, uint **array_ppt, uint nmer, uint mask )
+uint64_t oligo_array_size( uint nmer, bool canon )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Returns the number of counts in a dense oligo count array. */
+    /* Canonical counts of odd sized oligos only need half the array - */
+    /* see oligo_canonical. */
+
+    uint64_t size = ( uint64_t ) 1 << ( nmer * 2 );
+
+    if ( canon && nmer % 2 == 1 ) {
+        size >>= 1;
+    }
+
+    return size;
+}
+
+
+uint64_t oligo_canonical( uint64_t bin, uint64_t rc, uint nmer )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Returns the count array index of an oligo given the oligo and its */
+    /* reverse complement, so both strands get the same index. For odd */
+    /* sized oligos the strand with A or C as the middle residue is used - */
+    /* the complement of A=00 and C=01 is T=11 and G=10. The high bit of */
+    /* the middle residue is then always 0 and is dropped from the index. */
+    /* For even sized oligos the smallest of the two is used. */
+
+    uint     mid = nmer - 1;   /* Bit position of the middle residue. */
+    uint64_t low = 0;
+
+    if ( nmer % 2 == 0 ) {
+        return bin < rc ? bin : rc;
+    }
+
+    if ( ( bin >> mid ) & 2 ) {
+        bin = rc;
+    }
+
+    low = ( ( uint64_t ) 1 << ( mid + 1 ) ) - 1;
+
+    return ( ( bin >> ( mid + 2 ) ) << ( mid + 1 ) ) | ( bin & low );
+}
+
+
+void oligo_count( char *path, kcount **table_ppt, uint nmer, uint64_t mask, int layout, bool canon, int threads )
 {
     /* Martin A. Hansen, June 2008 */
 
     /* Count the occurence of all oligos of a fixed size in a FASTA file. */
+    /* Sequences are read in batches of about BATCH_CHUNKS chunks per */
+    /* thread - many short contigs or part of a chromosome - and split in */
+    /* chunks of CHUNK_SIZE residues that the threads take in turn. For */
+    /* small oligos each thread counts in a private dense table and the */
+    /* tables are merged at the end, otherwise all threads count in a */
+    /* shared table. If canon is set, each oligo and its reverse */
+    /* complement are counted once at the same index. */
+
+    kcount       *table      = NULL;
+    kcount      **tables     = NULL;
+    uint64_t      size       = 0;
+    size_t        residues   = 0;
+    size_t        n          = 0;
+    size_t        k          = 0;
+    size_t        pos        = 0;
+    size_t        next       = 0;
+    size_t        job_count  = 0;
+    size_t        job_max    = 0;
+    int           workers    = 0;
+    int           t          = 0;
+    bool          shared     = FALSE;
+    seq_entry   **entries    = NULL;
+    count_job    *jobs       = NULL;
+    file_buffer  *buffer     = NULL;
+    count_worker  worker_array[ THREADS_MAX ];
+    pthread_t     thread_array[ THREADS_MAX ];
+
+    size   = ( layout == KCOUNT_SPARSE ) ? 0 : oligo_array_size( nmer, canon );
+    shared = ( threads > 1 && ( nmer > PRIVATE_NMER || layout == KCOUNT_SPARSE ) );
+    table  = kcount_new( layout, size, shared );
+    tables = mem_get_zero( sizeof( kcount * ) * threads );
+
+    for ( t = 0; t < threads; t++ ) {
+        tables[ t ] = ( t == 0 || shared ) ? table : kcount_new( layout, size, FALSE );
+    }
 
-    uint       *array      = *array_ppt;
-    uint        array_size = 0;
-    uint        i          = 0;
-    uint        j          = 0;
-    uint        bin        = 0;
-    seq_entry  *entry      = NULL;
-    FILE       *fp         = NULL;
+    buffer_new( path, &buffer, FASTA_BLOCK );
 
-    array_size = ( 1 << ( nmer * 2 ) );
-    array = mem_get_zero( sizeof( uint ) * array_size );
+    entries = mem_get_zero( sizeof( seq_entry * ) * BATCH_MAX );
 
-    fp = read_open( path );
+    while ( 1 )
+    {
+        /* Read a batch of sequences. */
 
-    entry = seq_new( MAX_SEQ_NAME, MAX_SEQ );
+        n        = 0;
+        residues = 0;
 
-    while ( ( fasta_get_entry( fp, &entry ) ) != 0 )
-    {
-        fprintf( stderr, "Counting oligos in: %s ... ", entry->seq_name );
+        while ( n < BATCH_MAX && residues < ( size_t ) threads * BATCH_CHUNKS * CHUNK_SIZE )
+        {
+            if ( entries[ n ] == NULL ) {
+                entries[ n ] = seq_new( MAX_SEQ_NAME, MAX_SEQ );
+            }
 
-        /* ---- Sense strand ---- */    
+            if ( fasta_get_entry_buffer( buffer, &entries[ n ] ) == 0 ) {
+                break;
+            }
 
-        bin = 0;
-        j   = 0;
+            residues += entries[ n ]->seq_len;
 
-        for ( i = 0; entry->seq[ i ]; i++ )
+            n++;
+        }
+
+        if ( n == 0 ) {
+            break;
+        }
+
+        if ( n == 1 ) {
+            fprintf( stderr, "Counting oligos in: %s ... ", entries[ 0 ]->seq_name );
+        } else {
+            fprintf( stderr, "Counting oligos in: %s and %zu more ... ", entries[ 0 ]->seq_name, n - 1 );
+        }
+
+        /* Split the sequences in chunks. */
+
+        job_count = 0;
+
+        for ( k = 0; k < n; k++ )
         {
-            bin <<= 2;
+            pos = 0;
 
-            switch( entry->seq[ i ] )
+            do
             {
-                case 'A': case 'a': add_A( bin ); j++; break;
-                case 'T': case 't': add_T( bin ); j++; break;
-                case 'C': case 'c': add_C( bin ); j++; break;
-                case 'G': case 'g': add_G( bin ); j++; break;
-                default: bin = 0; j = 0; break;
-            }
+                if ( job_count == job_max )
+                {
+                    job_max = ( job_max == 0 ) ? 1024 : job_max * 2;
+                    jobs    = mem_resize( jobs, sizeof( count_job ) * job_max );
+                }
 
-            if ( j >= nmer )
-            {
-                array[ ( bin & mask ) ]++;
-/*                
-                printf( "\n" );
-                printf( "mask          : %s\n", bits2string( mask ) );
-                printf( "bin           : %s\n", bits2string( bin ) );
-                printf( "bin     & mask: %s\n", bits2string( bin & mask ) );
-*/
+                jobs[ job_count ].seq   = entries[ k ]->seq;
+                jobs[ job_count ].beg   = pos;
+                jobs[ job_count ].end   = MIN( pos + CHUNK_SIZE + nmer - 1, entries[ k ]->seq_len );
+                jobs[ job_count ].nmer  = nmer;
+                jobs[ job_count ].mask  = mask;
+                jobs[ job_count ].table = table;
+                jobs[ job_count ].canon = canon;
+
+                job_count++;
+
+                pos += CHUNK_SIZE;
             }
+            while ( pos < entries[ k ]->seq_len );
         }
 
-        /* ---- Anti-sense strand ---- */    
-
-        revcomp_dna( entry->seq );
+        /* Count the chunks. */
 
-        bin = 0;
-        j   = 0;
+        next    = 0;
+        workers = MIN( ( size_t ) threads, job_count );
 
-        for ( i = 0; entry->seq[ i ]; i++ )
+        for ( t = 0; t < workers; t++ )
         {
-            bin <<= 2;
+            worker_array[ t ].jobs  = jobs;
+            worker_array[ t ].count = job_count;
+            worker_array[ t ].next  = &next;
+            worker_array[ t ].table = tables[ t ];
+        }
 
-            switch( entry->seq[ i ] )
+        if ( workers == 1 )
+        {
+            oligo_count_worker( &worker_array[ 0 ] );
+        }
+        else
+        {
+            for ( t = 0; t < workers; t++ )
             {
-                case 'A': case 'a': add_A( bin ); j++; break;
-                case 'T': case 't': add_T( bin ); j++; break;
-                case 'C': case 'c': add_C( bin ); j++; break;
-                case 'G': case 'g': add_G( bin ); j++; break;
-                default: bin = 0; j = 0; break;
+                if ( pthread_create( &thread_array[ t ], NULL, oligo_count_worker, &worker_array[ t ] ) != 0 )
+                {
+                    fprintf( stderr, "ERROR: Could not create thread: %s\n", strerror( errno ) );
+                    abort();
+                }
             }
 
-            if ( j >= nmer )
-            {
-                array[ ( bin & mask ) ]++;
-/*                
-                printf( "\n" );
-                printf( "mask          : %s\n", bits2string( mask ) );
-                printf( "bin           : %s\n", bits2string( bin ) );
-                printf( "bin     & mask: %s\n", bits2string( bin & mask ) );
-*/
+            for ( t = 0; t < workers; t++ ) {
+                pthread_join( thread_array[ t ], NULL );
             }
         }
 
         fprintf( stderr, "done.\n" );
     }
 
-    close_stream( fp );
+    if ( ! shared )
+    {
+        for ( t = 1; t < threads; t++ )
+        {
+            kcount_merge( table, tables[ t ] );
+
+            kcount_destroy( &tables[ t ] );
+        }
+    }
+
+    fprintf( stderr, "Count table size: %zu MB\n", kcount_mem( table ) >> 20 );
+
+    for ( k = 0; k < BATCH_MAX && entries[ k ] != NULL; k++ ) {
+        seq_destroy( entries[ k ] );
+    }
+
+    mem_free( &entries );
+    mem_free( &jobs );
+    mem_free( &tables );
 
-    free( entry->seq_name );
-    free( entry->seq );
-    entry = NULL;
+    buffer_destroy( &buffer );
 
-    *array_ppt = array;
+    *table_ppt = table;
 }
 
 
-void oligo_count_output( char *path, uint *array, uint nmer, uint mask, bool log10_flag )
+void *oligo_count_worker( void *arg )
 {
-    /* Martin A. Hansen, June 2008 */
+    /* Martin A. Hansen, October 2026 */
+
+    /* Count chunks in the worker's table until all chunks are taken. */
+
+    count_worker *worker = ( count_worker * ) arg;
+    size_t        i      = 0;
+
+    while ( ( i = __atomic_fetch_add( worker->next, 1, __ATOMIC_RELAXED ) ) < worker->count )
+    {
+        worker->jobs[ i ].table = worker->table;
+
+        oligo_count_chunk( &worker->jobs[ i ] );
+    }
+
+    return NULL;
+}
+
+
+void *oligo_count_chunk( void *arg )
+{
+    /* Martin A. Hansen, October 2026 */
+
+    /* Count the oligos beginning in a chunk of a sequence on both strands. */
+    /* The antisense oligo is rolled along with the sense oligo by adding */
+    /* the complement of each residue to the left end, so the sequence is */
+    /* only read once and not reverse complemented. Canonical counting */
+    /* increments the shared index once - twice for palindromes, which */
+    /* are the same oligo on both strands - so counts are the same as */
+    /* when counting both strands. */
+
+    count_job *job   = ( count_job * ) arg;
+    char      *seq   = job->seq;
+    kcount    *table = job->table;
+    uint64_t   mask  = job->mask;
+    uint       nmer  = job->nmer;
+    uint       shift = 2 * ( nmer - 1 );
+    uint64_t   bin   = 0;
+    uint64_t   rc    = 0;
+    uint64_t   c     = 0;
+    uint       j     = 0;
+    size_t     i     = 0;
+
+    for ( i = job->beg; i < job->end; i++ )
+    {
+        bin <<= 2;
+        rc  >>= 2;
 
-    /* Output oligo count for each sequence position. */
+        switch( seq[ i ] )
+        {
+            case 'A': case 'a': c = 0; add_A( bin ); j++; break;
+            case 'T': case 't': c = 3; add_T( bin ); j++; break;
+            case 'C': case 'c': c = 1; add_C( bin ); j++; break;
+            case 'G': case 'g': c = 2; add_G( bin ); j++; break;
+            default: bin = 0; rc = 0; j = 0; continue;
+        }
 
-    uint       i;
-    uint       j;
-    uint       bin;
-    int        count;
-    uint      *block;
-    uint       block_pos;
-    uint       block_beg;
-    uint       block_size;
-    uint       chr_pos;
-    seq_entry *entry;
-    FILE      *fp;
+        rc |= ( c ^ 3 ) << shift;   /* the complement of a residue is c ^ 11. */
+
+        if ( j >= nmer )
+        {
+            if ( job->canon )
+            {
+                kcount_add( table, oligo_canonical( bin & mask, rc, nmer ), ( ( bin & mask ) == rc ) ? 2 : 1 );
+            }
+            else
+            {
+                kcount_add( table, bin & mask, 1 );
+                kcount_add( table, rc, 1 );
+            }
+        }
+    }
+
+    return NULL;
+}
+
+
+void oligo_count_output( char *path, kcount *table, uint nmer, uint64_t mask, bool canon, wig_writer *writer, bool log10_flag )
+{
+    /* Martin A. Hansen, June 2008 */
+
+    /* Output oligo count for each sequence position with a count above 1. */
+    /* Positions are streamed to the writer as runs of adjacent positions */
+    /* with equal counts, so no per-sequence block is kept. */
+
+    size_t       i         = 0;
+    uint         j         = 0;
+    uint64_t     bin       = 0;
+    uint64_t     rc        = 0;
+    uint         shift     = 2 * ( nmer - 1 );
+    uint         count     = 0;
+    size_t       chr_pos   = 0;
+    size_t       run_beg   = 0;
+    size_t       run_end   = 0;
+    uint         run_count = 0;
+    seq_entry   *entry     = NULL;
+    file_buffer *buffer    = NULL;
 
     entry = seq_new( MAX_SEQ_NAME, MAX_SEQ );
 
-    fp = read_open( path );
+    buffer_new( path, &buffer, FASTA_BLOCK );
 
-    while ( ( fasta_get_entry( fp, &entry ) ) != 0 )
+    while ( ( fasta_get_entry_buffer( buffer, &entry ) ) != 0 )
     {
         fprintf( stderr, "Writing results for: %s ... ", entry->seq_name );
 
-        bin        = 0;
-        j          = 0;
-        block_pos  = 0;
-        block_size = sizeof( uint ) * ( entry->seq_len + nmer );
-        block      = mem_get_zero( block_size );
+        bin     = 0;
+        rc      = 0;
+        j       = 0;
+        run_beg = 0;
+        run_end = 0;
 
         for ( i = 0; entry->seq[ i ]; i++ )
         {
             bin <<= 2;
+            rc  >>= 2;
 
             switch( entry->seq[ i ] )
             {
-                case 'A': case 'a': add_A( bin ); j++; break;
-                case 'T': case 't': add_T( bin ); j++; break;
-                case 'C': case 'c': add_C( bin ); j++; break;
-                case 'G': case 'g': add_G( bin ); j++; break;
-                default: bin = 0; j = 0; break;
+                case 'A': case 'a': add_A( bin ); rc |= ( uint64_t ) 3 << shift; j++; break;
+                case 'T': case 't': add_T( bin );                              j++; break;
+                case 'C': case 'c': add_C( bin ); rc |= ( uint64_t ) 2 << shift; j++; break;
+                case 'G': case 'g': add_G( bin ); rc |= ( uint64_t ) 1 << shift; j++; break;
+                default: bin = 0; rc = 0; j = 0; break;
             }
 
-            if ( j >= nmer )
-            {
-                count = array[ ( bin & mask ) ];
-
-                if ( count > 1 )
-                {
-                    chr_pos = i - nmer + 1;
-
-                    if ( block_pos == 0 )
-                    {
-                        block_beg = chr_pos;
+            if ( j < nmer ) {
+                continue;
+            }
 
-                        block[ block_pos ] = count;
+            if ( canon ) {
+                count = kcount_get( table, oligo_canonical( bin & mask, rc, nmer ) );
+            } else {
+                count = kcount_get( table, bin & mask );
+            }
 
-                        block_pos++;
-                    }
-                    else
-                    {
-                        if ( chr_pos > block_beg + block_pos )
-                        {
-                            fixedstep_put_entry( entry->seq_name, block_beg, 1, block, block_pos, log10_flag );
+            if ( count < 2 ) {
+                continue;
+            }
 
-                            block_pos = 0;
+            chr_pos = i - nmer + 1;
 
-                            memset( block, '\0', block_pos );
-                        }
-                        else
-                        {
-                            block[ block_pos ] = count;
+            if ( chr_pos != run_end || count != run_count )
+            {
+                oligo_run_put( writer, entry->seq_name, run_beg, run_end, run_count, log10_flag );
 
-                            block_pos++;
-                        }
-                    }
-                }
+                run_beg   = chr_pos;
+                run_count = count;
             }
-        }
 
-        if ( block_pos > 0 )
-        {
-            fixedstep_put_entry( entry->seq_name, block_beg, 1, block, block_pos, log10_flag );
-
-            free( block );
-            block = NULL;
+            run_end = chr_pos + 1;
         }
 
+        oligo_run_put( writer, entry->seq_name, run_beg, run_end, run_count, log10_flag );
+
         fprintf( stderr, "done.\n" );
     }
 
-    free( entry->seq_name );
-    free( entry->seq );
-    entry = NULL;
+    seq_destroy( entry );
 
-    close_stream( fp );
+    buffer_destroy( &buffer );
 }
 
 
-void fixedstep_put_entry( char *chr, int beg, int step_size, uint *block_array, int block_size, bool log10_flag )
+void oligo_run_put( wig_writer *writer, char *chr, size_t beg, size_t end, uint count, bool log10_flag )
 {
-    /* Martin A. Hansen, June 2008 */
-
-    /* Outputs a block of fixedStep values. */
-
-    int i;
+    /* Martin A. Hansen, October 2026 */
 
-    if ( log10_flag )
-    {
-        if ( block_size > 0 )
-        {
-            beg += 1; /* fixedStep format is 1 based. */
+    /* Put a run of positions from beg to end - exclusive - with the same */
+    /* oligo count. Empty runs are ignored. */
 
-            printf( "fixedStep chrom=%s start=%d step=%d\n", chr, beg, step_size );
-
-            for ( i = 0; i < block_size; i++ ) {
-                printf( "%lf\n", log10( block_array[ i ] ) );
-            }
-        }
+    if ( beg == end ) {
+        return;
     }
-    else
-    {
-        if ( block_size > 0 )
-        {
-            beg += 1; /* fixedStep format is 1 based. */
-
-            printf( "fixedStep chrom=%s start=%d step=%d\n", chr, beg, step_size );
 
-            for ( i = 0; i < block_size; i++ ) {
-                printf( "%i\n", block_array[ i ] );
-            }
-        }
+    if ( log10_flag ) {
+        wig_writer_put_span( writer, chr, beg, end, log10( count ) );
+    } else {
+        wig_writer_put_span( writer, chr, beg, end, count );
     }
 }
 
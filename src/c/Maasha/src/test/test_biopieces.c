@@ -0,0 +1,352 @@
+/* Martin Asser Hansen (mail@maasha.dk) Copyright (C) 2008 - All right reserved */
+
+#include "common.h"
+#include "mem.h"
+#include "filesys.h"
+#include "biopieces.h"
+
+#define TEST_FILE "/tmp/test_biopieces"
+
+static void test_bp_record_new();
+static void test_bp_record_get();
+static void test_bp_record_add();
+static void test_bp_record_put();
+static void test_bp_writer_binary();
+
+static void test_write_file( char *str );
+
+
+int main()
+{
+    fprintf( stderr, "Running all tests for biopieces.c\n" );
+
+    test_bp_record_new();
+    test_bp_record_get();
+    test_bp_record_add();
+    test_bp_record_put();
+    test_bp_writer_binary();
+
+    fprintf( stderr, "Done\n\n" );
+
+    return EXIT_SUCCESS;
+}
+
+
+void test_bp_record_new()
+{
+    fprintf( stderr, "   Testing bp_record_new ... " );
+
+    bp_record *record = NULL;
+
+    record = bp_record_new();
+
+    assert( record->count == 0 );
+    assert( record->max   == BP_FIELDS );
+
+    bp_record_destroy( &record );
+
+    assert( record == NULL );
+
+    fprintf( stderr, "OK\n" );
+}
+
+
+void test_bp_record_get()
+{
+    fprintf( stderr, "   Testing bp_record_get ... " );
+
+    file_buffer *buffer = NULL;
+    bp_record   *record = NULL;
+    size_t       sizes[] = { 1, 5, 1000 };
+    size_t       i       = 0;
+
+    test_write_file( "---\nSEQ_NAME: test1\nSEQ: ACGT: TG\nSEQ_LEN: 7\n---\nSEQ_NAME: test2\r\nEMPTY: \n---\n---\nSEQ_NAME: test3" );
+
+    record = bp_record_new();
+
+    for ( i = 0; i < sizeof( sizes ) / sizeof( sizes[ 0 ] ); i++ )
+    {
+        buffer_new( TEST_FILE, &buffer, sizes[ i ] );
+
+        assert( bp_record_get( buffer, record ) );
+        assert( record->count == 3 );
+        assert( strcmp( record->fields[ 0 ].key, "SEQ_NAME" ) == 0 );
+        assert( record->fields[ 0 ].key_len == 8 );
+        assert( strcmp( bp_record_val( record, "SEQ_NAME" ), "test1" ) == 0 );
+        assert( strcmp( bp_record_val( record, "SEQ" ), "ACGT: TG" ) == 0 );
+        assert( strcmp( bp_record_val( record, "SEQ_LEN" ), "7" ) == 0 );
+        assert( record->fields[ 1 ].val_len == 8 );
+        assert( bp_record_val( record, "FOO" ) == NULL );
+
+        assert( bp_record_get( buffer, record ) );
+        assert( record->count == 2 );
+        assert( strcmp( bp_record_val( record, "SEQ_NAME" ), "test2" ) == 0 );
+        assert( strcmp( bp_record_val( record, "EMPTY" ), "" ) == 0 );
+
+        assert( bp_record_get( buffer, record ) );
+        assert( record->count == 1 );
+        assert( strcmp( bp_record_val( record, "SEQ_NAME" ), "test3" ) == 0 );
+
+        assert( ! bp_record_get( buffer, record ) );
+
+        buffer_destroy( &buffer );
+    }
+
+    test_write_file( "" );
+
+    buffer_new( TEST_FILE, &buffer, 0 );
+
+    assert( ! bp_record_get( buffer, record ) );
+
+    buffer_destroy( &buffer );
+
+    bp_record_destroy( &record );
+
+    file_unlink( TEST_FILE );
+
+    fprintf( stderr, "OK\n" );
+}
+
+
+void test_bp_record_add()
+{
+    fprintf( stderr, "   Testing bp_record_add ... " );
+
+    bp_record *record = NULL;
+    char       key[ 16 ];
+    size_t     i      = 0;
+
+    record = bp_record_new();
+
+    for ( i = 0; i < BP_FIELDS * 3; i++ ) {
+        bp_record_add( record, "KEY", "VAL" );
+    }
+
+    assert( record->count == BP_FIELDS * 3 );
+    assert( record->max   >= BP_FIELDS * 3 );
+
+    bp_record_clear( record );
+
+    assert( record->count == 0 );
+
+    sprintf( key, "SEQ_NAME" );
+
+    bp_record_add( record, key, "test" );
+
+    assert( strcmp( bp_record_val( record, "SEQ_NAME" ), "test" ) == 0 );
+    assert( record->fields[ 0 ].val_len == 4 );
+
+    bp_record_destroy( &record );
+
+    fprintf( stderr, "OK\n" );
+}
+
+
+void test_bp_record_put()
+{
+    fprintf( stderr, "   Testing bp_record_put ... " );
+
+    char        *file   = "/tmp/test_bp_record_put";
+    char        *in     = "A: 1\nB: 2\n---\nC: 3\n---\n";
+    FILE        *fp     = NULL;
+    file_buffer *buffer = NULL;
+    bp_record   *record = NULL;
+    bp_writer   *writer = NULL;
+    char        *str    = NULL;
+    size_t       i      = 0;
+
+    test_write_file( in );
+
+    record = bp_record_new();
+    fp     = write_open( file );
+    writer = bp_writer_new( fp );
+
+    buffer_new( TEST_FILE, &buffer, 0 );
+
+    while ( bp_record_get( buffer, record ) ) {
+        bp_record_put( writer, record );
+    }
+
+    buffer_destroy( &buffer );
+
+    /* Records larger than the output buffer. */
+    str = mem_get( BP_OUT * 2 );
+
+    for ( i = 0; i < BP_OUT * 2 - 1; i++ ) {
+        str[ i ] = 'A';
+    }
+
+    str[ i ] = '\0';
+
+    bp_record_clear( record );
+    bp_record_add( record, "SEQ", str );
+    bp_record_put( writer, record );
+
+    bp_writer_destroy( &writer );
+
+    close_stream( fp );
+
+    buffer_new( file, &buffer, 0 );
+
+    assert( bp_record_get( buffer, record ) );
+    assert( strcmp( bp_record_val( record, "A" ), "1" ) == 0 );
+    assert( strcmp( bp_record_val( record, "B" ), "2" ) == 0 );
+    assert( bp_record_get( buffer, record ) );
+    assert( strcmp( bp_record_val( record, "C" ), "3" ) == 0 );
+    assert( bp_record_get( buffer, record ) );
+    assert( strcmp( bp_record_val( record, "SEQ" ), str ) == 0 );
+    assert( ! bp_record_get( buffer, record ) );
+
+    buffer_destroy( &buffer );
+
+    bp_record_destroy( &record );
+
+    mem_free( &str );
+
+    file_unlink( file );
+    file_unlink( TEST_FILE );
+
+    fprintf( stderr, "OK\n" );
+}
+
+
+void test_bp_writer_binary()
+{
+    fprintf( stderr, "   Testing bp_writer_binary ... " );
+
+    char        *file   = "/tmp/test_bp_writer_binary";
+    FILE        *fp     = NULL;
+    file_buffer *buffer = NULL;
+    bp_record   *record = NULL;
+    bp_writer   *writer = NULL;
+    char        *str    = NULL;
+    char         key[ 16 ];
+    char         val[ 16 ];
+    size_t       sizes[] = { 1, 5, 1000, 0 };
+    size_t       i      = 0;
+    size_t       j      = 0;
+
+    str = mem_get( BP_OUT * 2 );
+
+    for ( i = 0; i < BP_OUT * 2 - 1; i++ ) {
+        str[ i ] = 'A';
+    }
+
+    str[ i ] = '\0';
+
+    record = bp_record_new();
+    fp     = write_open( file );
+    writer = bp_writer_new( fp );
+
+    bp_writer_binary( writer );
+
+    /* Keys are reused, reordered and added between records. */
+    for ( i = 0; i < 200; i++ )
+    {
+        bp_record_clear( record );
+
+        sprintf( val, "%zu", i );
+
+        if ( i % 2 == 0 )
+        {
+            bp_record_add( record, "SEQ_NAME", val );
+            bp_record_add( record, "SEQ", "ACGT" );
+        }
+        else
+        {
+            bp_record_add( record, "SEQ", "" );
+            bp_record_add( record, "SEQ_NAME", val );
+        }
+
+        if ( i % 50 == 0 )
+        {
+            sprintf( key, "KEY_%zu", i );
+            bp_record_add( record, key, val );
+        }
+
+        bp_record_put( writer, record );
+    }
+
+    bp_record_clear( record );
+    bp_record_add( record, "SEQ", str );
+    bp_record_put( writer, record );
+
+    bp_writer_destroy( &writer );
+
+    close_stream( fp );
+
+    for ( j = 0; j < sizeof( sizes ) / sizeof( sizes[ 0 ] ); j++ )
+    {
+        bp_record_destroy( &record );
+
+        record = bp_record_new();
+
+        buffer_new( file, &buffer, sizes[ j ] );
+
+        for ( i = 0; i < 200; i++ )
+        {
+            sprintf( val, "%zu", i );
+
+            assert( bp_record_get( buffer, record ) );
+            assert( record->format == BP_BINARY );
+            assert( record->count == ( ( i % 50 == 0 ) ? 3 : 2 ) );
+            assert( strcmp( bp_record_val( record, "SEQ_NAME" ), val ) == 0 );
+            assert( strcmp( bp_record_val( record, "SEQ" ), ( i % 2 == 0 ) ? "ACGT" : "" ) == 0 );
+            assert( record->fields[ 0 ].key_len == ( ( i % 2 == 0 ) ? 8 : 3 ) );
+
+            if ( i % 50 == 0 )
+            {
+                sprintf( key, "KEY_%zu", i );
+                assert( strcmp( bp_record_val( record, key ), val ) == 0 );
+            }
+        }
+
+        assert( bp_record_get( buffer, record ) );
+        assert( record->fields[ 0 ].val_len == BP_OUT * 2 - 1 );
+        assert( strcmp( bp_record_val( record, "SEQ" ), str ) == 0 );
+        assert( ! bp_record_get( buffer, record ) );
+
+        buffer_destroy( &buffer );
+    }
+
+    assert( record->key_count == 6 );
+
+    bp_record_destroy( &record );
+
+    /* Text streams are still detected. */
+    test_write_file( "A: 1\n---\n" );
+
+    record = bp_record_new();
+
+    buffer_new( TEST_FILE, &buffer, 0 );
+
+    assert( bp_record_get( buffer, record ) );
+    assert( record->format == BP_TEXT );
+    assert( strcmp( bp_record_val( record, "A" ), "1" ) == 0 );
+    assert( ! bp_record_get( buffer, record ) );
+
+    buffer_destroy( &buffer );
+
+    bp_record_destroy( &record );
+
+    mem_free( &str );
+
+    file_unlink( file );
+    file_unlink( TEST_FILE );
+
+    fprintf( stderr, "OK\n" );
+}
+
+
+static void test_write_file( char *str )
+{
+    /* Write a string to the test file. */
+
+    FILE *fp = NULL;
+
+    fp = write_open( TEST_FILE );
+
+    fprintf( fp, "%s", str );
+
+    close_stream( fp );
+}
@@ -0,0 +1,452 @@
+/* Martin Asser Hansen (mail@maasha.dk) Copyright (C) 2008 - All right reserved */
+
+#include <pthread.h>
+#include "common.h"
+#include "mem.h"
+#include "chash.h"
+
+#define TEST_THREADS 4
+#define TEST_KEYS    20000
+#define TEST_ROUNDS  5
+
+static void  test_chash_new();
+static void  test_chash_add();
+static void  test_chash_insert();
+static void  test_chash_set();
+static void  test_chash_iter_next();
+static void  test_chash_threads();
+static void  test_chash_add_u64();
+static void  test_chash_iter_next_u64();
+static void  test_chash_mem();
+static void  test_chash_threads_u64();
+static void *test_chash_worker( void *arg );
+static void *test_chash_worker_u64( void *arg );
+
+
+int main()
+{
+    fprintf( stderr, "Running all tests for chash.c\n" );
+
+    test_chash_new();
+    test_chash_add();
+    test_chash_insert();
+    test_chash_set();
+    test_chash_iter_next();
+    test_chash_threads();
+    test_chash_add_u64();
+    test_chash_iter_next_u64();
+    test_chash_mem();
+    test_chash_threads_u64();
+
+    fprintf( stderr, "Done\n\n" );
+
+    return EXIT_SUCCESS;
+}
+
+
+void test_chash_new()
+{
+    fprintf( stderr, "   Testing chash_new ... " );
+
+    chash *hash_pt = NULL;
+
+    hash_pt = chash_new( 0 );
+
+    assert( hash_pt->mask == CHASH_SHARDS - 1 );
+    assert( chash_count( hash_pt ) == 0 );
+
+    chash_destroy( &hash_pt );
+
+    hash_pt = chash_new( 5 );
+
+    assert( hash_pt->mask == 7 );
+
+    chash_destroy( &hash_pt );
+
+    assert( hash_pt == NULL );
+
+    fprintf( stderr, "OK\n" );
+}
+
+
+void test_chash_add()
+{
+    fprintf( stderr, "   Testing chash_add ... " );
+
+    chash    *hash_pt = NULL;
+    uint64_t  val     = 0;
+    char      key[ 32 ];
+    int       i       = 0;
+
+    hash_pt = chash_new( 4 );
+
+    assert( ! chash_get( hash_pt, "chr1", &val ) );
+
+    assert( chash_add( hash_pt, "chr1", 3 ) == 3 );
+    assert( chash_add( hash_pt, "chr1", 4 ) == 7 );
+    assert( chash_get( hash_pt, "chr1", &val ) );
+    assert( val == 7 );
+
+    for ( i = 0; i < TEST_KEYS; i++ )
+    {
+        sprintf( key, "read_%d", i );
+
+        chash_add( hash_pt, key, i );
+    }
+
+    assert( chash_count( hash_pt ) == TEST_KEYS + 1 );
+
+    for ( i = 0; i < TEST_KEYS; i++ )
+    {
+        sprintf( key, "read_%d", i );
+
+        assert( chash_get( hash_pt, key, &val ) );
+        assert( val == ( uint64_t ) i );
+    }
+
+    chash_destroy( &hash_pt );
+
+    fprintf( stderr, "OK\n" );
+}
+
+
+void test_chash_insert()
+{
+    fprintf( stderr, "   Testing chash_insert ... " );
+
+    chash    *hash_pt = NULL;
+    uint64_t  val     = 0;
+
+    hash_pt = chash_new( 0 );
+
+    assert( chash_insert( hash_pt, "read_1", 10, &val ) );
+    assert( val == 10 );
+
+    assert( ! chash_insert( hash_pt, "read_1", 20, &val ) );
+    assert( val == 10 );
+
+    assert( chash_count( hash_pt ) == 1 );
+
+    chash_destroy( &hash_pt );
+
+    fprintf( stderr, "OK\n" );
+}
+
+
+void test_chash_set()
+{
+    fprintf( stderr, "   Testing chash_set ... " );
+
+    chash    *hash_pt = NULL;
+    uint64_t  val     = 0;
+
+    hash_pt = chash_new( 0 );
+
+    chash_set( hash_pt, "chr1", 1 );
+    chash_set( hash_pt, "chr1", 2 );
+
+    assert( chash_get( hash_pt, "chr1", &val ) );
+    assert( val == 2 );
+    assert( chash_count( hash_pt ) == 1 );
+
+    chash_destroy( &hash_pt );
+
+    fprintf( stderr, "OK\n" );
+}
+
+
+void test_chash_iter_next()
+{
+    fprintf( stderr, "   Testing chash_iter_next ... " );
+
+    chash      *hash_pt = NULL;
+    chash_iter  iter1;
+    chash_iter  iter2;
+    char       *key     = NULL;
+    uint64_t    val     = 0;
+    uint64_t    sum     = 0;
+    size_t      count   = 0;
+    char        buf[ 32 ];
+    int         i       = 0;
+
+    hash_pt = chash_new( 0 );
+
+    chash_iter_init( &iter1, hash_pt );
+
+    assert( ! chash_iter_next( &iter1, &key, &val ) );
+
+    for ( i = 1; i <= 1000; i++ )
+    {
+        sprintf( buf, "key_%d", i );
+
+        chash_add( hash_pt, buf, i );
+    }
+
+    chash_iter_init( &iter1, hash_pt );
+    chash_iter_init( &iter2, hash_pt );
+
+    /* Iterators are independent. */
+
+    assert( chash_iter_next( &iter2, &key, &val ) );
+
+    while ( chash_iter_next( &iter1, &key, &val ) )
+    {
+        assert( strncmp( key, "key_", 4 ) == 0 );
+        assert( val == strtoul( key + 4, NULL, 10 ) );
+
+        sum += val;
+        count++;
+    }
+
+    assert( count == 1000 );
+    assert( sum   == 1000 * 1001 / 2 );
+
+    count = 1;
+
+    while ( chash_iter_next( &iter2, &key, &val ) ) {
+        count++;
+    }
+
+    assert( count == 1000 );
+
+    chash_destroy( &hash_pt );
+
+    fprintf( stderr, "OK\n" );
+}
+
+
+void test_chash_threads()
+{
+    fprintf( stderr, "   Testing chash threads ... " );
+
+    chash     *hash_pt = NULL;
+    pthread_t  threads[ TEST_THREADS ];
+    uint64_t   val     = 0;
+    char       key[ 32 ];
+    int        i       = 0;
+
+    hash_pt = chash_new( 0 );
+
+    for ( i = 0; i < TEST_THREADS; i++ ) {
+        assert( pthread_create( &threads[ i ], NULL, test_chash_worker, hash_pt ) == 0 );
+    }
+
+    for ( i = 0; i < TEST_THREADS; i++ ) {
+        pthread_join( threads[ i ], NULL );
+    }
+
+    assert( chash_count( hash_pt ) == TEST_KEYS );
+
+    for ( i = 0; i < TEST_KEYS; i++ )
+    {
+        sprintf( key, "read_%d", i );
+
+        assert( chash_get( hash_pt, key, &val ) );
+        assert( val == TEST_THREADS * TEST_ROUNDS );
+    }
+
+    chash_destroy( &hash_pt );
+
+    fprintf( stderr, "OK\n" );
+}
+
+
+void test_chash_add_u64()
+{
+    fprintf( stderr, "   Testing chash_add_u64 ... " );
+
+    chash    *hash_pt = NULL;
+    uint      val     = 0;
+    uint64_t  key     = 0;
+    int       shared  = 0;
+
+    assert( sizeof( chash_u64_slot ) == 12 );
+
+    for ( shared = FALSE; shared <= TRUE; shared++ )
+    {
+        hash_pt = chash_new_u64( 4, shared );
+
+        assert( ! chash_get_u64( hash_pt, 0, &val ) );
+
+        assert( chash_add_u64( hash_pt, 0, 3 ) == 3 );
+        assert( chash_add_u64( hash_pt, 0, 4 ) == 7 );
+        assert( chash_get_u64( hash_pt, 0, &val ) );
+        assert( val == 7 );
+
+        /* Keys that differ only in one half. */
+
+        chash_add_u64( hash_pt, 0xffffffffULL, 1 );
+        chash_add_u64( hash_pt, 0x100000000ULL, 2 );
+        chash_add_u64( hash_pt, ~( uint64_t ) 0 - 1, 5 );
+
+        assert( chash_get_u64( hash_pt, 0xffffffffULL, &val ) && val == 1 );
+        assert( chash_get_u64( hash_pt, 0x100000000ULL, &val ) && val == 2 );
+        assert( chash_get_u64( hash_pt, ~( uint64_t ) 0 - 1, &val ) && val == 5 );
+        assert( ! chash_get_u64( hash_pt, 0x1ffffffffULL, &val ) );
+
+        for ( key = 1; key <= TEST_KEYS; key++ ) {
+            chash_add_u64( hash_pt, ( key << 33 ) | 1, ( uint ) key );
+        }
+
+        assert( chash_count( hash_pt ) == TEST_KEYS + 4 );
+
+        for ( key = 1; key <= TEST_KEYS; key++ )
+        {
+            assert( chash_get_u64( hash_pt, ( key << 33 ) | 1, &val ) );
+            assert( val == ( uint ) key );
+        }
+
+        chash_destroy( &hash_pt );
+    }
+
+    fprintf( stderr, "OK\n" );
+}
+
+
+void test_chash_iter_next_u64()
+{
+    fprintf( stderr, "   Testing chash_iter_next_u64 ... " );
+
+    chash      *hash_pt = NULL;
+    chash_iter  iter;
+    uint64_t    key     = 0;
+    uint        val     = 0;
+    uint64_t    sum     = 0;
+    size_t      count   = 0;
+
+    hash_pt = chash_new_u64( 0, FALSE );
+
+    chash_iter_init( &iter, hash_pt );
+
+    assert( ! chash_iter_next_u64( &iter, &key, &val ) );
+
+    for ( key = 0; key < 1000; key++ ) {
+        chash_add_u64( hash_pt, key * 3, ( uint ) key * 3 + 1 );
+    }
+
+    chash_iter_init( &iter, hash_pt );
+
+    while ( chash_iter_next_u64( &iter, &key, &val ) )
+    {
+        assert( key % 3 == 0 );
+        assert( val == key + 1 );
+
+        sum += key;
+        count++;
+    }
+
+    assert( count == 1000 );
+    assert( sum   == 3 * 999 * 1000 / 2 );
+
+    chash_destroy( &hash_pt );
+
+    fprintf( stderr, "OK\n" );
+}
+
+
+void test_chash_mem()
+{
+    fprintf( stderr, "   Testing chash_mem ... " );
+
+    chash    *hash_pt = NULL;
+    size_t    mem     = 0;
+    uint64_t  key     = 0;
+
+    hash_pt = chash_new_u64( 1, FALSE );
+
+    mem = chash_mem( hash_pt );
+
+    /* 1 << 16 keys at a load of at most 75 percent need 1 << 17 slots. */
+
+    for ( key = 0; key < 1 << 16; key++ ) {
+        chash_add_u64( hash_pt, key, 1 );
+    }
+
+    assert( chash_mem( hash_pt ) - mem == sizeof( chash_u64_slot ) * ( ( 1 << 17 ) - ( 1 << CHASH_BITS_MIN ) ) );
+
+    chash_destroy( &hash_pt );
+
+    fprintf( stderr, "OK\n" );
+}
+
+
+void test_chash_threads_u64()
+{
+    fprintf( stderr, "   Testing chash threads with 64 bit keys ... " );
+
+    chash     *hash_pt = NULL;
+    pthread_t  threads[ TEST_THREADS ];
+    uint64_t   key     = 0;
+    uint       val     = 0;
+    int        i       = 0;
+
+    hash_pt = chash_new_u64( 0, TRUE );
+
+    for ( i = 0; i < TEST_THREADS; i++ ) {
+        assert( pthread_create( &threads[ i ], NULL, test_chash_worker_u64, hash_pt ) == 0 );
+    }
+
+    for ( i = 0; i < TEST_THREADS; i++ ) {
+        pthread_join( threads[ i ], NULL );
+    }
+
+    assert( chash_count( hash_pt ) == TEST_KEYS );
+
+    for ( key = 0; key < TEST_KEYS; key++ )
+    {
+        assert( chash_get_u64( hash_pt, key * 0x9e3779b97f4a7c15ULL, &val ) );
+        assert( val == TEST_THREADS * TEST_ROUNDS );
+    }
+
+    chash_destroy( &hash_pt );
+
+    fprintf( stderr, "OK\n" );
+}
+
+
+static void *test_chash_worker( void *arg )
+{
+    /* All threads count the same keys, so inserts and updates race. */
+
+    chash    *hash_pt = ( chash * ) arg;
+    uint64_t  val     = 0;
+    char      key[ 32 ];
+    int       r       = 0;
+    int       i       = 0;
+
+    for ( r = 0; r < TEST_ROUNDS; r++ )
+    {
+        for ( i = 0; i < TEST_KEYS; i++ )
+        {
+            sprintf( key, "read_%d", i );
+
+            chash_add( hash_pt, key, 1 );
+
+            assert( chash_get( hash_pt, key, &val ) );
+            assert( val > 0 );
+        }
+    }
+
+    return NULL;
+}
+
+
+static void *test_chash_worker_u64( void *arg )
+{
+    /* All threads count the same keys, so inserts and grows race. */
+
+    chash    *hash_pt = ( chash * ) arg;
+    uint64_t  key     = 0;
+    int       r       = 0;
+
+    for ( r = 0; r < TEST_ROUNDS; r++ )
+    {
+        for ( key = 0; key < TEST_KEYS; key++ ) {
+            assert( chash_add_u64( hash_pt, key * 0x9e3779b97f4a7c15ULL, 1 ) > 0 );
+        }
+    }
+
+    return NULL;
+}
+
+
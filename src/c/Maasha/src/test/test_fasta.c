@@ -11,7 +11,11 @@
 #define TEST_COUNT 10
 #define TEST_SIZE  10
 
+static void test_fasta_count_stats();
 static void test_fasta_get_entry();
+static void test_fasta_get_entry_buffer();
+static void test_fasta_map_get_view();
+static void test_fasta_index();
 static void test_fasta_put_entry();
 
 
@@ -19,7 +23,11 @@ int main()
 {
     fprintf( stderr, "Running all tests for fasta.c\n" );
 
+    test_fasta_count_stats();
     test_fasta_get_entry();
+    test_fasta_get_entry_buffer();
+    test_fasta_map_get_view();
+    test_fasta_index();
     test_fasta_put_entry();
 
     fprintf( stderr, "Done\n\n" );
@@ -28,6 +36,57 @@ int main()
 }
 
 
+void test_fasta_count_stats()
+{
+    fprintf( stderr, "   Testing fasta_count_stats ... " );
+
+    char        *file  = "/tmp/test_fasta_count.fna";
+    FILE        *fp    = NULL;
+    fasta_stats  stats;
+    size_t       i     = 0;
+
+    fp = write_open( file );
+
+    fprintf( fp, "junk\n>seq1\nACGT\r\nAC GT\n>seq2\n" );
+
+    for ( i = 0; i < 3000; i++ ) {
+        fprintf( fp, ( i % 1024 == 1000 ) ? ">" : "A" );
+    }
+
+    fprintf( fp, "\n>seq3 >not an entry\n\n>seq4\nTTT" );
+
+    close_stream( fp );
+
+    fp = read_open( file );
+
+    fasta_count_stats( fp, &stats );
+
+    close_stream( fp );
+
+    assert( stats.count    == 4 );
+    assert( stats.residues == 3011 );
+    assert( stats.longest  == 3000 );
+
+    fp = read_open( file );
+
+    assert( fasta_count( fp ) == 4 );
+
+    close_stream( fp );
+
+    fp = read_open( TEST_FILE1 );
+
+    fasta_count_stats( fp, &stats );
+
+    close_stream( fp );
+
+    assert( stats.count == 10 );
+
+    unlink( file );
+
+    fprintf( stderr, "OK\n" );
+}
+
+
 void test_fasta_get_entry()
 {
     fprintf( stderr, "   Testing fasta_get_entry ... " );
@@ -53,6 +112,218 @@ void test_fasta_get_entry()
 }
 
 
+void test_fasta_get_entry_buffer()
+{
+    fprintf( stderr, "   Testing fasta_get_entry_buffer ... " );
+
+    FILE        *fp           = NULL;
+    file_buffer *buffer       = NULL;
+    seq_entry   *entry1       = NULL;
+    seq_entry   *entry2       = NULL;
+    size_t       max_seq_name = MAX_SEQ_NAME;
+    size_t       max_seq      = MAX_SEQ;
+    size_t       size         = 0;
+    size_t       count        = 0;
+
+    entry1 = seq_new( max_seq_name, max_seq );
+    entry2 = seq_new( 1, 1 );   /* forces entry2 to grow. */
+
+    /* Small block sizes force refills in the middle of names and lines. */
+    for ( size = 1; size <= FASTA_BLOCK; size <<= 4 )
+    {
+        fp = read_open( TEST_FILE1 );
+
+        buffer_new( TEST_FILE1, &buffer, size );
+
+        count = 0;
+
+        while ( ( fasta_get_entry( fp, &entry1 ) != FALSE ) )
+        {
+            assert( fasta_get_entry_buffer( buffer, &entry2 ) == TRUE );
+
+            assert( strcmp( entry1->seq_name, entry2->seq_name ) == 0 );
+            assert( strcmp( entry1->seq, entry2->seq ) == 0 );
+            assert( entry1->seq_len == entry2->seq_len );
+
+            count++;
+        }
+
+        assert( fasta_get_entry_buffer( buffer, &entry2 ) == FALSE );
+        assert( count > 0 );
+
+        buffer_destroy( &buffer );
+
+        close_stream( fp );
+    }
+
+    seq_destroy( entry1 );
+    seq_destroy( entry2 );
+
+    fprintf( stderr, "OK\n" );
+}
+
+
+void test_fasta_map_get_view()
+{
+    fprintf( stderr, "   Testing fasta_map_get_view ... " );
+
+    FILE       *fp    = NULL;
+    fasta_map  *map   = NULL;
+    fasta_view *view  = NULL;
+    seq_entry  *entry = NULL;
+    size_t      i     = 0;
+    size_t      j     = 0;
+    size_t      k     = 0;
+    size_t      count = 0;
+    char        c     = 0;
+
+    fp    = read_open( TEST_FILE1 );
+    map   = fasta_map_new( TEST_FILE1 );
+    view  = fasta_view_new();
+    entry = seq_new( MAX_SEQ_NAME, MAX_SEQ );
+
+    while ( ( fasta_get_entry( fp, &entry ) != FALSE ) )
+    {
+        assert( fasta_map_get_view( map, view ) == TRUE );
+
+        assert( view->seq_name_len == strlen( entry->seq_name ) );
+        assert( strncmp( view->seq_name, entry->seq_name, view->seq_name_len ) == 0 );
+
+        /* Walk the residues line by line skipping non-sequence chars. */
+        for ( k = 0, i = 0; i < view->line_count; i++ )
+        {
+            for ( j = 0; j < view->lines[ i ].len; j++ )
+            {
+                c = view->lines[ i ].str[ j ];
+
+                if ( isseq( c ) ) {
+                    assert( entry->seq[ k++ ] == c );
+                }
+            }
+        }
+
+        assert( k == entry->seq_len );
+
+        count++;
+    }
+
+    assert( fasta_map_get_view( map, view ) == FALSE );
+    assert( count > 0 );
+
+    seq_destroy( entry );
+    fasta_view_destroy( &view );
+    fasta_map_destroy( &map );
+    close_stream( fp );
+
+    assert( view == NULL );
+    assert( map  == NULL );
+
+    fprintf( stderr, "OK\n" );
+}
+
+
+void test_fasta_index()
+{
+    fprintf( stderr, "   Testing fasta_index ... " );
+
+    char        *file   = "/tmp/test_fasta_index.fna";
+    char        *fai    = "/tmp/test_fasta_index.fna.fai";
+    FILE        *fp     = NULL;
+    fasta_index *index  = NULL;
+    fasta_index *index2 = NULL;
+    fai_entry   *fai1   = NULL;
+    fai_entry   *fai2   = NULL;
+    seq_entry   *entry  = NULL;
+    size_t       i      = 0;
+
+    fp = write_open( file );
+
+    fprintf( fp, ">seq1 description\nACGTA\nCGTAC\nGT\n>seq2\r\nAAAA\r\nCCCC\r\n>empty\n>seq3\nTTT\n" );
+
+    close_stream( fp );
+
+    index = fasta_index_build( file );
+
+    assert( index->nmemb == 4 );
+
+    fai1 = fasta_index_get( index, "seq1" );
+
+    assert( fai1->len == 12 );
+    assert( fai1->offset == 18 );
+    assert( fai1->line_bases == 5 );
+    assert( fai1->line_width == 6 );
+
+    fai1 = fasta_index_get( index, "seq2" );
+
+    assert( fai1->len == 8 );
+    assert( fai1->line_bases == 4 );
+    assert( fai1->line_width == 6 );
+
+    assert( fasta_index_get( index, "empty" )->len == 0 );
+    assert( fasta_index_get( index, "seq4" ) == NULL );
+
+    fasta_index_write( index, fai );
+
+    index2 = fasta_index_read( file, fai );
+
+    assert( index2->nmemb == index->nmemb );
+
+    for ( i = 0; i < index->nmemb; i++ )
+    {
+        fai1 = &index->entries[ i ];
+        fai2 = &index2->entries[ i ];
+
+        assert( strcmp( fai1->name, fai2->name ) == 0 );
+        assert( fai1->len        == fai2->len );
+        assert( fai1->offset     == fai2->offset );
+        assert( fai1->line_bases == fai2->line_bases );
+        assert( fai1->line_width == fai2->line_width );
+    }
+
+    entry = seq_new( 1, 1 );
+
+    assert( fasta_fetch( index2, "seq1", 0, 12, &entry ) );
+    assert( strcmp( entry->seq_name, "seq1" ) == 0 );
+    assert( strcmp( entry->seq, "ACGTACGTACGT" ) == 0 );
+
+    assert( fasta_fetch( index2, "seq1", 3, 11, &entry ) );
+    assert( strcmp( entry->seq, "TACGTACG" ) == 0 );
+    assert( entry->seq_len == 8 );
+
+    assert( fasta_fetch( index2, "seq1", 10, 100, &entry ) );
+    assert( strcmp( entry->seq, "GT" ) == 0 );
+
+    assert( fasta_fetch( index2, "seq2", 2, 6, &entry ) );
+    assert( strcmp( entry->seq, "AACC" ) == 0 );
+
+    assert( fasta_fetch( index2, "seq3", 0, 3, &entry ) );
+    assert( strcmp( entry->seq, "TTT" ) == 0 );
+
+    assert( fasta_fetch( index2, "empty", 0, 10, &entry ) );
+    assert( entry->seq_len == 0 );
+
+    assert( ! fasta_fetch( index2, "seq4", 0, 10, &entry ) );
+
+    seq_destroy( entry );
+
+    fasta_index_destroy( &index );
+    fasta_index_destroy( &index2 );
+
+    index = fasta_index_load( file );
+
+    assert( index->nmemb == 4 );
+
+    fasta_index_destroy( &index );
+
+    assert( index == NULL );
+
+    unlink( file );
+    unlink( fai );
+
+    fprintf( stderr, "OK\n" );
+}
+
+
 void test_fasta_put_entry()
 {
     fprintf( stderr, "   Testing fasta_put_entry ... " );
@@ -1,6 +1,7 @@
 /* Martin Asser Hansen (mail@maasha.dk) Copyright (C) 2008 - All right reserved */
 
 #include "common.h"
+#include "mem.h"
 #include "filesys.h"
 
 //#define TEST_FILE "/Users/m.hansen/DATA/genomes/hg18/hg18.fna"
@@ -14,6 +15,7 @@ static void test_close_stream();
 static void test_file_read();
 static void test_file_unlink();
 static void test_file_rename();
+static void test_file_temp();
 static void test_buffer_new();
 static void test_buffer_read();
 static void test_buffer_getc();
@@ -38,6 +40,7 @@ int main()
     test_file_read();
     test_file_unlink();
     test_file_rename();
+    test_file_temp();
     test_buffer_new();
     test_buffer_read();
     test_buffer_getc();
@@ -192,6 +195,36 @@ void test_file_rename()
 }
 
 
+void test_file_temp()
+{
+    fprintf( stderr, "   Testing file_temp ... " );
+
+    char *file1 = NULL;
+    char *file2 = NULL;
+    FILE *fp1   = NULL;
+    FILE *fp2   = NULL;
+
+    fp1 = file_temp( "/tmp", &file1 );
+    fp2 = file_temp( "/tmp", &file2 );
+
+    assert( strncmp( file1, "/tmp/", 5 ) == 0 );
+    assert( strcmp( file1, file2 ) != 0 );
+
+    fprintf( fp1, "MARTIN" );
+
+    close_stream( fp1 );
+    close_stream( fp2 );
+
+    file_unlink( file1 );
+    file_unlink( file2 );
+
+    mem_free( &file1 );
+    mem_free( &file2 );
+
+    fprintf( stderr, "OK\n" );
+}
+
+
 void test_buffer_new()
 {
     fprintf( stderr, "   Testing buffer_new ... " );
@@ -219,7 +252,14 @@ void test_buffer_new()
 
     buffer_destroy( &buffer );
 
-    buffer = NULL;
+    assert( buffer == NULL );
+
+    num = buffer_new( file, &buffer, 0 );
+
+    assert( num == strlen( str ) );
+    assert( buffer->buffer_size == FILE_BUFFER_SIZE );
+
+    buffer_destroy( &buffer );
 
     file_unlink( file );
 
@@ -393,6 +433,7 @@ void test_buffer_gets()
     FILE        *fp     = NULL;
     char        *str    = NULL;
     size_t       size   = 1;
+    size_t       len    = 0;
     size_t          i   = 0;
     file_buffer *buffer = NULL;
 
@@ -404,19 +445,34 @@ void test_buffer_gets()
 
     i = 0;
 
-    while( ( str = buffer_gets( buffer ) ) != NULL )
+    while( ( len = buffer_gets( buffer, &str ) ) != 0 )
     {
         if ( i == 0 ) {
-            assert( strcmp( str, "MARTIN\n" ) == 0 );
+            assert( len == 7 && strncmp( str, "MARTIN\n", len ) == 0 );
         } else if ( i == 1 ) {
-            assert( strcmp( str, "ASSER\n" ) == 0 );
+            assert( len == 6 && strncmp( str, "ASSER\n", len ) == 0 );
         } else if ( i == 2 ) {
-            assert( strcmp( str, "HANSEN\n" ) == 0 );
+            assert( len == 7 && strncmp( str, "HANSEN\n", len ) == 0 );
         }
 
         i++;
     }
 
+    assert( i == 3 );
+
+    buffer_destroy( &buffer );
+
+    fp = write_open( file );
+    fprintf( fp, "MARTIN\nASSER" );
+    close_stream( fp );
+
+    buffer_new( file, &buffer, size );
+
+    assert( buffer_gets( buffer, &str ) == 7 );
+    assert( buffer_gets( buffer, &str ) == 5 );
+    assert( strcmp( str, "ASSER" ) == 0 );
+    assert( buffer_gets( buffer, &str ) == 0 );
+
     buffer_destroy( &buffer );
 
     buffer = NULL;
@@ -435,8 +491,8 @@ void test_buffer_ungets()
     char        *out    = "MARTIN\nASSER\nHANSEN\n";
     FILE        *fp     = NULL;
     size_t       size   = 1;
-    char        *str1   = NULL;
-    char        *str2   = NULL;
+    char        *str    = NULL;
+    size_t       len    = 0;
     file_buffer *buffer = NULL;
 
     fp = write_open( file );
@@ -447,23 +503,25 @@ void test_buffer_ungets()
 
     buffer_new( file, &buffer, size );
 
-    str1 = buffer_gets( buffer );
+    len = buffer_gets( buffer, &str );
+
+    assert( len == 7 && strncmp( str, "MARTIN\n", len ) == 0 );
 
     buffer_ungets( buffer );
 
-    str2 = buffer_gets( buffer );
+    len = buffer_gets( buffer, &str );
 
-    assert( strcmp( str1, str2 ) == 0 );
+    assert( len == 7 && strncmp( str, "MARTIN\n", len ) == 0 );
 
-    while ( ( str1 = buffer_gets( buffer ) ) != NULL )
+    while ( buffer_gets( buffer, &str ) != 0 )
     {
     }
     
     buffer_ungets( buffer );
 
-    str1 = buffer_gets( buffer );
+    len = buffer_gets( buffer, &str );
 
-    assert( ( strcmp( str1, "HANSEN\n" ) ) == 0 );
+    assert( len == 7 && strncmp( str, "HANSEN\n", len ) == 0 );
 
     buffer_destroy( &buffer );
 
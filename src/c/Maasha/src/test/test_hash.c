@@ -6,6 +6,8 @@
 
 static void test_hash_new();
 static void test_hash_key();
+static void test_hash_funcs();
+static void test_hash_func_set();
 static void test_hash_add();
 static void test_hash_get();
 static void test_hash_elem_get();
@@ -20,6 +22,8 @@ int main()
 
     test_hash_new();
     test_hash_key();
+    test_hash_funcs();
+    test_hash_func_set();
     test_hash_add();
     test_hash_get();
     test_hash_elem_get();
@@ -68,6 +72,88 @@ void test_hash_key()
 }
 
 
+void test_hash_funcs()
+{
+    fprintf( stderr, "   Testing hash_funcs ... " );
+
+    char   *s    = "ABCDEFGHIJKLMNOPQRSTUVXYZabcdefghijklmnopqrstuvxyz0123456789ABCDEFGHIJKLMNOPQRSTUVXYZ";
+    char    buf[ 128 ];
+    uint    h[ 100 ];
+    size_t  len  = 0;
+    size_t  i    = 0;
+
+    assert( hash_kent( s, strlen( s ) ) == hash_key( s ) );
+    assert( hash_fnv( "", 0 ) == 2166136261U );
+    assert( hash_fnv( "a", 1 ) == 0xe40c292c );
+
+    /* Word reads do not depend on alignment or bytes after the key. */
+    for ( len = 0; len < strlen( s ); len++ )
+    {
+        for ( i = 1; i < 8; i++ )
+        {
+            memset( buf, 'x', sizeof( buf ) );
+            memcpy( &buf[ i ], s, len );
+
+            assert( hash_wy( &buf[ i ], len ) == hash_wy( s, len ) );
+        }
+
+        h[ len ] = hash_wy( s, len );
+
+        for ( i = 0; i < len; i++ ) {
+            assert( h[ i ] != h[ len ] );
+        }
+    }
+
+    fprintf( stderr, "OK\n" );
+}
+
+
+void test_hash_func_set()
+{
+    fprintf( stderr, "   Testing hash_func_set ... " );
+
+    hash_func  funcs[] = { hash_kent, hash_fnv, hash_wy };
+    hash      *hash_pt = NULL;
+    char       key[ 32 ];
+    size_t     vals[ 1000 ];
+    size_t     i       = 0;
+    size_t     j       = 0;
+
+    hash_pt = hash_new( 4 );
+
+    assert( hash_pt->func == hash_wy );
+
+    for ( i = 0; i < 1000; i++ )
+    {
+        sprintf( key, "read_%zu/1", i );
+
+        vals[ i ] = i;
+
+        hash_add( hash_pt, key, &vals[ i ] );
+    }
+
+    for ( j = 0; j < sizeof( funcs ) / sizeof( funcs[ 0 ] ); j++ )
+    {
+        hash_func_set( hash_pt, funcs[ j ] );
+
+        assert( hash_pt->nmemb == 1000 );
+
+        for ( i = 0; i < 1000; i++ )
+        {
+            sprintf( key, "read_%zu/1", i );
+
+            assert( *( ( size_t * ) hash_get( hash_pt, key ) ) == i );
+        }
+
+        assert( hash_get( hash_pt, "read_1000/1" ) == NULL );
+    }
+
+    hash_destroy( hash_pt );
+
+    fprintf( stderr, "OK\n" );
+}
+
+
 void test_hash_add()
 {
     fprintf( stderr, "   Testing hash_add ... " );
@@ -76,11 +162,50 @@ void test_hash_add()
     size_t  size    = 16;
     char   *key1    = "key1";
     char   *val1    = "val1";
+    char   *val2    = "val2";
+    char    key[ 32 ];
+    size_t  i       = 0;
+    size_t  vals[ 10000 ];
 
     hash_pt = hash_new( size );
 
     hash_add( hash_pt, key1, val1 );
 
+    assert( hash_pt->nmemb == 1 );
+
+    hash_add( hash_pt, key1, val2 );
+
+    assert( hash_pt->nmemb == 1 );
+    assert( hash_get( hash_pt, key1 ) == val2 );
+
+    hash_destroy( hash_pt );
+
+    /* The table grows and keys are copied. */
+    hash_pt = hash_new( 0 );
+
+    for ( i = 0; i < 10000; i++ )
+    {
+        sprintf( key, "chr%zu", i );
+
+        vals[ i ] = i;
+
+        hash_add( hash_pt, key, &vals[ i ] );
+    }
+
+    assert( hash_pt->nmemb == 10000 );
+    assert( hash_pt->nmemb * 100 <= hash_pt->table_size * HASH_LOAD );
+
+    for ( i = 0; i < 10000; i++ )
+    {
+        sprintf( key, "chr%zu", i );
+
+        assert( *( ( size_t * ) hash_get( hash_pt, key ) ) == i );
+    }
+
+    assert( hash_get( hash_pt, "chr10000" ) == NULL );
+
+    hash_destroy( hash_pt );
+
     fprintf( stderr, "OK\n" );
 }
 
@@ -161,18 +286,24 @@ void test_hash_each()
     }
 
     assert( hash_pt->index_table == 0 );
-    assert( hash_pt->index_bucket == NULL );
 
-    hash_print( hash_pt );
+    i = 0;
 
     while( hash_each( hash_pt, &key0, &val0 ) )
     {
-        printf( "1: key0: %s   val0:   %s\n", key0, ( char * ) val0 );
-        printf( "index_table: %zu   index_bucket: %p\n", hash_pt->index_table, hash_pt->index_bucket );
+        assert( strncmp( key0, "key_", 4 ) == 0 );
+        assert( strcmp( val0, val ) == 0 );
 
-        hash_each( hash_pt, &key0, &val0 );
+        i++;
     }
 
+    assert( i == ( 1 << size ) );
+    assert( hash_pt->index_table == 0 );
+
+    hash_destroy( hash_pt );
+
+    mem_free( &key );
+
     fprintf( stderr, "OK\n" );
 }
 
@@ -0,0 +1,237 @@
+/* Martin Asser Hansen (mail@maasha.dk) Copyright (C) 2008 - All right reserved */
+
+#include <pthread.h>
+#include "common.h"
+#include "mem.h"
+#include "chash.h"
+#include "kcount.h"
+
+#define TEST_THREADS 4
+#define TEST_CODES   1000
+#define TEST_ROUNDS  300
+
+static void  test_kcount_new();
+static void  test_kcount_add();
+static void  test_kcount_overflow();
+static void  test_kcount_merge();
+static void  test_kcount_threads();
+static void *test_kcount_worker( void *arg );
+
+static int layouts[] = { KCOUNT_DENSE, KCOUNT_DENSE16, KCOUNT_DENSE8, KCOUNT_SPARSE };
+
+
+int main()
+{
+    fprintf( stderr, "Running all tests for kcount.c\n" );
+
+    test_kcount_new();
+    test_kcount_add();
+    test_kcount_overflow();
+    test_kcount_merge();
+    test_kcount_threads();
+
+    fprintf( stderr, "Done\n\n" );
+
+    return EXIT_SUCCESS;
+}
+
+
+void test_kcount_new()
+{
+    fprintf( stderr, "   Testing kcount_new ... " );
+
+    kcount   *table = NULL;
+    uint64_t  code  = 0;
+
+    table = kcount_new( KCOUNT_DENSE8, 1 << 20, FALSE );
+
+    assert( table->size == 1 << 20 );
+    assert( table->max  == 255 );
+    assert( kcount_mem( table ) > 1 << 20 );
+
+    kcount_destroy( &table );
+
+    assert( table == NULL );
+
+    table = kcount_new( KCOUNT_SPARSE, 0, FALSE );
+
+    assert( table->dense == NULL );
+    assert( kcount_mem( table ) < 1 << 21 );
+
+    /* 1 << 20 codes take 12 byte slots at a load of 37 to 75 percent. */
+
+    for ( code = 0; code < 1 << 20; code++ ) {
+        kcount_add( table, code * 0x9e3779b97f4a7c15ULL >> 2, 1 );
+    }
+
+    assert( kcount_mem( table ) >= 16 << 20 );
+    assert( kcount_mem( table ) <= 33 << 20 );
+
+    kcount_destroy( &table );
+
+    fprintf( stderr, "OK\n" );
+}
+
+
+void test_kcount_add()
+{
+    fprintf( stderr, "   Testing kcount_add ... " );
+
+    kcount   *table = NULL;
+    uint64_t  code  = 0;
+    int       l     = 0;
+
+    for ( l = 0; l < 4; l++ )
+    {
+        table = kcount_new( layouts[ l ], 1 << 16, FALSE );
+
+        for ( code = 0; code < 1 << 16; code += 7 ) {
+            kcount_add( table, code, code % 5 + 1 );
+        }
+
+        for ( code = 0; code < 1 << 16; code++ ) {
+            assert( kcount_get( table, code ) == ( ( code % 7 == 0 ) ? code % 5 + 1 : 0 ) );
+        }
+
+        kcount_destroy( &table );
+    }
+
+    /* Sparse tables take 64 bit codes. */
+
+    table = kcount_new( KCOUNT_SPARSE, 0, FALSE );
+
+    kcount_add( table, ~( uint64_t ) 0 >> 2, 3 );
+    kcount_add( table, 0, 1 );
+
+    assert( kcount_get( table, ~( uint64_t ) 0 >> 2 ) == 3 );
+    assert( kcount_get( table, 0 ) == 1 );
+    assert( kcount_get( table, 1 ) == 0 );
+
+    kcount_destroy( &table );
+
+    fprintf( stderr, "OK\n" );
+}
+
+
+void test_kcount_overflow()
+{
+    fprintf( stderr, "   Testing kcount overflow ... " );
+
+    kcount *table = NULL;
+    uint    i     = 0;
+
+    table = kcount_new( KCOUNT_DENSE8, 16, FALSE );
+
+    for ( i = 0; i < 1000; i++ ) {
+        kcount_add( table, 3, 1 );
+    }
+
+    kcount_add( table, 5, 254 );
+    kcount_add( table, 5, 10 );
+    kcount_add( table, 6, 255 );
+
+    assert( kcount_get( table, 3 ) == 1000 );
+    assert( kcount_get( table, 5 ) == 264 );
+    assert( kcount_get( table, 6 ) == 255 );
+
+    kcount_destroy( &table );
+
+    table = kcount_new( KCOUNT_DENSE16, 16, FALSE );
+
+    kcount_add( table, 1, 70000 );
+    kcount_add( table, 1, 1 );
+
+    assert( kcount_get( table, 1 ) == 70001 );
+
+    kcount_destroy( &table );
+
+    fprintf( stderr, "OK\n" );
+}
+
+
+void test_kcount_merge()
+{
+    fprintf( stderr, "   Testing kcount_merge ... " );
+
+    kcount   *dst  = NULL;
+    kcount   *src  = NULL;
+    uint64_t  code = 0;
+    int       l    = 0;
+
+    for ( l = 0; l < 4; l++ )
+    {
+        dst = kcount_new( layouts[ l ], 4096, FALSE );
+        src = kcount_new( layouts[ l ], 4096, FALSE );
+
+        for ( code = 0; code < 4096; code++ )
+        {
+            kcount_add( dst, code, 200 );
+            kcount_add( src, code, code % 3 == 0 ? 100 : 0 );
+        }
+
+        kcount_merge( dst, src );
+
+        for ( code = 0; code < 4096; code++ ) {
+            assert( kcount_get( dst, code ) == ( code % 3 == 0 ? 300 : 200 ) );
+        }
+
+        kcount_destroy( &dst );
+        kcount_destroy( &src );
+    }
+
+    fprintf( stderr, "OK\n" );
+}
+
+
+void test_kcount_threads()
+{
+    fprintf( stderr, "   Testing kcount threads ... " );
+
+    kcount    *table = NULL;
+    pthread_t  threads[ TEST_THREADS ];
+    uint64_t   code  = 0;
+    int        l     = 0;
+    int        i     = 0;
+
+    for ( l = 0; l < 4; l++ )
+    {
+        table = kcount_new( layouts[ l ], TEST_CODES, TRUE );
+
+        for ( i = 0; i < TEST_THREADS; i++ ) {
+            assert( pthread_create( &threads[ i ], NULL, test_kcount_worker, table ) == 0 );
+        }
+
+        for ( i = 0; i < TEST_THREADS; i++ ) {
+            pthread_join( threads[ i ], NULL );
+        }
+
+        for ( code = 0; code < TEST_CODES; code++ ) {
+            assert( kcount_get( table, code ) == TEST_THREADS * TEST_ROUNDS );
+        }
+
+        kcount_destroy( &table );
+    }
+
+    fprintf( stderr, "OK\n" );
+}
+
+
+static void *test_kcount_worker( void *arg )
+{
+    /* All threads count the same codes past the saturation of DENSE8. */
+
+    kcount   *table = ( kcount * ) arg;
+    uint64_t  code  = 0;
+    int       r     = 0;
+
+    for ( r = 0; r < TEST_ROUNDS; r++ )
+    {
+        for ( code = 0; code < TEST_CODES; code++ ) {
+            kcount_add( table, code, 1 );
+        }
+    }
+
+    return NULL;
+}
+
+
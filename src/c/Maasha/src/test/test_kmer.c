@@ -0,0 +1,148 @@
+/* Martin Asser Hansen (mail@maasha.dk) Copyright (C) 2008 - All right reserved */
+
+#include "common.h"
+#include "mem.h"
+#include "seq.h"
+#include "kmer.h"
+
+static void test_kmer_encode();
+static void test_kmer_iter_next();
+static void test_kmer_index_new();
+
+
+int main()
+{
+    fprintf( stderr, "Running all tests for kmer.c\n" );
+
+    test_kmer_encode();
+    test_kmer_iter_next();
+    test_kmer_index_new();
+
+    fprintf( stderr, "Done\n\n" );
+
+    return EXIT_SUCCESS;
+}
+
+
+void test_kmer_encode()
+{
+    fprintf( stderr, "   Testing kmer_encode ... " );
+
+    uint64_t kmer = 0;
+
+    assert( kmer_encode( "ATCGatcgu", 9, &kmer ) );
+    assert( kmer == ( uint64_t ) oligo2bin( "ATCGatcgu" ) );
+
+    assert( kmer_encode( "GGGGGGGGGGGGGGGGGGGGGGGGGGGGGGGG", 32, &kmer ) );
+    assert( kmer == ~( uint64_t ) 0 );
+
+    assert( ! kmer_encode( "ATNG", 4, &kmer ) );
+
+    fprintf( stderr, "OK\n" );
+}
+
+
+void test_kmer_iter_next()
+{
+    fprintf( stderr, "   Testing kmer_iter_next ... " );
+
+    char      *seq  = "ACGTNACGTACG";
+    kmer_iter  iter;
+    uint64_t   kmer = 0;
+    uint64_t   code = 0;
+    size_t     pos  = 0;
+    size_t     poss[] = { 0, 5, 6, 7, 8 };
+    size_t     i    = 0;
+
+    kmer_iter_init( &iter, seq, 0, strlen( seq ), 4 );
+
+    while ( kmer_iter_next( &iter, &kmer, &pos ) )
+    {
+        assert( pos == poss[ i ] );
+        assert( kmer_encode( &seq[ pos ], 4, &code ) );
+        assert( kmer == code );
+
+        i++;
+    }
+
+    assert( i == 5 );
+
+    kmer_iter_init( &iter, seq, 1, 4, 4 );
+
+    assert( ! kmer_iter_next( &iter, &kmer, &pos ) );
+
+    fprintf( stderr, "OK\n" );
+}
+
+
+void test_kmer_index_new()
+{
+    fprintf( stderr, "   Testing kmer_index_new ... " );
+
+    char       *seq      = NULL;
+    kmer_index *index    = NULL;
+    uint       *postings = NULL;
+    uint64_t    kmer     = 0;
+    size_t      len      = 20000;
+    size_t      count    = 0;
+    size_t      total    = 0;
+    size_t      pos      = 0;
+    size_t      i        = 0;
+    size_t      j        = 0;
+    uint        ks[]     = { 1, 4, KMER_DIRECT_MAX, KMER_DIRECT_MAX + 1, 20, KMER_MAX };
+    uint        k        = 0;
+
+    seq = mem_get( len + 1 );
+
+    for ( i = 0; i < len; i++ ) {
+        seq[ i ] = "ACGTN"[ ( i * 2654435761U >> 7 ) % ( ( i % 1000 == 0 ) ? 5 : 4 ) ];
+    }
+
+    seq[ len ] = '\0';
+
+    for ( j = 0; j < sizeof( ks ) / sizeof( ks[ 0 ] ); j++ )
+    {
+        k     = ks[ j ];
+        index = kmer_index_new( seq, 10, len - 10, k );
+        total = 0;
+
+        assert( ( index->kmers == NULL ) == ( k <= KMER_DIRECT_MAX ) );
+
+        for ( pos = 10; pos + k <= len - 10; pos++ )
+        {
+            if ( ! kmer_encode( &seq[ pos ], k, &kmer ) ) {
+                continue;
+            }
+
+            postings = kmer_index_get( index, kmer, &count );
+
+            assert( postings != NULL );
+
+            /* Postings are ascending and include pos. */
+            for ( i = 0; i < count && postings[ i ] != pos; i++ ) {
+                assert( i == 0 || postings[ i - 1 ] < postings[ i ] );
+            }
+
+            assert( i < count );
+
+            total++;
+        }
+
+        assert( total == index->count );
+
+        if ( k > 8 )
+        {
+            assert( kmer_encode( "GGGGGGGGGGGGGGGGGGGGGGGGGGGGGGGG", k, &kmer ) );
+            assert( kmer_index_get( index, kmer, &count ) == NULL );
+            assert( count == 0 );
+        }
+
+        kmer_index_destroy( &index );
+
+        assert( index == NULL );
+    }
+
+    mem_free( &seq );
+
+    fprintf( stderr, "OK\n" );
+}
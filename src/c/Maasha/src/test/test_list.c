@@ -13,6 +13,7 @@ static void test_list_sl_remove_beg();
 static void test_list_sl_remove_after();
 static void test_list_sl_print();
 static void test_list_sl_sort();
+static void test_list_sl_sort_radix();
 static void test_list_sl_destroy();
 static void test_node_sl_destroy();
 
@@ -29,6 +30,8 @@ static void test_node_dl_destroy();
 
 static void test_list_count();
 
+static uint64_t test_list_key( const void *val, void *data );
+
 
 int main()
 {
@@ -42,6 +45,7 @@ int main()
     test_list_sl_remove_after();
     test_list_sl_print();
     test_list_sl_sort();
+    test_list_sl_sort_radix();
     test_list_sl_destroy();
     test_node_sl_destroy();
 
@@ -338,6 +342,43 @@ void test_list_sl_sort()
 }
 
 
+void test_list_sl_sort_radix()
+{
+    fprintf( stderr, "   Testing list_sl_sort_radix ... " );
+
+    char    *array[ 5 ] = { "b2", "a1", "c3", "a2", "b1" };
+    char    *sorted[ 5 ] = { "a1", "a2", "b1", "b2", "c3" };
+    list_sl *list       = NULL;
+    node_sl *node       = NULL;
+    int      i          = 0;
+
+    list = list_sl_new();
+
+    list_sl_sort_radix( &list, test_list_key, NULL );
+
+    assert( list->first == NULL );
+
+    for ( i = 4; i >= 0; i-- )
+    {
+        node = node_sl_new();
+
+        node->val = array[ i ];
+
+        list_sl_add_beg( &list, &node );
+    }
+
+    list_sl_sort_radix( &list, test_list_key, NULL );
+
+    for ( i = 0, node = list->first; node != NULL; i++, node = node->next ) {
+        assert( strcmp( ( char * ) node->val, sorted[ i ] ) == 0 );
+    }
+
+    assert( i == 5 );
+
+    fprintf( stderr, "OK\n" );
+}
+
+
 void test_list_sl_destroy()
 {
     fprintf( stderr, "   Testing list_sl_destroy ... " );
@@ -707,3 +748,11 @@ void test_list_count()
 /* >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>><<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<< */
 
 
+static uint64_t test_list_key( const void *val, void *data )
+{
+    /* Returns the first two chars of a string packed as a key. */
+
+    char *str = ( char * ) val;
+
+    return ( ( uint64_t ) ( uchar ) str[ 0 ] << 8 ) | ( uchar ) str[ 1 ];
+}
@@ -4,6 +4,9 @@
 
 static void test_seq_new();
 static void test_seq_uppercase();
+static void test_seq_resize();
+static void test_seq_name_resize();
+static void test_seq_reset();
 static void test_seq_destroy();
 
 
@@ -13,6 +16,9 @@ int main()
 
     test_seq_new();
     test_seq_uppercase();
+    test_seq_resize();
+    test_seq_name_resize();
+    test_seq_reset();
     test_seq_destroy();
 
     fprintf( stderr, "Done\n\n" );
@@ -34,6 +40,8 @@ void test_seq_new()
     assert( entry->seq_name != NULL );
     assert( entry->seq      != NULL );
     assert( entry->seq_len  == 0 );
+    assert( entry->seq_name_size == max_seq_name );
+    assert( entry->seq_size      == max_seq );
 
     seq_destroy( entry );
 
@@ -55,6 +63,92 @@ void test_seq_uppercase()
 }
 
 
+void test_seq_resize()
+{
+    fprintf( stderr, "   Testing seq_resize ... " );
+
+    seq_entry *entry = NULL;
+    size_t     i     = 0;
+
+    entry = seq_new( 4, 4 );
+
+    seq_resize( entry, 3 );
+
+    assert( entry->seq_size == 4 );
+
+    seq_resize( entry, 4 );
+
+    assert( entry->seq_size == 8 );
+
+    seq_resize( entry, 100 );
+
+    assert( entry->seq_size == 128 );
+
+    for ( i = 0; i < 100; i++ ) {
+        entry->seq[ i ] = 'A';
+    }
+
+    entry->seq[ i ] = '\0';
+
+    assert( strlen( entry->seq ) == 100 );
+
+    seq_destroy( entry );
+
+    fprintf( stderr, "OK\n" );
+}
+
+
+void test_seq_name_resize()
+{
+    fprintf( stderr, "   Testing seq_name_resize ... " );
+
+    seq_entry *entry = NULL;
+
+    entry = seq_new( 4, 4 );
+
+    seq_name_resize( entry, 2 );
+
+    assert( entry->seq_name_size == 4 );
+
+    seq_name_resize( entry, 1000 );
+
+    assert( entry->seq_name_size == 1024 );
+    assert( entry->seq_size      == 4 );
+
+    seq_destroy( entry );
+
+    fprintf( stderr, "OK\n" );
+}
+
+
+void test_seq_reset()
+{
+    fprintf( stderr, "   Testing seq_reset ... " );
+
+    seq_entry *entry = NULL;
+
+    entry = seq_new( 4, 4 );
+
+    seq_resize( entry, 10 );
+
+    strcpy( entry->seq_name, "foo" );
+    strcpy( entry->seq, "ATCGATCG" );
+
+    entry->seq_len = 8;
+
+    seq_reset( entry );
+
+    assert( entry->seq_len == 0 );
+    assert( entry->seq[ 0 ] == '\0' );
+    assert( entry->seq_name[ 0 ] == '\0' );
+    assert( entry->seq_size == 16 );
+
+    seq_destroy( entry );
+
+    fprintf( stderr, "OK\n" );
+}
+
+
 void test_seq_destroy()
 {
     fprintf( stderr, "   Testing seq_destroy ... " );
@@ -0,0 +1,111 @@
+/* Martin Asser Hansen (mail@maasha.dk) Copyright (C) 2008 - All right reserved */
+
+#include "common.h"
+#include "mem.h"
+#include "sort.h"
+
+static void test_sort_radix_items();
+static void test_sort_radix();
+
+static uint64_t test_key( const void *elem, void *data );
+
+
+int main()
+{
+    fprintf( stderr, "Running all tests for sort.c\n" );
+
+    test_sort_radix_items();
+    test_sort_radix();
+
+    fprintf( stderr, "Done\n\n" );
+
+    return EXIT_SUCCESS;
+}
+
+
+void test_sort_radix_items()
+{
+    fprintf( stderr, "   Testing sort_radix_items ... " );
+
+    sort_item *items     = NULL;
+    size_t     counts[]  = { 0, 1, 2, 1000, SORT_PARALLEL_MIN * 3 + 7 };
+    int        threads[] = { 1, 4 };
+    uint64_t   key       = 0;
+    size_t     count     = 0;
+    size_t     i         = 0;
+    size_t     j         = 0;
+    size_t     t         = 0;
+
+    for ( j = 0; j < sizeof( counts ) / sizeof( counts[ 0 ] ); j++ )
+    {
+        for ( t = 0; t < sizeof( threads ) / sizeof( threads[ 0 ] ); t++ )
+        {
+            count = counts[ j ];
+            items = mem_get( ( count + 1 ) * sizeof( sort_item ) );
+
+            /* Few distinct keys spread over high and low bits to test stability. */
+            for ( i = 0; i < count; i++ )
+            {
+                key = ( i * 2654435761U ) % 97;
+
+                items[ i ].key   = ( key << 40 ) | ( key & 3 );
+                items[ i ].index = i;
+            }
+
+            sort_radix_items( items, count, threads[ t ] );
+
+            for ( i = 1; i < count; i++ )
+            {
+                assert( items[ i - 1 ].key <= items[ i ].key );
+
+                if ( items[ i - 1 ].key == items[ i ].key ) {
+                    assert( items[ i - 1 ].index < items[ i ].index );
+                }
+            }
+
+            mem_free( &items );
+        }
+    }
+
+    fprintf( stderr, "OK\n" );
+}
+
+
+void test_sort_radix()
+{
+    fprintf( stderr, "   Testing sort_radix ... " );
+
+    uint   array[ 1000 ];
+    uint   shift = 0;
+    size_t i     = 0;
+
+    for ( i = 0; i < 1000; i++ ) {
+        array[ i ] = ( ( ( i * 2654435761U ) % 97 ) << 16 ) | i;
+    }
+
+    /* Sort on the high bits only - equal keys keep their order. */
+    shift = 16;
+
+    sort_radix( array, 1000, sizeof( uint ), test_key, &shift, 1 );
+
+    for ( i = 1; i < 1000; i++ )
+    {
+        assert( ( array[ i - 1 ] >> 16 ) <= ( array[ i ] >> 16 ) );
+
+        if ( ( array[ i - 1 ] >> 16 ) == ( array[ i ] >> 16 ) ) {
+            assert( ( array[ i - 1 ] & 0xffff ) < ( array[ i ] & 0xffff ) );
+        }
+    }
+
+    sort_radix( array, 0, sizeof( uint ), test_key, &shift, 1 );
+
+    fprintf( stderr, "OK\n" );
+}
+
+
+static uint64_t test_key( const void *elem, void *data )
+{
+    /* Returns the key of a uint shifted by the number of bits in data. */
+
+    return *( ( uint * ) elem ) >> *( ( uint * ) data );
+}
@@ -1,3 +1,6 @@
+#include <limits.h>
+#include <signal.h>
+#include <sys/wait.h>
 #include "common.h"
 #include "filesys.h"
 #include "list.h"
@@ -5,9 +8,13 @@
 
 static void test_bed_entry_new();
 static void test_bed_entry_get();
+static void test_bed_entry_get_range();
+static bool bed_line_aborts( char *line );
 static void test_bed_entries_get();
 static void test_bed_entries_destroy();
 static void test_bed_entries_sort();
+static void test_bed_table_get();
+static void test_bed_table_sort();
 static void test_bed_file_sort_beg();
 static void test_bed_file_sort_strand_beg();
 static void test_bed_file_sort_chr_beg();
@@ -20,9 +27,12 @@ int main()
 
     test_bed_entry_new();
     test_bed_entry_get();
+    test_bed_entry_get_range();
     test_bed_entries_get();
     test_bed_entries_destroy();
     test_bed_entries_sort();
+    test_bed_table_get();
+    test_bed_table_sort();
     test_bed_file_sort_beg();
     test_bed_file_sort_strand_beg();
     test_bed_file_sort_chr_beg();
@@ -54,25 +64,177 @@ void test_bed_entry_get()
 {
     fprintf( stderr, "   Testing bed_entry_get ... " );
 
-    char      *path  = "test/test_files/test12.bed";
-    FILE      *fp    = NULL;
-    bed_entry *entry = NULL;
+    char        *path   = "test/test_files/test12.bed";
+    char        *file   = "/tmp/test_bed_entry_get.bed";
+    file_buffer *buffer = NULL;
+    bed_entry   *entry  = NULL;
+    FILE        *fp     = NULL;
+    size_t       count  = 0;
 
-    fp = read_open( path );
+    buffer_new( path, &buffer, 0 );
 
     entry = bed_entry_new( 12 );
 
-    while ( ( bed_entry_get( fp, &entry ) ) )
+    while ( ( bed_entry_get( buffer, &entry ) ) )
     {
-//        bed_entry_put( entry, 3 );
+        assert( entry->cols == 12 );
+
+        count++;
     }
 
+    assert( count > 0 );
+
+    buffer_destroy( &buffer );
+    bed_entry_destroy( entry );
+
+    /* Mixed column counts, long names and skipped lines. */
+    fp = write_open( file );
+
+    fprintf( fp, "track name=test\n" );
+    fprintf( fp, "# comment\n" );
+    fprintf( fp, "chrUn_gl000220_random_very_long_scaffold_name\t10\t4294967295\n" );
+    fprintf( fp, "\n" );
+    fprintf( fp, "chr1\t0\t100\tq1\t-5\t-\r\n" );
+    fprintf( fp, "chr2\t1\t2\tq2\t0\t+\t1\t2\t255,0,0" );
+
+    close_stream( fp );
+
+    entry = bed_entry_new( 0 );
+
+    buffer_new( file, &buffer, 1 );
+
+    assert( bed_entry_get( buffer, &entry ) );
+    assert( entry->cols == 3 );
+    assert( strcmp( entry->chr, "chrUn_gl000220_random_very_long_scaffold_name" ) == 0 );
+    assert( entry->chr_beg == 10 );
+    assert( entry->chr_end == 4294967295U );
+
+    assert( bed_entry_get( buffer, &entry ) );
+    assert( entry->cols == 6 );
+    assert( strcmp( entry->chr, "chr1" ) == 0 );
+    assert( strcmp( entry->q_id, "q1" ) == 0 );
+    assert( entry->score  == -5 );
+    assert( entry->strand == '-' );
+
+    assert( bed_entry_get( buffer, &entry ) );
+    assert( entry->cols == 9 );
+    assert( entry->thick_end == 2 );
+    assert( strcmp( entry->itemrgb, "255,0,0" ) == 0 );
+
+    assert( ! bed_entry_get( buffer, &entry ) );
+
+    buffer_destroy( &buffer );
+    bed_entry_destroy( entry );
+
+    /* Parsing is limited to max_cols. */
+    entry = bed_entry_new( 4 );
+
+    buffer_new( file, &buffer, 0 );
+
+    assert( bed_entry_get( buffer, &entry ) );
+    assert( entry->cols == 3 );
+    assert( bed_entry_get( buffer, &entry ) );
+    assert( entry->cols == 4 );
+    assert( strcmp( entry->q_id, "q1" ) == 0 );
+
+    buffer_destroy( &buffer );
+    bed_entry_destroy( entry );
+
+    file_unlink( file );
+
+    fprintf( stderr, "OK\n" );
+}
+
+
+void test_bed_entry_get_range()
+{
+    fprintf( stderr, "   Testing bed_entry_get range ... " );
+
+    char        *file   = "/tmp/test_bed_entry_get_range.bed";
+    file_buffer *buffer = NULL;
+    bed_entry   *entry  = NULL;
+    FILE        *fp     = NULL;
+
+    /* Limits parse. */
+    fp = write_open( file );
+
+    fprintf( fp, "chr1\t0\t4294967295\tq1\t-2147483648\n" );
+    fprintf( fp, "chr1\t0\t1\tq1\t2147483647\n" );
+
     close_stream( fp );
 
+    entry = bed_entry_new( 0 );
+
+    buffer_new( file, &buffer, 1 );
+
+    assert( bed_entry_get( buffer, &entry ) );
+    assert( entry->chr_end == 4294967295U );
+    assert( entry->score   == INT_MIN );
+
+    assert( bed_entry_get( buffer, &entry ) );
+    assert( entry->score   == INT_MAX );
+
+    buffer_destroy( &buffer );
+    bed_entry_destroy( entry );
+
+    file_unlink( file );
+
+    /* Values out of range - also when the last digit overflows - abort. */
+    assert( ! bed_line_aborts( "chr1\t4294967295\t4294967295\n" ) );
+    assert( bed_line_aborts( "chr1\t4294967296\t4294967297\n" ) );
+    assert( bed_line_aborts( "chr1\t0\t42949672950\n" ) );
+    assert( bed_line_aborts( "chr1\t0\t99999999999999999999999\n" ) );
+    assert( bed_line_aborts( "chr1\t0\t1\tq1\t2147483648\n" ) );
+    assert( bed_line_aborts( "chr1\t0\t1\tq1\t-2147483649\n" ) );
+    assert( bed_line_aborts( "chr1\t0\t1\tq1\t-\n" ) );
+    assert( bed_line_aborts( "chr1\t-1\t1\n" ) );
+
     fprintf( stderr, "OK\n" );
 }
 
 
+static bool bed_line_aborts( char *line )
+{
+    /* Parse a BED line in a child process and return TRUE if it aborts. */
+
+    char        *file   = "/tmp/test_bed_line_aborts.bed";
+    file_buffer *buffer = NULL;
+    bed_entry   *entry  = NULL;
+    FILE        *fp     = NULL;
+    pid_t        pid    = 0;
+    int          status = 0;
+
+    fp = write_open( file );
+
+    fprintf( fp, "%s", line );
+
+    close_stream( fp );
+
+    fflush( stderr );
+
+    if ( ( pid = fork() ) == 0 )
+    {
+        fclose( stderr );
+
+        entry = bed_entry_new( 0 );
+
+        buffer_new( file, &buffer, 1 );
+
+        bed_entry_get( buffer, &entry );
+
+        exit( EXIT_SUCCESS );
+    }
+
+    assert( pid > 0 );
+
+    waitpid( pid, &status, 0 );
+
+    file_unlink( file );
+
+    return WIFSIGNALED( status ) && WTERMSIG( status ) == SIGABRT;
+}
+
+
 void test_bed_entries_get()
 {
     fprintf( stderr, "   Testing bed_entries_get ... " );
@@ -109,8 +271,13 @@ void test_bed_entries_sort()
 {
     fprintf( stderr, "   Testing bed_entries_sort ... " );
 
-    char    *path    = "test/test_files/test12.bed";
-    list_sl *entries = NULL;
+    char      *path     = "test/test_files/test12.bed";
+    list_sl   *entries  = NULL;
+    list_sl   *entries2 = NULL;
+    node_sl   *node     = NULL;
+    node_sl   *node2    = NULL;
+    bed_entry *entry    = NULL;
+    bed_entry *entry2   = NULL;
     
     entries = bed_entries_get( path, 0 );
 
@@ -119,6 +286,131 @@ void test_bed_entries_sort()
 
 //    bed_entries_put( entries, 0 );
 
+    entries2 = bed_entries_get( path, 0 );
+
+    bed_entries_sort( &entries2, BED_SORT_CHR_STRAND_BEG );
+
+    for ( node = entries->first, node2 = entries2->first; node != NULL; node = node->next, node2 = node2->next )
+    {
+        assert( node2 != NULL );
+
+        entry  = ( bed_entry * ) node->val;
+        entry2 = ( bed_entry * ) node2->val;
+
+        assert( strcmp( entry->chr, entry2->chr ) == 0 );
+        assert( entry->strand  == entry2->strand );
+        assert( entry->chr_beg == entry2->chr_beg );
+    }
+
+    assert( node2 == NULL );
+
+    bed_entries_sort( &entries2, BED_SORT_BEG );
+
+    for ( node2 = entries2->first; node2->next != NULL; node2 = node2->next ) {
+        assert( ( ( bed_entry * ) node2->val )->chr_beg <= ( ( bed_entry * ) node2->next->val )->chr_beg );
+    }
+
+    fprintf( stderr, "OK\n" );
+}
+
+
+void test_bed_table_get()
+{
+    fprintf( stderr, "   Testing bed_table_get ... " );
+
+    char      *path  = "test/test_files/test12.bed";
+    char      *q_id  = NULL;
+    bed_table *table = NULL;
+    char       chr[ 32 ];
+    size_t     i     = 0;
+
+    table = bed_table_get( path, 0 );
+
+    assert( table->count > 0 );
+    assert( strcmp( table->chrs[ table->chr_ids[ 0 ] ], "chr14" ) == 0 );
+    assert( table->chr_begs[ 0 ] == 31176 );
+    assert( table->chr_ends[ 0 ] == 31602 );
+    assert( table->strands[ 0 ]  == '-' );
+    assert( table->cols[ 0 ]     == 12 );
+
+    q_id = &table->arena[ table->names[ 1 ] ];
+
+    assert( strcmp( q_id, "AA699063" ) == 0 );
+    assert( strcmp( q_id + strlen( q_id ) + 1, "70946\t71196\t0\t2\t142,55,\t0,195," ) == 0 );
+
+    /* Chromosome names are interned. */
+    for ( i = 0; i < table->count; i++ ) {
+        assert( bed_table_chr_id( table, table->chrs[ table->chr_ids[ i ] ] ) == table->chr_ids[ i ] );
+    }
+
+    assert( table->chr_count < table->count );
+
+    bed_table_destroy( &table );
+
+    assert( table == NULL );
+
+    /* Growing the chromosome index. */
+    table = bed_table_new();
+
+    for ( i = 0; i < BED_TABLE * 4; i++ )
+    {
+        sprintf( chr, "scaffold_%zu", i );
+
+        assert( bed_table_chr_id( table, chr ) == i );
+    }
+
+    assert( bed_table_chr_id( table, "scaffold_1" ) == 1 );
+    assert( table->chr_count == BED_TABLE * 4 );
+
+    bed_table_destroy( &table );
+
+    fprintf( stderr, "OK\n" );
+}
+
+
+void test_bed_table_sort()
+{
+    fprintf( stderr, "   Testing bed_table_sort ... " );
+
+    char      *path  = "test/test_files/test12.bed";
+    bed_table *table = NULL;
+    char      *a     = NULL;
+    char      *b     = NULL;
+    size_t     count = 0;
+    size_t     i     = 0;
+
+    table = bed_table_get( path, 0 );
+    count = table->count;
+
+    bed_table_sort( table, BED_SORT_CHR_STRAND_BEG, 1 );
+
+    assert( table->count == count );
+
+    for ( i = 1; i < table->count; i++ )
+    {
+        a = table->chrs[ table->chr_ids[ i - 1 ] ];
+        b = table->chrs[ table->chr_ids[ i ] ];
+
+        assert( strcmp( a, b ) <= 0 );
+
+        if ( strcmp( a, b ) == 0 )
+        {
+            assert( table->strands[ i - 1 ] <= table->strands[ i ] );
+
+            if ( table->strands[ i - 1 ] == table->strands[ i ] ) {
+                assert( table->chr_begs[ i - 1 ] <= table->chr_begs[ i ] );
+            }
+        }
+    }
+
+    bed_table_sort( table, BED_SORT_BEG, 2 );
+
+    for ( i = 1; i < table->count; i++ ) {
+        assert( table->chr_begs[ i - 1 ] <= table->chr_begs[ i ] );
+    }
+
+    bed_table_destroy( &table );
+
     fprintf( stderr, "OK\n" );
 }
 
@@ -0,0 +1,349 @@
+/* Martin Asser Hansen (mail@maasha.dk) Copyright (C) 2008 - All right reserved */
+
+#include "common.h"
+#include "mem.h"
+#include "wig.h"
+
+#define TEST_FILE "/tmp/test_wig.bin"
+
+static void test_wig_format_uint();
+static void test_wig_format_double();
+static void test_wig_writer_fixedstep();
+static void test_wig_writer_bedgraph();
+static void test_wig_writer_varstep();
+static void test_wig_writer_long();
+static void test_wig_writer_binary();
+
+
+int main()
+{
+    fprintf( stderr, "Running all tests for wig.c\n" );
+
+    test_wig_format_uint();
+    test_wig_format_double();
+    test_wig_writer_fixedstep();
+    test_wig_writer_bedgraph();
+    test_wig_writer_varstep();
+    test_wig_writer_long();
+    test_wig_writer_binary();
+
+    fprintf( stderr, "Done\n\n" );
+
+    return EXIT_SUCCESS;
+}
+
+
+void test_wig_format_uint()
+{
+    fprintf( stderr, "   Testing wig_format_uint ... " );
+
+    char buf[ 32 ];
+
+    buf[ wig_format_uint( buf, 0 ) ] = '\0';
+    assert( strcmp( buf, "0" ) == 0 );
+
+    buf[ wig_format_uint( buf, 1234567890 ) ] = '\0';
+    assert( strcmp( buf, "1234567890" ) == 0 );
+
+    buf[ wig_format_uint( buf, ~( uint64_t ) 0 ) ] = '\0';
+    assert( strcmp( buf, "18446744073709551615" ) == 0 );
+
+    fprintf( stderr, "OK\n" );
+}
+
+
+void test_wig_format_double()
+{
+    fprintf( stderr, "   Testing wig_format_double ... " );
+
+    char   buf[ 512 ];
+    char   ref[ 512 ];
+    double value    = 0;
+    int    decimals = 0;
+    uint   i        = 0;
+
+    buf[ wig_format_double( buf, sizeof( buf ), 0.5, 6 ) ] = '\0';
+    assert( strcmp( buf, "0.500000" ) == 0 );
+
+    buf[ wig_format_double( buf, sizeof( buf ), 7, 0 ) ] = '\0';
+    assert( strcmp( buf, "7" ) == 0 );
+
+    buf[ wig_format_double( buf, sizeof( buf ), -7, 0 ) ] = '\0';
+    assert( strcmp( buf, "-7" ) == 0 );
+
+    buf[ wig_format_double( buf, sizeof( buf ), 1e12, 2 ) ] = '\0';
+    assert( strcmp( buf, "1000000000000.00" ) == 0 );
+
+    /* Ties and negative zero as printf. */
+
+    buf[ wig_format_double( buf, sizeof( buf ), 0.125, 2 ) ] = '\0';
+    assert( strcmp( buf, "0.12" ) == 0 );
+
+    buf[ wig_format_double( buf, sizeof( buf ), 2.5, 0 ) ] = '\0';
+    assert( strcmp( buf, "2" ) == 0 );
+
+    buf[ wig_format_double( buf, sizeof( buf ), -0.0, 2 ) ] = '\0';
+    assert( strcmp( buf, "-0.00" ) == 0 );
+
+    buf[ wig_format_double( buf, sizeof( buf ), -0.001, 2 ) ] = '\0';
+    assert( strcmp( buf, "-0.00" ) == 0 );
+
+    /* Long values need a large buffer - the length is returned as snprintf. */
+
+    assert( wig_format_double( buf, 16, 1e300, 6 ) == 308 );
+    assert( wig_format_double( buf, sizeof( buf ), 1e300, 6 ) == 308 );
+
+    for ( i = 2; i < 100000; i++ )
+    {
+        value = log10( i );
+
+        buf[ wig_format_double( buf, sizeof( buf ), value, 6 ) ] = '\0';
+
+        sprintf( ref, "%lf", value );
+
+        assert( strcmp( buf, ref ) == 0 );
+    }
+
+    srand( 42 );
+
+    for ( i = 0; i < 1000000; i++ )
+    {
+        value    = ( ( double ) rand() / RAND_MAX - 0.5 ) * pow( 10, rand() % 20 - 6 );
+        decimals = rand() % 11;
+
+        buf[ wig_format_double( buf, sizeof( buf ), value, decimals ) ] = '\0';
+
+        sprintf( ref, "%.*f", decimals, value );
+
+        assert( strcmp( buf, ref ) == 0 );
+    }
+
+    fprintf( stderr, "OK\n" );
+}
+
+
+void test_wig_writer_fixedstep()
+{
+    fprintf( stderr, "   Testing wig_writer fixedStep ... " );
+
+    wig_writer *writer = NULL;
+    FILE       *fp     = NULL;
+    char        buf[ 256 ];
+    size_t      len    = 0;
+
+    fp = tmpfile();
+
+    writer = wig_writer_new( fp, WIG_FIXEDSTEP, 0 );
+
+    wig_writer_put( writer, "chr1", 9, 2 );
+    wig_writer_put( writer, "chr1", 10, 3 );
+    wig_writer_put( writer, "chr1", 20, 4 );
+    wig_writer_put( writer, "chr2", 21, 5 );
+
+    wig_writer_destroy( &writer );
+
+    rewind( fp );
+
+    len = fread( buf, 1, sizeof( buf ) - 1, fp );
+    buf[ len ] = '\0';
+
+    assert( strcmp( buf,
+        "fixedStep chrom=chr1 start=10 step=1\n2\n3\n"
+        "fixedStep chrom=chr1 start=21 step=1\n4\n"
+        "fixedStep chrom=chr2 start=22 step=1\n5\n" ) == 0 );
+
+    fclose( fp );
+
+    fprintf( stderr, "OK\n" );
+}
+
+
+void test_wig_writer_bedgraph()
+{
+    fprintf( stderr, "   Testing wig_writer bedGraph ... " );
+
+    wig_writer *writer = NULL;
+    FILE       *fp     = NULL;
+    char        buf[ 256 ];
+    size_t      len    = 0;
+
+    fp = tmpfile();
+
+    writer = wig_writer_new( fp, WIG_BEDGRAPH, 0 );
+
+    wig_writer_put( writer, "chr1", 9, 2 );
+    wig_writer_put( writer, "chr1", 10, 2 );
+    wig_writer_put_span( writer, "chr1", 11, 15, 2 );
+    wig_writer_put( writer, "chr1", 15, 3 );
+    wig_writer_put( writer, "chr1", 20, 3 );
+    wig_writer_put( writer, "chr2", 21, -3 );
+
+    wig_writer_destroy( &writer );
+
+    rewind( fp );
+
+    len = fread( buf, 1, sizeof( buf ) - 1, fp );
+    buf[ len ] = '\0';
+
+    assert( strcmp( buf,
+        "chr1\t9\t15\t2\n"
+        "chr1\t15\t16\t3\n"
+        "chr1\t20\t21\t3\n"
+        "chr2\t21\t22\t-3\n" ) == 0 );
+
+    fclose( fp );
+
+    fprintf( stderr, "OK\n" );
+}
+
+
+void test_wig_writer_long()
+{
+    fprintf( stderr, "   Testing wig_writer long values ... " );
+
+    wig_writer *writer = NULL;
+    FILE       *fp     = NULL;
+    char        buf[ 512 ];
+    size_t      i      = 0;
+    size_t      count  = 0;
+
+    fp = tmpfile();
+
+    writer = wig_writer_new( fp, WIG_BEDGRAPH, 6 );
+
+    for ( i = 0; i < 10000; i++ ) {
+        wig_writer_put( writer, "chr1", 2 * i, ( i % 2 ) ? -1e300 : 1e300 );
+    }
+
+    wig_writer_destroy( &writer );
+
+    rewind( fp );
+
+    while ( fgets( buf, sizeof( buf ), fp ) != NULL )
+    {
+        assert( strlen( buf ) > 300 && buf[ strlen( buf ) - 1 ] == '\n' );
+
+        count++;
+    }
+
+    assert( count == 10000 );
+
+    fclose( fp );
+
+    fprintf( stderr, "OK\n" );
+}
+
+
+void test_wig_writer_varstep()
+{
+    fprintf( stderr, "   Testing wig_writer variableStep ... " );
+
+    wig_writer *writer = NULL;
+    FILE       *fp     = NULL;
+    char        buf[ 256 ];
+    size_t      len    = 0;
+
+    fp = tmpfile();
+
+    writer = wig_writer_new( fp, WIG_VARSTEP, 1 );
+
+    wig_writer_put_span( writer, "chr1", 0, 5, 0.5 );
+    wig_writer_put_span( writer, "chr1", 5, 10, 1 );
+    wig_writer_put_span( writer, "chr1", 20, 21, 1 );
+    wig_writer_put_span( writer, "chr2", 0, 1, 1 );
+
+    wig_writer_destroy( &writer );
+
+    rewind( fp );
+
+    len = fread( buf, 1, sizeof( buf ) - 1, fp );
+    buf[ len ] = '\0';
+
+    assert( strcmp( buf,
+        "variableStep chrom=chr1 span=5\n1 0.5\n6 1.0\n"
+        "variableStep chrom=chr1 span=1\n21 1.0\n"
+        "variableStep chrom=chr2 span=1\n1 1.0\n" ) == 0 );
+
+    fclose( fp );
+
+    fprintf( stderr, "OK\n" );
+}
+
+
+void test_wig_writer_binary()
+{
+    fprintf( stderr, "   Testing wig_writer binary ... " );
+
+    wig_writer *writer = NULL;
+    wig_reader *reader = NULL;
+    wig_zoom    zoom;
+    FILE       *fp     = NULL;
+    float       values[ 20000 ];
+    size_t      i      = 0;
+
+    fp = fopen( TEST_FILE, "w" );
+
+    writer = wig_writer_new( fp, WIG_BINARY, 0 );
+
+    for ( i = 100; i < 10100; i++ ) {
+        wig_writer_put( writer, "chr1", i, i % 7 );
+    }
+
+    for ( i = 12000; i < 12010; i++ ) {
+        wig_writer_put( writer, "chr1", i, 1.5 );
+    }
+
+    wig_writer_put( writer, "chr2", 5, 42 );
+
+    wig_writer_destroy( &writer );
+
+    fclose( fp );
+
+    reader = wig_reader_new( TEST_FILE );
+
+    assert( reader->chr_count == 2 );
+    assert( reader->block_count == 4 );
+
+    assert( wig_reader_values( reader, "chr1", 0, 20000, values ) == 10010 );
+
+    assert( isnan( values[ 99 ] ) );
+
+    for ( i = 100; i < 10100; i++ ) {
+        assert( values[ i ] == i % 7 );
+    }
+
+    assert( isnan( values[ 10100 ] ) );
+    assert( values[ 12009 ] == 1.5 );
+
+    assert( wig_reader_values( reader, "chr2", 0, 10, values ) == 1 );
+    assert( values[ 5 ] == 42 );
+
+    assert( wig_reader_values( reader, "chr3", 0, 10, values ) == 0 );
+
+    /* Zoom summaries. */
+
+    assert( wig_reader_summary( reader, 0, "chr1", 0, 256, &zoom ) );
+    assert( zoom.count == 156 );
+    assert( zoom.beg   == 0 );
+    assert( zoom.end   == 256 );
+
+    assert( wig_reader_summary( reader, 2, "chr1", 0, 100000, &zoom ) );
+    assert( zoom.count == 10010 );
+    assert( zoom.min   == 0 );
+    assert( zoom.max   == 6 );
+    assert( zoom.sum   == 30002 + 15 );
+
+    assert( wig_reader_summary( reader, 1, "chr2", 0, 10, &zoom ) );
+    assert( zoom.count == 1 );
+    assert( zoom.max   == 42 );
+
+    assert( ! wig_reader_summary( reader, 0, "chr1", 50000, 60000, &zoom ) );
+
+    wig_reader_destroy( &reader );
+
+    unlink( TEST_FILE );
+
+    fprintf( stderr, "OK\n" );
+}
+
+
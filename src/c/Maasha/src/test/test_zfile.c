@@ -0,0 +1,244 @@
+/* Martin Asser Hansen (mail@maasha.dk) Copyright (C) 2008 - All right reserved */
+
+#include <zlib.h>
+#include "common.h"
+#include "mem.h"
+#include "filesys.h"
+#include "zfile.h"
+
+#define TEST_FILE "test/test_files/test.fna"
+#define TEST_GZ   "/tmp/test_zfile.fna.gz"
+#define TEST_BGZF "/tmp/test_zfile.fna.bgz"
+#define TEST_SIZE 1000
+
+static void test_zfile_format();
+static void test_zfile_plain();
+static void test_zfile_gzip();
+static void test_zfile_bgzf();
+
+static size_t test_read_all( char *file, char **str_ppt );
+static void   test_bgzf_write( char *file, char *str, size_t len, size_t block_size );
+
+
+int main()
+{
+    fprintf( stderr, "Running all tests for zfile.c\n" );
+
+    test_zfile_format();
+    test_zfile_plain();
+    test_zfile_gzip();
+    test_zfile_bgzf();
+
+    fprintf( stderr, "Done\n\n" );
+
+    return EXIT_SUCCESS;
+}
+
+
+void test_zfile_format()
+{
+    fprintf( stderr, "   Testing zfile_format ... " );
+
+    uchar plain[] = ">seq1\nACGT";
+    uchar gzip[]  = { 0x1f, 0x8b, 0x08, 0x00, 0, 0, 0, 0, 0, 0xff };
+    uchar bgzf[]  = { 0x1f, 0x8b, 0x08, 0x04, 0, 0, 0, 0, 0, 0xff, 6, 0, 'B', 'C', 2, 0, 0x1b, 0 };
+    uchar zstd[]  = { 0x28, 0xb5, 0x2f, 0xfd, 0 };
+
+    assert( zfile_format( plain, sizeof( plain ) ) == ZFILE_PLAIN );
+    assert( zfile_format( gzip, sizeof( gzip ) )   == ZFILE_GZIP );
+    assert( zfile_format( bgzf, sizeof( bgzf ) )   == ZFILE_BGZF );
+    assert( zfile_format( bgzf, 10 )               == ZFILE_GZIP );
+    assert( zfile_format( zstd, sizeof( zstd ) )   == ZFILE_ZSTD );
+    assert( zfile_format( zstd, 1 )                == ZFILE_PLAIN );
+
+    fprintf( stderr, "OK\n" );
+}
+
+
+void test_zfile_plain()
+{
+    fprintf( stderr, "   Testing zfile_plain ... " );
+
+    char   *str = NULL;
+    FILE   *fp  = NULL;
+    char    c   = 0;
+    size_t  len = 0;
+
+    len = test_read_all( TEST_FILE, &str );
+
+    assert( len > 0 );
+
+    fp = read_open( TEST_FILE );
+
+    assert( fread( &c, 1, 1, fp ) == 1 );
+    assert( c == str[ 0 ] );
+
+    close_stream( fp );
+
+    mem_free( &str );
+
+    fprintf( stderr, "OK\n" );
+}
+
+
+void test_zfile_gzip()
+{
+    fprintf( stderr, "   Testing zfile_gzip ... " );
+
+    char   *str  = NULL;
+    char   *str2 = NULL;
+    gzFile  gz   = NULL;
+    size_t  len  = 0;
+    size_t  len2 = 0;
+
+    len = test_read_all( TEST_FILE, &str );
+
+    /* Two gzip members as with: cat a.gz b.gz > ab.gz */
+    gz = gzopen( TEST_GZ, "wb" );
+    gzwrite( gz, str, len / 2 );
+    gzclose( gz );
+
+    gz = gzopen( TEST_GZ, "ab" );
+    gzwrite( gz, &str[ len / 2 ], len - len / 2 );
+    gzclose( gz );
+
+    len2 = test_read_all( TEST_GZ, &str2 );
+
+    assert( len2 == len );
+    assert( memcmp( str, str2, len ) == 0 );
+
+    unlink( TEST_GZ );
+
+    mem_free( &str );
+    mem_free( &str2 );
+
+    fprintf( stderr, "OK\n" );
+}
+
+
+void test_zfile_bgzf()
+{
+    fprintf( stderr, "   Testing zfile_bgzf ... " );
+
+    char        *str    = NULL;
+    char        *str2   = NULL;
+    char        *line   = NULL;
+    file_buffer *buffer = NULL;
+    size_t       len    = 0;
+    size_t       len2   = 0;
+    size_t       i      = 0;
+    size_t       sizes[] = { 1, 7, 100, BGZF_BLOCK - 1024 };
+
+    len = test_read_all( TEST_FILE, &str );
+
+    for ( i = 0; i < sizeof( sizes ) / sizeof( sizes[ 0 ] ); i++ )
+    {
+        test_bgzf_write( TEST_BGZF, str, len, sizes[ i ] );
+
+        len2 = test_read_all( TEST_BGZF, &str2 );
+
+        assert( len2 == len );
+        assert( memcmp( str, str2, len ) == 0 );
+
+        mem_free( &str2 );
+    }
+
+    buffer_new( TEST_BGZF, &buffer, TEST_SIZE );
+
+    len2 = buffer_gets( buffer, &line );
+
+    assert( len2 == strchr( str, '\n' ) - str + 1 );
+    assert( strncmp( line, str, len2 ) == 0 );
+
+    buffer_destroy( &buffer );
+
+    unlink( TEST_BGZF );
+
+    mem_free( &str );
+
+    fprintf( stderr, "OK\n" );
+}
+
+
+static size_t test_read_all( char *file, char **str_ppt )
+{
+    /* Read all data from a file with read_open into a string. */
+
+    FILE   *fp   = NULL;
+    char   *str  = NULL;
+    size_t  len  = 0;
+    size_t  size = TEST_SIZE;
+
+    str = mem_get( size );
+    fp  = read_open( file );
+
+    while ( ( len += fread( &str[ len ], 1, size - len, fp ) ) == size )
+    {
+        size <<= 1;
+        str    = mem_resize( str, size );
+    }
+
+    close_stream( fp );
+
+    *str_ppt = str;
+
+    return len;
+}
+
+
+static void test_bgzf_write( char *file, char *str, size_t len, size_t block_size )
+{
+    /* Write a string as BGZF blocks of a given size followed by the EOF block. */
+
+    FILE     *fp     = NULL;
+    uchar     cdata[ BGZF_BLOCK ];
+    uchar     header[ 18 ] = { 0x1f, 0x8b, 0x08, 0x04, 0, 0, 0, 0, 0, 0xff, 6, 0, 'B', 'C', 2, 0, 0, 0 };
+    uchar     trailer[ 8 ];
+    uchar     eof[ 28 ] = { 0x1f, 0x8b, 0x08, 0x04, 0, 0, 0, 0, 0, 0xff, 6, 0, 'B', 'C', 2, 0, 0x1b, 0, 3, 0, 0, 0, 0, 0, 0, 0, 0, 0 };
+    z_stream  strm;
+    size_t    pos    = 0;
+    size_t    n      = 0;
+    size_t    bsize  = 0;
+    uint      crc    = 0;
+    int       i      = 0;
+
+    fp = write_open( file );
+
+    for ( pos = 0; pos < len; pos += n )
+    {
+        n = ( len - pos < block_size ) ? len - pos : block_size;
+
+        memset( &strm, 0, sizeof( strm ) );
+
+        assert( deflateInit2( &strm, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY ) == Z_OK );
+
+        strm.next_in   = ( uchar * ) &str[ pos ];
+        strm.avail_in  = n;
+        strm.next_out  = cdata;
+        strm.avail_out = sizeof( cdata );
+
+        assert( deflate( &strm, Z_FINISH ) == Z_STREAM_END );
+
+        bsize = strm.total_out + 18 + 8 - 1;
+        crc   = crc32( crc32( 0L, Z_NULL, 0 ), ( uchar * ) &str[ pos ], n );
+
+        header[ 16 ] = bsize & 0xff;
+        header[ 17 ] = bsize >> 8;
+
+        for ( i = 0; i < 4; i++ )
+        {
+            trailer[ i ]     = ( crc >> ( 8 * i ) ) & 0xff;
+            trailer[ i + 4 ] = ( n >> ( 8 * i ) ) & 0xff;
+        }
+
+        fwrite( header, 1, sizeof( header ), fp );
+        fwrite( cdata, 1, strm.total_out, fp );
+        fwrite( trailer, 1, sizeof( trailer ), fp );
+
+        deflateEnd( &strm );
+    }
+
+    fwrite( eof, 1, sizeof( eof ), fp );
+
+    close_stream( fp );
+}
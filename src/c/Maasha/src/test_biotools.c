@@ -1,129 +1,52 @@
 #include "common.h"
 #include "filesys.h"
-#include "hash.h"
-
-bool get_record( struct file_buffer *buffer, struct hash *record );
-void put_record( struct hash *record );
+#include "biopieces.h"
 
 int main( int argc, char *argv[] )
 {
-    int                 count;
-    char               *file;
-    struct file_buffer *buffer = NULL;
-    struct hash        *record = NULL;
-
-    file = argv[ 1 ];
+    /* Read Biopieces records from a file and write them to stdout. */
+    /* With -b the records are written in binary framing. */
 
-    buffer = read_open_buffer( file );
-
-    record = hash_new( 5 );
-
-    count = 0;
+    int          count;
+    char        *file;
+    file_buffer *buffer = NULL;
+    bp_record   *record = NULL;
+    bp_writer   *writer = NULL;
+    bool         binary = FALSE;
 
-    while ( ( get_record( buffer, record ) ) != FALSE )
+    if ( argc > 2 && strcmp( argv[ 1 ], "-b" ) == 0 )
     {
-        put_record( record );
-
-        count++;
+        binary = TRUE;
+        argv++;
     }
 
-    fprintf( stderr, "Count: %d\n", count );
-
-    hash_destroy( record );
-
-    buffer_destroy( buffer );
-
-    return 0;
-}
+    file = argv[ 1 ];
 
+    buffer_new( file, &buffer, 0 );
 
-bool get_record( struct file_buffer *buffer, struct hash *record )
-{
-    /* Martin A. Hansen, June 2008 */
+    record = bp_record_new();
+    writer = bp_writer_new( stdout );
 
-    /* Get next record from the stream. */
+    if ( binary ) {
+        bp_writer_binary( writer );
+    }
 
-    char *line = NULL;
-    char *val  = NULL;
-    char  key[ 256 ];
-    int   len;
-    int   i;
-    bool  key_ok;
+    count = 0;
 
-    while ( ( line = buffer_gets( buffer ) ) )
+    while ( bp_record_get( buffer, record ) )
     {
-        key_ok = FALSE;
-
-        //printf( "LINE->%s<-", line );
-
-        if ( strcmp( line, "---\n" ) == 0 )
-        {
-//            printf( "found\n" );
-            
-            return TRUE;
-        }
-        else
-        {
-            len = strlen( line );
-
-            i = 0;
-
-            while ( i < len )
-            {
-                if ( i < len - 1 && line[ i ] == ':' && line[ i + 1 ] == ' ' )
-                {
-                    key_ok = TRUE;
+        bp_record_put( writer, record );
 
-                    key[ i ] = '\0';
-
-                    i += 2;
-
-                    break;
-                }
-
-                key[ i ] = line[ i ];
-            
-                i++;
-            }
-
-            if ( ! key_ok ) {
-                die( "Could not locate key." );
-            }
-
-            val = mem_get( len - i );
-
-            memcpy( val, &line[ i ], len - i - 1 );
-
-            val[ len - i ] = '\0';
-
-//            printf( "key: ->%s<- val: ->%s<-\n", key, val );
-
-            hash_add( record, key, val );
-        }
+        count++;
     }
 
-    return FALSE;
-}
+    bp_writer_destroy( &writer );
 
+    fprintf( stderr, "Count: %d\n", count );
 
-void put_record( struct hash *record )
-{
-    /* Martin A. Hansen, June 2008 */
-
-    /* Output a record to the stream. */
-
-    int              i;
-    struct hash_elem *bucket;
+    bp_record_destroy( &record );
 
-    for ( i = 0; i < record->table_size; i++ )
-    {
-        for ( bucket = record->table[ i ]; bucket != NULL; bucket = bucket->next ) {
-            printf( "%s: %s\n", ( char * ) bucket->key, ( char * ) bucket->val );
-        }
-    }
+    buffer_destroy( &buffer );
 
-    printf( "---\n" );
+    return 0;
 }
-
-
-
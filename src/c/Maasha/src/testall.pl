@@ -9,14 +9,22 @@ $test_dir = "test";
 
 @tests = qw(
     test_barray
+    test_biopieces
+    test_chash
     test_common
     test_fasta
     test_filesys
+    test_hash
+    test_kcount
+    test_kmer
     test_list
     test_mem
     test_seq
+    test_sort
     test_strings
     test_ucsc
+    test_wig
+    test_zfile
 );
 
 print STDERR "\nRunning all unit tests:\n\n";